@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct BenchResult {
+  std::string name;
+  double ns_per_iter;
+  double items_per_iter;
+  std::string unit;
+};
+
+// A derived figure reported next to the timings, e.g. a compression ratio
+struct BenchMetric {
+  std::string name;
+  double value;
+  std::string unit;
+};
+
+// Collects results from the benchmark modules; the filter is a substring
+// matched against benchmark names.
+class BenchReporter {
+  public:
+    explicit BenchReporter(const std::string& filter = std::string()) : filter_(filter) {}
+
+    bool enabled(const std::string& name) const {
+      return filter_.empty() || name.find(filter_) != std::string::npos;
+    }
+
+    void add(const std::string& name, double ns_per_iter, double items_per_iter, const std::string& unit = "samples") {
+      results_.push_back({name, ns_per_iter, items_per_iter, unit});
+      char line[200];
+      snprintf(line, sizeof(line), "%-48s %12.1f ns/iter %10.3f ns/%s %10.1f M%s/s\n",
+               name.c_str(), ns_per_iter, ns_per_iter / items_per_iter, singular(unit).c_str(),
+               items_per_iter * 1e3 / ns_per_iter, unit.c_str());
+      fputs(line, stdout);
+      fflush(stdout);
+    }
+
+    void addMetric(const std::string& name, double value, const std::string& unit) {
+      metrics_.push_back({name, value, unit});
+      char line[200];
+      snprintf(line, sizeof(line), "%-48s %12.2f %s\n", name.c_str(), value, unit.c_str());
+      fputs(line, stdout);
+      fflush(stdout);
+    }
+
+    const std::vector<BenchResult>& results() const { return results_; }
+    const std::vector<BenchMetric>& metrics() const { return metrics_; }
+
+  private:
+    std::string filter_;
+    std::vector<BenchResult> results_;
+    std::vector<BenchMetric> metrics_;
+
+    static std::string singular(const std::string& unit) {
+      return !unit.empty() && unit.back() == 's' ? unit.substr(0, unit.size() - 1) : unit;
+    }
+};
+
+// Results files: JSON with the active kernel set, every timing and every
+// metric. Compare flags timings that grew by more than threshold_percent
+// and returns false if any did.
+bool writeBenchJson(const std::string& path, const std::string& isa, const BenchReporter& reporter);
+bool readBenchJson(const std::string& path, std::vector<BenchResult>& results);
+bool compareBenchResults(const std::vector<BenchResult>& base, const std::vector<BenchResult>& current,
+                         double threshold_percent, std::ostream& out);
+
+// Keeps the optimiser from discarding a benchmarked result
+template <typename T>
+inline void benchKeep(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "g"(&value) : "memory");
+#else
+  static volatile T sink;
+  sink = value;
+  (void) sink;
+#endif
+}
+
+// Best-of-five average time of one call to fn, in nanoseconds. Each round
+// runs for at least min_seconds / 5.
+template <typename F>
+double benchTimeNs(F&& fn, double min_seconds = 0.2) {
+  using clock = std::chrono::steady_clock;
+  for (int i = 0; i < 3; ++i) fn();
+
+  double best = 1e300;
+  const double round_ns = min_seconds * 1e9 / 5.0;
+  for (int round = 0; round < 5; ++round) {
+    size_t iters = 0;
+    auto start = clock::now();
+    double elapsed = 0.0;
+    do {
+      for (int k = 0; k < 16; ++k) fn();
+      iters += 16;
+      elapsed = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    } while (elapsed < round_ns);
+    best = std::min(best, elapsed / iters);
+  }
+  return best;
+}
@@ -0,0 +1,64 @@
+#include "BenchHarness.h"
+#include "AudioBuffer.h"
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t CAPACITY = 8192;
+
+// Best of three runs of writers pushing chunks through one buffer to a
+// single reader, in nanoseconds per chunk read. The capacity is a multiple
+// of the chunk, so every write and read moves a whole chunk.
+double contendedNsPerChunk(size_t writers, size_t chunk, size_t chunks_per_writer) {
+  using clock = std::chrono::steady_clock;
+  double best = 1e300;
+  for (int round = 0; round < 3; ++round) {
+    AudioBuffer buffer(CAPACITY);
+    const auto start = clock::now();
+    std::vector<std::thread> threads;
+    for (size_t w = 0; w < writers; ++w) {
+      threads.emplace_back([&buffer, chunk, chunks_per_writer] {
+        std::vector<float> data(chunk, 0.25f);
+        for (size_t i = 0; i < chunks_per_writer; ++i) buffer.write(data.data(), chunk);
+      });
+    }
+    std::vector<float> out(chunk);
+    const size_t total = writers * chunks_per_writer;
+    for (size_t i = 0; i < total; ++i) buffer.read(out.data(), chunk);
+    for (auto& thread : threads) thread.join();
+    const double elapsed = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    best = std::min(best, elapsed / total);
+  }
+  return best;
+}
+
+} // namespace
+
+// AudioBuffer is the hand-off between the network and playback threads
+void runBufferBenchmarks(BenchReporter& reporter) {
+  const size_t chunks[] = {64, 256, 1024, 4096};
+
+  for (size_t chunk : chunks) {
+    const std::string name = "buffer/write_read/" + std::to_string(chunk);
+    if (!reporter.enabled(name)) continue;
+    AudioBuffer buffer(CAPACITY);
+    std::vector<float> in(chunk, 0.5f), out(chunk);
+    reporter.add(name, benchTimeNs([&] {
+      buffer.write(in.data(), chunk);
+      buffer.read(out.data(), chunk);
+    }), static_cast<double>(chunk));
+  }
+
+  const size_t writer_counts[] = {1, 2, 4};
+  for (size_t writers : writer_counts) {
+    for (size_t chunk : {size_t(256), size_t(1024)}) {
+      const std::string name = "buffer/contended/" + std::to_string(writers) + "w/" + std::to_string(chunk);
+      if (!reporter.enabled(name)) continue;
+      // About the same amount of audio whatever the split
+      const size_t chunks_per_writer = (1u << 22) / chunk / writers;
+      reporter.add(name, contendedNsPerChunk(writers, chunk, chunks_per_writer), static_cast<double>(chunk));
+    }
+  }
+}
@@ -0,0 +1,113 @@
+#include "BenchHarness.h"
+#include "AudioCodec.h"
+#include "OpusCodec.h"
+#include <cmath>
+#include <vector>
+
+namespace {
+
+constexpr double SAMPLE_RATE = 48000.0;
+
+// A few decaying harmonics over a -70 dB noise floor, closer to an
+// instrument than a pure tone
+std::vector<float> testSignal(size_t n) {
+  std::vector<float> signal(n);
+  uint32_t seed = 12345;
+  for (size_t i = 0; i < n; ++i) {
+    const double t = i / SAMPLE_RATE;
+    double x = 0.0;
+    for (int h = 1; h <= 6; ++h) x += 0.3 / h * std::sin(2.0 * 3.14159265358979 * 220.0 * h * t + h);
+    seed = seed * 1664525u + 1013904223u;
+    x += 3e-4 * (static_cast<double>(seed >> 8) / (1 << 24) - 0.5);
+    signal[i] = static_cast<float>(x * std::exp(-0.5 * t));
+  }
+  return signal;
+}
+
+} // namespace
+
+// Full frame encode/decode through the codec layer with the active kernels
+void runCodecBenchmarks(BenchReporter& reporter) {
+  const AudioCodec codecs[] = {
+    AudioCodec::FLOAT32, AudioCodec::PCM16, AudioCodec::ULAW,
+    AudioCodec::ALAW, AudioCodec::ADPCM, AudioCodec::LOSSLESS, AudioCodec::FLOAT16
+  };
+  const size_t n = 256;
+  const size_t frames = 64;
+
+  const std::vector<float> signal = testSignal(n * frames);
+  std::vector<float> out(n);
+
+  for (AudioCodec codec : codecs) {
+    const std::string prefix = std::string("codecs/") + codecName(codec) + "/";
+    const std::string encode = prefix + "encode/" + std::to_string(n);
+    const std::string decode = prefix + "decode/" + std::to_string(n);
+    if (!reporter.enabled(encode) && !reporter.enabled(decode)) continue;
+
+    std::vector<std::vector<uint8_t>> encoded(frames);
+    CodecState state;
+    size_t total = 0;
+    for (size_t f = 0; f < frames; ++f) {
+      encoded[f].resize(maxEncodedBytes(codec, n));
+      encoded[f].resize(encodeAudio(codec, signal.data() + f * n, n, encoded[f].data(), state));
+      total += encoded[f].size();
+    }
+
+    size_t frame = 0;
+    if (reporter.enabled(encode)) {
+      std::vector<uint8_t> scratch(maxEncodedBytes(codec, n));
+      const double ns = benchTimeNs([&] {
+        benchKeep(encodeAudio(codec, signal.data() + frame * n, n, scratch.data(), state));
+        frame = (frame + 1) % frames;
+      });
+      reporter.add(encode, ns, static_cast<double>(n));
+      reporter.addMetric(prefix + "encode_realtime", n / SAMPLE_RATE * 1e9 / ns, "x real time at 48 kHz");
+    }
+    if (reporter.enabled(decode)) {
+      reporter.add(decode, benchTimeNs([&] {
+        benchKeep(decodeAudio(codec, encoded[frame].data(), encoded[frame].size(), n, out.data()));
+        frame = (frame + 1) % frames;
+      }), static_cast<double>(n));
+    }
+    reporter.addMetric(prefix + "bits_per_sample", 8.0 * total / (n * frames), "bits/sample");
+  }
+
+  // Opus is stateful and frames are 20 ms; only in builds with libopus
+  OpusSettings settings;
+  OpusFrameEncoder encoder;
+  OpusFrameDecoder decoder;
+  if (!opusAvailable() || !encoder.configure(static_cast<int>(SAMPLE_RATE), settings) ||
+      !decoder.configure(static_cast<int>(SAMPLE_RATE))) return;
+  const size_t opus_n = encoder.frameSamples();
+  const std::string opus_encode = "codecs/opus/encode/" + std::to_string(opus_n);
+  const std::string opus_decode = "codecs/opus/decode/" + std::to_string(opus_n);
+  if (!reporter.enabled(opus_encode) && !reporter.enabled(opus_decode)) return;
+  const size_t opus_frames = 16;
+  const std::vector<float> opus_signal = testSignal(opus_n * opus_frames);
+  std::vector<std::vector<uint8_t>> packets(opus_frames);
+  size_t opus_total = 0;
+  for (size_t f = 0; f < opus_frames; ++f) {
+    packets[f].resize(OPUS_MAX_PACKET);
+    packets[f].resize(encoder.encode(opus_signal.data() + f * opus_n, packets[f].data(), OPUS_MAX_PACKET));
+    opus_total += packets[f].size();
+  }
+
+  size_t frame = 0;
+  std::vector<float> decoded(opus_n);
+  if (reporter.enabled(opus_encode)) {
+    std::vector<uint8_t> scratch(OPUS_MAX_PACKET);
+    const double ns = benchTimeNs([&] {
+      benchKeep(encoder.encode(opus_signal.data() + frame * opus_n, scratch.data(), scratch.size()));
+      frame = (frame + 1) % opus_frames;
+    });
+    reporter.add(opus_encode, ns, static_cast<double>(opus_n));
+    reporter.addMetric("codecs/opus/encode_realtime", opus_n / SAMPLE_RATE * 1e9 / ns, "x real time at 48 kHz");
+  }
+  if (reporter.enabled(opus_decode)) {
+    reporter.add(opus_decode, benchTimeNs([&] {
+      benchKeep(decoder.decode(packets[frame].data(), packets[frame].size(), decoded.data(), opus_n));
+      frame = (frame + 1) % opus_frames;
+    }), static_cast<double>(opus_n));
+  }
+  reporter.addMetric("codecs/opus/bits_per_sample", 8.0 * opus_total / (opus_n * opus_frames), "bits/sample");
+}
@@ -0,0 +1,118 @@
+#include "BenchHarness.h"
+#include "ComfortNoise.h"
+#include "DspStages.h"
+#include "Fft.h"
+#include "VoiceActivity.h"
+#include <cmath>
+#include <memory>
+#include <vector>
+
+namespace {
+
+constexpr int SAMPLE_RATE = 48000;
+constexpr size_t BLOCK = 256;
+
+// Speech-band tones over low noise, so gates and suppressors do real work
+std::vector<float> testBlock(size_t n) {
+  std::vector<float> block(n);
+  uint32_t seed = 777;
+  for (size_t i = 0; i < n; ++i) {
+    seed = seed * 1664525u + 1013904223u;
+    const double noise = 0.01 * (static_cast<double>(seed >> 8) / (1 << 24) - 0.5);
+    block[i] = static_cast<float>(0.3 * std::sin(0.05 * i) + 0.1 * std::sin(0.31 * i) + noise);
+  }
+  return block;
+}
+
+void runStage(BenchReporter& reporter, std::unique_ptr<DspStage> stage, const std::vector<float>& input) {
+  const std::string name = std::string("dsp/") + stage->name() + "/" + std::to_string(BLOCK);
+  if (!reporter.enabled(name)) return;
+
+  DspChain chain;
+  chain.addStage(std::move(stage));
+  chain.prepare(SAMPLE_RATE, BLOCK);
+  std::vector<float> block(BLOCK);
+  reporter.add(name, benchTimeNs([&] {
+    block = input;
+    chain.process(block.data(), BLOCK);
+  }), static_cast<double>(BLOCK));
+}
+
+} // namespace
+
+// Every DSP stage alone, the default capture chain, and the analysis the
+// client runs on each captured block
+void runDspBenchmarks(BenchReporter& reporter) {
+  const std::vector<float> input = testBlock(BLOCK);
+
+  runStage(reporter, std::unique_ptr<DspStage>(new GainStage(-6.0f)), input);
+  runStage(reporter, std::unique_ptr<DspStage>(new HighPassStage(80.0f)), input);
+  runStage(reporter, std::unique_ptr<DspStage>(new NoiseGateStage()), input);
+  runStage(reporter, std::unique_ptr<DspStage>(new AgcStage()), input);
+  runStage(reporter, std::unique_ptr<DspStage>(new LimiterStage(-1.0f)), input);
+  runStage(reporter, std::unique_ptr<DspStage>(new NoiseSuppressorStage()), input);
+
+  const std::string chain_name = "dsp/capture_chain/" + std::to_string(BLOCK);
+  if (reporter.enabled(chain_name)) {
+    // Same stages and order as AudioProcessor's capture chain
+    DspChain chain;
+    chain.addStage(std::unique_ptr<DspStage>(new HighPassStage(80.0f)));
+    chain.addStage(std::unique_ptr<DspStage>(new NoiseSuppressorStage()));
+    chain.addStage(std::unique_ptr<DspStage>(new NoiseGateStage()));
+    chain.addStage(std::unique_ptr<DspStage>(new AgcStage()));
+    chain.addStage(std::unique_ptr<DspStage>(new LimiterStage(-1.0f)));
+    chain.prepare(SAMPLE_RATE, BLOCK);
+    std::vector<float> block(BLOCK);
+    const double ns = benchTimeNs([&] {
+      block = input;
+      chain.process(block.data(), BLOCK);
+    });
+    reporter.add(chain_name, ns, static_cast<double>(BLOCK));
+    reporter.addMetric("dsp/capture_chain/load", ns / (BLOCK * 1e9 / SAMPLE_RATE) * 100.0, "% of one core at 48 kHz");
+  }
+
+  const size_t fft_size = 512;
+  const std::string fft_name = "dsp/fft_roundtrip/" + std::to_string(fft_size);
+  if (reporter.enabled(fft_name)) {
+    ScratchArena arena;
+    arena.reset(Fft::scratchSize(fft_size));
+    Fft fft;
+    fft.prepare(fft_size, arena);
+    std::vector<float> re(fft_size), im(fft_size, 0.0f);
+    const std::vector<float> signal = testBlock(fft_size);
+    reporter.add(fft_name, benchTimeNs([&] {
+      re = signal;
+      std::fill(im.begin(), im.end(), 0.0f);
+      fft.forward(re.data(), im.data());
+      fft.inverse(re.data(), im.data());
+    }), static_cast<double>(fft_size));
+  }
+
+  const std::string vad_name = "dsp/vad/" + std::to_string(BLOCK);
+  if (reporter.enabled(vad_name)) {
+    VoiceActivityDetector vad;
+    vad.configure(SAMPLE_RATE);
+    reporter.add(vad_name, benchTimeNs([&] { benchKeep(vad.process(input.data(), BLOCK)); }),
+                 static_cast<double>(BLOCK));
+  }
+
+  const std::string analyze_name = "dsp/comfort_noise_analyze/" + std::to_string(BLOCK);
+  if (reporter.enabled(analyze_name)) {
+    ComfortNoiseAnalyzer analyzer;
+    reporter.add(analyze_name, benchTimeNs([&] { analyzer.analyze(input.data(), BLOCK); }),
+                 static_cast<double>(BLOCK));
+  }
+
+  const std::string generate_name = "dsp/comfort_noise_generate/" + std::to_string(BLOCK);
+  if (reporter.enabled(generate_name)) {
+    ComfortNoiseAnalyzer analyzer;
+    analyzer.analyze(input.data(), BLOCK);
+    ComfortNoiseParams params;
+    analyzer.describe(params);
+    ComfortNoiseGenerator generator;
+    generator.setParams(params);
+    std::vector<float> out(BLOCK);
+    reporter.add(generate_name, benchTimeNs([&] { generator.generate(out.data(), BLOCK); }),
+                 static_cast<double>(BLOCK));
+  }
+}
@@ -0,0 +1,140 @@
+#include "BenchHarness.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+namespace {
+
+std::string quoted(const std::string& text) {
+  std::string out = "\"";
+  for (char c : text) {
+    if (c == '"' || c == '\\') out += '\\';
+    out += c;
+  }
+  return out + "\"";
+}
+
+// Reads the value of "key" between begin and end; enough JSON for the
+// files writeBenchJson() produces
+bool stringField(const std::string& text, size_t begin, size_t end, const char* key, std::string& value) {
+  const std::string pattern = std::string("\"") + key + "\"";
+  size_t pos = text.find(pattern, begin);
+  if (pos == std::string::npos || pos >= end) return false;
+  pos = text.find('"', text.find(':', pos + pattern.size()));
+  if (pos == std::string::npos || pos >= end) return false;
+  value.clear();
+  for (++pos; pos < end && text[pos] != '"'; ++pos) {
+    if (text[pos] == '\\' && pos + 1 < end) ++pos;
+    value += text[pos];
+  }
+  return pos < end;
+}
+
+bool numberField(const std::string& text, size_t begin, size_t end, const char* key, double& value) {
+  const std::string pattern = std::string("\"") + key + "\"";
+  size_t pos = text.find(pattern, begin);
+  if (pos == std::string::npos || pos >= end) return false;
+  pos = text.find(':', pos + pattern.size());
+  if (pos == std::string::npos || pos >= end) return false;
+  char* parsed = nullptr;
+  value = std::strtod(text.c_str() + pos + 1, &parsed);
+  return parsed != text.c_str() + pos + 1;
+}
+
+} // namespace
+
+bool writeBenchJson(const std::string& path, const std::string& isa, const BenchReporter& reporter) {
+  std::ofstream out(path);
+  if (!out) {
+    std::cerr << "Cannot write " << path << std::endl;
+    return false;
+  }
+  out.precision(6);
+  out << "{\n  \"isa\": " << quoted(isa) << ",\n  \"results\": [";
+  const auto& results = reporter.results();
+  for (size_t i = 0; i < results.size(); ++i) {
+    out << (i ? ",\n" : "\n") << "    {\"name\": " << quoted(results[i].name) << ", \"ns_per_iter\": "
+        << results[i].ns_per_iter << ", \"items_per_iter\": " << results[i].items_per_iter
+        << ", \"unit\": " << quoted(results[i].unit) << "}";
+  }
+  out << "\n  ],\n  \"metrics\": [";
+  const auto& metrics = reporter.metrics();
+  for (size_t i = 0; i < metrics.size(); ++i) {
+    out << (i ? ",\n" : "\n") << "    {\"name\": " << quoted(metrics[i].name) << ", \"value\": "
+        << metrics[i].value << ", \"unit\": " << quoted(metrics[i].unit) << "}";
+  }
+  out << "\n  ]\n}\n";
+  return static_cast<bool>(out);
+}
+
+bool readBenchJson(const std::string& path, std::vector<BenchResult>& results) {
+  std::ifstream in(path);
+  if (!in) {
+    std::cerr << "Cannot read " << path << std::endl;
+    return false;
+  }
+  std::stringstream buffer;
+  buffer << in.rdbuf();
+  const std::string text = buffer.str();
+
+  const size_t section = text.find("\"results\"");
+  if (section == std::string::npos) {
+    std::cerr << path << " has no results" << std::endl;
+    return false;
+  }
+  const size_t section_end = text.find(']', section);
+  results.clear();
+  for (size_t pos = text.find('{', section); pos < section_end; pos = text.find('{', pos + 1)) {
+    const size_t end = text.find('}', pos);
+    BenchResult result{};
+    if (end == std::string::npos || !stringField(text, pos, end, "name", result.name) ||
+        !numberField(text, pos, end, "ns_per_iter", result.ns_per_iter)) {
+      std::cerr << path << ": malformed result" << std::endl;
+      return false;
+    }
+    numberField(text, pos, end, "items_per_iter", result.items_per_iter);
+    stringField(text, pos, end, "unit", result.unit);
+    results.push_back(result);
+  }
+  return true;
+}
+
+bool compareBenchResults(const std::vector<BenchResult>& base, const std::vector<BenchResult>& current,
+                         double threshold_percent, std::ostream& out) {
+  std::map<std::string, double> before;
+  for (const auto& result : base) before[result.name] = result.ns_per_iter;
+
+  size_t regressions = 0;
+  size_t improvements = 0;
+  size_t compared = 0;
+  char line[200];
+  for (const auto& result : current) {
+    auto it = before.find(result.name);
+    if (it == before.end()) {
+      snprintf(line, sizeof(line), "%-48s %12s %12.1f  new\n", result.name.c_str(), "-", result.ns_per_iter);
+      out << line;
+      continue;
+    }
+    ++compared;
+    const double change = (result.ns_per_iter / it->second - 1.0) * 100.0;
+    const char* verdict = "";
+    if (change > threshold_percent) {
+      verdict = "  REGRESSION";
+      ++regressions;
+    } else if (change < -threshold_percent) {
+      verdict = "  faster";
+      ++improvements;
+    }
+    snprintf(line, sizeof(line), "%-48s %12.1f %12.1f %+8.1f%%%s\n", result.name.c_str(), it->second,
+             result.ns_per_iter, change, verdict);
+    out << line;
+    before.erase(it);
+  }
+  // Whatever is left was not run this time, e.g. under a filter
+  if (!before.empty()) out << before.size() << " benchmarks only in the base results" << std::endl;
+  out << compared << " compared, " << regressions << " slower and " << improvements << " faster by more than "
+      << threshold_percent << "%" << std::endl;
+  return regressions == 0;
+}
@@ -0,0 +1,59 @@
+#include "BenchHarness.h"
+#include "SampleKernels.h"
+#include <cmath>
+#include <vector>
+
+void runKernelBenchmarks(BenchReporter& reporter) {
+  const SampleKernels::Isa isas[] = {
+    SampleKernels::Isa::SCALAR, SampleKernels::Isa::SSE2,
+    SampleKernels::Isa::AVX2, SampleKernels::Isa::AVX512
+  };
+  const size_t sizes[] = {256, 4096};
+
+  for (auto isa : isas) {
+    const SampleKernelTable* k = SampleKernels::table(isa);
+    if (!k) continue;
+
+    for (size_t n : sizes) {
+      std::vector<float> a(2 * n), b(2 * n), c(2 * n);
+      std::vector<int16_t> s16(n);
+      std::vector<uint16_t> f16(n);
+      std::vector<uint8_t> s24(3 * n + 16);
+      std::vector<uint8_t> s8(n);
+      for (size_t i = 0; i < 2 * n; ++i) {
+        a[i] = 0.8f * std::sin(0.01f * i);
+        b[i] = 0.5f * std::cos(0.013f * i);
+      }
+      DitherState dither;
+
+      const std::string prefix = std::string("kernels/") + k->name + "/";
+      const std::string suffix = "/" + std::to_string(n);
+      auto run = [&](const char* kernel, auto&& fn) {
+        const std::string name = prefix + kernel + suffix;
+        if (reporter.enabled(name)) reporter.add(name, benchTimeNs(fn), static_cast<double>(n));
+      };
+
+      run("float_to_int16", [&] { k->floatToInt16(a.data(), s16.data(), n, nullptr); });
+      run("float_to_int16_dither", [&] { k->floatToInt16(a.data(), s16.data(), n, &dither); });
+      run("int16_to_float", [&] { k->int16ToFloat(s16.data(), c.data(), n); });
+      run("float_to_int24_dither", [&] { k->floatToInt24(a.data(), s24.data(), n, &dither); });
+      run("int24_to_float", [&] { k->int24ToFloat(s24.data(), c.data(), n); });
+      run("float_to_ulaw", [&] { k->floatToUlaw(a.data(), s8.data(), n); });
+      run("ulaw_to_float", [&] { k->ulawToFloat(s8.data(), c.data(), n); });
+      run("float_to_alaw", [&] { k->floatToAlaw(a.data(), s8.data(), n); });
+      run("alaw_to_float", [&] { k->alawToFloat(s8.data(), c.data(), n); });
+      run("float_to_half", [&] { k->floatToHalf(a.data(), f16.data(), n); });
+      run("half_to_float", [&] { k->halfToFloat(f16.data(), c.data(), n); });
+      run("gain", [&] { k->applyGain(c.data(), n, 1.0f); });
+      run("ramp", [&] { k->applyRamp(c.data(), n, 1.0f, 0.0f); });
+      run("mix_accumulate", [&] { k->mixAccumulate(c.data(), b.data(), n, 0.5f); });
+      run("multiply", [&] { k->multiply(c.data(), a.data(), n); });
+      run("multiply_add", [&] { k->multiplyAdd(c.data(), a.data(), b.data(), n); });
+      run("magnitude_squared", [&] { k->magnitudeSquared(a.data(), b.data(), c.data(), n); });
+      run("peak", [&] { benchKeep(k->peak(a.data(), n)); });
+      run("sum_squares", [&] { benchKeep(k->sumSquares(a.data(), n)); });
+      run("interleave2", [&] { k->interleave2(a.data(), b.data(), c.data(), n); });
+      run("deinterleave2", [&] { k->deinterleave2(a.data(), b.data(), c.data(), n); });
+    }
+  }
+}
@@ -0,0 +1,227 @@
+#include "BenchHarness.h"
+#include "AudioCodec.h"
+#include "AudioFrame.h"
+#include "AudioServer.h"
+#include "NetworkManager.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t FRAME_SAMPLES = 256;
+// Frames each room's speaker sends in the fan-out benchmark
+constexpr size_t FANOUT_FRAMES = 2000;
+
+using BenchClock = std::chrono::steady_clock;
+
+// A connected pair of stream sockets
+bool openPair(SOCKET pair[2]) {
+#ifdef _WIN32
+  (void) pair;
+  return false;
+#else
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return false;
+  pair[0] = fds[0];
+  pair[1] = fds[1];
+  return true;
+#endif
+}
+
+void shutdownBoth(SOCKET socket_fd) {
+#ifdef _WIN32
+  shutdown(socket_fd, SD_BOTH);
+#else
+  shutdown(socket_fd, SHUT_RDWR);
+#endif
+}
+
+Message audioMessage(size_t payload_bytes) {
+  AudioFrameHeader header{};
+  header.samples = static_cast<uint16_t>(FRAME_SAMPLES);
+  header.codec = static_cast<uint8_t>(AudioCodec::PCM16);
+  std::vector<uint8_t> payload(payload_bytes, 0x5a);
+  Message message;
+  buildAudioFrame(message, header, payload.data(), payload.size());
+  return message;
+}
+
+// sendMessage/receiveMessage over a socketpair: one-way throughput with a
+// reader thread, and ping-pong round trips
+void runFraming(BenchReporter& reporter) {
+  const size_t payloads[] = {0, 512, 4096};
+  NetworkManager network;
+
+  for (size_t payload : payloads) {
+    const std::string stream = "framing/stream/" + std::to_string(payload);
+    const std::string roundtrip = "framing/roundtrip/" + std::to_string(payload);
+    if (!reporter.enabled(stream) && !reporter.enabled(roundtrip)) continue;
+
+    SOCKET pair[2];
+    if (!openPair(pair)) {
+      std::cerr << "framing benchmarks need socketpair()" << std::endl;
+      return;
+    }
+    const Message message = audioMessage(payload);
+
+    if (reporter.enabled(stream)) {
+      const size_t count = 20000;
+      double best = 1e300;
+      for (int round = 0; round < 3; ++round) {
+        const auto start = BenchClock::now();
+        std::thread reader([&] {
+          Message received;
+          for (size_t i = 0; i < count; ++i) network.receiveMessage(received, pair[1]);
+        });
+        for (size_t i = 0; i < count; ++i) network.sendMessage(message, pair[0]);
+        reader.join();
+        best = std::min(best, std::chrono::duration<double, std::nano>(BenchClock::now() - start).count() / count);
+      }
+      reporter.add(stream, best, 1.0, "messages");
+    }
+
+    if (reporter.enabled(roundtrip)) {
+      std::atomic<bool> echoing(true);
+      std::thread echo([&] {
+        Message received;
+        while (echoing && network.receiveMessage(received, pair[1])) network.sendMessage(received, pair[1]);
+      });
+      Message reply;
+      reporter.add(roundtrip, benchTimeNs([&] {
+        network.sendMessage(message, pair[0]);
+        network.receiveMessage(reply, pair[0]);
+      }), 1.0, "messages");
+      echoing = false;
+      // Unblocks the echo thread's receive
+      shutdownBoth(pair[0]);
+      echo.join();
+    }
+    close_socket(pair[0]);
+    close_socket(pair[1]);
+  }
+}
+
+struct BenchClient {
+  std::unique_ptr<NetworkManager> network;
+  std::thread reader;
+  std::atomic<size_t> frames{0};
+};
+
+bool joinRoom(BenchClient& client, int port, bool listen_only) {
+  CodecHello hello{};
+  hello.version = CODEC_HELLO_VERSION;
+  hello.preferred = static_cast<uint8_t>(AudioCodec::PCM16);
+  hello.supported = builtinCodecMask();
+  hello.features = listen_only ? HELLO_FEATURE_LISTEN_ONLY : 0;
+  std::vector<uint8_t> payload(sizeof(hello));
+  std::memcpy(payload.data(), &hello, sizeof(hello));
+
+  client.network.reset(new NetworkManager());
+  if (!client.network->connectToServer("127.0.0.1", port, payload)) return false;
+  Message ready;
+  ready.type = MessageType::CLIENT_READY;
+  ready.size = 0;
+  if (!client.network->sendMessage(ready)) return false;
+
+  NetworkManager* network = client.network.get();
+  std::atomic<size_t>* frames = &client.frames;
+  client.reader = std::thread([network, frames] {
+    Message message;
+    while (network->receiveMessage(message)) {
+      if (message.type == MessageType::AUDIO_DATA) frames->fetch_add(1, std::memory_order_relaxed);
+    }
+  });
+  return true;
+}
+
+// Rooms x clients through real AudioServer instances, one per room since
+// a server is one session. One speaker per room sends frames as fast as
+// it can; the time is per frame delivered to a listener.
+void runFanout(BenchReporter& reporter, int base_port) {
+  const size_t room_counts[] = {1, 4};
+  const size_t client_counts[] = {4, 16, 64};
+
+  for (size_t rooms : room_counts) {
+    for (size_t clients : client_counts) {
+      const std::string name = "fanout/" + std::to_string(rooms) + "x" + std::to_string(clients);
+      if (!reporter.enabled(name)) continue;
+
+      // The servers narrate connections on stdout
+      std::streambuf* narration = std::cout.rdbuf(nullptr);
+      std::vector<std::unique_ptr<AudioServer>> servers;
+      std::vector<std::unique_ptr<BenchClient>> members;
+      bool ok = true;
+      for (size_t r = 0; r < rooms && ok; ++r) {
+        servers.emplace_back(new AudioServer());
+        const int port = base_port + static_cast<int>(r);
+        ok = servers.back()->start(port);
+        for (size_t c = 0; c < clients && ok; ++c) {
+          members.emplace_back(new BenchClient());
+          ok = joinRoom(*members.back(), port, c > 0);
+        }
+      }
+      // Every listener must be registered and ready before timing starts
+      const auto settle = BenchClock::now() + std::chrono::seconds(5);
+      auto registered = [&] {
+        for (const auto& server : servers) {
+          if (server->getListeners() + 1 < clients) return false;
+        }
+        return true;
+      };
+      while (ok && !registered() && BenchClock::now() < settle) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+      const Message frame = audioMessage(FRAME_SAMPLES * sizeof(int16_t));
+      const size_t expected = rooms * (clients - 1) * FANOUT_FRAMES;
+      size_t delivered = 0;
+      const auto start = BenchClock::now();
+      if (ok) {
+        std::vector<std::thread> speakers;
+        for (size_t r = 0; r < rooms; ++r) {
+          NetworkManager* speaker = members[r * clients]->network.get();
+          speakers.emplace_back([speaker, &frame] {
+            for (size_t i = 0; i < FANOUT_FRAMES; ++i) speaker->sendMessage(frame);
+          });
+        }
+        for (auto& speaker : speakers) speaker.join();
+        const auto deadline = BenchClock::now() + std::chrono::seconds(30);
+        while (BenchClock::now() < deadline) {
+          delivered = 0;
+          for (const auto& member : members) delivered += member->frames.load(std::memory_order_relaxed);
+          if (delivered >= expected) break;
+          std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+      }
+      const double elapsed = std::chrono::duration<double, std::nano>(BenchClock::now() - start).count();
+
+      for (auto& member : members) {
+        member->network->stopReceiving();
+        if (member->reader.joinable()) member->reader.join();
+        member->network->disconnect();
+      }
+      for (auto& server : servers) server->stop();
+      std::cout.rdbuf(narration);
+      std::cout.clear();
+
+      if (!ok || delivered < expected) {
+        std::cerr << name << ": " << (ok ? "frames went missing" : "could not set up the rooms") << std::endl;
+        continue;
+      }
+      reporter.add(name, elapsed / expected, 1.0, "frames");
+    }
+  }
+}
+
+} // namespace
+
+void runNetworkBenchmarks(BenchReporter& reporter, int base_port) {
+  runFraming(reporter);
+  runFanout(reporter, base_port);
+}
@@ -0,0 +1,57 @@
+#include "BenchHarness.h"
+#include "SampleKernels.h"
+#include <iostream>
+#include <string>
+
+void runKernelBenchmarks(BenchReporter& reporter);
+void runCodecBenchmarks(BenchReporter& reporter);
+void runDspBenchmarks(BenchReporter& reporter);
+void runBufferBenchmarks(BenchReporter& reporter);
+void runNetworkBenchmarks(BenchReporter& reporter, int base_port);
+
+int main(int argc, char* argv[]) {
+  std::string filter;
+  std::string json_path;
+  std::string compare_base;
+  std::string compare_current;
+  double threshold_percent = 10.0;
+  int base_port = 19400;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--filter" && i + 1 < argc) {
+      filter = argv[++i];
+    } else if (arg == "--json" && i + 1 < argc) {
+      json_path = argv[++i];
+    } else if (arg == "--compare" && i + 2 < argc) {
+      compare_base = argv[++i];
+      compare_current = argv[++i];
+    } else if (arg == "--threshold" && i + 1 < argc) {
+      threshold_percent = std::stod(argv[++i]);
+    } else if (arg == "--port" && i + 1 < argc) {
+      base_port = std::stoi(argv[++i]);
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--filter <substring>] [--json <results.json>] [--port <first>]\n"
+                << "       " << argv[0] << " --compare <base.json> <new.json> [--threshold <percent>]" << std::endl;
+      return 1;
+    }
+  }
+
+  if (!compare_base.empty()) {
+    std::vector<BenchResult> base, current;
+    if (!readBenchJson(compare_base, base) || !readBenchJson(compare_current, current)) return 1;
+    return compareBenchResults(base, current, threshold_percent, std::cout) ? 0 : 2;
+  }
+
+  const std::string isa = SampleKernels::isaName(SampleKernels::activeIsa());
+  std::cout << "AudSync benchmarks (active kernels: " << isa << ")" << std::endl;
+
+  BenchReporter reporter(filter);
+  runKernelBenchmarks(reporter);
+  runCodecBenchmarks(reporter);
+  runDspBenchmarks(reporter);
+  runBufferBenchmarks(reporter);
+  runNetworkBenchmarks(reporter, base_port);
+
+  if (!json_path.empty() && !writeBenchJson(json_path, isa, reporter)) return 1;
+  return 0;
+}
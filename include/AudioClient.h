@@ -6,11 +6,28 @@
 #include "SessionLogger.h"
 #include "AudioRecorder.h"
 #include "JitterBuffer.h"
+#include "VoiceActivity.h"
+#include "ComfortNoise.h"
+#include "OpusCodec.h"
+#include "ClockSync.h"
+#include "MulticastChannel.h"
+#include "SubscriptionSet.h"
+#include "WavFileSource.h"
+#include "LockFreeRing.h"
 #include <string>
 #include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <vector>
 
+// For setFrameObserver()
+enum class FrameEvent : uint8_t {
+  SENT,       // written to the server connection
+  RECEIVED    // arrived, about to enter the jitter buffer
+};
+
 class AudioClient {
   public:
     // New constructor with device, sample rate, channels, logger, recorder, jitter buffer
@@ -25,12 +42,69 @@ class AudioClient {
     bool connect(const std::string& server_host, int server_port);
     void disconnect();
 
+    // The first start opens the devices. Stop only pauses them, silent
+    // and not sending, so a later start resumes at once; disconnect()
+    // closes them.
     bool startAudio();
     void stopAudio();
 
     bool isConnected() const;
     bool isAudioActive() const;
+
+    // Discontinuous transmission: silent frames are replaced by periodic
+    // comfort noise descriptors. On by default.
+    void setDtxEnabled(bool enabled) { dtx_enabled_ = enabled; }
+    // Codec to ask the server for; takes effect on the next connect. Until
+    // the server confirms with CODEC_SELECT the client sends FLOAT32.
+    void setPreferredCodec(AudioCodec codec) { preferred_codec_ = codec; }
+    // Used when the server selects Opus; takes effect on the next start
+    void setOpusSettings(const OpusSettings& settings) { opus_settings_ = settings; }
+    // Repair data sent with speech. max_group is the parity group size, or
+    // the spacing of redundant copies, used while receivers report no loss;
+    // reported loss shrinks it. Takes effect on the next start.
+    void setFec(FecMode mode, size_t max_group) {
+      fec_mode_ = mode;
+      fec_max_group_ = max_group;
+    }
+    // Offers to take relayed audio from the server's multicast group, if it
+    // has one; audio stays on unicast while no group datagrams arrive.
+    // Takes effect on the next connect.
+    void setMulticast(bool enabled, const std::string& interface_address = std::string()) {
+      multicast_enabled_ = enabled;
+      multicast_interface_ = interface_address;
+    }
+    // Emulated bad network between this client and the server, for
+    // testing. Takes effect on the next connect.
+    void setImpairment(const ImpairmentConfig& send, const ImpairmentConfig& receive) {
+      network_manager_.setImpairment(send, receive);
+    }
+    // Listen-only clients open no capture stream and never send audio; the
+    // server keeps them off its speaker list. Takes effect on the next connect.
+    void setListenOnly(bool listen_only) { listen_only_ = listen_only; }
+    bool isListenOnly() const { return listen_only_; }
+    // Streams source, which must be open at the session rate, instead of
+    // the microphone; no audio device is opened and nothing is played.
+    // Takes effect on the next start.
+    void setFileSource(WavFileSource* source) { file_source_ = source; }
+    WavFileSource* fileSource() const { return file_source_; }
+    // Asks the server to relay, or stop relaying, the given senders' audio
+    // (ids as in frames and stats); no ids means everyone. Everyone is
+    // received after connecting.
+    bool subscribe(const std::vector<uint16_t>& senders);
+    bool unsubscribe(const std::vector<uint16_t>& senders);
+    // Sees every audio frame sent or received, with the monotonicNowNs()
+    // time it left or arrived; for latency instrumentation. Called on the
+    // sender and network threads. Set before connect().
+    void setFrameObserver(std::function<void(FrameEvent, const AudioFrameHeader&, int64_t)> observer) {
+      frame_observer_ = observer;
+    }
+    // The device side: the null device, DSP stages. Set up before startAudio().
+    AudioProcessor& audioProcessor() { return audio_processor_; }
     void run(); // Main client loop
+    void printStats() const;
+
+    // The server's media clock, estimated from heartbeats while connected
+    const ClockSync& clockSync() const { return clock_sync_; }
 
     // Static utility to list input devices
     static std::vector<std::string> getInputDeviceNames();
@@ -42,6 +116,7 @@ class AudioClient {
     SessionLogger* logger_;
     AudioRecorder* recorder_;
     JitterBuffer* jitterBuffer_;
+    std::unique_ptr<JitterBuffer> owned_jitter_buffer_;
 
     int inputDeviceId_;
     int sampleRate_;
@@ -49,12 +124,135 @@ class AudioClient {
 
     std::atomic<bool> connected_;
     std::atomic<bool> audio_active_;
+    bool streams_open_;       // paused between stop and start, closed on disconnect
     std::atomic<bool> running_;
+    bool listen_only_;
+    // File source mode: a timer thread stands in for the capture callback
+    WavFileSource* file_source_;
+    std::thread source_thread_;
+    std::atomic<bool> source_running_;
+    std::function<void(FrameEvent, const AudioFrameHeader&, int64_t)> frame_observer_;
     
     std::thread network_thread_;
-    
+    std::thread clock_thread_;
+    ClockSync clock_sync_;
+    bool clock_sync_logged_;     // network thread only
+
+    // Multicast delivery. Received audio is pushed from both the network
+    // and the multicast thread, one at a time.
+    MulticastChannel multicast_;
+    std::thread multicast_thread_;
+    bool multicast_enabled_;
+    std::string multicast_interface_;
+    uint16_t multicast_self_id_;
+    std::atomic<bool> multicast_active_;
+    std::atomic<uint64_t> multicast_received_;
+    std::mutex receive_mutex_;
+    // Mirrors the server's subscriptions, keyed by sender id, so frames
+    // from the multicast group can be filtered here
+    SubscriptionSet subscriptions_;
+    std::mutex subscription_mutex_;
+
+    // Captured blocks are copied into preallocated frames and handed to the
+    // sender thread, which encodes and sends them; the callback never
+    // blocks on the network. Filled frames go through tx_ready_ and come
+    // back through tx_free_.
+    struct TxBlock {
+        uint32_t frame;
+        uint32_t epoch;
+        size_t samples;
+        int64_t captured_ns;
+    };
+    std::vector<float> tx_frames_;
+    LockFreeRing<TxBlock> tx_ready_;
+    LockFreeRing<uint32_t> tx_free_;
+    std::thread sender_thread_;
+    std::atomic<bool> sender_running_;
+    // Bumped by every start: the sender resets the transmit state when it
+    // sees a new epoch, and drops blocks captured before a pause
+    std::atomic<uint32_t> tx_epoch_;
+    uint32_t tx_epoch_seen_;      // sender thread only
+    std::atomic<uint64_t> tx_overruns_;
+
+    // Transmit state, only touched from the sender thread (or the file
+    // source thread, which has no sender thread)
+    VoiceActivityDetector vad_;
+    ComfortNoiseAnalyzer comfort_noise_;
+    uint32_t tx_sequence_;
+    uint32_t tx_timestamp_;
+    size_t samples_since_descriptor_;
+    bool in_talkspurt_;
+    CodecState codec_state_;
+    std::vector<uint8_t> encode_buffer_;
+    // Opus frames are longer than capture blocks; speech is collected here
+    OpusFrameEncoder opus_encoder_;
+    OpusSettings opus_settings_;
+    std::vector<float> opus_pending_;
+    size_t opus_fill_;
+    AudioFrameHeader opus_header_;
+    // FEC state: the parity group being built, or the redundant copy of
+    // the last frame, sent after the next one
+    FecMode fec_mode_;
+    size_t fec_max_group_;
+    size_t fec_interval_;
+    uint8_t fec_loss_;
+    FecParityEncoder fec_parity_;
+    CodecState fec_codec_state_;
+    std::vector<uint8_t> fec_buffer_;
+    AudioFrameHeader fec_header_;
+    size_t fec_pending_bytes_;
+    // Sender reports are timed by samples sent: the transmit path queues
+    // the timestamp and capture time of a block, the clock thread sends it
+    struct TxReport {
+        uint32_t timestamp;
+        int64_t captured_ns;
+    };
+    size_t samples_since_sender_report_;
+    LockFreeRing<TxReport> sender_reports_;
+    // Receiver reports go from the clock thread, which alone touches this
+    std::vector<JitterStreamCounters> report_baseline_;
+
+    AudioCodec preferred_codec_;
+    std::atomic<uint8_t> tx_codec_;
+
+    std::atomic<bool> dtx_enabled_;
+    std::atomic<uint64_t> frames_sent_;
+    std::atomic<uint64_t> frames_suppressed_;
+    std::atomic<uint64_t> descriptors_sent_;
+    std::atomic<uint64_t> bytes_sent_;
+    std::atomic<uint64_t> repair_frames_sent_;
+    std::atomic<uint8_t> reported_loss_;
+    // The transmit path never logs; the clock thread logs the latest FEC
+    // change from here: interval << 8 | loss, or -1 once logged
+    std::atomic<int64_t> fec_adapted_;
+
+    bool opusUsable() const;
+    uint32_t supportedCodecs() const;
+    void sendSpeech(AudioFrameHeader& header, const float* data, size_t samples);
+    void queueOpus(const AudioFrameHeader& header, const float* data, size_t samples);
+    void flushOpus();
+    void sendFrame(const AudioFrameHeader& header, const void* payload, size_t bytes);
+    void adaptFec();
+    void queueRedundantCopy(const AudioFrameHeader& header, const float* data, size_t samples);
+    void flushFec();
+    void sendRepair(const AudioFrameHeader& header, const uint8_t* payload, size_t bytes);
+    void sendReceiverReport();
+    void sendSenderReport(const TxReport& queued);
+    void handleDspCommand(const std::string& args);
+    void handleSubscribeCommand(bool subscribe, const std::string& args);
+    bool sendSubscription(bool subscribe, const std::vector<uint16_t>& senders);
+    bool isSubscribed(uint16_t sender_id);
     void handleNetworkMessage(const Message& message, int socket_fd);
-    void onAudioCaptured(const float* data, size_t samples);
+    void onAudioCaptured(const float* data, size_t samples, int64_t captured_ns);
+    void resetTransmit();
+    void transmitBlock(const float* data, size_t samples, int64_t captured_ns);
+    void senderLoop();
+    void stopSender();
     void networkLoop();
+    void clockLoop();
+    void sourceLoop();
+    void joinMulticast(const Message& offer);
+    void sendMulticastStatus(bool receiving);
+    void multicastLoop();
 };
 
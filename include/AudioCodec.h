@@ -0,0 +1,63 @@
+#pragma once
+
+#include "SampleKernels.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Payload encodings for AUDIO_DATA frames
+enum class AudioCodec : uint8_t {
+  FLOAT32 = 0,
+  PCM16 = 1,    // native-endian int16, TPDF dithered
+  ULAW = 2,     // G.711 mu-law
+  ALAW = 3,     // G.711 A-law
+  ADPCM = 4,    // IMA-ADPCM, 4 bits per sample
+  OPUS = 5,     // stateful, see OpusCodec.h; not handled by encodeAudio/decodeAudio
+  LOSSLESS = 6, // 24-bit, see LosslessCodec.h
+  FLOAT16 = 7   // IEEE half precision, native-endian
+};
+
+inline uint32_t codecBit(AudioCodec codec) {
+  return 1u << static_cast<uint8_t>(codec);
+}
+
+// CONNECT payload. A client that sends an empty CONNECT is assumed to
+// understand FLOAT32 only.
+#pragma pack(push, 1)
+struct CodecHello {
+  uint8_t version;
+  uint8_t preferred;     // AudioCodec the client would like to send
+  uint16_t features;     // HelloFeature bits
+  uint32_t supported;    // codecBit() of every codec it can decode
+};
+#pragma pack(pop)
+
+static_assert(sizeof(CodecHello) == 8, "CodecHello is part of the wire format");
+
+constexpr uint8_t CODEC_HELLO_VERSION = 1;
+
+enum HelloFeature : uint16_t {
+  HELLO_FEATURE_FEC = 0x0001,   // understands FEC repair frames and sends receiver reports
+  HELLO_FEATURE_MULTICAST = 0x0002, // can receive audio from a multicast group, see MulticastChannel.h
+  HELLO_FEATURE_LISTEN_ONLY = 0x0004 // never sends audio
+};
+
+const char* codecName(AudioCodec codec);
+bool parseCodecName(const std::string& name, AudioCodec& codec);
+// Codecs encodeAudio() and decodeAudio() handle
+uint32_t builtinCodecMask();
+
+// Encoder state carried from frame to frame. Every encoded frame still
+// decodes on its own.
+struct CodecState {
+  DitherState dither;
+  int adpcm_index = 0;
+};
+
+// Upper bound of encodeAudio's output for a frame of samples
+size_t maxEncodedBytes(AudioCodec codec, size_t samples);
+// Returns the encoded size, or 0 if the codec is not built in
+size_t encodeAudio(AudioCodec codec, const float* in, size_t samples, uint8_t* out, CodecState& state);
+// Decodes a frame of samples. Returns the number decoded, 0 if bytes is too
+// short for the codec or the codec is unknown.
+size_t decodeAudio(AudioCodec codec, const uint8_t* in, size_t bytes, size_t samples, float* out);
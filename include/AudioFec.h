@@ -0,0 +1,95 @@
+#pragma once
+
+#include "AudioFrame.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Forward error correction for AUDIO_DATA frames. Repair frames carry the
+// FRAME_FEC_PARITY or FRAME_FEC_REDUNDANT flag, take no sequence number of
+// their own and are only forwarded to receivers that announced
+// HELLO_FEATURE_FEC.
+//
+// Parity: after a group of consecutive frames the sender emits the XOR of
+// their header fields and zero-padded payloads. The parity frame's
+// sequence is the first one it covers. A receiver missing exactly one
+// frame of the group rebuilds it from the others.
+//
+// Redundant: each speech frame is followed by a low-bitrate copy of the one
+// before it, with the sequence of the frame it copies.
+enum class FecMode : uint8_t {
+  OFF = 0,
+  PARITY = 1,
+  REDUNDANT = 2
+};
+
+const char* fecModeName(FecMode mode);
+bool parseFecMode(const std::string& name, FecMode& mode);
+
+constexpr size_t FEC_MAX_GROUP = 16;
+
+// Prefix of a parity frame's payload; the XOR of the covered payloads
+// follows, as long as the longest of them
+#pragma pack(push, 1)
+struct FecParityHeader {
+  uint32_t timestamp;   // XOR of the covered frames' fields
+  uint32_t length;      // XOR of their payload sizes
+  uint16_t samples;
+  uint8_t codec;
+  uint8_t flags;
+  uint8_t count;        // frames covered
+  uint8_t reserved[3];
+};
+#pragma pack(pop)
+
+static_assert(sizeof(FecParityHeader) == 16, "FecParityHeader is part of the wire format");
+
+// One entry of a RECEIVER_REPORT payload per sender heard. The server
+// sends each sender the worst loss any receiver reported for it as a
+// one-byte LOSS_REPORT.
+#pragma pack(push, 1)
+struct ReceiverReportEntry {
+  uint16_t sender_id;
+  uint8_t loss;         // missing frames since the last report, in 1/256ths
+  uint8_t reserved;
+};
+#pragma pack(pop)
+
+// XORs one frame into a parity header and payload, which must have room
+// for bytes
+void fecAccumulate(FecParityHeader& parity, uint8_t* payload, const AudioFrameHeader& header,
+                   const uint8_t* frame, size_t bytes);
+
+// Redundant copies are coded with ADPCM, the cheapest codec whose frames
+// decode on their own. Opus streams rely on Opus' in-band FEC instead.
+constexpr AudioCodec FEC_REDUNDANT_CODEC = AudioCodec::ADPCM;
+
+// Frames per parity frame, or between redundant copies, for the worst loss
+// a receiver reported (in 1/256ths, as in RTCP). No loss gives max_group;
+// around 10% loss gives min_group.
+size_t fecInterval(uint8_t loss, size_t min_group, size_t max_group);
+
+// Builds parity frames for one outgoing stream
+class FecParityEncoder {
+  public:
+    // Largest frame payload, matching the jitter buffer's
+    static constexpr size_t MAX_PAYLOAD = 4096 * sizeof(float);
+
+    FecParityEncoder();
+
+    // Adds a sent frame. Its sequence must follow the previous one.
+    void add(const AudioFrameHeader& header, const uint8_t* payload, size_t bytes);
+    size_t count() const { return parity_.count; }
+    void reset();
+    // Writes the parity frame for the frames added so far to out (at least
+    // sizeof(FecParityHeader) + MAX_PAYLOAD bytes) and starts a new group.
+    // Returns its payload size, 0 if the group is empty.
+    size_t finish(AudioFrameHeader& header, uint8_t* out);
+
+  private:
+    FecParityHeader parity_;
+    uint32_t first_sequence_;
+    size_t longest_;
+    std::unique_ptr<uint8_t[]> payload_;
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "AudioCodec.h"
+#include "NetworkManager.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// AUDIO_DATA flag bits
+enum AudioFrameFlags : uint8_t {
+  FRAME_COMFORT_NOISE = 0x01,   // payload is a ComfortNoiseParams descriptor
+  FRAME_TALKSPURT = 0x02,       // first speech frame after silence
+  FRAME_FEC_PARITY = 0x04,      // repair data, see AudioFec.h
+  FRAME_FEC_REDUNDANT = 0x08
+};
+
+constexpr uint8_t FRAME_FEC_MASK = FRAME_FEC_PARITY | FRAME_FEC_REDUNDANT;
+
+// Prefix of every AUDIO_DATA payload. sequence counts transmitted frames so
+// receivers can tell loss from DTX silence; timestamp is the sender's
+// sample clock at the first sample.
+#pragma pack(push, 1)
+struct AudioFrameHeader {
+  uint32_t sequence;
+  uint32_t timestamp;
+  uint16_t sender_id;   // filled in by the server before fan-out
+  uint16_t samples;     // audio samples in the frame, 0 for comfort noise
+  uint8_t codec;
+  uint8_t flags;
+  uint16_t reserved;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(AudioFrameHeader) == 16, "AudioFrameHeader is part of the wire format");
+
+// SENDER_REPORT payload. Ties a sender's sample clock to the media clock
+// (see ClockSync.h): the sample stamped timestamp was captured at
+// media_time_ns. Receivers that synchronize playout present each sample
+// a fixed delay after its capture time.
+#pragma pack(push, 1)
+struct SenderReport {
+  uint16_t sender_id;   // filled in by the server before fan-out
+  uint16_t reserved;
+  uint32_t timestamp;
+  int64_t media_time_ns;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(SenderReport) == 16, "SenderReport is part of the wire format");
+
+inline void buildAudioFrame(Message& message, const AudioFrameHeader& header,
+                            const void* payload, size_t bytes) {
+  message.type = MessageType::AUDIO_DATA;
+  message.size = static_cast<uint32_t>(sizeof(header) + bytes);
+  message.data.resize(message.size);
+  std::memcpy(message.data.data(), &header, sizeof(header));
+  if (bytes > 0) {
+    std::memcpy(message.data.data() + sizeof(header), payload, bytes);
+  }
+}
+
+// Returns false for payloads too short to carry a header
+inline bool parseAudioFrame(const Message& message, AudioFrameHeader& header,
+                            const uint8_t*& payload, size_t& bytes) {
+  if (message.type != MessageType::AUDIO_DATA || message.data.size() < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, message.data.data(), sizeof(header));
+  payload = message.data.data() + sizeof(header);
+  bytes = message.data.size() - sizeof(header);
+  return true;
+}
+
+inline uint8_t audioFrameFlags(const Message& message) {
+  if (message.type != MessageType::AUDIO_DATA || message.data.size() < sizeof(AudioFrameHeader)) return 0;
+  return message.data[offsetof(AudioFrameHeader, flags)];
+}
+
+// Sender id of an AUDIO_DATA or SENDER_REPORT message, -1 for others
+inline int audioFrameSender(const Message& message) {
+  uint16_t sender_id;
+  if (message.type == MessageType::SENDER_REPORT && message.data.size() >= sizeof(SenderReport)) {
+    std::memcpy(&sender_id, message.data.data() + offsetof(SenderReport, sender_id), sizeof(sender_id));
+    return sender_id;
+  }
+  if (message.type == MessageType::AUDIO_DATA && message.data.size() >= sizeof(AudioFrameHeader)) {
+    std::memcpy(&sender_id, message.data.data() + offsetof(AudioFrameHeader, sender_id), sizeof(sender_id));
+    return sender_id;
+  }
+  return -1;
+}
+
+inline void stampAudioFrameSender(Message& message, uint16_t sender_id) {
+  if (message.type == MessageType::SENDER_REPORT) {
+    if (message.data.size() >= sizeof(SenderReport)) {
+      std::memcpy(message.data.data() + offsetof(SenderReport, sender_id), &sender_id, sizeof(sender_id));
+    }
+    return;
+  }
+  if (message.data.size() < sizeof(AudioFrameHeader)) return;
+  std::memcpy(message.data.data() + offsetof(AudioFrameHeader, sender_id), &sender_id, sizeof(sender_id));
+}
@@ -1,15 +1,27 @@
 #pragma once
 
 #include "AudioBuffer.h"
+#include "DspChain.h"
+#include "SessionLogger.h"
 #include <portaudio.h>
 #include <functional>
 #include <atomic>
+#include <thread>
 
 class AudioProcessor {
   public:
       AudioProcessor();
       ~AudioProcessor();
 
+      // Without a device (CI, headless hosts) capture and playback run on
+      // timer threads at the stream rate instead of PortAudio callbacks.
+      // Captured audio comes from the null input, silence if none is set,
+      // and played audio only reaches the tap. Choose before initialize().
+      void setNullDevice(bool null_device) { null_device_ = null_device; }
+      bool isNullDevice() const { return null_device_; }
+      // Fills each captured block; gets the time of its first sample
+      void setNullInput(std::function<void(float*, size_t, int64_t)> input);
+
       bool initialize(int sample_rate = 44100, int frames_per_buffer = 256);
       void cleanup();
 
@@ -17,25 +29,64 @@ class AudioProcessor {
       bool startPlayback();
       void stop();
 
-      // Set callback for when audio data is captured
-      void setAudioCaptureCallback(std::function<void(const float*, size_t)> callback);
+      // Set callback for when audio data is captured. Callbacks and sources
+      // also get the monotonicNowNs() time at which the first sample
+      // reached the ADC, or will reach the DAC, from PortAudio's timestamps
+      // corrected for the latency of the DSP chains.
+      void setAudioCaptureCallback(std::function<void(const float*, size_t, int64_t)> callback);
       bool addPlaybackData(const float* data, size_t samples);
+      // Pulls playback audio from source instead of the internal buffer
+      void setPlaybackSource(std::function<void(float*, size_t, int64_t)> source);
+      // Sees every played block after the playback chain, with the time
+      // its first sample reaches the DAC
+      void setPlaybackTap(std::function<void(const float*, size_t, int64_t)> tap);
+      void setLogger(SessionLogger* logger) { logger_ = logger; }
 
       bool isRecording() const {return recording_; }
       bool isPlaying() const {return playing_; }
+
+      // Keeps the streams running but silent: capture is not delivered and
+      // playback renders zeros, so resuming needs no reopen. Pausing waits
+      // up to 100 ms for blocks already being captured or rendered to
+      // finish, after which the chains may be reset; it returns false if
+      // some were still running.
+      bool setPaused(bool paused);
+      bool isPaused() const { return paused_; }
+
+      // Processing applied between the device and the application
+      DspChain& captureChain() { return capture_chain_; }
+      DspChain& playbackChain() { return playback_chain_; }
   private:
       PaStream* input_stream_;
       PaStream* output_stream_;
       
       AudioBuffer* playback_buffer_;
-      std::function<void(const float*, size_t)> capture_callback_;
+      std::function<void(const float*, size_t, int64_t)> capture_callback_;
+      std::function<void(float*, size_t, int64_t)> playback_source_;
+      std::function<void(const float*, size_t, int64_t)> playback_tap_;
+      std::function<void(float*, size_t, int64_t)> null_input_;
+      DspChain capture_chain_;
+      DspChain playback_chain_;
+      SessionLogger* logger_;
       
       std::atomic<bool> recording_;
       std::atomic<bool> playing_;
       std::atomic<bool> initialized_;
+      std::atomic<bool> paused_;
+      std::atomic<int> in_callback_;  // blocks being captured or rendered
+      bool null_device_;
+      std::thread null_capture_thread_;
+      std::thread null_playback_thread_;
 
       int sample_rate;
       int frames_per_buffer_;
+      int64_t output_latency_ns_;   // for hosts that report no DAC time
+
+      // Shared by the PortAudio callbacks and the null device threads
+      void deliverCapture(const float* input, size_t frames, int64_t captured_ns);
+      void renderPlayback(float* output, size_t frames, int64_t heard_ns);
+      void nullCaptureLoop();
+      void nullPlaybackLoop();
 
       static int recordCallback(const void* inputBuffer, void* outputBuffer, unsigned long framesPerBuffer, const PaStreamCallbackTimeInfo* timeInfo, PaStreamCallbackFlags statusFlags, void* userData);
       static int playCallback(const void* inputBuffer, void* outputBuffer, unsigned long framesPerBuffer, const PaStreamCallbackTimeInfo* timeInfo, PaStreamCallbackFlags statusFlags, void* userData);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "LockFreeRing.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+// Session recorder. Audio threads push samples into per-track lock-free rings;
+// a background writer drains them into large aligned blocks and writes WAV
+// (RF64 once a track passes 4 GiB) files. The audio side never touches the
+// filesystem: if the disk falls behind, the rings absorb the lag and, once
+// full, samples are dropped and counted instead of stalling the callback.
+class AudioRecorder {
+  public:
+    enum class Track : uint8_t {
+      CAPTURE = 0,
+      PLAYBACK = 1
+    };
+    static constexpr size_t TRACK_COUNT = 2;
+
+    AudioRecorder(int sample_rate = 44100, int channels = 1, double ring_seconds = 4.0);
+    ~AudioRecorder();
+
+    // Creates <path_prefix>_capture.wav and <path_prefix>_playback.wav
+    bool open(const std::string& path_prefix);
+    void close();
+    bool isOpen() const { return open_; }
+
+    // Real-time safe: no locks, no allocation, no I/O
+    bool push(Track track, const float* data, size_t samples);
+
+    uint64_t droppedSamples(Track track) const;
+    uint64_t writtenSamples(Track track) const;
+    size_t writerLag(Track track) const;
+
+  private:
+    struct TrackState;
+
+    int sample_rate_;
+    int channels_;
+    size_t ring_samples_;
+
+    std::unique_ptr<TrackState> tracks_[TRACK_COUNT];
+    std::atomic<bool> open_;
+    std::atomic<bool> running_;
+    std::thread writer_thread_;
+
+    void writerLoop();
+    bool drainTrack(TrackState& track, bool flush);
+    bool writeBlock(TrackState& track, size_t bytes);
+    bool finalizeTrack(TrackState& track);
+};
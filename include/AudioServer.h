@@ -1,6 +1,15 @@
 #pragma once
 
 #include "NetworkManager.h"
+#include "AudioFec.h"
+#include "AudioFrame.h"
+#include "ClockSync.h"
+#include "MulticastChannel.h"
+#include "SubscriptionSet.h"
+#include "SessionLogger.h"
+#include "SessionCapture.h"
+#include <array>
+#include <map>
 #include <vector>
 #include <atomic>
 #include <thread>
@@ -10,30 +19,92 @@ struct ClientInfo {
   SOCKET socket_fd;
   bool ready;
   std::string id;
+  bool negotiates;        // sent a CodecHello and understands CODEC_SELECT
+  uint32_t codecs;        // codecBit() mask the client can decode
+  AudioCodec preferred;
+  AudioCodec selected;    // what the client currently sends
+  bool fec;               // takes FEC repair frames
+  std::map<SOCKET, uint8_t> receiver_loss;  // latest loss each receiver reported for this sender
+  uint8_t reported_loss;  // last LOSS_REPORT sent to the client
+  bool multicast;         // gets relayed audio from the multicast group instead of unicast
+  size_t slot;            // small index of this speaker in subscription sets
+  SubscriptionSet subscriptions;  // speaker slots this client receives
+};
+
+// A listen-only client. Listeners never send audio, so they are kept apart
+// from the speakers with only what fan-out needs.
+struct ListenerInfo {
+  SOCKET socket_fd;
+  bool ready;
+  bool fec;
+  bool multicast;
+  uint32_t codecs;
+  SubscriptionSet subscriptions;
 };
 
 class AudioServer {
   public:
-    AudioServer();
+    AudioServer(SessionLogger* logger = nullptr);
     ~AudioServer();
 
+    // Broadcast room: relayed audio goes once to the group for every
+    // client that receives it, and by unicast to the rest. Call before start().
+    bool setMulticast(const std::string& group, int port, int ttl,
+                      const std::string& interface_address = std::string());
+
+    // Emulated bad network on every client connection, for testing.
+    // Call before start().
+    void setImpairment(const ImpairmentConfig& send, const ImpairmentConfig& receive) {
+      network_manager_.setImpairment(send, receive);
+    }
+
+    // Records every received message for audsync_replay. The capture must
+    // be open and outlive the server. Call before start().
+    void setCapture(SessionCapture* capture) { capture_ = capture; }
+
     bool start(int port);
     void stop();
 
     bool isRunning() const;
     size_t getConnectedClients() const;
+    size_t getMulticastClients() const;
+    size_t getListeners() const;
   
   private:
     NetworkManager network_manager_;
-    std::vector<ClientInfo> clients_;
+    MulticastChannel multicast_;
+    SessionLogger* logger_;
+    SessionCapture* capture_;
+    std::vector<ClientInfo> clients_;   // speakers
+    std::vector<ListenerInfo> listeners_;
+    // Listeners that can decode each codec, so codec selection need not
+    // walk the listener list
+    std::array<size_t, 32> listener_codec_count_;
+    SubscriptionSet speaker_slots_;     // slots in use, as an explicit list
     std::atomic<bool> running_;
 
     mutable std::mutex clients_mutex;
     std::thread server_thread_;
 
-    void handleClientMessage(const Message& message, SOCKET client_socket);
-    void broadcastAudioToOthers(const Message& message, SOCKET sender_socket);
-    void addClient(SOCKET socket_fd);
+    void handleClientMessage(Message& message, SOCKET client_socket);
+    // Stamps the sender id into the frame in place, once it is known to
+    // come from a speaker
+    void broadcastAudioToOthers(Message& message, SOCKET sender_socket);
+    void handleReceiverReport(const Message& message, SOCKET receiver_socket);
+    void handleSubscription(const Message& message, SOCKET recipient_socket);
+    // Sends the client the worst loss its receivers report if that changed.
+    // Call with clients_mutex held.
+    void updateLossReport(ClientInfo& sender);
+    void addClient(SOCKET socket_fd, const Message& connect);
+    void addListener(SOCKET socket_fd, const CodecHello& hello);
+    // Call with clients_mutex held
+    ClientInfo* findClient(SOCKET socket_fd);
+    ClientInfo* findSpeaker(uint16_t sender_id);
+    ListenerInfo* findListener(SOCKET socket_fd);
+    void sendMulticastOffer(SOCKET socket_fd);
     void removeClient(SOCKET socket_fd);
+    // Frames are forwarded as sent, so each sender must use a codec every
+    // client can decode. Call with clients_mutex held.
+    void selectCodecs();
     void serverLoop();
 };
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Monotonic local time. The server's reading of this clock is the
+// session's shared media clock.
+inline int64_t monotonicNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+enum HeartbeatFlags : uint8_t {
+  HEARTBEAT_REPLY = 0x01        // server_receive and server_send are filled in
+};
+
+// HEARTBEAT payload for an NTP-style exchange. The client stamps
+// client_send; the server stamps the other two and sends it back. Empty
+// heartbeats are still echoed as they are.
+#pragma pack(push, 1)
+struct HeartbeatPayload {
+  uint8_t version;
+  uint8_t flags;
+  uint16_t reserved;
+  uint32_t sequence;
+  int64_t client_send;      // client clock, ns
+  int64_t server_receive;   // server clock, ns
+  int64_t server_send;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(HeartbeatPayload) == 32, "HeartbeatPayload is part of the wire format");
+
+constexpr uint8_t HEARTBEAT_VERSION = 1;
+
+struct ClockSyncStats {
+  bool synchronized;
+  int64_t offset_ns;        // server clock minus local clock
+  int64_t rtt_ns;           // of the best recent exchange
+  double drift_ppm;         // how much faster the server clock runs than the local one
+  uint64_t samples;         // replies accepted
+  uint64_t outliers;        // replies rejected for a long round trip
+};
+
+// Estimates the server's media clock from heartbeat round trips. Replies
+// whose round trip is well above the recent minimum were queued somewhere
+// and are dropped; the rest drive a filter that tracks both the offset and
+// the drift between the two clocks, so the estimate stays good between
+// exchanges.
+//
+// processReply() is called from one thread; the conversions may be called
+// from any thread, including audio callbacks, and never block.
+class ClockSync {
+  public:
+    ClockSync();
+
+    void reset();
+    // Stamps a request with the local clock
+    void prepareRequest(HeartbeatPayload& request);
+    // Feeds a reply received at local time received_ns. Returns false if it
+    // was malformed or rejected as an outlier.
+    bool processReply(const HeartbeatPayload& reply, int64_t received_ns);
+
+    bool synchronized() const { return accepted_.load(std::memory_order_acquire) >= MIN_SAMPLES; }
+    int64_t serverTimeNs(int64_t local_ns) const;
+    int64_t localTimeNs(int64_t server_ns) const;
+    // Current media clock reading
+    int64_t nowNs() const { return serverTimeNs(monotonicNowNs()); }
+
+    ClockSyncStats stats() const;
+
+  private:
+    static constexpr size_t WINDOW = 8;
+    static constexpr uint64_t MIN_SAMPLES = 4;
+
+    // Filter state, processReply() only
+    uint32_t next_sequence_;
+    int64_t rtt_window_[WINDOW];
+    size_t rtt_count_;
+    size_t rtt_pos_;
+    int64_t ref_local_;
+    double offset_;
+    double skew_;
+
+    // Published estimate, guarded by a sequence counter
+    std::atomic<uint32_t> version_;
+    std::atomic<int64_t> pub_ref_local_;
+    std::atomic<int64_t> pub_offset_;
+    std::atomic<double> pub_skew_;
+    std::atomic<int64_t> pub_rtt_;
+    std::atomic<uint64_t> accepted_;
+    std::atomic<uint64_t> outliers_;
+
+    void publish(int64_t rtt);
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Spectral envelope and level of background noise, sent in place of audio
+// while a sender is silent. lpc holds the predictor a[1..ORDER] of an
+// all-pole model; level is the RMS of its excitation.
+struct ComfortNoiseParams {
+  static constexpr size_t ORDER = 8;
+  float level;
+  float lpc[ORDER];
+};
+
+// Solves the normal equations for an all-pole model from autocorrelation
+// r[0..order]. Returns the prediction error energy, or 0 if r[0] is zero.
+float levinsonDurbin(const float* r, float* lpc, size_t order);
+
+// Sender side: keeps a running autocorrelation of the frames the VAD
+// classified as noise and turns it into a descriptor on demand.
+class ComfortNoiseAnalyzer {
+  public:
+    ComfortNoiseAnalyzer();
+
+    void analyze(const float* samples, size_t n);
+    // False until at least one frame has been analysed
+    bool describe(ComfortNoiseParams& params) const;
+    void reset();
+
+  private:
+    double autocorr_[ComfortNoiseParams::ORDER + 1];
+    bool primed_;
+};
+
+// Receiver side: shaped noise from the latest descriptor. Level changes are
+// ramped across a block so descriptor updates do not click.
+class ComfortNoiseGenerator {
+  public:
+    ComfortNoiseGenerator();
+
+    void setParams(const ComfortNoiseParams& params);
+    // Overwrites out with n samples of comfort noise
+    void generate(float* out, size_t n);
+    void reset();
+
+  private:
+    ComfortNoiseParams params_;
+    float history_[ComfortNoiseParams::ORDER];
+    float current_level_;
+    uint32_t seed_;
+};
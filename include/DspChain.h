@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// One contiguous block of float scratch memory shared by all stages of a
+// chain. Stages carve out their slices in prepare(); nothing is allocated
+// once processing starts.
+class ScratchArena {
+  public:
+    ScratchArena() : used_(0) {}
+
+    void reset(size_t floats);
+    float* allocate(size_t floats);
+
+    // Size of a slice after padding; stages requesting several slices
+    // report the sum of their padded sizes from scratchSize()
+    static size_t padded(size_t floats) { return (floats + 15) & ~static_cast<size_t>(15); }
+
+    size_t capacity() const { return storage_.size(); }
+    size_t used() const { return used_; }
+
+  private:
+    std::vector<float> storage_;
+    size_t used_;
+};
+
+// A single in-place block processor. Parameters are set from control
+// threads through setParameter() and picked up by the audio thread at the
+// next block, so reconfiguration never allocates.
+class DspStage {
+  public:
+    explicit DspStage(const char* name) : name_(name), enabled_(true) {}
+    virtual ~DspStage() = default;
+
+    const char* name() const { return name_; }
+
+    bool isEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+    void setEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+
+    // Floats of scratch this stage needs for blocks up to max_frames
+    virtual size_t scratchSize(int sample_rate, size_t max_frames) const;
+    virtual void prepare(int sample_rate, size_t max_frames, ScratchArena& arena) = 0;
+    virtual void process(float* block, size_t frames) = 0;
+    // Clears history. The chain also calls it on the audio thread when a
+    // disabled stage is switched back on, so stale audio is never replayed.
+    virtual void reset() {}
+    // Samples of delay the stage adds to the signal
+    virtual size_t latencyFrames() const { return 0; }
+
+    // "enabled" is handled here; stages add their own parameters
+    virtual bool setParameter(const std::string& name, float value);
+    virtual std::string describe() const;
+
+  private:
+    const char* name_;
+    std::atomic<bool> enabled_;
+};
+
+struct DspStageStats {
+  std::string name;
+  bool enabled;
+  uint64_t blocks;
+  double avg_us;
+  double max_us;
+  double load;      // share of the real-time budget for one block
+};
+
+// Ordered chain of stages processing mono blocks in place, with per-stage
+// CPU time accounting.
+class DspChain {
+  public:
+    DspChain();
+
+    // Stages must be added before prepare()
+    void addStage(std::unique_ptr<DspStage> stage);
+    bool prepare(int sample_rate, size_t max_frames);
+    void reset();
+
+    // Real-time safe. Blocks larger than max_frames are split.
+    void process(float* block, size_t frames);
+
+    // Work buffer from the arena for callers whose input is read-only
+    float* workBuffer() const { return work_; }
+    size_t maxFrames() const { return max_frames_; }
+    // Combined latency of the enabled stages
+    size_t latencyFrames() const;
+
+    DspStage* stage(const std::string& name) const;
+    bool setParameter(const std::string& stage_name, const std::string& param, float value);
+
+    std::vector<DspStageStats> stats() const;
+    std::string report() const;
+    void resetStats();
+
+  private:
+    struct Timing {
+      std::atomic<uint64_t> blocks{0};
+      std::atomic<uint64_t> total_ns{0};
+      std::atomic<uint64_t> max_ns{0};
+      bool active = false;      // audio thread only
+    };
+
+    std::vector<std::unique_ptr<DspStage>> stages_;
+    std::unique_ptr<Timing[]> timings_;
+    ScratchArena arena_;
+    float* work_;
+    int sample_rate_;
+    size_t max_frames_;
+    bool prepared_;
+
+    void processBlock(float* block, size_t frames);
+};
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "DspChain.h"
+#include "Fft.h"
+
+// Smoothed gain. Parameters: gain_db
+class GainStage : public DspStage {
+  public:
+    explicit GainStage(float gain_db = 0.0f);
+    void prepare(int sample_rate, size_t max_frames, ScratchArena& arena) override;
+    void process(float* block, size_t frames) override;
+    void reset() override;
+    bool setParameter(const std::string& name, float value) override;
+
+  private:
+    std::atomic<float> gain_db_;
+    float current_;
+};
+
+// Second-order Butterworth high-pass for rumble and DC removal.
+// Parameters: cutoff_hz
+class HighPassStage : public DspStage {
+  public:
+    explicit HighPassStage(float cutoff_hz = 80.0f);
+    void prepare(int sample_rate, size_t max_frames, ScratchArena& arena) override;
+    void process(float* block, size_t frames) override;
+    void reset() override;
+    bool setParameter(const std::string& name, float value) override;
+
+  private:
+    std::atomic<float> cutoff_hz_;
+    float active_cutoff_;
+    int sample_rate_;
+    float b0_, b1_, b2_, a1_, a2_;
+    float z1_, z2_;
+
+    void updateCoefficients(float cutoff);
+};
+
+// Downward expander that closes below a threshold after a hold time.
+// Parameters: threshold_db, floor_db, attack_ms, release_ms, hold_ms
+class NoiseGateStage : public DspStage {
+  public:
+    NoiseGateStage();
+    void prepare(int sample_rate, size_t max_frames, ScratchArena& arena) override;
+    void process(float* block, size_t frames) override;
+    void reset() override;
+    bool setParameter(const std::string& name, float value) override;
+
+  private:
+    std::atomic<float> threshold_db_;
+    std::atomic<float> floor_db_;
+    std::atomic<float> attack_ms_;
+    std::atomic<float> release_ms_;
+    std::atomic<float> hold_ms_;
+    int sample_rate_;
+    float envelope_;
+    float gain_;
+    size_t hold_counter_;
+};
+
+// Slow automatic gain control towards a target RMS level. Quiet input
+// below the noise threshold is left alone rather than amplified.
+// Parameters: target_db, max_gain_db, noise_db
+class AgcStage : public DspStage {
+  public:
+    AgcStage();
+    void prepare(int sample_rate, size_t max_frames, ScratchArena& arena) override;
+    void process(float* block, size_t frames) override;
+    void reset() override;
+    bool setParameter(const std::string& name, float value) override;
+
+  private:
+    std::atomic<float> target_db_;
+    std::atomic<float> max_gain_db_;
+    std::atomic<float> noise_db_;
+    int sample_rate_;
+    float mean_square_;
+    float gain_;
+};
+
+// Look-ahead peak limiter. The delay line lives in the chain's scratch
+// arena. Parameters: ceiling_db, release_ms
+class LimiterStage : public DspStage {
+  public:
+    explicit LimiterStage(float ceiling_db = -1.0f);
+    size_t scratchSize(int sample_rate, size_t max_frames) const override;
+    void prepare(int sample_rate, size_t max_frames, ScratchArena& arena) override;
+    void process(float* block, size_t frames) override;
+    void reset() override;
+    bool setParameter(const std::string& name, float value) override;
+    size_t latencyFrames() const override { return delay_len_; }
+
+  private:
+    static constexpr float LOOKAHEAD_MS = 1.5f;
+
+    std::atomic<float> ceiling_db_;
+    std::atomic<float> release_ms_;
+    int sample_rate_;
+    float* delay_;
+    size_t delay_len_;
+    size_t delay_pos_;
+    float gain_;
+};
+
+// Streaming spectral noise suppressor. Frames of FRAME_SIZE samples with 50%
+// overlap are windowed, transformed, and every bin is scaled by a
+// spectral-subtraction gain against a minimum-tracking noise floor. Latency
+// is fixed at one frame. Parameters: reduction_db (deepest attenuation),
+// oversubtract, noise_rise_db (floor tracking speed in dB/s). The window,
+// spectrum and gain passes use the SIMD kernels; the FFT butterflies are
+// scalar.
+class NoiseSuppressorStage : public DspStage {
+  public:
+    NoiseSuppressorStage();
+    size_t scratchSize(int sample_rate, size_t max_frames) const override;
+    void prepare(int sample_rate, size_t max_frames, ScratchArena& arena) override;
+    void process(float* block, size_t frames) override;
+    void reset() override;
+    bool setParameter(const std::string& name, float value) override;
+    size_t latencyFrames() const override { return FRAME_SIZE; }
+
+  private:
+    static constexpr size_t FRAME_SIZE = 512;
+    static constexpr size_t HOP = FRAME_SIZE / 2;
+    static constexpr size_t BINS = FRAME_SIZE / 2 + 1;
+
+    std::atomic<float> reduction_db_;
+    std::atomic<float> oversubtract_;
+    std::atomic<float> noise_rise_db_;
+    int sample_rate_;
+    Fft fft_;
+    float* window_;
+    float* input_;      // last FRAME_SIZE input samples
+    float* output_;     // HOP finished samples being played out
+    float* overlap_;    // overlap-add accumulator
+    float* re_;
+    float* im_;
+    float* power_;
+    float* smoothed_;
+    float* noise_;
+    float* gain_;
+    size_t fill_;
+    bool primed_;
+
+    void processFrame();
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "DspChain.h"
+#include <cstddef>
+
+// In-place radix-2 complex FFT on split real/imaginary arrays. Twiddle
+// tables come from a ScratchArena, so a prepared instance never allocates.
+class Fft {
+  public:
+    Fft() : size_(0), cos_(nullptr), sin_(nullptr) {}
+
+    // Floats of scratch needed for a transform of size n
+    static size_t scratchSize(size_t n) { return 2 * ScratchArena::padded(n / 2); }
+
+    // n must be a power of two
+    bool prepare(size_t n, ScratchArena& arena);
+    size_t size() const { return size_; }
+
+    void forward(float* re, float* im) const;
+    // Scaled by 1/n, so inverse(forward(x)) == x
+    void inverse(float* re, float* im) const;
+
+  private:
+    size_t size_;
+    float* cos_;
+    float* sin_;
+
+    void transform(float* re, float* im, float sign) const;
+};
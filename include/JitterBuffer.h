@@ -0,0 +1,82 @@
+#pragma once
+
+#include "AudioFec.h"
+#include "AudioFrame.h"
+#include "ComfortNoise.h"
+#include "OpusCodec.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+struct JitterBufferStats {
+  uint64_t received;
+  uint64_t late;          // arrived after their playout slot
+  uint64_t lost;          // never arrived, concealed
+  uint64_t recovered;     // lost frames rebuilt from Opus FEC data
+  uint64_t repaired;      // missing frames rebuilt from parity or redundant copies
+  uint64_t dropped;       // discarded to bring the depth back down
+  uint64_t comfort_noise; // descriptors received
+  uint64_t sync_adjusted; // samples held back or skipped by synchronized playout
+  size_t streams;
+};
+
+// Loss counters of one sender's stream, for receiver reports
+struct JitterStreamCounters {
+  uint16_t sender_id;
+  uint64_t expected;      // frames received, repaired or concealed
+  uint64_t missing;       // frames the network lost, repaired or not
+};
+
+// Per-sender reordering buffer and mixer for received AUDIO_DATA frames.
+// The network thread push()es frames; the audio thread read()s the mix of
+// every sender. Frames are kept encoded until their playout time, and the
+// two sides only meet through per-slot sequence tags, so neither blocks.
+//
+// Missing frames are first rebuilt from parity or redundant copies (see
+// AudioFec.h) when those arrive in time. Otherwise they are concealed by
+// fading out the previous one, or for Opus streams rebuilt from the next
+// packet's FEC data when it has arrived and otherwise by Opus' own
+// concealment. A comfort noise descriptor switches the sender to locally
+// generated noise until its next talkspurt.
+class JitterBuffer {
+  public:
+    static constexpr size_t MAX_STREAMS = 32;
+    static constexpr size_t MAX_FRAME_SAMPLES = 4096;
+
+    explicit JitterBuffer(int sample_rate = 44100, size_t target_frames = 3);
+    ~JitterBuffer();
+
+    // Network thread. Returns false for malformed or unplaceable frames.
+    bool push(const AudioFrameHeader& header, const uint8_t* payload, size_t bytes);
+
+    // Synchronized playout: every sender's samples are played latency_ns
+    // after their capture time on the media clock, given its SENDER_REPORTs
+    // and the media time passed to read(). 0 plays frames as they come.
+    void setSyncLatency(int64_t latency_ns) { sync_latency_ns_ = latency_ns; }
+    int64_t syncLatency() const { return sync_latency_ns_; }
+    // Network thread. The sender's sample stamped timestamp was captured at
+    // media_time_ns.
+    void setSenderClock(uint16_t sender_id, uint32_t timestamp, int64_t media_time_ns);
+
+    // Audio thread. Overwrites out with the mix of all senders. media_time_ns
+    // is when out[0] will be heard, or -1 if the media clock is unknown.
+    void read(float* out, size_t frames, int64_t media_time_ns = -1);
+
+    JitterBufferStats stats() const;
+    // Writes up to max per-sender counters to out, returns how many
+    size_t streamCounters(JitterStreamCounters* out, size_t max) const;
+    int sampleRate() const { return sample_rate_; }
+
+  private:
+    struct Stream;
+
+    int sample_rate_;
+    size_t target_frames_;
+    std::unique_ptr<std::atomic<Stream*>[]> streams_;
+    std::atomic<size_t> stream_count_;
+    std::atomic<int64_t> sync_latency_ns_;
+    std::unique_ptr<float[]> mix_scratch_;
+
+    Stream* findOrCreate(uint16_t sender_id);
+};
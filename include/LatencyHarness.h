@@ -0,0 +1,60 @@
+#pragma once
+
+#include "AudioCodec.h"
+#include "AudioFec.h"
+#include "LatencyHistogram.h"
+#include "NetworkImpairment.h"
+#include "OpusCodec.h"
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct LatencyHarnessConfig {
+  int port = 18090;
+  int sample_rate = 48000;
+  AudioCodec codec = AudioCodec::PCM16;
+  OpusSettings opus;
+  FecMode fec = FecMode::OFF;
+  size_t fec_group = 4;
+  bool dtx = false;
+  int sync_ms = 0;                // synchronized playout delay, 0 for none
+  ImpairmentConfig impairment;    // applied to what the receiver is sent
+  double warmup_seconds = 2.0;    // clock sync and jitter buffer settle first
+  double duration_seconds = 10.0;
+  int marker_interval_ms = 500;   // must exceed the latency being measured
+};
+
+// Measures mouth-to-ear latency through the real client and server code
+// without audio hardware. A server, a sender and a listen-only receiver
+// run in one process, both clients on the null audio device. The sender's
+// input carries a short chirp every marker interval; a matched filter on
+// the receiver's played output finds them again. Both devices run on the
+// local clock, so each chirp's capture and playout times compare
+// directly. Frames are also timed as they leave the sender and reach the
+// receiver, which splits the total into stages.
+class LatencyHarness {
+  public:
+    explicit LatencyHarness(const LatencyHarnessConfig& config);
+
+    bool run();
+    void printReport(std::ostream& out) const;
+
+    size_t markersSent() const { return markers_sent_; }
+    size_t markersDetected() const { return total_.count(); }
+    const LatencyHistogram& total() const { return total_; }
+
+  private:
+    LatencyHarnessConfig config_;
+    size_t markers_sent_;
+    size_t spurious_;
+    size_t untraced_;     // detected, but its frame was not sent as speech
+    LatencyHistogram total_;
+    LatencyHistogram capture_;
+    LatencyHistogram send_;
+    LatencyHistogram network_;
+    LatencyHistogram playout_;
+    double total_sum_us_;
+    std::vector<std::string> page_faults_;  // per thread role, see pageFaultReport()
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Latencies in microseconds, bucketed log-linearly: exact below 64 us and
+// within 1/32 (about 3%) above that, up to about three days. Recording is
+// an increment, so it is cheap on hot paths; histograms merge by adding.
+class LatencyHistogram {
+  public:
+    LatencyHistogram() : counts_(BUCKETS, 0), total_(0), max_us_(0) {}
+
+    void record(int64_t us) {
+        const uint64_t value = us > 0 ? static_cast<uint64_t>(us) : 0;
+        counts_[bucket(value)]++;
+        total_++;
+        max_us_ = std::max(max_us_, value);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < BUCKETS; ++i) counts_[i] += other.counts_[i];
+        total_ += other.total_;
+        max_us_ = std::max(max_us_, other.max_us_);
+    }
+
+    void clear() {
+        std::fill(counts_.begin(), counts_.end(), 0);
+        total_ = 0;
+        max_us_ = 0;
+    }
+
+    uint64_t count() const { return total_; }
+    uint64_t maxUs() const { return max_us_; }
+
+    // Upper edge of the bucket holding the quantile (0 to 1), never more
+    // than the largest value recorded; 0 when empty
+    uint64_t percentileUs(double quantile) const {
+        if (total_ == 0) return 0;
+        const double wanted = std::min(1.0, std::max(0.0, quantile)) * static_cast<double>(total_);
+        const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(wanted + 0.999999));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += counts_[i];
+            if (seen >= rank) return std::min(upperEdge(i), max_us_);
+        }
+        return max_us_;
+    }
+
+  private:
+    static constexpr size_t LINEAR = 64;        // one bucket per microsecond
+    static constexpr size_t SUB_BUCKETS = 32;   // per power of two above
+    static constexpr size_t OCTAVES = 32;
+    static constexpr size_t BUCKETS = LINEAR + OCTAVES * SUB_BUCKETS;
+
+    std::vector<uint64_t> counts_;
+    uint64_t total_;
+    uint64_t max_us_;
+
+    static size_t bucket(uint64_t value) {
+        if (value < LINEAR) return static_cast<size_t>(value);
+        size_t log2 = 6;
+        while (log2 < 63 && (value >> (log2 + 1)) != 0) ++log2;
+        // Top six bits: the leading one and five bits of sub-bucket
+        const size_t index = LINEAR + (log2 - 6) * SUB_BUCKETS +
+                             static_cast<size_t>((value >> (log2 - 5)) - SUB_BUCKETS);
+        return std::min(index, BUCKETS - 1);
+    }
+
+    static uint64_t upperEdge(size_t index) {
+        if (index < LINEAR) return index;
+        const size_t log2 = (index - LINEAR) / SUB_BUCKETS + 6;
+        const uint64_t sub = (index - LINEAR) % SUB_BUCKETS;
+        return ((SUB_BUCKETS + sub + 1) << (log2 - 5)) - 1;
+    }
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "AudioCodec.h"
+#include "LatencyHistogram.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct LoadGenConfig {
+  std::string host = "127.0.0.1";
+  int port = 8080;
+  size_t clients = 100;
+  size_t speakers = 0;            // the rest connect listen-only; 0 for everyone
+  size_t threads = 4;             // event loops the clients are spread over
+  int sample_rate = 48000;
+  size_t frame_samples = 256;     // one capture callback's worth, as AudioProcessor uses
+  AudioCodec codec = AudioCodec::PCM16;
+  bool dtx = true;                // comfort noise descriptors in pauses, as clients send
+  double talk_seconds = 1.0;      // mean talkspurt and pause, exponentially
+  double pause_seconds = 1.5;     // distributed (a conversational speech model)
+  double ramp_seconds = 5.0;      // clients connect evenly over this long
+  std::string source_path;        // WAV to speak; a synthetic voice without one
+};
+
+// Totals since start(), readable while the load runs
+struct LoadGenCounters {
+  uint64_t connected = 0;
+  uint64_t connect_failures = 0;
+  uint64_t closed_by_server = 0;
+  uint64_t frames_sent = 0;
+  uint64_t descriptors_sent = 0;
+  uint64_t bytes_sent = 0;
+  uint64_t send_drops = 0;        // frames not sent because the server stopped reading
+  uint64_t frames_received = 0;
+  uint64_t bytes_received = 0;
+  uint64_t frames_lost = 0;       // sequence gaps in received streams
+
+  LoadGenCounters& operator+=(const LoadGenCounters& other);
+};
+
+// Simulates many clients in one process for capacity testing. Every
+// simulated client has its own connection and behaves like AudioClient on
+// the wire: it sends a codec hello, speaks on a talk/pause schedule, and
+// counts and times what the server relays to it. Speakers stamp frames
+// from a sample clock shared by the whole process, so a receiver knows
+// when any frame it gets was captured without a clock exchange.
+class LoadGenerator {
+  public:
+    explicit LoadGenerator(const LoadGenConfig& config);
+    ~LoadGenerator();
+
+    bool start();
+    void stop();
+
+    LoadGenCounters counters() const;
+    // After stop(): latency percentiles overall and per client, loss and
+    // fairness across clients
+    void printSummary(std::ostream& out) const;
+
+  private:
+    class EventLoop;
+
+    LoadGenConfig config_;
+    std::vector<float> voice_;      // shared, read-only while running
+    std::vector<std::unique_ptr<EventLoop>> loops_;
+    int64_t epoch_ns_;
+    int64_t started_ns_;
+    int64_t stopped_ns_;
+
+    bool loadVoice();
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+// Single-producer / single-consumer ring for trivially copyable items.
+// Neither side ever blocks, allocates or makes a system call, so it is safe
+// to use from PortAudio callbacks. Capacity is rounded up to a power of two.
+template <typename T>
+class LockFreeRing {
+  static_assert(std::is_trivially_copyable<T>::value, "LockFreeRing requires trivially copyable items");
+
+  public:
+    explicit LockFreeRing(size_t capacity)
+        : capacity_(roundUp(capacity)), mask_(capacity_ - 1), buffer_(new T[capacity_]()),
+          head_(0), tail_(0) {}
+
+    LockFreeRing(const LockFreeRing&) = delete;
+    LockFreeRing& operator=(const LockFreeRing&) = delete;
+
+    // Producer side: writes all items or none
+    bool write(const T* data, size_t count) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        if (capacity_ - (head - tail) < count) return false;
+
+        const size_t start = head & mask_;
+        const size_t first = count < capacity_ - start ? count : capacity_ - start;
+        std::memcpy(buffer_.get() + start, data, first * sizeof(T));
+        std::memcpy(buffer_.get(), data + first, (count - first) * sizeof(T));
+
+        head_.store(head + count, std::memory_order_release);
+        return true;
+    }
+
+    bool push(const T& item) { return write(&item, 1); }
+
+    // Consumer side: reads up to count items, returns how many were read
+    size_t read(T* data, size_t count) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t head = head_.load(std::memory_order_acquire);
+        const size_t n = count < head - tail ? count : head - tail;
+
+        const size_t start = tail & mask_;
+        const size_t first = n < capacity_ - start ? n : capacity_ - start;
+        std::memcpy(data, buffer_.get() + start, first * sizeof(T));
+        std::memcpy(data + first, buffer_.get(), (n - first) * sizeof(T));
+
+        tail_.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    bool pop(T& item) { return read(&item, 1) == 1; }
+
+    size_t available() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+    size_t space() const { return capacity_ - available(); }
+    size_t capacity() const { return capacity_; }
+
+  private:
+    static size_t roundUp(size_t n) {
+        size_t p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<T[]> buffer_;
+
+    alignas(64) std::atomic<size_t> head_;
+    alignas(64) std::atomic<size_t> tail_;
+};
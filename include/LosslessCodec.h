@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Lossless coding of 24-bit samples in short blocks, FLAC style. Each block
+// picks the cheapest of the fixed polynomial predictors and a quantised LPC
+// predictor, and Rice-codes the residual in partitions with their own
+// parameter. Blocks carry their warm-up samples and coefficients, so every
+// block decodes without the ones before it. Digital silence and blocks that
+// do not compress are stored as constant or verbatim blocks.
+constexpr size_t LOSSLESS_BLOCK = 256;
+constexpr size_t LOSSLESS_MAX_ORDER = 8;
+
+// Upper bound of the encoded size of n samples, split into blocks
+size_t losslessMaxBytes(size_t n);
+// Encodes one block of n <= LOSSLESS_BLOCK samples in [-2^23, 2^23).
+// Returns the encoded size.
+size_t encodeLosslessBlock(const int32_t* samples, size_t n, uint8_t* out);
+// Decodes one block of n samples. Returns the bytes it took, 0 if the data
+// is malformed or too short.
+size_t decodeLosslessBlock(const uint8_t* in, size_t bytes, int32_t* samples, size_t n);
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "NetworkManager.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// MULTICAST_OFFER payload: the group the server also delivers relayed
+// audio to. A client that joins it answers with MULTICAST_STATUS once
+// datagrams arrive, and the server then stops unicasting audio to it.
+#pragma pack(push, 1)
+struct MulticastOffer {
+  uint32_t group;       // IPv4 address, network byte order
+  uint16_t port;
+  uint16_t sender_id;   // the client's own id, so it can drop its own frames
+};
+#pragma pack(pop)
+
+static_assert(sizeof(MulticastOffer) == 8, "MulticastOffer is part of the wire format");
+
+// UDP socket for one multicast group. Each datagram carries one Message in
+// the same type/size/data framing as the TCP stream. Loss and reordering
+// are left to the jitter buffer and FEC.
+class MulticastChannel {
+  public:
+    // Largest message that fits a UDP datagram
+    static constexpr size_t MAX_DATAGRAM = 65507;
+
+    MulticastChannel();
+    ~MulticastChannel();
+
+    // Parses "<group>[:<port>]"; port is left alone when not given
+    static bool parseGroup(const std::string& spec, std::string& group, int& port);
+
+    // interface_address selects the outgoing or joining interface; empty
+    // lets the routing table decide
+    bool openSender(const std::string& group, int port, int ttl,
+                    const std::string& interface_address = std::string());
+    bool join(uint32_t group, int port, const std::string& interface_address = std::string());
+    void close();
+    bool isOpen() const { return socket_ != INVALID_SOCKET_VAL; }
+
+    // Safe to call from several threads
+    bool send(const Message& message);
+    // Waits up to timeout_ms. Returns false on timeout, error or a
+    // malformed datagram.
+    bool receive(Message& message, int timeout_ms);
+
+    // Network byte order, as in MulticastOffer
+    uint32_t group() const { return group_addr_.sin_addr.s_addr; }
+    int port() const { return ntohs(group_addr_.sin_port); }
+    std::string describe() const;
+
+  private:
+    SOCKET socket_;
+    sockaddr_in group_addr_;
+    std::mutex send_mutex_;
+    std::vector<uint8_t> send_buffer_;
+    std::vector<uint8_t> receive_buffer_;
+
+    bool resolveInterface(const std::string& interface_address, in_addr& out);
+};
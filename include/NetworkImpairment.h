@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+
+// Shape of the delay added on top of the base delay; jitter is its spread
+enum class DelayDistribution : uint8_t {
+  UNIFORM = 0,    // 0..2 * jitter
+  NORMAL = 1,     // mean jitter, deviation jitter / 2, clipped at 0
+  PARETO = 2      // mean jitter, heavy tail like a congested path
+};
+
+const char* delayDistributionName(DelayDistribution distribution);
+
+// A bad network, as seen by one direction of a connection. Parsed from a
+// comma separated list, percentages in percent:
+//   delay=MS jitter=MS dist=uniform|normal|pareto loss=PCT
+//   burst=ENTER:EXIT (Gilbert-Elliott, PCT per message) burst-loss=PCT
+//   reorder=PCT hold=MS dup=PCT rate=KBPS seed=N
+// e.g. "delay=40,jitter=10,dist=pareto,loss=1,burst=2:30,rate=512"
+struct ImpairmentConfig {
+  double delay_ms = 0.0;
+  double jitter_ms = 0.0;
+  DelayDistribution distribution = DelayDistribution::UNIFORM;
+  double loss = 0.0;          // per message in the good state, 0..1
+  double burst_enter = 0.0;   // good to bad state, per message
+  double burst_exit = 0.0;    // bad to good state, per message
+  double burst_loss = 1.0;    // per message in the bad state
+  double reorder = 0.0;       // held back so later messages overtake it
+  double reorder_hold_ms = 20.0;
+  double duplicate = 0.0;
+  double rate_kbps = 0.0;     // 0 for no bandwidth cap
+  uint64_t seed = 1;
+
+  bool active() const;
+  std::string describe() const;
+};
+
+bool parseImpairment(const std::string& spec, ImpairmentConfig& config);
+
+struct ImpairmentStats {
+  uint64_t messages = 0;
+  uint64_t dropped = 0;
+  uint64_t duplicated = 0;
+  uint64_t reordered = 0;
+  uint64_t delayed_ns = 0;    // total added delay of delivered messages
+
+  ImpairmentStats& operator+=(const ImpairmentStats& other);
+};
+
+// Decides the fate of each message on one impaired link. Only media is
+// lost, duplicated or reordered: the protocol has no recovery for
+// control messages, which keep their order and only see delay and the
+// bandwidth cap. The same seed and message sequence give the same
+// decisions, so runs are repeatable.
+class NetworkImpairment {
+  public:
+    static constexpr size_t MAX_DELIVERIES = 2;
+
+    NetworkImpairment(const ImpairmentConfig& config, uint64_t link);
+
+    // Fills due with when the message is delivered, on the
+    // monotonicNowNs() clock; returns how many copies, 0 if lost
+    size_t plan(bool media, size_t bytes, int64_t now_ns, int64_t due[MAX_DELIVERIES]);
+
+    const ImpairmentStats& stats() const { return stats_; }
+
+  private:
+    ImpairmentConfig config_;
+    std::mt19937_64 random_;
+    bool bad_state_;
+    int64_t link_free_ns_;    // end of the last message on the capped link
+    int64_t last_due_ns_;     // in-order messages never overtake this
+    ImpairmentStats stats_;
+
+    double uniform();
+    int64_t addedDelayNs();
+    bool lose();
+};
@@ -1,10 +1,16 @@
 #pragma once
 
+#include "NetworkImpairment.h"
+#include "SessionLogger.h"
 #include <string>
 #include <vector>
 #include <functional>
 #include <thread>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <map>
+#include <memory>
 
 // Cross-platform socket includes
 #ifdef _WIN32
@@ -21,6 +27,7 @@
 #else
     #include <sys/socket.h>
     #include <netinet/in.h>
+    #include <netinet/tcp.h>
     #include <arpa/inet.h>
     #include <unistd.h>
     typedef int SOCKET;
@@ -35,7 +42,15 @@ enum class MessageType : uint8_t {
   DISCONNECT = 2, 
   AUDIO_DATA = 3,
   HEARTBEAT = 4, 
-  CLIENT_READY = 5
+  CLIENT_READY = 5,
+  CODEC_SELECT = 6,   // server to client: one byte, the AudioCodec to send
+  RECEIVER_REPORT = 7, // client to server: ReceiverReportEntry per sender heard
+  LOSS_REPORT = 8,    // server to client: one byte, worst loss reported for its stream
+  SENDER_REPORT = 9,  // SenderReport, relayed to the other clients like AUDIO_DATA
+  MULTICAST_OFFER = 10, // server to client: MulticastOffer
+  MULTICAST_STATUS = 11, // client to server: one byte, 1 while group datagrams arrive, 0 to fall back
+  SUBSCRIBE = 12,     // client to server: uint16_t sender ids to receive, none for everyone
+  UNSUBSCRIBE = 13    // client to server: uint16_t sender ids to stop receiving, none for everyone
 };
 
 
@@ -53,22 +68,39 @@ class NetworkManager {
     ~NetworkManager();
 
     //client Methods
-    bool connectToServer(const std::string& host, int port);
+    // hello is sent as the CONNECT payload
+    bool connectToServer(const std::string& host, int port,
+                         const std::vector<uint8_t>& hello = std::vector<uint8_t>());
     void disconnect();
+    // Wakes a thread blocked receiving on the connection; sending still works
+    void stopReceiving();
 
     //server methods
     bool startServer(int port);
     void stopServer();
     
     //common methods
+    // Safe to call from several threads
     bool sendMessage(const Message& message, SOCKET socket_fd = INVALID_SOCKET_VAL);
+    // Calls stamp on the message once the socket is free to write, so a
+    // send time it records excludes the wait for other senders
+    bool sendStamped(Message& message, SOCKET socket_fd, const std::function<void(Message&)>& stamp);
     bool receiveMessage(Message& message, SOCKET socket_fd = INVALID_SOCKET_VAL);
     
-    void setMessageHandler(std::function<void(const Message&, SOCKET)> handler);
+    // The handler may modify the message in place; it is discarded after
+    void setMessageHandler(std::function<void(Message&, SOCKET)> handler);
+    void setLogger(SessionLogger* logger) { logger_ = logger; }
     bool isConnected() const;
 
     SOCKET getClientSocket() const {return client_socket_;}
 
+    // Emulates a bad network on this end of every connection, for testing
+    // transport, FEC and jitter handling without netem. Set before
+    // connecting or starting the server.
+    void setImpairment(const ImpairmentConfig& send, const ImpairmentConfig& receive);
+    ImpairmentStats sendImpairmentStats() const;
+    ImpairmentStats receiveImpairmentStats() const;
+
   private:
     SOCKET server_socket_;
     SOCKET client_socket_;
@@ -76,13 +108,64 @@ class NetworkManager {
     std::atomic<bool> running_;
 
     std::thread accept_thread_;
-    std::function<void(const Message&, SOCKET)> message_handler_;
+    std::function<void(Message&, SOCKET)> message_handler_;
+    // Messages go out in several writes; keep concurrent senders to a
+    // socket from interleaving them. One lock per socket, so a peer that
+    // stops reading stalls only its own senders.
+    std::map<SOCKET, std::shared_ptr<std::mutex>> send_locks_;
+    std::mutex send_locks_mutex_;
+    SessionLogger* logger_;
+
+    // Impaired sends wait in outgoing_ for the delivery thread; impaired
+    // receives are held in their link's pending queue until due
+    struct ReceiveLink {
+      NetworkImpairment impairment;
+      std::multimap<std::pair<int64_t, uint64_t>, Message> pending;
+      uint64_t order;
+    };
+    struct Outgoing {
+      SOCKET socket_fd;
+      Message message;
+    };
+    ImpairmentConfig send_impairment_;
+    ImpairmentConfig receive_impairment_;
+    std::map<SOCKET, NetworkImpairment> send_links_;
+    std::map<SOCKET, std::unique_ptr<ReceiveLink>> receive_links_;
+    std::multimap<std::pair<int64_t, uint64_t>, Outgoing> outgoing_;   // by due time, then order sent
+    uint64_t outgoing_order_;
+    uint64_t links_opened_;
+    ImpairmentStats closed_send_stats_;
+    ImpairmentStats closed_receive_stats_;
+    bool delivery_stop_;
+    std::thread delivery_thread_;
+    mutable std::mutex impairment_mutex_;
+    std::condition_variable delivery_cv_;
+    // Held while a queued message is written, so its socket is not closed
+    // under it
+    std::mutex delivery_mutex_;
+
+    bool sendNow(const Message& message, SOCKET socket_fd);
+    std::shared_ptr<std::mutex> sendLock(SOCKET socket_fd);
+    // Writes one framed message; the caller holds the socket's send lock
+    bool writeMessage(const Message& message, SOCKET socket_fd);
+    bool receiveNow(Message& message, SOCKET socket_fd);
+    bool sendImpaired(const Message& message, SOCKET socket_fd);
+    bool receiveImpaired(Message& message, SOCKET socket_fd);
+    void deliveryLoop();
+    // Ends the delivery thread; what is still queued goes out at once
+    // with flush, else it is dropped
+    void stopDelivery(bool flush);
+    void forgetLink(SOCKET socket_fd);
+    bool waitReadable(SOCKET socket_fd, int64_t timeout_ns);
 
     void acceptClients();
     void handleClient(SOCKET client_fd);
     bool sendRaw(const void* data, size_t size, SOCKET socket_fd);
     bool receiveRaw(void* data, size_t size, SOCKET socket_fd);
     
+    // Frames are small and latency-critical; don't let Nagle hold them back
+    void disableNagle(SOCKET socket_fd);
+
     // Cross-platform socket initialization
     bool initializeNetworking();
     void cleanupNetworking();
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+struct OpusEncoder;
+struct OpusDecoder;
+
+// Largest packet Opus produces for one frame
+constexpr size_t OPUS_MAX_PACKET = 1275;
+
+struct OpusSettings {
+  int bitrate = 32000;       // bits per second
+  int complexity = 5;        // 0-10
+  int frame_ms = 20;         // 10 or 20
+  bool fec = true;           // in-band forward error correction
+  int expected_loss = 10;    // percent; FEC is only emitted when this is non-zero
+  bool dtx = false;
+};
+
+// False when the build has no libopus (AUDSYNC_HAVE_OPUS unset)
+bool opusAvailable();
+// Opus only runs at 8, 12, 16, 24 or 48 kHz
+bool opusSupportsRate(int sample_rate);
+
+// Mono Opus encoder for one outgoing stream. Opus is stateful, so unlike
+// encodeAudio() one instance must see every frame of its stream.
+class OpusFrameEncoder {
+  public:
+    OpusFrameEncoder();
+    ~OpusFrameEncoder();
+
+    bool configure(int sample_rate, const OpusSettings& settings);
+    bool isConfigured() const { return encoder_ != nullptr; }
+    // Takes effect from the next frame
+    bool setBitrate(int bitrate);
+    bool setExpectedLoss(int percent);
+
+    size_t frameSamples() const { return frame_samples_; }
+    // Encodes exactly frameSamples() samples. Returns the packet size, 0 on error.
+    size_t encode(const float* in, uint8_t* out, size_t max_bytes);
+
+  private:
+    OpusEncoder* encoder_;
+    size_t frame_samples_;
+};
+
+// Decoder for one incoming stream. Lost frames are rebuilt from the FEC
+// data in the following packet when it is there, else concealed.
+class OpusFrameDecoder {
+  public:
+    OpusFrameDecoder();
+    ~OpusFrameDecoder();
+
+    bool configure(int sample_rate);
+    bool isConfigured() const { return decoder_ != nullptr; }
+    // Does not allocate; safe on the audio thread
+    void reset();
+
+    // Each returns the number of samples written to out, 0 on error
+    size_t decode(const uint8_t* packet, size_t bytes, float* out, size_t max_samples);
+    // Rebuilds the samples of a lost frame from the packet after it
+    size_t recover(const uint8_t* next_packet, size_t bytes, float* out, size_t samples);
+    size_t conceal(float* out, size_t samples);
+
+  private:
+    OpusDecoder* decoder_;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "ThreadPolicy.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct RealtimeMemoryConfig {
+  bool lock = false;              // mlockall, so nothing is paged out
+  bool huge_pages = false;        // back the heap reserve with transparent huge pages
+  size_t reserve_bytes = 64u << 20;  // heap prefaulted up front and never returned
+};
+
+// Startup phase that keeps real-time threads from page faulting. The heap
+// is grown by the reserve and every page touched, and freed memory is
+// never handed back to the OS, so the rings, pools, codec state and DSP
+// scratch allocated later come from memory that is already mapped.
+// Optionally everything is locked. Call before any thread starts; prints
+// what it could do and carries on without what it could not.
+void prepareRealtimeMemory(const RealtimeMemoryConfig& config);
+bool realtimeMemoryPrepared();
+
+// Called when a thread of the role starts (applyThreadPolicy does it).
+// Prefaults the top of the stack once memory is prepared, and counts the
+// thread's page faults for pageFaultReport().
+void prepareThreadMemory(ThreadRole role);
+
+// For threads we do not own, such as PortAudio's callback threads: only
+// notes the thread id in a preallocated slot, without locking, allocating
+// or touching the stack. pageFaultReport() reads /proc for it later and
+// counts its faults from then on. Their stacks are left as PortAudio
+// made them.
+void trackCallbackThread(ThreadRole role);
+
+// Minor and major faults per role since the previous report, one line per
+// role with live threads. Only Linux counts faults per thread.
+std::vector<std::string> pageFaultReport();
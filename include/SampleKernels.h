@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Per-lane xorshift generators for TPDF dither. Sample i always draws from
+// lane i % 16, so every implementation produces the same dither sequence.
+struct DitherState {
+  uint32_t lanes[16];
+  explicit DitherState(uint32_t seed = 0x9E3779B9u);
+};
+
+// One implementation of every sample kernel. Float samples are nominally in
+// [-1, 1]; int24 samples are packed little-endian, 3 bytes each.
+struct SampleKernelTable {
+  const char* name;
+
+  // dither may be null for plain rounding
+  void (*floatToInt16)(const float* src, int16_t* dst, size_t n, DitherState* dither);
+  void (*int16ToFloat)(const int16_t* src, float* dst, size_t n);
+  void (*floatToInt24)(const float* src, uint8_t* dst, size_t n, DitherState* dither);
+  void (*int24ToFloat)(const uint8_t* src, float* dst, size_t n);
+  // G.711 companding on the int16 scale
+  void (*floatToUlaw)(const float* src, uint8_t* dst, size_t n);
+  void (*ulawToFloat)(const uint8_t* src, float* dst, size_t n);
+  void (*floatToAlaw)(const float* src, uint8_t* dst, size_t n);
+  void (*alawToFloat)(const uint8_t* src, float* dst, size_t n);
+  // IEEE half precision, round to nearest even
+  void (*floatToHalf)(const float* src, uint16_t* dst, size_t n);
+  void (*halfToFloat)(const uint16_t* src, float* dst, size_t n);
+
+  void (*applyGain)(float* buf, size_t n, float gain);
+  // buf[i] *= start + step * (i + 1)
+  void (*applyRamp)(float* buf, size_t n, float start, float step);
+  // dst[i] = clamp(dst[i] + src[i] * gain, -1, 1)
+  void (*mixAccumulate)(float* dst, const float* src, size_t n, float gain);
+
+  // dst[i] *= src[i]
+  void (*multiply)(float* dst, const float* src, size_t n);
+  // dst[i] += a[i] * b[i]
+  void (*multiplyAdd)(float* dst, const float* a, const float* b, size_t n);
+  // dst[i] = re[i]^2 + im[i]^2
+  void (*magnitudeSquared)(const float* re, const float* im, float* dst, size_t n);
+
+  float (*peak)(const float* src, size_t n);
+  float (*sumSquares)(const float* src, size_t n);
+
+  void (*interleave2)(const float* left, const float* right, float* dst, size_t frames);
+  void (*deinterleave2)(const float* src, float* left, float* right, size_t frames);
+};
+
+// Runtime-dispatched sample kernels. The best implementation the CPU and the
+// build support is picked at startup from CPUID; AUDSYNC_SIMD=scalar|sse2|
+// avx2|avx512 in the environment caps the choice.
+class SampleKernels {
+  public:
+    enum class Isa { SCALAR = 0, SSE2 = 1, AVX2 = 2, AVX512 = 3 };
+
+    static const SampleKernelTable& active();
+    static Isa activeIsa();
+    // nullptr if the build or the CPU lacks the instruction set
+    static const SampleKernelTable* table(Isa isa);
+    static const char* isaName(Isa isa);
+
+    static void floatToInt16(const float* src, int16_t* dst, size_t n, DitherState* dither = nullptr) {
+      active().floatToInt16(src, dst, n, dither);
+    }
+    static void int16ToFloat(const int16_t* src, float* dst, size_t n) {
+      active().int16ToFloat(src, dst, n);
+    }
+    static void floatToInt24(const float* src, uint8_t* dst, size_t n, DitherState* dither = nullptr) {
+      active().floatToInt24(src, dst, n, dither);
+    }
+    static void int24ToFloat(const uint8_t* src, float* dst, size_t n) {
+      active().int24ToFloat(src, dst, n);
+    }
+    static void floatToUlaw(const float* src, uint8_t* dst, size_t n) {
+      active().floatToUlaw(src, dst, n);
+    }
+    static void ulawToFloat(const uint8_t* src, float* dst, size_t n) {
+      active().ulawToFloat(src, dst, n);
+    }
+    static void floatToAlaw(const float* src, uint8_t* dst, size_t n) {
+      active().floatToAlaw(src, dst, n);
+    }
+    static void alawToFloat(const uint8_t* src, float* dst, size_t n) {
+      active().alawToFloat(src, dst, n);
+    }
+    static void floatToHalf(const float* src, uint16_t* dst, size_t n) {
+      active().floatToHalf(src, dst, n);
+    }
+    static void halfToFloat(const uint16_t* src, float* dst, size_t n) {
+      active().halfToFloat(src, dst, n);
+    }
+    static void applyGain(float* buf, size_t n, float gain) {
+      active().applyGain(buf, n, gain);
+    }
+    static void applyRamp(float* buf, size_t n, float start, float step) {
+      active().applyRamp(buf, n, start, step);
+    }
+    static void mixAccumulate(float* dst, const float* src, size_t n, float gain = 1.0f) {
+      active().mixAccumulate(dst, src, n, gain);
+    }
+    static void multiply(float* dst, const float* src, size_t n) {
+      active().multiply(dst, src, n);
+    }
+    static void multiplyAdd(float* dst, const float* a, const float* b, size_t n) {
+      active().multiplyAdd(dst, a, b, n);
+    }
+    static void magnitudeSquared(const float* re, const float* im, float* dst, size_t n) {
+      active().magnitudeSquared(re, im, dst, n);
+    }
+    static float peak(const float* src, size_t n) {
+      return active().peak(src, n);
+    }
+    static float sumSquares(const float* src, size_t n) {
+      return active().sumSquares(src, n);
+    }
+    static void interleave2(const float* left, const float* right, float* dst, size_t frames) {
+      active().interleave2(left, right, dst, frames);
+    }
+    static void deinterleave2(const float* src, float* left, float* right, size_t frames) {
+      active().deinterleave2(src, left, right, frames);
+    }
+};
+
+// Defined by the per-ISA translation units; return nullptr when the
+// instruction set was not enabled for this build
+const SampleKernelTable* scalarSampleKernels();
+const SampleKernelTable* sse2SampleKernels();
+const SampleKernelTable* avx2SampleKernels();
+const SampleKernelTable* avx512SampleKernels();
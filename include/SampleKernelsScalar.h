@@ -0,0 +1,259 @@
+#pragma once
+
+// Scalar reference kernels. Shared by the scalar table and by the vector
+// implementations for their tails; first is the absolute sample index so
+// dither lanes line up with the vector loops.
+//
+// Everything here is static and avoids the std:: inline templates: each
+// ISA's translation unit is built with its own -m flags, and a shared
+// weak copy compiled for AVX-512 could otherwise be linked into the
+// scalar table.
+
+#include "SampleKernels.h"
+#include <math.h>
+#include <cstring>
+
+static inline float clampFloat(float x, float lo, float hi) {
+  return x < lo ? lo : (x > hi ? hi : x);
+}
+
+static inline float maxFloat(float a, float b) {
+  return a < b ? b : a;
+}
+
+static inline uint32_t ditherNext(uint32_t& x) {
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return x;
+}
+
+// Triangular dither in (-1, 1) LSB from the two halves of one draw
+static inline float ditherTpdf(uint32_t r) {
+  return static_cast<float>(static_cast<int32_t>(r & 0xFFFF) - static_cast<int32_t>(r >> 16)) * (1.0f / 65536.0f);
+}
+
+static inline void scalarFloatToInt16(const float* src, int16_t* dst, size_t n, DitherState* dither, size_t first = 0) {
+  for (size_t i = first; i < n; ++i) {
+    float y = src[i] * 32767.0f;
+    if (dither) y += ditherTpdf(ditherNext(dither->lanes[i & 15]));
+    y = clampFloat(y, -32768.0f, 32767.0f);
+    dst[i] = static_cast<int16_t>(lrintf(y));
+  }
+}
+
+static inline void scalarInt16ToFloat(const int16_t* src, float* dst, size_t n, size_t first = 0) {
+  for (size_t i = first; i < n; ++i) {
+    dst[i] = static_cast<float>(src[i]) * (1.0f / 32768.0f);
+  }
+}
+
+static inline void scalarFloatToInt24(const float* src, uint8_t* dst, size_t n, DitherState* dither, size_t first = 0) {
+  for (size_t i = first; i < n; ++i) {
+    float y = src[i] * 8388607.0f;
+    if (dither) y += ditherTpdf(ditherNext(dither->lanes[i & 15]));
+    y = clampFloat(y, -8388608.0f, 8388607.0f);
+    const int32_t v = static_cast<int32_t>(lrintf(y));
+    dst[3 * i] = static_cast<uint8_t>(v);
+    dst[3 * i + 1] = static_cast<uint8_t>(v >> 8);
+    dst[3 * i + 2] = static_cast<uint8_t>(v >> 16);
+  }
+}
+
+static inline void scalarInt24ToFloat(const uint8_t* src, float* dst, size_t n, size_t first = 0) {
+  for (size_t i = first; i < n; ++i) {
+    const uint32_t u = static_cast<uint32_t>(src[3 * i]) << 8 |
+                       static_cast<uint32_t>(src[3 * i + 1]) << 16 |
+                       static_cast<uint32_t>(src[3 * i + 2]) << 24;
+    dst[i] = static_cast<float>(static_cast<int32_t>(u) >> 8) * (1.0f / 8388608.0f);
+  }
+}
+
+// G.711 works on int16 samples. Segment and mantissa are the exponent and
+// top four mantissa bits of the magnitude converted to float, which lets
+// the vector versions encode without a leading-zero count.
+static inline int32_t g711Quantize(float x) {
+  return static_cast<int32_t>(lrintf(clampFloat(x * 32767.0f, -32768.0f, 32767.0f)));
+}
+
+static inline uint32_t floatBits(float f) {
+  uint32_t bits;
+  std::memcpy(&bits, &f, sizeof(bits));
+  return bits;
+}
+
+static inline uint8_t ulawEncode(int32_t s) {
+  const uint32_t sign = s < 0 ? 0x80 : 0;
+  const int32_t magnitude = s < 0 ? -s : s;
+  const int32_t mag = (magnitude < 32635 ? magnitude : 32635) + 132;
+  const uint32_t bits = floatBits(static_cast<float>(mag));
+  const uint32_t exponent = (bits >> 23) - 134;
+  const uint32_t mantissa = (bits >> 19) & 0x0F;
+  return static_cast<uint8_t>(~(sign | exponent << 4 | mantissa));
+}
+
+static inline int16_t ulawDecode(uint8_t code) {
+  const uint32_t u = ~code & 0xFFu;
+  const int32_t t = static_cast<int32_t>(((u & 0x0F) << 3) + 0x84) << ((u & 0x70) >> 4);
+  return static_cast<int16_t>((u & 0x80) ? 0x84 - t : t - 0x84);
+}
+
+static inline uint8_t alawEncode(int32_t s) {
+  int32_t v = s >> 3;
+  uint32_t mask = 0xD5;
+  if (v < 0) {
+    mask = 0x55;
+    v = -v - 1;
+  }
+  uint32_t segment = 0;
+  uint32_t mantissa = static_cast<uint32_t>(v) >> 1;
+  if (v >= 32) {
+    const uint32_t bits = floatBits(static_cast<float>(v));
+    segment = (bits >> 23) - 131;
+    mantissa = (bits >> 19) & 0x0F;
+  }
+  return static_cast<uint8_t>((segment << 4 | mantissa) ^ mask);
+}
+
+static inline int16_t alawDecode(uint8_t code) {
+  const uint32_t a = code ^ 0x55u;
+  int32_t t = static_cast<int32_t>((a & 0x0F) << 4);
+  const uint32_t segment = (a & 0x70) >> 4;
+  if (segment == 0) {
+    t += 8;
+  } else {
+    t = (t + 0x108) << (segment - 1);
+  }
+  return static_cast<int16_t>((a & 0x80) ? t : -t);
+}
+
+// Decoded G.711 values as floats, indexed by code
+static inline const float* ulawTable() {
+  static const struct Table {
+    float values[256];
+    Table() { for (int i = 0; i < 256; ++i) values[i] = ulawDecode(static_cast<uint8_t>(i)) * (1.0f / 32768.0f); }
+  } table;
+  return table.values;
+}
+
+static inline const float* alawTable() {
+  static const struct Table {
+    float values[256];
+    Table() { for (int i = 0; i < 256; ++i) values[i] = alawDecode(static_cast<uint8_t>(i)) * (1.0f / 32768.0f); }
+  } table;
+  return table.values;
+}
+
+static inline void scalarFloatToUlaw(const float* src, uint8_t* dst, size_t n, size_t first = 0) {
+  for (size_t i = first; i < n; ++i) dst[i] = ulawEncode(g711Quantize(src[i]));
+}
+
+static inline void scalarUlawToFloat(const uint8_t* src, float* dst, size_t n, size_t first = 0) {
+  const float* table = ulawTable();
+  for (size_t i = first; i < n; ++i) dst[i] = table[src[i]];
+}
+
+static inline void scalarFloatToAlaw(const float* src, uint8_t* dst, size_t n, size_t first = 0) {
+  for (size_t i = first; i < n; ++i) dst[i] = alawEncode(g711Quantize(src[i]));
+}
+
+static inline void scalarAlawToFloat(const uint8_t* src, float* dst, size_t n, size_t first = 0) {
+  const float* table = alawTable();
+  for (size_t i = first; i < n; ++i) dst[i] = table[src[i]];
+}
+
+static inline float floatFromBits(uint32_t bits) {
+  float f;
+  std::memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+
+// Half precision conversion with integer operations and one float add for
+// the subnormal range. NaNs become the canonical quiet NaN.
+constexpr uint32_t HALF_DENORM_MAGIC = ((127 - 15) + (23 - 10) + 1) << 23;
+
+static inline uint16_t floatToHalfBits(float value) {
+  uint32_t x = floatBits(value);
+  const uint32_t sign = x & 0x80000000u;
+  x ^= sign;
+  uint32_t h;
+  if (x >= (127 + 16) << 23) {
+    h = x > 0x7F800000u ? 0x7E00 : 0x7C00;
+  } else if (x < 113u << 23) {
+    h = floatBits(floatFromBits(x) + floatFromBits(HALF_DENORM_MAGIC)) - HALF_DENORM_MAGIC;
+  } else {
+    const uint32_t odd = (x >> 13) & 1;
+    h = (x + ((15u - 127u) << 23) + 0xFFF + odd) >> 13;
+  }
+  return static_cast<uint16_t>(h | sign >> 16);
+}
+
+static inline float halfBitsToFloat(uint16_t h) {
+  uint32_t x = static_cast<uint32_t>(h & 0x7FFF) << 13;
+  const uint32_t exponent = x & (0x7C00u << 13);
+  x += (127 - 15) << 23;
+  if (exponent == 0x7C00u << 13) {
+    x += (128 - 16) << 23;
+  } else if (exponent == 0) {
+    x = floatBits(floatFromBits(x + (1 << 23)) - floatFromBits(113u << 23));
+  }
+  return floatFromBits(x | static_cast<uint32_t>(h & 0x8000) << 16);
+}
+
+static inline void scalarFloatToHalf(const float* src, uint16_t* dst, size_t n, size_t first = 0) {
+  for (size_t i = first; i < n; ++i) dst[i] = floatToHalfBits(src[i]);
+}
+
+static inline void scalarHalfToFloat(const uint16_t* src, float* dst, size_t n, size_t first = 0) {
+  for (size_t i = first; i < n; ++i) dst[i] = halfBitsToFloat(src[i]);
+}
+
+static inline void scalarApplyGain(float* buf, size_t n, float gain, size_t first = 0) {
+  for (size_t i = first; i < n; ++i) buf[i] *= gain;
+}
+
+static inline void scalarApplyRamp(float* buf, size_t n, float start, float step, size_t first = 0) {
+  for (size_t i = first; i < n; ++i) buf[i] *= start + step * static_cast<float>(i + 1);
+}
+
+static inline void scalarMixAccumulate(float* dst, const float* src, size_t n, float gain, size_t first = 0) {
+  for (size_t i = first; i < n; ++i) {
+    dst[i] = clampFloat(dst[i] + src[i] * gain, -1.0f, 1.0f);
+  }
+}
+
+static inline void scalarMultiply(float* dst, const float* src, size_t n, size_t first = 0) {
+  for (size_t i = first; i < n; ++i) dst[i] *= src[i];
+}
+
+static inline void scalarMultiplyAdd(float* dst, const float* a, const float* b, size_t n, size_t first = 0) {
+  for (size_t i = first; i < n; ++i) dst[i] += a[i] * b[i];
+}
+
+static inline void scalarMagnitudeSquared(const float* re, const float* im, float* dst, size_t n, size_t first = 0) {
+  for (size_t i = first; i < n; ++i) dst[i] = re[i] * re[i] + im[i] * im[i];
+}
+
+static inline float scalarPeak(const float* src, size_t n, size_t first = 0, float peak = 0.0f) {
+  for (size_t i = first; i < n; ++i) peak = maxFloat(peak, fabsf(src[i]));
+  return peak;
+}
+
+static inline float scalarSumSquares(const float* src, size_t n, size_t first = 0, float sum = 0.0f) {
+  for (size_t i = first; i < n; ++i) sum += src[i] * src[i];
+  return sum;
+}
+
+static inline void scalarInterleave2(const float* left, const float* right, float* dst, size_t frames, size_t first = 0) {
+  for (size_t i = first; i < frames; ++i) {
+    dst[2 * i] = left[i];
+    dst[2 * i + 1] = right[i];
+  }
+}
+
+static inline void scalarDeinterleave2(const float* src, float* left, float* right, size_t frames, size_t first = 0) {
+  for (size_t i = first; i < frames; ++i) {
+    left[i] = src[2 * i];
+    right[i] = src[2 * i + 1];
+  }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "LockFreeRing.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct CaptureFileHeader {
+  char magic[4];           // "ASCP"
+  uint32_t version;
+  uint64_t wall_clock_ns;  // system clock at steady_base_ns
+  uint64_t steady_base_ns;
+};
+static_assert(sizeof(CaptureFileHeader) == 24, "CaptureFileHeader is part of the file format");
+
+// Precedes each captured message's payload. Connections are numbered from
+// 1 in the order they first sent something, so a reused socket is still a
+// new connection. A record of type CAPTURE_CONNECTION_CLOSED with no
+// payload marks where a connection's thread ended.
+#pragma pack(push, 1)
+struct CaptureRecordHeader {
+  uint64_t arrival_ns;     // since steady_base_ns
+  uint32_t connection;
+  uint32_t size;           // payload bytes that follow
+  uint8_t type;            // MessageType
+};
+#pragma pack(pop)
+static_assert(sizeof(CaptureRecordHeader) == 17, "CaptureRecordHeader is part of the file format");
+
+constexpr uint8_t CAPTURE_CONNECTION_CLOSED = 0;
+
+// Records every message a server receives into an append-only file for
+// audsync_replay. Like SessionLogger, record() copies into a per-thread
+// lock-free ring, and the server reads each connection on its own thread,
+// so a ring holds one connection. A background thread merges the rings in
+// arrival order and appends them. If the disk falls behind, full rings
+// drop messages and count them rather than stall the connection.
+class SessionCapture {
+  public:
+    SessionCapture();
+    ~SessionCapture();
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return running_; }
+
+    void record(uint8_t type, const uint8_t* payload, uint32_t size);
+
+    uint64_t capturedMessages() const { return captured_.load(std::memory_order_relaxed); }
+    uint64_t droppedMessages() const { return dropped_.load(std::memory_order_relaxed); }
+
+  private:
+    struct ConnectionRing;
+
+    const uint64_t instance_id_;
+    FILE* file_;
+    CaptureFileHeader header_;
+
+    std::mutex rings_mutex_;
+    std::vector<std::shared_ptr<ConnectionRing>> rings_;
+    uint32_t next_connection_;
+
+    std::atomic<bool> running_;
+    std::atomic<uint64_t> captured_;
+    std::atomic<uint64_t> dropped_;
+    std::thread writer_thread_;
+    std::vector<uint8_t> batch_;  // whole records, merged before sorting
+
+    ConnectionRing* threadRing();
+    void writerLoop();
+    void flushPending();
+};
+
+// Reads a capture back one message at a time
+class CaptureReader {
+  public:
+    CaptureReader() : file_(nullptr), header_{} {}
+    ~CaptureReader();
+
+    bool open(const std::string& path);
+    void close();
+    const CaptureFileHeader& header() const { return header_; }
+
+    // False at the end of the file or on a truncated record
+    bool next(CaptureRecordHeader& record, std::vector<uint8_t>& payload);
+    bool rewind();
+
+  private:
+    FILE* file_;
+    CaptureFileHeader header_;
+};
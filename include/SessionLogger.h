@@ -0,0 +1,109 @@
+#pragma once
+
+#include "LockFreeRing.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class LogEvent : uint16_t {
+  SERVER_STARTED = 1,
+  SERVER_STOPPED = 2,
+  SERVER_STATUS = 3,
+  CLIENT_ACCEPTED = 4,
+  CLIENT_CLOSED = 5,
+  ACCEPT_FAILED = 6,
+  CLIENT_JOINED = 7,
+  CLIENT_LEFT = 8,
+  CLIENT_READY = 9,
+  AUDIO_STARTED = 10,
+  AUDIO_STOPPED = 11,
+  RECORDING_STARTED = 12,
+  RECORDING_STOPPED = 13,
+  PLAYBACK_STARTED = 14,
+  PLAYBACK_STOPPED = 15,
+  CONNECTION_LOST = 16,
+  CODEC_SELECTED = 17,
+  FEC_ADAPTED = 18,
+  CLOCK_SYNCED = 19,
+  MULTICAST_JOINED = 20,
+  MULTICAST_LEFT = 21
+};
+
+// Fixed-size binary log record. Arguments are interpreted by the event's
+// format string, see SessionLogger::formatMessage.
+struct LogRecord {
+  uint64_t timestamp_ns;   // steady clock
+  uint16_t event;
+  uint16_t thread_id;
+  uint32_t reserved;
+  int64_t args[4];
+};
+static_assert(sizeof(LogRecord) == 48, "LogRecord layout is part of the file format");
+
+struct LogFileHeader {
+  char magic[4];           // "ASLG"
+  uint32_t version;
+  uint64_t wall_clock_ns;  // system clock at steady_base_ns
+  uint64_t steady_base_ns;
+};
+
+// Asynchronous session logger. log() copies one record into a per-thread
+// lock-free ring (a few tens of nanoseconds, safe from audio callbacks);
+// a background thread merges the rings, appends the binary records to the
+// log file and optionally echoes them as text to the console.
+class SessionLogger {
+  public:
+    SessionLogger(bool echo_to_console = true);
+    ~SessionLogger();
+
+    // Without a path the logger only echoes to the console
+    bool open(const std::string& path = std::string());
+    void close();
+
+    void log(LogEvent event, int64_t a0 = 0, int64_t a1 = 0, int64_t a2 = 0, int64_t a3 = 0);
+
+    // Pre-registers the calling thread so its first log() does not allocate
+    void registerThread();
+
+    uint64_t droppedRecords() const { return dropped_.load(std::memory_order_relaxed); }
+
+    static std::string formatMessage(const LogRecord& record);
+    static std::string formatRecord(const LogRecord& record, const LogFileHeader& header);
+
+  private:
+    struct ThreadRing;
+
+    const uint64_t instance_id_;
+    bool echo_;
+    FILE* file_;
+    LogFileHeader header_;
+
+    std::mutex rings_mutex_;
+    std::vector<std::shared_ptr<ThreadRing>> rings_;
+    uint16_t next_thread_id_;
+
+    std::atomic<bool> running_;
+    std::atomic<uint64_t> dropped_;
+    std::thread flush_thread_;
+    std::vector<LogRecord> batch_;
+
+    ThreadRing* threadRing();
+    void flushLoop();
+    void flushPending();
+};
+
+// Convenience for components whose logger is optional
+inline void logEvent(SessionLogger* logger, LogEvent event,
+                     int64_t a0 = 0, int64_t a1 = 0, int64_t a2 = 0, int64_t a3 = 0) {
+  if (logger) logger->log(event, a0, a1, a2, a3);
+}
+
+// Called where a thread starts, so its first log() never allocates
+inline void registerLogThread(SessionLogger* logger) {
+  if (logger) logger->registerThread();
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "LatencyHistogram.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+struct ReplayConfig {
+  std::string host = "127.0.0.1";
+  int port = 8080;
+  double speed = 1.0;             // 2 plays twice as fast; 0 as fast as the server takes it
+};
+
+struct ReplayStats {
+  uint64_t connections = 0;
+  uint64_t connect_failures = 0;
+  uint64_t closed_by_server = 0;
+  uint64_t messages = 0;
+  uint64_t bytes = 0;
+  uint64_t skipped = 0;           // messages for connections that could not be opened or were closed
+  uint64_t bytes_received = 0;    // what the server sent back, read and discarded
+  double capture_seconds = 0.0;   // first to last captured arrival
+  double elapsed_seconds = 0.0;
+  LatencyHistogram lateness;      // how far behind its schedule each message went out
+
+  void print(std::ostream& out, double speed) const;
+};
+
+// Plays a SessionCapture file into a server. Every captured connection
+// gets its own socket, opened when its first message is due, and every
+// message goes out at its captured arrival time scaled by the speed, so a
+// recorded session becomes a repeatable load. The server's replies are
+// read and dropped so its fan-out never backs up into the replay.
+class SessionReplay {
+  public:
+    explicit SessionReplay(const ReplayConfig& config) : config_(config) {}
+
+    // Blocks until the whole capture has been sent or stop() is called.
+    // False if the capture cannot be read.
+    bool run(const std::string& capture_path, ReplayStats& stats);
+
+    // Safe from a signal handler
+    void stop() { stopping_ = true; }
+
+  private:
+    struct Connection;
+
+    ReplayConfig config_;
+    volatile bool stopping_ = false;
+};
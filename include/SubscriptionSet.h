@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Which senders a recipient wants, as a bitset over small sender indices.
+// The set is either "only the marked senders" or "everyone except the
+// marked senders", so subscribing to all stays correct for senders that
+// join later and costs no memory. contains() is a shift and a mask.
+class SubscriptionSet {
+  public:
+    SubscriptionSet() : except_(true) {}
+
+    bool contains(size_t index) const {
+        const size_t word = index / 64;
+        const bool marked = word < words_.size() && ((words_[word] >> (index % 64)) & 1u);
+        return marked != except_;
+    }
+
+    void add(size_t index) { mark(index, !except_); }
+    void remove(size_t index) { mark(index, except_); }
+
+    void addAll() { reset(true); }
+    void removeAll() { reset(false); }
+    bool isAll() const { return except_ && !hasMarks(); }
+
+    // For a sender index that is being reused: back to what a newly joined
+    // sender gets, included unless the set is an explicit list
+    void forget(size_t index) { mark(index, false); }
+
+    // Lowest index not marked, to hand out indices
+    size_t firstUnmarked() const {
+        for (size_t word = 0; word < words_.size(); ++word) {
+            if (~words_[word]) {
+                for (size_t bit = 0; bit < 64; ++bit) {
+                    if (!((words_[word] >> bit) & 1u)) return word * 64 + bit;
+                }
+            }
+        }
+        return words_.size() * 64;
+    }
+
+  private:
+    std::vector<uint64_t> words_;
+    bool except_;
+
+    void mark(size_t index, bool value) {
+        const size_t word = index / 64;
+        if (word >= words_.size()) {
+            if (!value) return;
+            words_.resize(word + 1, 0);
+        }
+        const uint64_t bit = uint64_t(1) << (index % 64);
+        words_[word] = value ? (words_[word] | bit) : (words_[word] & ~bit);
+    }
+
+    void reset(bool except) {
+        words_.clear();
+        except_ = except;
+    }
+
+    bool hasMarks() const {
+        for (uint64_t word : words_) {
+            if (word) return true;
+        }
+        return false;
+    }
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// What a thread does, which decides how it is scheduled
+enum class ThreadRole {
+  AUDIO,        // paces audio in or out: null device, file source
+  NETWORK,      // client send and receive loops, emulated delivery
+  CONNECTION,   // server per-connection threads, which fan audio out
+  CONTROL,      // accept, housekeeping and clock sync loops
+  BACKGROUND,   // log, capture and recording writers
+  COUNT
+};
+
+enum class SchedClass {
+  NORMAL,       // the OS default time-sharing class
+  FIFO,
+  RR
+};
+
+struct ThreadPolicy {
+  SchedClass sched = SchedClass::NORMAL;
+  int priority = 0;             // 1-99 for FIFO and RR
+  int nice = 0;                 // for NORMAL, and the fallback when real-time is refused
+  std::vector<int> cpus;        // affinity; empty for any CPU
+
+  bool isDefault() const { return sched == SchedClass::NORMAL && nice == 0 && cpus.empty(); }
+  std::string describe() const;
+};
+
+const char* threadRoleName(ThreadRole role);
+
+// "role=fifo:70@2,3", "role=rr:50", "role=nice:-5@1" or "role=normal".
+// A real-time request also carries a nice value of -10 to fall back on.
+bool parseThreadPolicy(const std::string& spec, ThreadRole& role, ThreadPolicy& policy);
+
+// Sensible real-time policies for every role, for --realtime
+void setRealtimeThreadPolicies();
+
+// Configure before the threads start
+void setThreadPolicy(ThreadRole role, const ThreadPolicy& policy);
+ThreadPolicy threadPolicy(ThreadRole role);
+// The roles that have a policy, one line each
+std::vector<std::string> describeThreadPolicies();
+
+// Called at the top of a thread function. Prepares the thread's memory
+// (see RealtimeMemory.h), applies the role's policy to the calling thread,
+// falling back to the nice value and then to the default when the OS
+// refuses, and prints what it got the first time for each role.
+void applyThreadPolicy(ThreadRole role);
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+
+// Energy-based voice activity detector. Frames more than threshold_db above
+// an adaptive noise floor count as speech; the decision is held for
+// hangover_ms afterwards so word endings and short pauses are not clipped.
+class VoiceActivityDetector {
+  public:
+    VoiceActivityDetector();
+
+    void configure(int sample_rate, float threshold_db = 9.0f, float hangover_ms = 240.0f);
+    // Returns true while speech or its hangover is active
+    bool process(const float* samples, size_t n);
+    void reset();
+
+    // Decision for the last frame without hangover
+    bool frameIsSpeech() const { return frame_speech_; }
+    float noiseFloorDb() const;
+
+  private:
+    int sample_rate_;
+    float threshold_;         // power ratio over the floor
+    size_t hangover_samples_;
+    size_t hangover_left_;
+    float noise_floor_;       // mean-square power
+    bool frame_speech_;
+    bool primed_;
+};
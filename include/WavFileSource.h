@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// A WAV file (RIFF or RF64; 16, 24 or 32-bit PCM or 32-bit float, any
+// channel count) memory-mapped for streaming into a session. Mono float
+// files are played straight out of the mapping; other formats are
+// converted one block at a time, and extra channels mixed down to mono.
+//
+// One thread read()s; seek() and setLoop() may be called from any other.
+class WavFileSource {
+  public:
+    // Largest block read() returns
+    static constexpr size_t MAX_BLOCK = 4096;
+
+    WavFileSource();
+    ~WavFileSource();
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return data_ != nullptr; }
+
+    const std::string& path() const { return path_; }
+    int sampleRate() const { return sample_rate_; }
+    int channels() const { return channels_; }
+    uint64_t frames() const { return frames_; }
+    double durationSeconds() const { return sample_rate_ ? static_cast<double>(frames_) / sample_rate_ : 0.0; }
+
+    void setLoop(bool loop) { loop_ = loop; }
+    bool loops() const { return loop_; }
+    // Takes effect at the next read()
+    void seek(double seconds);
+    double positionSeconds() const;
+    bool finished() const { return !loop_ && position_ >= frames_; }
+
+    // Returns up to frames (at most MAX_BLOCK) mono samples, stopping at
+    // the end of the file; out points into the mapping or an internal
+    // block. 0 once a non-looping file has ended.
+    size_t read(size_t frames, const float*& out);
+
+  private:
+    enum class Encoding : uint8_t { PCM16, PCM24, PCM32, FLOAT32 };
+
+    std::string path_;
+    const uint8_t* data_;       // whole mapping
+    size_t mapped_bytes_;
+#ifdef _WIN32
+    void* file_handle_;
+    void* mapping_handle_;
+#endif
+    const uint8_t* samples_;    // first byte of the data chunk
+    Encoding encoding_;
+    int sample_rate_;
+    int channels_;
+    size_t frame_bytes_;
+    uint64_t frames_;
+
+    std::atomic<uint64_t> position_;
+    std::atomic<int64_t> seek_to_;  // -1 when no seek is pending
+    std::atomic<bool> loop_;
+    std::unique_ptr<float[]> block_;
+
+    bool map(const std::string& path);
+    bool parse();
+    void convert(const uint8_t* src, float* dst, size_t samples) const;
+};
@@ -1,7 +1,8 @@
 #include "AudioBuffer.h"
 #include <algorithm>
+#include <cstring>
 
-AudioBuffer::AudioBuffer(size_t capacity):buffer_(capacity), capacity_(capacity), read_pos(0), write_pos(0),size_(0){}
+AudioBuffer::AudioBuffer(size_t capacity):buffer_(capacity), capacity_(capacity), write_pos(0), read_pos(0),size_(0){}
 
 AudioBuffer::~AudioBuffer() = default;
 
@@ -9,10 +10,11 @@ bool AudioBuffer::write(const float* data, size_t samples) {
   std::unique_lock<std::mutex> lock(mutex_);
   not_full_.wait(lock,[this] {return size_ < capacity_;});
   size_t to_write = std::min(samples, capacity_ - size_);
-  for(size_t i = 0;i < to_write;++i){
-    buffer_[write_pos] = data[i];
-    write_pos = (write_pos + 1) % capacity_;
-  }
+  // At most two contiguous copies around the wrap point
+  size_t first = std::min(to_write, capacity_ - write_pos);
+  std::memcpy(buffer_.data() + write_pos, data, first * sizeof(float));
+  std::memcpy(buffer_.data(), data + first, (to_write - first) * sizeof(float));
+  write_pos = (write_pos + to_write) % capacity_;
   
   size_ += to_write;
   not_empty_.notify_all();
@@ -23,14 +25,12 @@ bool AudioBuffer::read(float* data, size_t samples) {
   std::unique_lock<std::mutex> lock(mutex_);
   not_empty_.wait(lock,[this] {return size_ > 0;});
   size_t to_read = std::min(samples, size_);
-  for(size_t i = 0;i<to_read;++i){
-    data[i] = buffer_[read_pos];
-    read_pos = (read_pos + 1) % capacity_;
-  }
+  size_t first = std::min(to_read, capacity_ - read_pos);
+  std::memcpy(data, buffer_.data() + read_pos, first * sizeof(float));
+  std::memcpy(data + first, buffer_.data(), (to_read - first) * sizeof(float));
+  read_pos = (read_pos + to_read) % capacity_;
 
-  for(size_t i = to_read;i < samples; ++i){
-    data[i] = 0.0f;
-  }
+  std::fill(data + to_read, data + samples, 0.0f);
   size_ -= to_read;
   not_full_.notify_all();
   
@@ -1,9 +1,73 @@
 #include "AudioClient.h"
+#include "RealtimeMemory.h"
+#include "ThreadPolicy.h"
+#include <algorithm>
 #include <iostream>
+#include <sstream>
 #include <cstring>
+#include <chrono>
 
-AudioClient::AudioClient() 
-    : connected_(false), audio_active_(false), running_(false) {
+namespace {
+
+// How often a silent sender refreshes its comfort noise descriptor
+constexpr float DESCRIPTOR_INTERVAL_MS = 160.0f;
+// How often loss seen on received streams is reported to the server, and
+// how often the sample clock is tied to the media clock for receivers
+constexpr float REPORT_INTERVAL_MS = 1000.0f;
+constexpr size_t DEFAULT_FEC_GROUP = 4;
+// Clock sync heartbeats are sent quickly until the estimate settles
+constexpr int HEARTBEAT_FAST_MS = 250;
+constexpr int HEARTBEAT_INTERVAL_MS = 1000;
+// The server probes the multicast group four times a second; without a
+// datagram for this long the client goes back to unicast
+constexpr int MULTICAST_POLL_MS = 100;
+constexpr int64_t MULTICAST_TIMEOUT_NS = 1000000000LL;
+// File sources send blocks the size of a typical capture callback
+constexpr size_t SOURCE_BLOCK_FRAMES = 256;
+// Captured blocks waiting for the sender thread: over 150 ms of 256 frame
+// blocks at 48 kHz. The sender polls like the other ring consumers.
+constexpr size_t TX_FRAMES = 32;
+constexpr int SENDER_POLL_MS = 1;
+
+void printImpairment(const char* direction, const ImpairmentStats& stats) {
+    if (stats.messages == 0) return;
+    std::cout << "Impairment: " << stats.messages << " messages " << direction << ", " << stats.dropped
+              << " dropped, " << stats.duplicated << " duplicated, " << stats.reordered << " reordered, mean delay "
+              << stats.delayed_ns / 1e6 / stats.messages << " ms" << std::endl;
+}
+
+} // namespace
+
+AudioClient::AudioClient(int inputDeviceId,
+                         int sampleRate,
+                         int channels,
+                         SessionLogger* logger,
+                         AudioRecorder* recorder,
+                         JitterBuffer* jitterBuffer)
+    : logger_(logger), recorder_(recorder), jitterBuffer_(jitterBuffer),
+      inputDeviceId_(inputDeviceId), sampleRate_(sampleRate), channels_(channels),
+      connected_(false), audio_active_(false), streams_open_(false), running_(false), listen_only_(false), file_source_(nullptr),
+      source_running_(false), clock_sync_logged_(false),
+      multicast_enabled_(true), multicast_self_id_(0), multicast_active_(false), multicast_received_(0),
+      tx_frames_(TX_FRAMES * JitterBuffer::MAX_FRAME_SAMPLES), tx_ready_(TX_FRAMES), tx_free_(TX_FRAMES),
+      sender_running_(false), tx_epoch_(0), tx_epoch_seen_(0), tx_overruns_(0),
+      tx_sequence_(0), tx_timestamp_(0), samples_since_descriptor_(0), in_talkspurt_(false),
+      encode_buffer_(JitterBuffer::MAX_FRAME_SAMPLES * sizeof(float)), opus_fill_(0), opus_header_{},
+      fec_mode_(FecMode::OFF), fec_max_group_(DEFAULT_FEC_GROUP), fec_interval_(DEFAULT_FEC_GROUP), fec_loss_(0),
+      fec_buffer_(sizeof(FecParityHeader) + FecParityEncoder::MAX_PAYLOAD), fec_header_{}, fec_pending_bytes_(0),
+      samples_since_sender_report_(0), sender_reports_(2), report_baseline_(JitterBuffer::MAX_STREAMS),
+      preferred_codec_(AudioCodec::PCM16), tx_codec_(static_cast<uint8_t>(AudioCodec::FLOAT32)),
+      dtx_enabled_(true), frames_sent_(0), frames_suppressed_(0), descriptors_sent_(0), bytes_sent_(0),
+      repair_frames_sent_(0), reported_loss_(0), fec_adapted_(-1) {
+    if (!jitterBuffer_) {
+        owned_jitter_buffer_.reset(new JitterBuffer(sampleRate_));
+        jitterBuffer_ = owned_jitter_buffer_.get();
+    }
+    network_manager_.setLogger(logger_);
+    audio_processor_.setLogger(logger_);
+    for (uint32_t frame = 0; frame < TX_FRAMES; ++frame) {
+        tx_free_.push(frame);
+    }
 }
 
 AudioClient::~AudioClient() {
@@ -19,15 +83,36 @@ bool AudioClient::connect(const std::string& server_host, int server_port) {
         }
     );
 
-    if (!network_manager_.connectToServer(server_host, server_port)) {
+    CodecHello hello{};
+    hello.version = CODEC_HELLO_VERSION;
+    hello.preferred = static_cast<uint8_t>(preferred_codec_);
+    hello.supported = supportedCodecs();
+    hello.features = HELLO_FEATURE_FEC | (multicast_enabled_ ? HELLO_FEATURE_MULTICAST : 0) |
+                     (listen_only_ ? HELLO_FEATURE_LISTEN_ONLY : 0);
+    if (preferred_codec_ == AudioCodec::OPUS && !opusUsable()) {
+        std::cerr << "Opus needs libopus and a 48 kHz family sample rate; asking for pcm16" << std::endl;
+        hello.preferred = static_cast<uint8_t>(AudioCodec::PCM16);
+    }
+    const uint8_t* hello_bytes = reinterpret_cast<const uint8_t*>(&hello);
+    tx_codec_ = static_cast<uint8_t>(AudioCodec::FLOAT32);
+
+    if (!network_manager_.connectToServer(server_host, server_port,
+                                          std::vector<uint8_t>(hello_bytes, hello_bytes + sizeof(hello)))) {
         std::cerr << "Failed to connect to server" << std::endl;
         return false;
     }
 
     connected_ = true;
     running_ = true;
+    clock_sync_.reset();
+    clock_sync_logged_ = false;
+    {
+        std::lock_guard<std::mutex> lock(subscription_mutex_);
+        subscriptions_.addAll();
+    }
     
     network_thread_ = std::thread(&AudioClient::networkLoop, this);
+    clock_thread_ = std::thread(&AudioClient::clockLoop, this);
     
     std::cout << "Connected to server at " << server_host << ":" << server_port << std::endl;
     return true;
@@ -36,11 +121,27 @@ bool AudioClient::connect(const std::string& server_host, int server_port) {
 void AudioClient::disconnect() {
     running_ = false;
     
+    if (clock_thread_.joinable()) {
+        clock_thread_.join();
+    }
     if (network_thread_.joinable()) {
+        // With nothing arriving the thread would wait in recv forever
+        network_manager_.stopReceiving();
         network_thread_.join();
     }
+    if (multicast_thread_.joinable()) {
+        multicast_thread_.join();
+    }
+    multicast_.close();
+    multicast_active_ = false;
     
     stopAudio();
+    if (streams_open_) {
+        audio_processor_.stop();
+        audio_processor_.cleanup();
+        streams_open_ = false;
+    }
+    stopSender();
     network_manager_.disconnect();
     connected_ = false;
     
@@ -50,19 +151,72 @@ void AudioClient::disconnect() {
 bool AudioClient::startAudio() {
     if (!connected_ || audio_active_) return false;
 
-    if (!audio_processor_.initialize()) {
+    if (file_source_ && (!file_source_->isOpen() || file_source_->sampleRate() != sampleRate_)) {
+        std::cerr << "The file source must be open at the session rate of " << sampleRate_ << " Hz" << std::endl;
+        return false;
+    }
+    if (!file_source_ && !streams_open_ && !audio_processor_.initialize(sampleRate_)) {
         std::cerr << "Failed to initialize audio processor" << std::endl;
         return false;
     }
 
+    if (file_source_) {
+        // Sources only send, so they never tell the server they are ready
+        // to receive
+        resetTransmit();
+        audio_active_ = true;
+        source_running_ = true;
+        source_thread_ = std::thread(&AudioClient::sourceLoop, this);
+        logEvent(logger_, LogEvent::AUDIO_STARTED);
+        return true;
+    }
+
+    // The sender thread starts the codec state afresh on the first block
+    // of the new epoch, and drops any left from before a pause
+    tx_epoch_++;
+
+    if (streams_open_) {
+        // The streams kept running silent and the server already knows we
+        // are ready. The chains still hold audio from before the pause, so
+        // clear them before unpausing, unless a block is somehow still in
+        // them.
+        if (audio_processor_.setPaused(true)) {
+            audio_processor_.captureChain().reset();
+            audio_processor_.playbackChain().reset();
+        }
+        audio_active_ = true;
+        audio_processor_.setPaused(false);
+        logEvent(logger_, LogEvent::AUDIO_STARTED);
+        return true;
+    }
+
     // Set up audio capture callback
     audio_processor_.setAudioCaptureCallback(
-        [this](const float* data, size_t samples) {
-            onAudioCaptured(data, samples);
+        [this](const float* data, size_t samples, int64_t captured_ns) {
+            onAudioCaptured(data, samples, captured_ns);
         }
     );
 
-    if (!audio_processor_.startRecording()) {
+    // Received streams are mixed by the jitter buffer at playout time,
+    // scheduled on the media clock once it is known
+    audio_processor_.setPlaybackSource(
+        [this](float* out, size_t samples, int64_t heard_ns) {
+            jitterBuffer_->read(out, samples, clock_sync_.synchronized() ? clock_sync_.serverTimeNs(heard_ns) : -1);
+        }
+    );
+    if (recorder_) {
+        audio_processor_.setPlaybackTap(
+            [this](const float* data, size_t samples, int64_t) {
+                recorder_->push(AudioRecorder::Track::PLAYBACK, data, samples);
+            }
+        );
+    }
+
+    if (!listen_only_ && !sender_thread_.joinable()) {
+        sender_running_ = true;
+        sender_thread_ = std::thread(&AudioClient::senderLoop, this);
+    }
+    if (!listen_only_ && !audio_processor_.startRecording()) {
         std::cerr << "Failed to start recording" << std::endl;
         return false;
     }
@@ -72,6 +226,7 @@ bool AudioClient::startAudio() {
         audio_processor_.stop();
         return false;
     }
+    streams_open_ = true;
 
     // Send ready message to server
     Message ready_msg;
@@ -80,18 +235,26 @@ bool AudioClient::startAudio() {
     network_manager_.sendMessage(ready_msg);
 
     audio_active_ = true;
-    std::cout << "Audio system started - you can now speak!" << std::endl;
+    logEvent(logger_, LogEvent::AUDIO_STARTED);
     return true;
 }
 
 void AudioClient::stopAudio() {
     if (!audio_active_) return;
     
-    audio_processor_.stop();
-    audio_processor_.cleanup();
+    if (source_thread_.joinable()) {
+        source_running_ = false;
+        source_thread_.join();
+    } else {
+        // Reopening the devices can take hundreds of milliseconds, so they
+        // stay open and silent until disconnect()
+        if (!audio_processor_.setPaused(true)) {
+            std::cerr << "Audio callbacks still running after pausing" << std::endl;
+        }
+    }
     audio_active_ = false;
     
-    std::cout << "Audio system stopped" << std::endl;
+    logEvent(logger_, LogEvent::AUDIO_STOPPED);
 }
 
 bool AudioClient::isConnected() const {
@@ -105,24 +268,59 @@ bool AudioClient::isAudioActive() const {
 void AudioClient::run() {
     std::cout << "AudSync Client" << std::endl;
     std::cout << "Commands:" << std::endl;
-    std::cout << "  start - Start audio streaming" << std::endl;
-    std::cout << "  stop  - Stop audio streaming" << std::endl;
+    std::cout << "  start - Start audio streaming, or resume it" << std::endl;
+    std::cout << "  stop  - Pause audio streaming, keeping the devices open" << std::endl;
+    std::cout << "  dsp   - Show DSP stage load, or 'dsp <capture|playback> <stage> <param> <value>'" << std::endl;
+    std::cout << "  dtx   - 'dtx on' or 'dtx off' to toggle silence suppression" << std::endl;
+    std::cout << "  stats - Show transmit, jitter buffer and page fault counters" << std::endl;
+    std::cout << "  subscribe   - 'subscribe all' or 'subscribe <sender>...' to receive only some senders" << std::endl;
+    std::cout << "  unsubscribe - 'unsubscribe all' or 'unsubscribe <sender>...'" << std::endl;
     std::cout << "  quit  - Disconnect and exit" << std::endl;
 
     std::string command;
     while (running_ && std::cin >> command) {
         if (command == "start") {
             if (!audio_active_) {
-                startAudio();
+                const bool resume = streams_open_;
+                const int64_t begin = monotonicNowNs();
+                if (startAudio()) {
+                    std::cout << (resume ? "Audio resumed in " : "Audio started in ")
+                              << (monotonicNowNs() - begin) / 1000 << " us" << std::endl;
+                }
             } else {
                 std::cout << "Audio already active" << std::endl;
             }
         } else if (command == "stop") {
             if (audio_active_) {
+                const int64_t begin = monotonicNowNs();
                 stopAudio();
+                std::cout << (streams_open_ ? "Audio paused in " : "Audio stopped in ")
+                          << (monotonicNowNs() - begin) / 1000 << " us" << std::endl;
             } else {
                 std::cout << "Audio not active" << std::endl;
             }
+        } else if (command == "dsp") {
+            std::string args;
+            std::getline(std::cin, args);
+            handleDspCommand(args);
+        } else if (command == "dtx") {
+            std::string mode;
+            std::cin >> mode;
+            if (mode == "on" || mode == "off") {
+                dtx_enabled_ = mode == "on";
+                std::cout << "DTX " << mode << std::endl;
+            } else {
+                std::cout << "Usage: dtx <on|off>" << std::endl;
+            }
+        } else if (command == "stats") {
+            printStats();
+            for (const auto& line : pageFaultReport()) {
+                std::cout << "Page faults since last stats, " << line << std::endl;
+            }
+        } else if (command == "subscribe" || command == "unsubscribe") {
+            std::string args;
+            std::getline(std::cin, args);
+            handleSubscribeCommand(command == "subscribe", args);
         } else if (command == "quit") {
             break;
         } else {
@@ -131,22 +329,212 @@ void AudioClient::run() {
     }
 }
 
+void AudioClient::handleDspCommand(const std::string& args) {
+    std::istringstream in(args);
+    std::string chain_name, stage, param;
+    float value = 0.0f;
+
+    if (!(in >> chain_name)) {
+        std::cout << "Capture chain:" << std::endl << audio_processor_.captureChain().report();
+        std::cout << "Playback chain:" << std::endl << audio_processor_.playbackChain().report();
+        return;
+    }
+
+    DspChain* chain = chain_name == "capture" ? &audio_processor_.captureChain()
+                    : chain_name == "playback" ? &audio_processor_.playbackChain() : nullptr;
+    if (!chain || !(in >> stage >> param >> value) || !chain->setParameter(stage, param, value)) {
+        std::cout << "Usage: dsp <capture|playback> <stage> <param> <value>" << std::endl;
+        return;
+    }
+    std::cout << chain_name << " " << stage << " " << param << " = " << value << std::endl;
+}
+
+void AudioClient::handleSubscribeCommand(bool subscribe, const std::string& args) {
+    std::istringstream in(args);
+    std::vector<uint16_t> senders;
+    std::string word;
+    bool all = false;
+    while (in >> word) {
+        if (word == "all") {
+            all = true;
+            continue;
+        }
+        try {
+            senders.push_back(static_cast<uint16_t>(std::stoul(word)));
+        } catch (...) {
+            all = false;
+            senders.clear();
+            break;
+        }
+    }
+    if (all == !senders.empty()) {
+        std::cout << "Usage: " << (subscribe ? "subscribe" : "unsubscribe") << " <all|sender...>" << std::endl;
+        return;
+    }
+    if (!sendSubscription(subscribe, senders)) {
+        std::cout << "Not connected" << std::endl;
+    }
+}
+
+bool AudioClient::subscribe(const std::vector<uint16_t>& senders) {
+    return sendSubscription(true, senders);
+}
+
+bool AudioClient::unsubscribe(const std::vector<uint16_t>& senders) {
+    return sendSubscription(false, senders);
+}
+
+bool AudioClient::sendSubscription(bool subscribe, const std::vector<uint16_t>& senders) {
+    if (!connected_) return false;
+    {
+        std::lock_guard<std::mutex> lock(subscription_mutex_);
+        if (senders.empty()) {
+            if (subscribe) {
+                subscriptions_.addAll();
+            } else {
+                subscriptions_.removeAll();
+            }
+        }
+        for (uint16_t sender : senders) {
+            if (subscribe) {
+                subscriptions_.add(sender);
+            } else {
+                subscriptions_.remove(sender);
+            }
+        }
+    }
+
+    Message message;
+    message.type = subscribe ? MessageType::SUBSCRIBE : MessageType::UNSUBSCRIBE;
+    message.size = static_cast<uint32_t>(senders.size() * sizeof(uint16_t));
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(senders.data());
+    message.data.assign(bytes, bytes + message.size);
+    return network_manager_.sendMessage(message);
+}
+
+bool AudioClient::isSubscribed(uint16_t sender_id) {
+    std::lock_guard<std::mutex> lock(subscription_mutex_);
+    return subscriptions_.contains(sender_id);
+}
+
+void AudioClient::printStats() const {
+    if (listen_only_) {
+        std::cout << "Transmit: listen only" << std::endl;
+    } else {
+        const uint64_t sent = frames_sent_;
+        const uint64_t suppressed = frames_suppressed_;
+        const uint64_t descriptors = descriptors_sent_;
+        const uint64_t total = sent + suppressed + descriptors;
+        std::cout << "Transmit: " << codecName(static_cast<AudioCodec>(tx_codec_.load())) << ", "
+                  << sent << " blocks sent (" << bytes_sent_ / 1024 << " KiB), " << suppressed << " suppressed, "
+                  << descriptors << " comfort noise descriptors ("
+                  << (total ? 100 * (suppressed + descriptors) / total : 0) << "% silence), noise floor "
+                  << vad_.noiseFloorDb() << " dB" << std::endl;
+        if (tx_overruns_ > 0) {
+            std::cout << "Sender: " << tx_overruns_ << " captured blocks dropped while it fell behind" << std::endl;
+        }
+        if (fec_mode_ != FecMode::OFF) {
+            std::cout << "FEC: " << fecModeName(fec_mode_) << " every " << fec_interval_ << " frames, "
+                      << repair_frames_sent_ << " repair frames sent, worst receiver loss "
+                      << reported_loss_ * 100 / 256 << "%" << std::endl;
+        }
+    }
+
+    const ClockSyncStats clock = clock_sync_.stats();
+    if (clock.synchronized) {
+        std::cout << "Clock: offset " << clock.offset_ns / 1e6 << " ms, round trip " << clock.rtt_ns / 1000
+                  << " us, drift " << clock.drift_ppm << " ppm (" << clock.samples << " samples, "
+                  << clock.outliers << " outliers)" << std::endl;
+    } else {
+        std::cout << "Clock: not synchronized" << std::endl;
+    }
+
+    printImpairment("sent", network_manager_.sendImpairmentStats());
+    printImpairment("received", network_manager_.receiveImpairmentStats());
+
+    if (multicast_.isOpen()) {
+        std::cout << "Delivery: " << (multicast_active_ ? "multicast " : "unicast, waiting for multicast ")
+                  << multicast_.describe() << ", " << multicast_received_ << " datagrams" << std::endl;
+    }
+
+    const JitterBufferStats rx = jitterBuffer_->stats();
+    std::cout << "Receive: " << rx.streams << " streams, " << rx.received << " frames, "
+              << rx.comfort_noise << " descriptors, " << rx.lost << " lost ("
+              << rx.recovered << " recovered by Opus FEC), " << rx.repaired << " repaired, "
+              << rx.late << " late, " << rx.dropped << " dropped" << std::endl;
+    JitterStreamCounters streams[JitterBuffer::MAX_STREAMS];
+    const size_t stream_count = jitterBuffer_->streamCounters(streams, JitterBuffer::MAX_STREAMS);
+    if (stream_count > 0) {
+        std::cout << "Senders heard:";
+        for (size_t i = 0; i < stream_count; ++i) std::cout << " " << streams[i].sender_id;
+        std::cout << std::endl;
+    }
+    if (jitterBuffer_->syncLatency() > 0) {
+        std::cout << "Synchronized playout: " << jitterBuffer_->syncLatency() / 1000000 << " ms after capture, "
+                  << (clock.synchronized ? "" : "waiting for the clock, ")
+                  << rx.sync_adjusted << " samples adjusted" << std::endl;
+    }
+}
+
 void AudioClient::handleNetworkMessage(const Message& message, int socket_fd) {
     (void)socket_fd; // Unused in client mode
 
     switch (message.type) {
         case MessageType::AUDIO_DATA:
-            if (audio_active_ && message.size > 0) {
-                // Convert received data to float and add to playback buffer
-                const float* audio_data = reinterpret_cast<const float*>(message.data.data());
-                size_t samples = message.size / sizeof(float);
-                audio_processor_.addPlaybackData(audio_data, samples);
+            if (audio_active_) {
+                std::lock_guard<std::mutex> lock(receive_mutex_);
+                AudioFrameHeader header;
+                const uint8_t* payload = nullptr;
+                size_t bytes = 0;
+                if (parseAudioFrame(message, header, payload, bytes)) {
+                    if (frame_observer_) frame_observer_(FrameEvent::RECEIVED, header, monotonicNowNs());
+                    jitterBuffer_->push(header, payload, bytes);
+                }
             }
             break;
             
+        case MessageType::CODEC_SELECT:
+            if (!message.data.empty() && message.data[0] < 32 &&
+                (supportedCodecs() & (1u << message.data[0]))) {
+                tx_codec_ = message.data[0];
+                std::cout << "Sending " << codecName(static_cast<AudioCodec>(message.data[0])) << std::endl;
+            }
+            break;
+
+        case MessageType::SENDER_REPORT:
+            if (audio_active_ && message.data.size() >= sizeof(SenderReport)) {
+                std::lock_guard<std::mutex> lock(receive_mutex_);
+                SenderReport report;
+                std::memcpy(&report, message.data.data(), sizeof(report));
+                jitterBuffer_->setSenderClock(report.sender_id, report.timestamp, report.media_time_ns);
+            }
+            break;
+
+        case MessageType::MULTICAST_OFFER:
+            joinMulticast(message);
+            break;
+
+        case MessageType::LOSS_REPORT:
+            if (!message.data.empty()) reported_loss_ = message.data[0];
+            break;
+
         case MessageType::HEARTBEAT:
-            // Respond to heartbeat
             {
+                // Replies to our clock sync requests carry a payload
+                const int64_t received = monotonicNowNs();
+                HeartbeatPayload reply;
+                if (message.data.size() >= sizeof(reply)) {
+                    std::memcpy(&reply, message.data.data(), sizeof(reply));
+                    if (clock_sync_.processReply(reply, received) && !clock_sync_logged_ &&
+                        clock_sync_.synchronized()) {
+                        const ClockSyncStats clock = clock_sync_.stats();
+                        logEvent(logger_, LogEvent::CLOCK_SYNCED, clock.offset_ns / 1000, clock.rtt_ns / 1000);
+                        clock_sync_logged_ = true;
+                    }
+                    break;
+                }
+
+                // Respond to heartbeat
                 Message response;
                 response.type = MessageType::HEARTBEAT;
                 response.size = 0;
@@ -159,30 +547,448 @@ void AudioClient::handleNetworkMessage(const Message& message, int socket_fd) {
     }
 }
 
-void AudioClient::onAudioCaptured(const float* data, size_t samples) {
+// Runs on the capture callback: copies the block into free frames for the
+// sender thread, splitting blocks longer than a frame
+void AudioClient::onAudioCaptured(const float* data, size_t samples, int64_t captured_ns) {
     if (!connected_ || !audio_active_) return;
 
-    // Send audio data to server
+    if (recorder_) {
+        recorder_->push(AudioRecorder::Track::CAPTURE, data, samples);
+    }
+
+    const uint32_t epoch = tx_epoch_.load(std::memory_order_relaxed);
+    size_t done = 0;
+    while (done < samples) {
+        uint32_t frame;
+        if (!tx_free_.pop(frame)) {
+            // The sender has fallen behind; drop rather than wait for it
+            tx_overruns_++;
+            return;
+        }
+        const size_t count = std::min(samples - done, JitterBuffer::MAX_FRAME_SAMPLES);
+        std::memcpy(tx_frames_.data() + frame * JitterBuffer::MAX_FRAME_SAMPLES, data + done,
+                    count * sizeof(float));
+        done += count;
+        // Each piece is stamped with the time of its own last sample
+        const int64_t later_ns = static_cast<int64_t>((samples - done) * 1e9 / sampleRate_);
+        tx_ready_.push(TxBlock{frame, epoch, count, captured_ns - later_ns});
+    }
+}
+
+// Starts a new stream: fresh codec, VAD, FEC and report state
+void AudioClient::resetTransmit() {
+    vad_.configure(sampleRate_);
+    comfort_noise_.reset();
+    samples_since_descriptor_ = 0;
+    in_talkspurt_ = false;
+    opus_fill_ = 0;
+    if (opusUsable() && opus_encoder_.configure(sampleRate_, opus_settings_)) {
+        opus_pending_.assign(opus_encoder_.frameSamples(), 0.0f);
+    }
+    fec_parity_.reset();
+    fec_pending_bytes_ = 0;
+    fec_loss_ = 0;
+    fec_interval_ = fecInterval(0, 1, fec_max_group_);
+    samples_since_sender_report_ = static_cast<size_t>(REPORT_INTERVAL_MS * 0.001f * sampleRate_);
+}
+
+// Encodes and sends captured blocks in order, off the capture callback
+void AudioClient::senderLoop() {
+    applyThreadPolicy(ThreadRole::NETWORK);
+    registerLogThread(logger_);
+    while (sender_running_) {
+        TxBlock block;
+        if (!tx_ready_.pop(block)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(SENDER_POLL_MS));
+            continue;
+        }
+        const uint32_t epoch = tx_epoch_.load();
+        if (block.epoch == epoch && audio_active_ && connected_) {
+            if (tx_epoch_seen_ != epoch) {
+                tx_epoch_seen_ = epoch;
+                resetTransmit();
+            }
+            transmitBlock(tx_frames_.data() + block.frame * JitterBuffer::MAX_FRAME_SAMPLES, block.samples,
+                          block.captured_ns);
+        }
+        tx_free_.push(block.frame);
+    }
+}
+
+void AudioClient::stopSender() {
+    if (!sender_thread_.joinable()) return;
+    sender_running_ = false;
+    sender_thread_.join();
+}
+
+void AudioClient::transmitBlock(const float* data, size_t samples, int64_t captured_ns) {
+    const size_t report_interval = static_cast<size_t>(REPORT_INTERVAL_MS * 0.001f * sampleRate_);
+    if (samples_since_sender_report_ >= report_interval && clock_sync_.synchronized()) {
+        // The clock thread sends it; a report is dropped if one is still
+        // queued, as the next will do as well
+        samples_since_sender_report_ = 0;
+        sender_reports_.push(TxReport{tx_timestamp_, captured_ns});
+    }
+    samples_since_sender_report_ += samples;
+    adaptFec();
+
+    const bool speech = vad_.process(data, samples) || !dtx_enabled_;
+    if (!vad_.frameIsSpeech()) {
+        comfort_noise_.analyze(data, samples);
+    }
+
+    AudioFrameHeader header{};
+    header.timestamp = tx_timestamp_;
+    tx_timestamp_ += static_cast<uint32_t>(samples);
+
+    if (speech) {
+        header.flags = in_talkspurt_ ? 0 : FRAME_TALKSPURT;
+        in_talkspurt_ = true;
+        sendSpeech(header, data, samples);
+        frames_sent_++;
+        return;
+    }
+
+    // Silence: one descriptor when the talkspurt ends, then a refresh
+    // every DESCRIPTOR_INTERVAL_MS
+    samples_since_descriptor_ += samples;
+    const size_t interval = static_cast<size_t>(DESCRIPTOR_INTERVAL_MS * 0.001f * sampleRate_);
+    if (in_talkspurt_ && opus_fill_ > 0) flushOpus();
+    ComfortNoiseParams params;
+    if ((in_talkspurt_ || samples_since_descriptor_ >= interval) && comfort_noise_.describe(params)) {
+        header.flags = FRAME_COMFORT_NOISE;
+        sendFrame(header, &params, sizeof(params));
+        samples_since_descriptor_ = 0;
+        descriptors_sent_++;
+    } else {
+        frames_suppressed_++;
+    }
+    // Repair data must not wait for the next talkspurt
+    if (in_talkspurt_) flushFec();
+    in_talkspurt_ = false;
+}
+
+bool AudioClient::opusUsable() const {
+    return opusAvailable() && opusSupportsRate(sampleRate_);
+}
+
+uint32_t AudioClient::supportedCodecs() const {
+    return builtinCodecMask() | (opusUsable() ? codecBit(AudioCodec::OPUS) : 0);
+}
+
+void AudioClient::sendSpeech(AudioFrameHeader& header, const float* data, size_t samples) {
+    AudioCodec codec = static_cast<AudioCodec>(tx_codec_.load());
+    if (codec == AudioCodec::OPUS && opus_encoder_.isConfigured()) {
+        queueOpus(header, data, samples);
+        return;
+    }
+    if (opus_fill_ > 0) flushOpus();
+    if (codec == AudioCodec::OPUS || samples > JitterBuffer::MAX_FRAME_SAMPLES) codec = AudioCodec::FLOAT32;
+
+    header.samples = static_cast<uint16_t>(samples);
+    header.codec = static_cast<uint8_t>(codec);
+    if (codec == AudioCodec::FLOAT32) {
+        sendFrame(header, data, samples * sizeof(float));
+    } else {
+        const size_t bytes = encodeAudio(codec, data, samples, encode_buffer_.data(), codec_state_);
+        sendFrame(header, encode_buffer_.data(), bytes);
+    }
+    if (fec_mode_ == FecMode::REDUNDANT) queueRedundantCopy(header, data, samples);
+}
+
+void AudioClient::queueOpus(const AudioFrameHeader& header, const float* data, size_t samples) {
+    const size_t frame = opus_pending_.size();
+    size_t done = 0;
+    while (done < samples) {
+        if (opus_fill_ == 0) {
+            opus_header_ = header;
+            opus_header_.timestamp = header.timestamp + static_cast<uint32_t>(done);
+            if (done > 0) opus_header_.flags = 0;
+        }
+        const size_t count = std::min(samples - done, frame - opus_fill_);
+        std::memcpy(opus_pending_.data() + opus_fill_, data + done, count * sizeof(float));
+        opus_fill_ += count;
+        done += count;
+        if (opus_fill_ == frame) flushOpus();
+    }
+}
+
+// Sends the collected Opus frame, padding a partial one with silence
+void AudioClient::flushOpus() {
+    std::fill(opus_pending_.begin() + opus_fill_, opus_pending_.end(), 0.0f);
+    opus_fill_ = 0;
+
+    const size_t bytes = opus_encoder_.encode(opus_pending_.data(), encode_buffer_.data(), OPUS_MAX_PACKET);
+    if (bytes == 0) return;
+    opus_header_.samples = static_cast<uint16_t>(opus_pending_.size());
+    opus_header_.codec = static_cast<uint8_t>(AudioCodec::OPUS);
+    sendFrame(opus_header_, encode_buffer_.data(), bytes);
+}
+
+void AudioClient::sendFrame(const AudioFrameHeader& header, const void* payload, size_t bytes) {
+    AudioFrameHeader stamped = header;
+    stamped.sequence = tx_sequence_++;
+
     Message audio_msg;
-    audio_msg.type = MessageType::AUDIO_DATA;
-    audio_msg.size = samples * sizeof(float);
-    audio_msg.data.resize(audio_msg.size);
-    
-    memcpy(audio_msg.data.data(), data, audio_msg.size);
+    buildAudioFrame(audio_msg, stamped, payload, bytes);
     network_manager_.sendMessage(audio_msg);
+    bytes_sent_ += audio_msg.size;
+    if (frame_observer_) frame_observer_(FrameEvent::SENT, stamped, monotonicNowNs());
+
+    if (fec_mode_ == FecMode::PARITY) {
+        fec_parity_.add(stamped, static_cast<const uint8_t*>(payload), bytes);
+        if (fec_parity_.count() >= fec_interval_) flushFec();
+    } else if (fec_pending_bytes_ > 0) {
+        flushFec();
+    }
+}
+
+// Follows the worst loss the server says receivers see: smaller parity
+// groups or denser redundant copies as it rises, and a matching Opus loss
+// expectation
+void AudioClient::adaptFec() {
+    const uint8_t loss = reported_loss_;
+    if (loss == fec_loss_) return;
+    fec_loss_ = loss;
+
+    if (fec_mode_ != FecMode::OFF) {
+        const size_t interval = fecInterval(loss, fec_mode_ == FecMode::PARITY ? 2 : 1, fec_max_group_);
+        if (interval != fec_interval_) {
+            fec_interval_ = interval;
+            fec_adapted_.store(static_cast<int64_t>(interval) << 8 | loss, std::memory_order_relaxed);
+        }
+    }
+    if (opus_encoder_.isConfigured()) {
+        opus_encoder_.setExpectedLoss(std::max(opus_settings_.expected_loss, loss * 100 / 256));
+    }
+}
+
+// Keeps a low-bitrate copy of the frame just sent, to go out after the next
+void AudioClient::queueRedundantCopy(const AudioFrameHeader& header, const float* data, size_t samples) {
+    const uint32_t sequence = tx_sequence_ - 1;
+    if (sequence % fec_interval_ != 0) return;
+
+    fec_header_ = header;
+    fec_header_.sequence = sequence;
+    fec_header_.codec = static_cast<uint8_t>(FEC_REDUNDANT_CODEC);
+    fec_header_.flags |= FRAME_FEC_REDUNDANT;
+    fec_pending_bytes_ = encodeAudio(FEC_REDUNDANT_CODEC, data, samples, fec_buffer_.data(), fec_codec_state_);
+}
+
+// Sends the parity of the current group, or the pending redundant copy
+void AudioClient::flushFec() {
+    if (fec_mode_ == FecMode::PARITY) {
+        AudioFrameHeader header;
+        const size_t bytes = fec_parity_.finish(header, fec_buffer_.data());
+        if (bytes > 0) sendRepair(header, fec_buffer_.data(), bytes);
+    } else if (fec_pending_bytes_ > 0) {
+        sendRepair(fec_header_, fec_buffer_.data(), fec_pending_bytes_);
+        fec_pending_bytes_ = 0;
+    }
+}
+
+void AudioClient::sendRepair(const AudioFrameHeader& header, const uint8_t* payload, size_t bytes) {
+    Message repair_msg;
+    buildAudioFrame(repair_msg, header, payload, bytes);
+    network_manager_.sendMessage(repair_msg);
+    bytes_sent_ += repair_msg.size;
+    repair_frames_sent_++;
+}
+
+// Tells the server what share of each sender's frames went missing since
+// the last report, counting those FEC repaired
+void AudioClient::sendReceiverReport() {
+    JitterStreamCounters counters[JitterBuffer::MAX_STREAMS];
+    ReceiverReportEntry entries[JitterBuffer::MAX_STREAMS];
+    const size_t count = jitterBuffer_->streamCounters(counters, JitterBuffer::MAX_STREAMS);
+
+    size_t used = 0;
+    for (size_t i = 0; i < count; ++i) {
+        JitterStreamCounters& baseline = report_baseline_[i];
+        if (baseline.sender_id == counters[i].sender_id && counters[i].expected > baseline.expected) {
+            const uint64_t expected = counters[i].expected - baseline.expected;
+            const uint64_t missing = counters[i].missing - baseline.missing;
+            ReceiverReportEntry& entry = entries[used++];
+            entry.sender_id = counters[i].sender_id;
+            entry.loss = static_cast<uint8_t>(std::min<uint64_t>(missing * 256 / expected, 255));
+            entry.reserved = 0;
+        }
+        baseline = counters[i];
+    }
+    if (used == 0) return;
+
+    Message report;
+    report.type = MessageType::RECEIVER_REPORT;
+    report.size = static_cast<uint32_t>(used * sizeof(ReceiverReportEntry));
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(entries);
+    report.data.assign(bytes, bytes + report.size);
+    network_manager_.sendMessage(report);
 }
 
 void AudioClient::networkLoop() {
+    applyThreadPolicy(ThreadRole::NETWORK);
+    registerLogThread(logger_);
     while (running_) {
         Message message;
         if (network_manager_.receiveMessage(message)) {
             handleNetworkMessage(message, -1);
         } else {
             // Connection lost
-            std::cout << "Connection to server lost" << std::endl;
+            logEvent(logger_, LogEvent::CONNECTION_LOST);
             running_ = false;
             break;
         }
     }
 }
 
+
+// Tells receivers when the block stamped timestamp was captured, on the
+// media clock
+void AudioClient::sendSenderReport(const TxReport& queued) {
+    SenderReport report{};
+    report.timestamp = queued.timestamp;
+    report.media_time_ns = clock_sync_.serverTimeNs(queued.captured_ns);
+
+    Message message;
+    message.type = MessageType::SENDER_REPORT;
+    message.size = sizeof(report);
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&report);
+    message.data.assign(bytes, bytes + sizeof(report));
+    network_manager_.sendMessage(message);
+}
+
+// Sends clock sync heartbeats, whose replies are handled on the network
+// thread, and the reports, so the transmit path never waits on them.
+// Receiver reports describe the received streams; sender reports are
+// queued by the transmit path.
+void AudioClient::clockLoop() {
+    applyThreadPolicy(ThreadRole::CONTROL);
+    registerLogThread(logger_);
+    std::fill(report_baseline_.begin(), report_baseline_.end(), JitterStreamCounters{});
+    TxReport queued;
+    while (sender_reports_.pop(queued)) {
+        // Left from the last connection
+    }
+    int64_t last_report = monotonicNowNs();
+    while (running_) {
+        const int64_t now = monotonicNowNs();
+        if (audio_active_ && now - last_report >= static_cast<int64_t>(REPORT_INTERVAL_MS * 1e6f)) {
+            last_report = now;
+            sendReceiverReport();
+        }
+
+        HeartbeatPayload request;
+        clock_sync_.prepareRequest(request);
+        Message heartbeat;
+        heartbeat.type = MessageType::HEARTBEAT;
+        heartbeat.size = sizeof(request);
+        heartbeat.data.resize(sizeof(request));
+        network_manager_.sendStamped(heartbeat, INVALID_SOCKET_VAL, [&request](Message& stamped) {
+            // Audio sends may hold the socket; the wait is not round trip
+            request.client_send = monotonicNowNs();
+            std::memcpy(stamped.data.data(), &request, sizeof(request));
+        });
+
+        const int interval = clock_sync_.synchronized() ? HEARTBEAT_INTERVAL_MS : HEARTBEAT_FAST_MS;
+        for (int waited = 0; waited < interval && running_; waited += 50) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            while (sender_reports_.pop(queued)) {
+                sendSenderReport(queued);
+            }
+            const int64_t adapted = fec_adapted_.exchange(-1, std::memory_order_relaxed);
+            if (adapted >= 0) logEvent(logger_, LogEvent::FEC_ADAPTED, adapted >> 8, adapted & 0xff);
+        }
+    }
+}
+
+void AudioClient::joinMulticast(const Message& offer) {
+    MulticastOffer group;
+    if (!multicast_enabled_ || multicast_thread_.joinable() || offer.data.size() < sizeof(group)) return;
+    std::memcpy(&group, offer.data.data(), sizeof(group));
+
+    // Unicast carries on if the group cannot be joined
+    if (!multicast_.join(group.group, group.port, multicast_interface_)) return;
+    multicast_self_id_ = group.sender_id;
+    multicast_received_ = 0;
+    multicast_thread_ = std::thread(&AudioClient::multicastLoop, this);
+    std::cout << "Joined multicast group " << multicast_.describe() << std::endl;
+}
+
+void AudioClient::sendMulticastStatus(bool receiving) {
+    Message status;
+    status.type = MessageType::MULTICAST_STATUS;
+    status.size = 1;
+    status.data.assign(1, receiving ? 1 : 0);
+    network_manager_.sendMessage(status);
+    logEvent(logger_, receiving ? LogEvent::MULTICAST_JOINED : LogEvent::MULTICAST_LEFT, multicast_self_id_);
+}
+
+// Receives relayed audio from the group. The server switches this client
+// to the group once told datagrams arrive, and back to unicast when they
+// stop.
+void AudioClient::multicastLoop() {
+    applyThreadPolicy(ThreadRole::NETWORK);
+    registerLogThread(logger_);
+    int64_t last_heard = monotonicNowNs();
+    while (running_) {
+        Message message;
+        const bool received = multicast_.receive(message, MULTICAST_POLL_MS);
+        const int64_t now = monotonicNowNs();
+        if (!received) {
+            if (multicast_active_ && now - last_heard > MULTICAST_TIMEOUT_NS) {
+                multicast_active_ = false;
+                sendMulticastStatus(false);
+            }
+            continue;
+        }
+
+        last_heard = now;
+        multicast_received_++;
+        if (!multicast_active_) {
+            multicast_active_ = true;
+            sendMulticastStatus(true);
+        }
+        // The group also carries our own frames, the server's probes and
+        // senders other group members subscribed to
+        const int sender = audioFrameSender(message);
+        if (sender >= 0 && sender != multicast_self_id_ && isSubscribed(static_cast<uint16_t>(sender))) {
+            handleNetworkMessage(message, -1);
+        }
+    }
+}
+
+// Feeds the file source through the capture path in real time. Blocks are
+// due on absolute deadlines, so timer jitter never accumulates into drift.
+void AudioClient::sourceLoop() {
+    applyThreadPolicy(ThreadRole::AUDIO);
+    registerLogThread(logger_);
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point due = Clock::now();
+
+    while (source_running_) {
+        const float* samples = nullptr;
+        const size_t count = file_source_->read(SOURCE_BLOCK_FRAMES, samples);
+        if (count == 0) {
+            std::cout << "Finished playing " << file_source_->path() << std::endl;
+            break;
+        }
+
+        // Like a capture callback, a block is delivered once its last
+        // sample would have been recorded
+        const int64_t captured_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            due.time_since_epoch()).count();
+        due += std::chrono::nanoseconds(static_cast<int64_t>(count * 1e9 / sampleRate_));
+        const Clock::time_point now = Clock::now();
+        if (now - due > std::chrono::seconds(1)) {
+            // Stalled (suspended, or a debugger); resume rather than burst
+            due = now;
+        }
+        std::this_thread::sleep_until(due);
+        // No sender thread here: this thread may block on the network, and
+        // the mapped samples need no copy
+        if (recorder_) {
+            recorder_->push(AudioRecorder::Track::CAPTURE, samples, count);
+        }
+        transmitBlock(samples, count, captured_ns);
+    }
+}
@@ -0,0 +1,287 @@
+#include "AudioCodec.h"
+#include "LosslessCodec.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+struct CodecInfo {
+    AudioCodec codec;
+    const char* name;
+    bool stateless;
+};
+
+const CodecInfo CODECS[] = {
+    {AudioCodec::FLOAT32, "float32", true},
+    {AudioCodec::PCM16,   "pcm16",   true},
+    {AudioCodec::ULAW,    "ulaw",    true},
+    {AudioCodec::ALAW,    "alaw",    true},
+    {AudioCodec::ADPCM,   "adpcm",   true},
+    {AudioCodec::OPUS,    "opus",    false},
+    {AudioCodec::LOSSLESS, "lossless", true},
+    {AudioCodec::FLOAT16, "float16", true},
+};
+
+// Encoding goes through a stack buffer of int16 samples in chunks this size
+constexpr size_t CHUNK = 256;
+
+// IMA-ADPCM frame: the first sample verbatim, the step index the rest was
+// coded with, then one nibble per remaining sample, low nibble first
+constexpr size_t ADPCM_HEADER = 4;
+
+const int16_t ADPCM_STEPS[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767
+};
+
+const int ADPCM_INDEX_STEP[8] = {-1, -1, -1, -1, 2, 4, 6, 8};
+
+size_t adpcmBytes(size_t samples) {
+    return samples == 0 ? 0 : ADPCM_HEADER + samples / 2;
+}
+
+// Applies code to the predictor exactly as the decoder will
+void adpcmUpdate(uint8_t code, int& predictor, int& index) {
+    const int step = ADPCM_STEPS[index];
+    int delta = step >> 3;
+    if (code & 4) delta += step;
+    if (code & 2) delta += step >> 1;
+    if (code & 1) delta += step >> 2;
+    predictor += (code & 8) ? -delta : delta;
+    predictor = std::min(std::max(predictor, -32768), 32767);
+    index = std::min(std::max(index + ADPCM_INDEX_STEP[code & 7], 0), 88);
+}
+
+uint8_t adpcmCode(int sample, int predictor, int index) {
+    int diff = sample - predictor;
+    uint8_t code = 0;
+    if (diff < 0) {
+        code = 8;
+        diff = -diff;
+    }
+    int step = ADPCM_STEPS[index];
+    if (diff >= step) { code |= 4; diff -= step; }
+    step >>= 1;
+    if (diff >= step) { code |= 2; diff -= step; }
+    step >>= 1;
+    if (diff >= step) code |= 1;
+    return code;
+}
+
+size_t encodeAdpcm(const float* in, size_t samples, uint8_t* out, CodecState& state) {
+    if (samples == 0) return 0;
+    std::memset(out, 0, adpcmBytes(samples));
+
+    int16_t pcm[CHUNK];
+    int index = std::min(std::max(state.adpcm_index, 0), 88);
+    int predictor = 0;
+    for (size_t base = 0; base < samples; base += CHUNK) {
+        const size_t n = std::min(CHUNK, samples - base);
+        SampleKernels::floatToInt16(in + base, pcm, n, nullptr);
+        size_t i = 0;
+        if (base == 0) {
+            predictor = pcm[0];
+            const int16_t first = pcm[0];
+            std::memcpy(out, &first, sizeof(first));
+            out[2] = static_cast<uint8_t>(index);
+            i = 1;
+        }
+        for (; i < n; ++i) {
+            const uint8_t code = adpcmCode(pcm[i], predictor, index);
+            adpcmUpdate(code, predictor, index);
+            const size_t k = base + i - 1;
+            out[ADPCM_HEADER + k / 2] |= (k & 1) ? code << 4 : code;
+        }
+    }
+    state.adpcm_index = index;
+    return adpcmBytes(samples);
+}
+
+size_t decodeAdpcm(const uint8_t* in, size_t bytes, size_t samples, float* out) {
+    if (samples == 0 || bytes < adpcmBytes(samples) || in[2] > 88) return 0;
+
+    int16_t first;
+    std::memcpy(&first, in, sizeof(first));
+    int predictor = first;
+    int index = in[2];
+    out[0] = predictor * (1.0f / 32768.0f);
+    for (size_t k = 0; k + 1 < samples; ++k) {
+        const uint8_t byte = in[ADPCM_HEADER + k / 2];
+        adpcmUpdate((k & 1) ? byte >> 4 : byte & 0x0F, predictor, index);
+        out[k + 1] = predictor * (1.0f / 32768.0f);
+    }
+    return samples;
+}
+
+size_t encodePcm16(const float* in, size_t samples, uint8_t* out, CodecState& state) {
+    int16_t pcm[CHUNK];
+    for (size_t base = 0; base < samples; base += CHUNK) {
+        const size_t n = std::min(CHUNK, samples - base);
+        SampleKernels::floatToInt16(in + base, pcm, n, &state.dither);
+        std::memcpy(out + base * sizeof(int16_t), pcm, n * sizeof(int16_t));
+    }
+    return samples * sizeof(int16_t);
+}
+
+size_t decodePcm16(const uint8_t* in, size_t bytes, size_t samples, float* out) {
+    if (bytes < samples * sizeof(int16_t)) return 0;
+    int16_t pcm[CHUNK];
+    for (size_t base = 0; base < samples; base += CHUNK) {
+        const size_t n = std::min(CHUNK, samples - base);
+        std::memcpy(pcm, in + base * sizeof(int16_t), n * sizeof(int16_t));
+        SampleKernels::int16ToFloat(pcm, out + base, n);
+    }
+    return samples;
+}
+
+size_t encodeHalf(const float* in, size_t samples, uint8_t* out) {
+    uint16_t half[CHUNK];
+    for (size_t base = 0; base < samples; base += CHUNK) {
+        const size_t n = std::min(CHUNK, samples - base);
+        SampleKernels::floatToHalf(in + base, half, n);
+        std::memcpy(out + base * sizeof(uint16_t), half, n * sizeof(uint16_t));
+    }
+    return samples * sizeof(uint16_t);
+}
+
+size_t decodeHalf(const uint8_t* in, size_t bytes, size_t samples, float* out) {
+    if (bytes < samples * sizeof(uint16_t)) return 0;
+    uint16_t half[CHUNK];
+    for (size_t base = 0; base < samples; base += CHUNK) {
+        const size_t n = std::min(CHUNK, samples - base);
+        std::memcpy(half, in + base * sizeof(uint16_t), n * sizeof(uint16_t));
+        SampleKernels::halfToFloat(half, out + base, n);
+    }
+    return samples;
+}
+
+// Lossless frames are coded in blocks of LOSSLESS_BLOCK int24 samples
+size_t encodeLosslessFrame(const float* in, size_t samples, uint8_t* out) {
+    uint8_t packed[3 * LOSSLESS_BLOCK];
+    int32_t pcm[LOSSLESS_BLOCK];
+    size_t bytes = 0;
+    for (size_t base = 0; base < samples; base += LOSSLESS_BLOCK) {
+        const size_t n = std::min(LOSSLESS_BLOCK, samples - base);
+        SampleKernels::floatToInt24(in + base, packed, n, nullptr);
+        for (size_t i = 0; i < n; ++i) {
+            const uint32_t u = static_cast<uint32_t>(packed[3 * i]) << 8 |
+                               static_cast<uint32_t>(packed[3 * i + 1]) << 16 |
+                               static_cast<uint32_t>(packed[3 * i + 2]) << 24;
+            pcm[i] = static_cast<int32_t>(u) >> 8;
+        }
+        bytes += encodeLosslessBlock(pcm, n, out + bytes);
+    }
+    return bytes;
+}
+
+size_t decodeLosslessFrame(const uint8_t* in, size_t bytes, size_t samples, float* out) {
+    int32_t pcm[LOSSLESS_BLOCK];
+    size_t pos = 0;
+    for (size_t base = 0; base < samples; base += LOSSLESS_BLOCK) {
+        const size_t n = std::min(LOSSLESS_BLOCK, samples - base);
+        const size_t used = decodeLosslessBlock(in + pos, bytes - pos, pcm, n);
+        if (used == 0) return 0;
+        pos += used;
+        for (size_t i = 0; i < n; ++i) out[base + i] = pcm[i] * (1.0f / 8388608.0f);
+    }
+    return samples;
+}
+
+} // namespace
+
+const char* codecName(AudioCodec codec) {
+    for (const CodecInfo& info : CODECS) {
+        if (info.codec == codec) return info.name;
+    }
+    return "unknown";
+}
+
+bool parseCodecName(const std::string& name, AudioCodec& codec) {
+    for (const CodecInfo& info : CODECS) {
+        if (name == info.name) {
+            codec = info.codec;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t builtinCodecMask() {
+    uint32_t mask = 0;
+    for (const CodecInfo& info : CODECS) {
+        if (info.stateless) mask |= codecBit(info.codec);
+    }
+    return mask;
+}
+
+size_t maxEncodedBytes(AudioCodec codec, size_t samples) {
+    switch (codec) {
+        case AudioCodec::FLOAT32: return samples * sizeof(float);
+        case AudioCodec::PCM16:   return samples * sizeof(int16_t);
+        case AudioCodec::ULAW:
+        case AudioCodec::ALAW:    return samples;
+        case AudioCodec::ADPCM:   return adpcmBytes(samples);
+        case AudioCodec::OPUS:    return 1275;   // OPUS_MAX_PACKET
+        case AudioCodec::LOSSLESS: return losslessMaxBytes(samples);
+        case AudioCodec::FLOAT16: return samples * sizeof(uint16_t);
+    }
+    return 0;
+}
+
+size_t encodeAudio(AudioCodec codec, const float* in, size_t samples, uint8_t* out, CodecState& state) {
+    switch (codec) {
+        case AudioCodec::FLOAT32:
+            std::memcpy(out, in, samples * sizeof(float));
+            return samples * sizeof(float);
+        case AudioCodec::PCM16:
+            return encodePcm16(in, samples, out, state);
+        case AudioCodec::ULAW:
+            SampleKernels::floatToUlaw(in, out, samples);
+            return samples;
+        case AudioCodec::ALAW:
+            SampleKernels::floatToAlaw(in, out, samples);
+            return samples;
+        case AudioCodec::ADPCM:
+            return encodeAdpcm(in, samples, out, state);
+        case AudioCodec::LOSSLESS:
+            return encodeLosslessFrame(in, samples, out);
+        case AudioCodec::FLOAT16:
+            return encodeHalf(in, samples, out);
+        case AudioCodec::OPUS:
+            break;
+    }
+    return 0;
+}
+
+size_t decodeAudio(AudioCodec codec, const uint8_t* in, size_t bytes, size_t samples, float* out) {
+    switch (codec) {
+        case AudioCodec::FLOAT32:
+            if (bytes < samples * sizeof(float)) return 0;
+            std::memcpy(out, in, samples * sizeof(float));
+            return samples;
+        case AudioCodec::PCM16:
+            return decodePcm16(in, bytes, samples, out);
+        case AudioCodec::ULAW:
+            if (bytes < samples) return 0;
+            SampleKernels::ulawToFloat(in, out, samples);
+            return samples;
+        case AudioCodec::ALAW:
+            if (bytes < samples) return 0;
+            SampleKernels::alawToFloat(in, out, samples);
+            return samples;
+        case AudioCodec::ADPCM:
+            return decodeAdpcm(in, bytes, samples, out);
+        case AudioCodec::LOSSLESS:
+            return decodeLosslessFrame(in, bytes, samples, out);
+        case AudioCodec::FLOAT16:
+            return decodeHalf(in, bytes, samples, out);
+        case AudioCodec::OPUS:
+            break;
+    }
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include "AudioFec.h"
+#include <algorithm>
+#include <cstring>
+
+const char* fecModeName(FecMode mode) {
+    switch (mode) {
+        case FecMode::OFF:       return "off";
+        case FecMode::PARITY:    return "parity";
+        case FecMode::REDUNDANT: return "redundant";
+    }
+    return "unknown";
+}
+
+bool parseFecMode(const std::string& name, FecMode& mode) {
+    for (FecMode m : {FecMode::OFF, FecMode::PARITY, FecMode::REDUNDANT}) {
+        if (name == fecModeName(m)) {
+            mode = m;
+            return true;
+        }
+    }
+    return false;
+}
+
+void fecAccumulate(FecParityHeader& parity, uint8_t* payload, const AudioFrameHeader& header,
+                   const uint8_t* frame, size_t bytes) {
+    parity.timestamp ^= header.timestamp;
+    parity.length ^= static_cast<uint32_t>(bytes);
+    parity.samples ^= header.samples;
+    parity.codec ^= header.codec;
+    parity.flags ^= header.flags;
+    for (size_t i = 0; i < bytes; ++i) payload[i] ^= frame[i];
+}
+
+size_t fecInterval(uint8_t loss, size_t min_group, size_t max_group) {
+    max_group = std::min(std::max(max_group, min_group), FEC_MAX_GROUP);
+    if (loss == 0) return max_group;
+    return std::min(std::max<size_t>(26 / loss, min_group), max_group);
+}
+
+FecParityEncoder::FecParityEncoder()
+    : parity_{}, first_sequence_(0), longest_(0), payload_(new uint8_t[MAX_PAYLOAD]()) {}
+
+void FecParityEncoder::add(const AudioFrameHeader& header, const uint8_t* payload, size_t bytes) {
+    if (bytes > MAX_PAYLOAD) return;
+    if (parity_.count == 0) first_sequence_ = header.sequence;
+    fecAccumulate(parity_, payload_.get(), header, payload, bytes);
+    longest_ = std::max(longest_, bytes);
+    ++parity_.count;
+}
+
+void FecParityEncoder::reset() {
+    std::memset(payload_.get(), 0, longest_);
+    parity_ = FecParityHeader{};
+    longest_ = 0;
+}
+
+size_t FecParityEncoder::finish(AudioFrameHeader& header, uint8_t* out) {
+    if (parity_.count == 0) return 0;
+
+    header = AudioFrameHeader{};
+    header.sequence = first_sequence_;
+    header.flags = FRAME_FEC_PARITY;
+    std::memcpy(out, &parity_, sizeof(parity_));
+    std::memcpy(out + sizeof(parity_), payload_.get(), longest_);
+    const size_t bytes = sizeof(parity_) + longest_;
+    reset();
+    return bytes;
+}
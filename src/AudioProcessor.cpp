@@ -1,41 +1,77 @@
 
 #include "AudioProcessor.h"
+#include "DspStages.h"
+#include "ClockSync.h"
+#include "RealtimeMemory.h"
+#include "ThreadPolicy.h"
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <vector>
 
 #include <cstring>
 
-AudioProcessor::AudioProcessor() : input_stream_(nullptr), output_stream_(nullptr), playback_buffer_(nullptr), recording_(false), playing_(false), initialized_(false), sample_rate(44100), frames_per_buffer_(256) {
+namespace {
 
+// A null device that falls this far behind resumes rather than bursting
+constexpr int64_t NULL_DEVICE_MAX_LAG_NS = 1000000000LL;
+// Longest a pause waits for blocks in flight; they take a few hundred
+// microseconds, so this only runs out if a host call in one is stuck
+constexpr int64_t PAUSE_WAIT_NS = 100000000LL;
+
+void sleepUntilNs(int64_t when_ns) {
+  std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(when_ns)));
+}
+
+} // namespace
+
+AudioProcessor::AudioProcessor() : input_stream_(nullptr), output_stream_(nullptr), playback_buffer_(nullptr), logger_(nullptr), recording_(false), playing_(false), initialized_(false), paused_(false), in_callback_(0), null_device_(false), sample_rate(44100), frames_per_buffer_(256), output_latency_ns_(0) {
+  capture_chain_.addStage(std::unique_ptr<DspStage>(new HighPassStage(80.0f)));
+  capture_chain_.addStage(std::unique_ptr<DspStage>(new NoiseSuppressorStage()));
+  capture_chain_.addStage(std::unique_ptr<DspStage>(new NoiseGateStage()));
+  capture_chain_.addStage(std::unique_ptr<DspStage>(new AgcStage()));
+  capture_chain_.addStage(std::unique_ptr<DspStage>(new LimiterStage(-1.0f)));
+  // Off unless asked for: the suppressor adds a frame of latency
+  capture_chain_.stage("denoise")->setEnabled(false);
+  capture_chain_.stage("gate")->setEnabled(false);
+  capture_chain_.stage("agc")->setEnabled(false);
+
+  playback_chain_.addStage(std::unique_ptr<DspStage>(new GainStage(0.0f)));
+  playback_chain_.addStage(std::unique_ptr<DspStage>(new LimiterStage(-1.0f)));
 }
 AudioProcessor::~AudioProcessor() {
   cleanup();
 }
 
-bool AudioProcessor::initialize(int sample_rate, int frames_per_buffer_){
-  sample_rate = sample_rate;
-  frames_per_buffer_ = frames_per_buffer_;
+bool AudioProcessor::initialize(int rate, int frames_per_buffer){
+  sample_rate = rate;
+  frames_per_buffer_ = frames_per_buffer;
   
-  PaError err = Pa_Initialize();
-  
-  if(err != paNoError){
-    std::cerr << "PortAudio initialization failed: " << Pa_GetErrorText(err) << std::endl;
-    return false;
+  if (!null_device_) {
+    PaError err = Pa_Initialize();
+    if(err != paNoError){
+      std::cerr << "PortAudio initialization failed: " << Pa_GetErrorText(err) << std::endl;
+      return false;
+    }
   }
   
   playback_buffer_ = new AudioBuffer(sample_rate * 2);
+  capture_chain_.prepare(sample_rate, frames_per_buffer_);
+  playback_chain_.prepare(sample_rate, frames_per_buffer_);
   initialized_ = true;
   return true;
 }
 
 void AudioProcessor::cleanup(){
   stop();
+  paused_ = false;
   if(playback_buffer_){
     delete playback_buffer_;
     playback_buffer_ = nullptr;
   }
 
   if(initialized_){
-      Pa_Terminate();
+      if (!null_device_) Pa_Terminate();
       initialized_ = false;
   }
 
@@ -43,6 +79,12 @@ void AudioProcessor::cleanup(){
 
 bool AudioProcessor::startRecording() {
   if (!initialized_ || recording_ ) return false;
+  if (null_device_) {
+    recording_ = true;
+    null_capture_thread_ = std::thread(&AudioProcessor::nullCaptureLoop, this);
+    logEvent(logger_, LogEvent::RECORDING_STARTED);
+    return true;
+  }
   PaStreamParameters inputParameters;
   inputParameters.device = Pa_GetDefaultInputDevice();
   if (inputParameters.device == paNoDevice) {
@@ -79,13 +121,20 @@ bool AudioProcessor::startRecording() {
   }
 
   recording_ = true;
-  std::cout << "Recording started " << std::endl;
+  logEvent(logger_, LogEvent::RECORDING_STARTED);
   return true;
 }
 
 
 bool AudioProcessor::startPlayback() {
   if (!initialized_ || playing_) return false;
+  if (null_device_) {
+    output_latency_ns_ = 0;
+    playing_ = true;
+    null_playback_thread_ = std::thread(&AudioProcessor::nullPlaybackLoop, this);
+    logEvent(logger_, LogEvent::PLAYBACK_STARTED);
+    return true;
+  }
 
   PaStreamParameters outputParameters;
   outputParameters.device = Pa_GetDefaultOutputDevice();
@@ -122,18 +171,32 @@ bool AudioProcessor::startPlayback() {
     return false;
   }
 
+  const PaStreamInfo* info = Pa_GetStreamInfo(output_stream_);
+  output_latency_ns_ = info ? static_cast<int64_t>(info->outputLatency * 1e9) : 0;
+
   playing_ = true;
-  std::cout << "Playback started " << std::endl;
+  logEvent(logger_, LogEvent::PLAYBACK_STARTED);
   return true;
 }
 
 void AudioProcessor::stop(){
+  if (null_capture_thread_.joinable()) {
+    recording_ = false;
+    null_capture_thread_.join();
+    logEvent(logger_, LogEvent::RECORDING_STOPPED);
+  }
+  if (null_playback_thread_.joinable()) {
+    playing_ = false;
+    null_playback_thread_.join();
+    logEvent(logger_, LogEvent::PLAYBACK_STOPPED);
+  }
+
   if (recording_ && input_stream_ ) {
     Pa_StopStream(input_stream_);
     Pa_CloseStream(input_stream_);
     input_stream_ = nullptr;
     recording_ = false;
-    std::cout<<"Recording stopped "<< std::endl;
+    logEvent(logger_, LogEvent::RECORDING_STOPPED);
   }
   
   if (playing_ && output_stream_) {
@@ -141,33 +204,65 @@ void AudioProcessor::stop(){
     Pa_CloseStream(output_stream_);
     output_stream_ = nullptr;
     playing_ = false;
-    std::cout<<"Playback stopped "<< std::endl;
+    logEvent(logger_, LogEvent::PLAYBACK_STOPPED);
   }
 }
 
-void AudioProcessor::setAudioCaptureCallback(std::function<void(const float*, size_t)> callback){
+void AudioProcessor::setAudioCaptureCallback(std::function<void(const float*, size_t, int64_t)> callback){
   capture_callback_ = callback;
 }
 
+void AudioProcessor::setPlaybackSource(std::function<void(float*, size_t, int64_t)> source) {
+  playback_source_ = source;
+}
+
+void AudioProcessor::setPlaybackTap(std::function<void(const float*, size_t, int64_t)> tap) {
+  playback_tap_ = tap;
+}
+
+void AudioProcessor::setNullInput(std::function<void(float*, size_t, int64_t)> input) {
+  null_input_ = input;
+}
+
 bool AudioProcessor::addPlaybackData(const float* data, size_t samples) {
   if(!playback_buffer_) return false;
   return playback_buffer_->write(data, samples); 
 }
 
+namespace {
+
+// Converts a PortAudio stream time to monotonicNowNs(). Hosts that do not
+// implement timestamps report zeros; fallback_offset_ns is used instead.
+int64_t deviceTimeNs(const PaStreamCallbackTimeInfo* timeInfo, PaTime when, int64_t fallback_offset_ns) {
+    const int64_t now = monotonicNowNs();
+    if (!timeInfo || timeInfo->currentTime == 0.0 || when == 0.0) return now + fallback_offset_ns;
+    return now + static_cast<int64_t>((when - timeInfo->currentTime) * 1e9);
+}
+
+// PortAudio owns its callback threads, so they are only noted on their
+// first callback; the fault accounting happens off the audio thread
+void prepareCallbackThread() {
+    trackCallbackThread(ThreadRole::AUDIO);
+}
+
+} // namespace
+
 int AudioProcessor::recordCallback(const void* inputBuffer, void* outputBuffer,
                                  unsigned long framesPerBuffer,
                                  const PaStreamCallbackTimeInfo* timeInfo,
                                  PaStreamCallbackFlags statusFlags,
                                  void* userData) {
     (void)outputBuffer; // Unused
-    (void)timeInfo;     // Unused
     (void)statusFlags;  // Unused
 
+    prepareCallbackThread();
     AudioProcessor* processor = static_cast<AudioProcessor*>(userData);
     const float* input = static_cast<const float*>(inputBuffer);
 
-    if (processor->capture_callback_) {
-        processor->capture_callback_(input, framesPerBuffer);
+    if (processor->capture_callback_ && input) {
+        const int64_t captured = deviceTimeNs(timeInfo, timeInfo ? timeInfo->inputBufferAdcTime : 0.0,
+            -static_cast<int64_t>(framesPerBuffer * 1e9 / processor->sample_rate));
+        processor->deliverCapture(input, framesPerBuffer, captured);
     }
 
     return paContinue;
@@ -179,22 +274,130 @@ int AudioProcessor::playCallback(const void* inputBuffer, void* outputBuffer,
                                 PaStreamCallbackFlags statusFlags,
                                 void* userData) {
     (void)inputBuffer;  // Unused
-    (void)timeInfo;     // Unused
     (void)statusFlags;  // Unused
 
+    prepareCallbackThread();
     AudioProcessor* processor = static_cast<AudioProcessor*>(userData);
-    float* output = static_cast<float*>(outputBuffer);
+    const int64_t heard = deviceTimeNs(timeInfo, timeInfo ? timeInfo->outputBufferDacTime : 0.0,
+                                       processor->output_latency_ns_);
+    processor->renderPlayback(static_cast<float*>(outputBuffer), framesPerBuffer, heard);
+    return paContinue;
+}
 
-    if (processor->playback_buffer_) {
-        processor->playback_buffer_->read(output, framesPerBuffer);
-    } else {
-        // Fill with silence
-        memset(output, 0, framesPerBuffer * sizeof(float));
+bool AudioProcessor::setPaused(bool paused) {
+    paused_ = paused;
+    if (!paused) return true;
+    const int64_t deadline = monotonicNowNs() + PAUSE_WAIT_NS;
+    while (in_callback_ > 0) {
+        if (monotonicNowNs() >= deadline) return false;
+        std::this_thread::yield();
     }
+    return true;
+}
 
-    return paContinue;
+void AudioProcessor::deliverCapture(const float* input, size_t frames, int64_t captured_ns) {
+    if (!capture_callback_) return;
+    in_callback_++;
+    if (paused_) {
+        in_callback_--;
+        return;
+    }
+    float* work = capture_chain_.workBuffer();
+    if (work) {
+        // Hosts may deliver more than the chain was prepared for; such
+        // blocks go through in pieces, each dated by its first sample
+        const size_t max_frames = capture_chain_.maxFrames();
+        // The chain delays what comes out; date it by when it went in
+        const size_t delay = capture_chain_.latencyFrames();
+        for (size_t done = 0; done < frames;) {
+            const size_t piece = std::min(frames - done, max_frames);
+            memcpy(work, input + done, piece * sizeof(float));
+            capture_chain_.process(work, piece);
+            const int64_t offset = static_cast<int64_t>((static_cast<double>(done) - delay) * 1e9 / sample_rate);
+            capture_callback_(work, piece, captured_ns + offset);
+            done += piece;
+        }
+    } else {
+        capture_callback_(input, frames, captured_ns);
+    }
+    in_callback_--;
 }
 
+void AudioProcessor::renderPlayback(float* output, size_t frames, int64_t heard_ns) {
+    in_callback_++;
+    if (paused_) {
+        in_callback_--;
+        memset(output, 0, frames * sizeof(float));
+        return;
+    }
+    if (playback_source_) {
+        // What the source writes now leaves the chain this much later
+        const size_t delay = playback_chain_.latencyFrames();
+        playback_source_(output, frames, heard_ns + static_cast<int64_t>(delay * 1e9 / sample_rate));
+        playback_chain_.process(output, frames);
+    } else if (playback_buffer_) {
+        playback_buffer_->read(output, frames);
+        playback_chain_.process(output, frames);
+    } else {
+        // Fill with silence
+        memset(output, 0, frames * sizeof(float));
+    }
 
+    if (playback_tap_) {
+        playback_tap_(output, frames, heard_ns);
+    }
+    in_callback_--;
+}
 
+// Blocks are due on the sample clock, so timer jitter never accumulates
+// into drift. A capture block is delivered once its last sample is in.
+void AudioProcessor::nullCaptureLoop() {
+    applyThreadPolicy(ThreadRole::AUDIO);
+    registerLogThread(logger_);
+    const size_t frames = static_cast<size_t>(frames_per_buffer_);
+    std::vector<float> block(frames);
+    int64_t start = monotonicNowNs();
+    uint64_t captured = 0;
+    while (recording_) {
+        const int64_t first = start + static_cast<int64_t>(captured * 1e9 / sample_rate);
+        const int64_t ready = start + static_cast<int64_t>((captured + frames) * 1e9 / sample_rate);
+        if (monotonicNowNs() - ready > NULL_DEVICE_MAX_LAG_NS) {
+            start = monotonicNowNs();
+            captured = 0;
+            continue;
+        }
+        sleepUntilNs(ready);
+        if (!recording_) break;
+
+        if (null_input_) {
+            null_input_(block.data(), frames, first);
+        } else {
+            std::fill(block.begin(), block.end(), 0.0f);
+        }
+        deliverCapture(block.data(), frames, first);
+        captured += frames;
+    }
+}
 
+// The null device has no output buffer: a block is heard when it is due
+void AudioProcessor::nullPlaybackLoop() {
+    applyThreadPolicy(ThreadRole::AUDIO);
+    registerLogThread(logger_);
+    const size_t frames = static_cast<size_t>(frames_per_buffer_);
+    std::vector<float> block(frames);
+    int64_t start = monotonicNowNs();
+    uint64_t played = 0;
+    while (playing_) {
+        const int64_t due = start + static_cast<int64_t>(played * 1e9 / sample_rate);
+        if (monotonicNowNs() - due > NULL_DEVICE_MAX_LAG_NS) {
+            start = monotonicNowNs();
+            played = 0;
+            continue;
+        }
+        sleepUntilNs(due);
+        if (!playing_) break;
+
+        renderPlayback(block.data(), frames, due);
+        played += frames;
+    }
+}
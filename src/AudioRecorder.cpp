@@ -0,0 +1,330 @@
+#include "AudioRecorder.h"
+#include "ThreadPolicy.h"
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+
+#ifdef _WIN32
+    #include <cstdio>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace {
+
+// Data starts on a 4 KiB boundary so every full block lands aligned on disk
+constexpr size_t HEADER_BYTES = 4096;
+constexpr size_t BLOCK_BYTES = 256 * 1024;
+constexpr size_t BLOCK_ALIGN = 4096;
+constexpr uint64_t PREALLOC_BYTES = 64ull * 1024 * 1024;
+constexpr uint64_t RIFF_LIMIT = 0xFFFFFFFFull;
+
+// RIFF(12) + ds64/JUNK(8+28) + JUNK padding + fmt(8+18) + data header(8)
+constexpr size_t DS64_OFFSET = 12;
+constexpr size_t PAD_OFFSET = DS64_OFFSET + 8 + 28;
+constexpr size_t FMT_OFFSET = HEADER_BYTES - 8 - (8 + 18);
+constexpr size_t DATA_OFFSET = HEADER_BYTES - 8;
+
+void put16(uint8_t* p, uint16_t v) { p[0] = v & 0xFF; p[1] = (v >> 8) & 0xFF; }
+void put32(uint8_t* p, uint32_t v) { for (int i = 0; i < 4; ++i) p[i] = (v >> (8 * i)) & 0xFF; }
+void put64(uint8_t* p, uint64_t v) { for (int i = 0; i < 8; ++i) p[i] = (v >> (8 * i)) & 0xFF; }
+
+struct AlignedFree {
+    void operator()(uint8_t* p) const {
+#ifdef _WIN32
+        _aligned_free(p);
+#else
+        std::free(p);
+#endif
+    }
+};
+
+uint8_t* alignedAlloc(size_t bytes) {
+#ifdef _WIN32
+    return static_cast<uint8_t*>(_aligned_malloc(bytes, BLOCK_ALIGN));
+#else
+    void* p = nullptr;
+    if (posix_memalign(&p, BLOCK_ALIGN, bytes) != 0) return nullptr;
+    return static_cast<uint8_t*>(p);
+#endif
+}
+
+void buildHeader(uint8_t* h, int sample_rate, int channels, uint64_t data_bytes) {
+    std::memset(h, 0, HEADER_BYTES);
+    const uint64_t riff_bytes = HEADER_BYTES - 8 + data_bytes;
+    const bool rf64 = riff_bytes > RIFF_LIMIT;
+    const uint16_t block_align = static_cast<uint16_t>(channels * sizeof(float));
+
+    std::memcpy(h, rf64 ? "RF64" : "RIFF", 4);
+    put32(h + 4, rf64 ? 0xFFFFFFFFu : static_cast<uint32_t>(riff_bytes));
+    std::memcpy(h + 8, "WAVE", 4);
+
+    // Reserved ds64 slot; stays a JUNK chunk unless the file outgrows RIFF
+    std::memcpy(h + DS64_OFFSET, rf64 ? "ds64" : "JUNK", 4);
+    put32(h + DS64_OFFSET + 4, 28);
+    if (rf64) {
+        put64(h + DS64_OFFSET + 8, riff_bytes);
+        put64(h + DS64_OFFSET + 16, data_bytes);
+        put64(h + DS64_OFFSET + 24, data_bytes / block_align);
+    }
+
+    std::memcpy(h + PAD_OFFSET, "JUNK", 4);
+    put32(h + PAD_OFFSET + 4, static_cast<uint32_t>(FMT_OFFSET - PAD_OFFSET - 8));
+
+    std::memcpy(h + FMT_OFFSET, "fmt ", 4);
+    put32(h + FMT_OFFSET + 4, 18);
+    put16(h + FMT_OFFSET + 8, 3); // WAVE_FORMAT_IEEE_FLOAT
+    put16(h + FMT_OFFSET + 10, static_cast<uint16_t>(channels));
+    put32(h + FMT_OFFSET + 12, static_cast<uint32_t>(sample_rate));
+    put32(h + FMT_OFFSET + 16, static_cast<uint32_t>(sample_rate) * block_align);
+    put16(h + FMT_OFFSET + 20, block_align);
+    put16(h + FMT_OFFSET + 22, 32);
+    put16(h + FMT_OFFSET + 24, 0);
+
+    std::memcpy(h + DATA_OFFSET, "data", 4);
+    put32(h + DATA_OFFSET + 4, rf64 ? 0xFFFFFFFFu : static_cast<uint32_t>(data_bytes));
+}
+
+} // namespace
+
+struct AudioRecorder::TrackState {
+    explicit TrackState(size_t ring_samples) : ring(ring_samples), dropped(0), written(0) {}
+
+    std::string path;
+    LockFreeRing<float> ring;
+#ifdef _WIN32
+    FILE* file = nullptr;
+#else
+    int fd = -1;
+#endif
+    std::unique_ptr<uint8_t, AlignedFree> block;
+    size_t block_fill = 0;
+    uint64_t data_bytes = 0;
+    uint64_t allocated_bytes = 0;
+    bool failed = false;
+
+    std::atomic<uint64_t> dropped;
+    std::atomic<uint64_t> written;
+
+    bool isOpen() const {
+#ifdef _WIN32
+        return file != nullptr;
+#else
+        return fd >= 0;
+#endif
+    }
+
+    bool writeAt(const void* data, size_t bytes, uint64_t offset) {
+#ifdef _WIN32
+        if (_fseeki64(file, static_cast<long long>(offset), SEEK_SET) != 0) return false;
+        return fwrite(data, 1, bytes, file) == bytes;
+#else
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        while (bytes > 0) {
+            ssize_t n = pwrite(fd, p, bytes, static_cast<off_t>(offset));
+            if (n <= 0) return false;
+            p += n;
+            bytes -= n;
+            offset += n;
+        }
+        return true;
+#endif
+    }
+
+    // Reserve extents ahead of the write position so block writes do not
+    // have to allocate on the fly. Failure here is harmless.
+    void preallocate(uint64_t end) {
+        if (end <= allocated_bytes) return;
+        uint64_t target = allocated_bytes + PREALLOC_BYTES;
+        while (target < end) target += PREALLOC_BYTES;
+#if defined(__linux__)
+        if (fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(target)) != 0) {
+            posix_fallocate(fd, static_cast<off_t>(allocated_bytes), static_cast<off_t>(target - allocated_bytes));
+        }
+#endif
+        allocated_bytes = target;
+    }
+
+    void closeFile() {
+#ifdef _WIN32
+        if (file) fclose(file);
+        file = nullptr;
+#else
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+#endif
+    }
+};
+
+AudioRecorder::AudioRecorder(int sample_rate, int channels, double ring_seconds)
+    : sample_rate_(sample_rate), channels_(channels),
+      ring_samples_(static_cast<size_t>(ring_seconds * sample_rate * channels)),
+      open_(false), running_(false) {
+    for (auto& track : tracks_) {
+        track.reset(new TrackState(ring_samples_));
+    }
+}
+
+AudioRecorder::~AudioRecorder() {
+    close();
+}
+
+bool AudioRecorder::open(const std::string& path_prefix) {
+    if (open_) return true;
+
+    static const char* suffixes[TRACK_COUNT] = {"_capture.wav", "_playback.wav"};
+    uint8_t header[HEADER_BYTES];
+    buildHeader(header, sample_rate_, channels_, 0);
+
+    for (size_t i = 0; i < TRACK_COUNT; ++i) {
+        TrackState& track = *tracks_[i];
+        track.path = path_prefix + suffixes[i];
+#ifdef _WIN32
+        track.file = fopen(track.path.c_str(), "wb");
+#else
+        track.fd = ::open(track.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+        if (!track.isOpen()) {
+            std::cerr << "Failed to open recording file " << track.path << std::endl;
+            for (size_t j = 0; j < i; ++j) tracks_[j]->closeFile();
+            return false;
+        }
+
+        track.block.reset(alignedAlloc(BLOCK_BYTES));
+        track.block_fill = 0;
+        track.data_bytes = 0;
+        track.allocated_bytes = 0;
+        track.failed = !track.block || !track.writeAt(header, HEADER_BYTES, 0);
+        track.dropped = 0;
+        track.written = 0;
+#ifndef _WIN32
+        track.preallocate(HEADER_BYTES + BLOCK_BYTES);
+#endif
+    }
+
+    running_ = true;
+    open_ = true;
+    writer_thread_ = std::thread(&AudioRecorder::writerLoop, this);
+
+    std::cout << "Recording session to " << path_prefix << "_*.wav" << std::endl;
+    return true;
+}
+
+void AudioRecorder::close() {
+    if (!open_) return;
+    open_ = false;
+    running_ = false;
+
+    if (writer_thread_.joinable()) {
+        writer_thread_.join();
+    }
+
+    for (auto& track : tracks_) {
+        drainTrack(*track, true);
+        finalizeTrack(*track);
+        track->closeFile();
+        track->block.reset();
+    }
+}
+
+bool AudioRecorder::push(Track track, const float* data, size_t samples) {
+    if (!open_) return false;
+
+    TrackState& state = *tracks_[static_cast<size_t>(track)];
+    if (!state.ring.write(data, samples)) {
+        state.dropped.fetch_add(samples, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+uint64_t AudioRecorder::droppedSamples(Track track) const {
+    return tracks_[static_cast<size_t>(track)]->dropped.load(std::memory_order_relaxed);
+}
+
+uint64_t AudioRecorder::writtenSamples(Track track) const {
+    return tracks_[static_cast<size_t>(track)]->written.load(std::memory_order_relaxed);
+}
+
+size_t AudioRecorder::writerLag(Track track) const {
+    return tracks_[static_cast<size_t>(track)]->ring.available();
+}
+
+void AudioRecorder::writerLoop() {
+    applyThreadPolicy(ThreadRole::BACKGROUND);
+    while (running_) {
+        bool busy = false;
+        for (auto& track : tracks_) {
+            busy |= drainTrack(*track, false);
+        }
+        if (!busy) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+}
+
+// Moves queued samples into the staging block and writes it out whenever it
+// fills. Returns true if at least one full block was written.
+bool AudioRecorder::drainTrack(TrackState& track, bool flush) {
+    bool wrote = false;
+    float* staging = reinterpret_cast<float*>(track.block.get());
+    const size_t block_samples = BLOCK_BYTES / sizeof(float);
+
+    while (staging) {
+        size_t filled = track.block_fill / sizeof(float);
+        size_t n = track.ring.read(staging + filled, block_samples - filled);
+        track.block_fill += n * sizeof(float);
+
+        if (track.block_fill == BLOCK_BYTES) {
+            writeBlock(track, BLOCK_BYTES);
+            wrote = true;
+        } else {
+            break;
+        }
+    }
+
+    if (flush && track.block_fill > 0) {
+        writeBlock(track, track.block_fill);
+    }
+    return wrote;
+}
+
+bool AudioRecorder::writeBlock(TrackState& track, size_t bytes) {
+    track.block_fill = 0;
+    if (track.failed) return false;
+
+    const uint64_t offset = HEADER_BYTES + track.data_bytes;
+#ifndef _WIN32
+    track.preallocate(offset + bytes);
+#endif
+    if (!track.writeAt(track.block.get(), bytes, offset)) {
+        std::cerr << "Recording write failed for " << track.path << ", track disabled" << std::endl;
+        track.failed = true;
+        return false;
+    }
+
+    track.data_bytes += bytes;
+    track.written.store(track.data_bytes / sizeof(float), std::memory_order_relaxed);
+    return true;
+}
+
+// Sizes are only known at the end, so the header is rewritten once on close
+bool AudioRecorder::finalizeTrack(TrackState& track) {
+    if (!track.isOpen() || track.failed) return false;
+
+    uint8_t header[HEADER_BYTES];
+    buildHeader(header, sample_rate_, channels_, track.data_bytes);
+    if (!track.writeAt(header, HEADER_BYTES, 0)) {
+        std::cerr << "Failed to finalize recording " << track.path << std::endl;
+        return false;
+    }
+
+    const uint64_t dropped = track.dropped.load();
+    if (dropped > 0) {
+        std::cerr << "Recording " << track.path << " dropped " << dropped
+                  << " samples (disk too slow)" << std::endl;
+    }
+    return true;
+}
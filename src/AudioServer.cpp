@@ -1,8 +1,20 @@
 #include "AudioServer.h"
+#include "ThreadPolicy.h"
 #include <iostream>
 #include <algorithm>
+#include <cstring>
 
-AudioServer::AudioServer(): running_(false) {
+namespace {
+
+// How often the multicast group is probed; also the server loop's tick
+constexpr int MULTICAST_PROBE_MS = 250;
+
+} // namespace
+
+AudioServer::AudioServer(SessionLogger* logger): logger_(logger), capture_(nullptr), running_(false) {
+  network_manager_.setLogger(logger_);
+  listener_codec_count_.fill(0);
+  speaker_slots_.removeAll();
 
 }
 
@@ -10,11 +22,18 @@ AudioServer::~AudioServer() {
   stop();
 }
 
+bool AudioServer::setMulticast(const std::string& group, int port, int ttl,
+                               const std::string& interface_address) {
+  if (!multicast_.openSender(group, port, ttl, interface_address)) return false;
+  std::cout << "Multicast delivery to " << multicast_.describe() << std::endl;
+  return true;
+}
+
 bool AudioServer::start(int port){
   if (running_) return true;
   
   network_manager_.setMessageHandler(
-    [this] (const Message& msg, int socket) {
+    [this] (Message& msg, int socket) {
       handleClientMessage(msg, socket);
     }
   );
@@ -25,7 +44,7 @@ bool AudioServer::start(int port){
 
  running_ = true;
  server_thread_ = std::thread(&AudioServer::serverLoop, this);
-  std::cout << "AudSync Server started on port" << port << std::endl;
+  logEvent(logger_, LogEvent::SERVER_STARTED, port);
   return true;
 }
 
@@ -46,7 +65,10 @@ void AudioServer::stop() {
   std::lock_guard<std::mutex> lock(clients_mutex);
 
   clients_.clear();
-  std::cout <<"Server stopped" << std::endl;
+  listeners_.clear();
+  listener_codec_count_.fill(0);
+  speaker_slots_.removeAll();
+  logEvent(logger_, LogEvent::SERVER_STOPPED);
 }
 
 bool AudioServer::isRunning() const {
@@ -55,43 +77,97 @@ bool AudioServer::isRunning() const {
 
 size_t AudioServer::getConnectedClients() const {
   std::lock_guard<std::mutex> lock(clients_mutex);
-  return clients_.size();
+  return clients_.size() + listeners_.size();
 }
-void AudioServer::handleClientMessage(const Message& message, SOCKET client_socket) {
+
+size_t AudioServer::getMulticastClients() const {
+  std::lock_guard<std::mutex> lock(clients_mutex);
+  return std::count_if(clients_.begin(), clients_.end(),
+                       [](const ClientInfo& client) { return client.multicast; }) +
+         std::count_if(listeners_.begin(), listeners_.end(),
+                       [](const ListenerInfo& listener) { return listener.multicast; });
+}
+
+size_t AudioServer::getListeners() const {
+  std::lock_guard<std::mutex> lock(clients_mutex);
+  return listeners_.size();
+}
+void AudioServer::handleClientMessage(Message& message, SOCKET client_socket) {
+    if (capture_) {
+        capture_->record(static_cast<uint8_t>(message.type), message.data.data(), message.size);
+    }
     switch (message.type) {
         case MessageType::CONNECT:
-            addClient(client_socket);
-            std::cout << "Client " << client_socket << " connected. Total clients: " 
-                      << getConnectedClients() << std::endl;
+            addClient(client_socket, message);
+            logEvent(logger_, LogEvent::CLIENT_JOINED, client_socket, getConnectedClients());
             break;
             
         case MessageType::DISCONNECT:
             removeClient(client_socket);
-            std::cout << "Client " << client_socket << " disconnected. Total clients: " 
-                      << getConnectedClients() << std::endl;
+            logEvent(logger_, LogEvent::CLIENT_LEFT, client_socket, getConnectedClients());
             break;
             
         case MessageType::CLIENT_READY:
             {
                 std::lock_guard<std::mutex> lock(clients_mutex);
-                auto it = std::find_if(clients_.begin(), clients_.end(),
-                    [client_socket](const ClientInfo& client) {
-                        return client.socket_fd == client_socket;
-                    });
-                if (it != clients_.end()) {
-                    it->ready = true;
-                    std::cout << "Client " << client_socket << " is ready for audio" << std::endl;
+                ClientInfo* client = findClient(client_socket);
+                ListenerInfo* listener = client ? nullptr : findListener(client_socket);
+                if (client || listener) {
+                    (client ? client->ready : listener->ready) = true;
+                    logEvent(logger_, LogEvent::CLIENT_READY, client_socket);
                 }
             }
             break;
             
         case MessageType::AUDIO_DATA:
+        case MessageType::SENDER_REPORT:
             broadcastAudioToOthers(message, client_socket);
             break;
             
+        case MessageType::RECEIVER_REPORT:
+            handleReceiverReport(message, client_socket);
+            break;
+
+        case MessageType::SUBSCRIBE:
+        case MessageType::UNSUBSCRIBE:
+            handleSubscription(message, client_socket);
+            break;
+
+        case MessageType::MULTICAST_STATUS:
+            if (!message.data.empty() && multicast_.isOpen()) {
+                std::lock_guard<std::mutex> lock(clients_mutex);
+                ClientInfo* client = findClient(client_socket);
+                ListenerInfo* listener = client ? nullptr : findListener(client_socket);
+                bool* multicast = client ? &client->multicast : listener ? &listener->multicast : nullptr;
+                const bool receiving = message.data[0] != 0;
+                if (multicast && *multicast != receiving) {
+                    *multicast = receiving;
+                    logEvent(logger_, receiving ? LogEvent::MULTICAST_JOINED : LogEvent::MULTICAST_LEFT,
+                             client_socket);
+                }
+            }
+            break;
+
         case MessageType::HEARTBEAT:
-            // Echo heartbeat back
-            network_manager_.sendMessage(message, client_socket);
+            {
+                // Echo heartbeat back, stamped with the media clock when it
+                // asks for a clock sample
+                HeartbeatPayload sync;
+                if (message.data.size() < sizeof(sync)) {
+                    network_manager_.sendMessage(message, client_socket);
+                    break;
+                }
+                const int64_t received = monotonicNowNs();
+                Message reply = message;
+                std::memcpy(&sync, reply.data.data(), sizeof(sync));
+                sync.flags |= HEARTBEAT_REPLY;
+                sync.server_receive = received;
+                network_manager_.sendStamped(reply, client_socket, [&sync](Message& stamped) {
+                    // Stamped once no other sender holds the socket
+                    sync.server_send = monotonicNowNs();
+                    std::memcpy(stamped.data.data(), &sync, sizeof(sync));
+                });
+            }
             break;
             
         default:
@@ -99,30 +175,141 @@ void AudioServer::handleClientMessage(const Message& message, SOCKET client_sock
     }
 }
 
-void AudioServer::broadcastAudioToOthers(const Message& message, SOCKET sender_socket) {
+void AudioServer::broadcastAudioToOthers(Message& message, SOCKET sender_socket) {
   
   std::lock_guard<std::mutex> lock(clients_mutex);
 
+  // Listeners have no ingress path; only speakers are relayed
+  const ClientInfo* sender = findClient(sender_socket);
+  if (!sender) return;
+  // Receivers keep one jitter buffer stream per sender
+  stampAudioFrameSender(message, static_cast<uint16_t>(sender_socket));
+
+  const size_t slot = sender->slot;
+  const bool repair = (audioFrameFlags(message) & FRAME_FEC_MASK) != 0;
+  bool to_group = false;
   for(const auto& client: clients_  ){
-    if(client.socket_fd != sender_socket && client.ready) {
+    if(client.socket_fd == sender_socket || !client.ready || !client.subscriptions.contains(slot)) continue;
+    if (client.multicast) {
+        // Group members drop their own frames by sender id
+        to_group = true;
+    } else if (client.fec || !repair) {
         network_manager_.sendMessage(message, client.socket_fd);
     }
   }
+  for (const auto& listener : listeners_) {
+    if (!listener.ready || !listener.subscriptions.contains(slot)) continue;
+    if (listener.multicast) {
+        to_group = true;
+    } else if (listener.fec || !repair) {
+        network_manager_.sendMessage(message, listener.socket_fd);
+    }
+  }
+  if (to_group) multicast_.send(message);
 }
 
-void AudioServer::addClient(SOCKET socket_fd) {
+void AudioServer::addClient(SOCKET socket_fd, const Message& connect) {
     std::lock_guard<std::mutex> lock(clients_mutex);
+
+    CodecHello hello{};
+    if (connect.data.size() >= sizeof(hello)) {
+        std::memcpy(&hello, connect.data.data(), sizeof(hello));
+        if (hello.features & HELLO_FEATURE_LISTEN_ONLY) {
+            addListener(socket_fd, hello);
+            return;
+        }
+    }
     
     ClientInfo client;
     client.socket_fd = socket_fd;
     client.ready = false;
     client.id = "client_" + std::to_string(socket_fd);
+    client.negotiates = false;
+    client.codecs = codecBit(AudioCodec::FLOAT32);
+    client.preferred = AudioCodec::FLOAT32;
+    client.selected = AudioCodec::FLOAT32;
+    client.fec = false;
+    client.reported_loss = 0;
+    client.multicast = false;
+    client.slot = speaker_slots_.firstUnmarked();
+    speaker_slots_.add(client.slot);
+
+    if (connect.data.size() >= sizeof(hello)) {
+        client.negotiates = true;
+        client.codecs = hello.supported | codecBit(AudioCodec::FLOAT32);
+        client.preferred = static_cast<AudioCodec>(hello.preferred);
+        client.fec = (hello.features & HELLO_FEATURE_FEC) != 0;
+    }
     
     clients_.push_back(client);
+    selectCodecs();
+
+    if (hello.features & HELLO_FEATURE_MULTICAST) sendMulticastOffer(socket_fd);
+}
+
+void AudioServer::addListener(SOCKET socket_fd, const CodecHello& hello) {
+    ListenerInfo listener;
+    listener.socket_fd = socket_fd;
+    listener.ready = false;
+    listener.fec = (hello.features & HELLO_FEATURE_FEC) != 0;
+    listener.multicast = false;
+    listener.codecs = hello.supported | codecBit(AudioCodec::FLOAT32);
+    listeners_.push_back(listener);
+
+    for (size_t bit = 0; bit < listener_codec_count_.size(); ++bit) {
+        if (listener.codecs & (1u << bit)) ++listener_codec_count_[bit];
+    }
+    selectCodecs();
+    if (hello.features & HELLO_FEATURE_MULTICAST) sendMulticastOffer(socket_fd);
+}
+
+ClientInfo* AudioServer::findClient(SOCKET socket_fd) {
+    for (auto& client : clients_) {
+        if (client.socket_fd == socket_fd) return &client;
+    }
+    return nullptr;
+}
+
+// Sender ids in frames are the sender's socket, see AUDIO_DATA
+ClientInfo* AudioServer::findSpeaker(uint16_t sender_id) {
+    for (auto& client : clients_) {
+        if (static_cast<uint16_t>(client.socket_fd) == sender_id) return &client;
+    }
+    return nullptr;
+}
+
+ListenerInfo* AudioServer::findListener(SOCKET socket_fd) {
+    for (auto& listener : listeners_) {
+        if (listener.socket_fd == socket_fd) return &listener;
+    }
+    return nullptr;
+}
+
+void AudioServer::sendMulticastOffer(SOCKET socket_fd) {
+    if (!multicast_.isOpen()) return;
+
+    MulticastOffer offer{};
+    offer.group = multicast_.group();
+    offer.port = static_cast<uint16_t>(multicast_.port());
+    offer.sender_id = static_cast<uint16_t>(socket_fd);
+    Message message;
+    message.type = MessageType::MULTICAST_OFFER;
+    message.size = sizeof(offer);
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&offer);
+    message.data.assign(bytes, bytes + sizeof(offer));
+    network_manager_.sendMessage(message, socket_fd);
 }
 
 void AudioServer::removeClient(SOCKET socket_fd) {
     std::lock_guard<std::mutex> lock(clients_mutex);
+
+    // The slot goes to the next speaker, who starts out with each
+    // recipient's default
+    if (const ClientInfo* speaker = findClient(socket_fd)) {
+        speaker_slots_.remove(speaker->slot);
+        for (auto& client : clients_) client.subscriptions.forget(speaker->slot);
+        for (auto& listener : listeners_) listener.subscriptions.forget(speaker->slot);
+    }
     
     clients_.erase(
         std::remove_if(clients_.begin(), clients_.end(),
@@ -131,20 +318,126 @@ void AudioServer::removeClient(SOCKET socket_fd) {
             }),
         clients_.end()
     );
+    if (ListenerInfo* listener = findListener(socket_fd)) {
+        for (size_t bit = 0; bit < listener_codec_count_.size(); ++bit) {
+            if (listener->codecs & (1u << bit)) --listener_codec_count_[bit];
+        }
+        // Order does not matter to fan-out
+        *listener = listeners_.back();
+        listeners_.pop_back();
+    }
+    for (auto& client : clients_) {
+        if (client.receiver_loss.erase(socket_fd)) updateLossReport(client);
+    }
+    selectCodecs();
+}
+
+void AudioServer::handleReceiverReport(const Message& message, SOCKET receiver_socket) {
+    std::lock_guard<std::mutex> lock(clients_mutex);
+
+    for (size_t offset = 0; offset + sizeof(ReceiverReportEntry) <= message.data.size();
+         offset += sizeof(ReceiverReportEntry)) {
+        ReceiverReportEntry entry;
+        std::memcpy(&entry, message.data.data() + offset, sizeof(entry));
+        ClientInfo* sender = findSpeaker(entry.sender_id);
+        if (!sender || sender->socket_fd == receiver_socket) continue;
+        sender->receiver_loss[receiver_socket] = entry.loss;
+        updateLossReport(*sender);
+    }
+}
+
+void AudioServer::handleSubscription(const Message& message, SOCKET recipient_socket) {
+    std::lock_guard<std::mutex> lock(clients_mutex);
+
+    ClientInfo* client = findClient(recipient_socket);
+    ListenerInfo* listener = client ? nullptr : findListener(recipient_socket);
+    if (!client && !listener) return;
+    SubscriptionSet& subscriptions = client ? client->subscriptions : listener->subscriptions;
+
+    const bool subscribe = message.type == MessageType::SUBSCRIBE;
+    if (message.data.size() < sizeof(uint16_t)) {
+        if (subscribe) {
+            subscriptions.addAll();
+        } else {
+            subscriptions.removeAll();
+        }
+        return;
+    }
+    for (size_t offset = 0; offset + sizeof(uint16_t) <= message.data.size(); offset += sizeof(uint16_t)) {
+        uint16_t sender_id;
+        std::memcpy(&sender_id, message.data.data() + offset, sizeof(sender_id));
+        const ClientInfo* sender = findSpeaker(sender_id);
+        if (!sender) continue;
+        if (subscribe) {
+            subscriptions.add(sender->slot);
+        } else {
+            subscriptions.remove(sender->slot);
+        }
+    }
+}
+
+void AudioServer::updateLossReport(ClientInfo& sender) {
+    uint8_t worst = 0;
+    for (const auto& report : sender.receiver_loss) worst = std::max(worst, report.second);
+    if (worst == sender.reported_loss || !sender.fec) return;
+
+    sender.reported_loss = worst;
+    Message report;
+    report.type = MessageType::LOSS_REPORT;
+    report.size = 1;
+    report.data.assign(1, worst);
+    network_manager_.sendMessage(report, sender.socket_fd);
+}
+
+void AudioServer::selectCodecs() {
+    uint32_t common = ~0u;
+    for (const auto& client : clients_) common &= client.codecs;
+    for (size_t bit = 0; bit < listener_codec_count_.size(); ++bit) {
+        if (listener_codec_count_[bit] != listeners_.size()) common &= ~(1u << bit);
+    }
+
+    for (auto& client : clients_) {
+        AudioCodec choice = AudioCodec::FLOAT32;
+        if (common & codecBit(client.preferred)) {
+            choice = client.preferred;
+        } else if (common & codecBit(AudioCodec::PCM16)) {
+            choice = AudioCodec::PCM16;
+        }
+        if (choice == client.selected || !client.negotiates) continue;
+
+        client.selected = choice;
+        Message select;
+        select.type = MessageType::CODEC_SELECT;
+        select.size = 1;
+        select.data.assign(1, static_cast<uint8_t>(choice));
+        network_manager_.sendMessage(select, client.socket_fd);
+        logEvent(logger_, LogEvent::CODEC_SELECTED, client.socket_fd, static_cast<int>(choice));
+    }
 }
 
 void AudioServer::serverLoop() {
+    applyThreadPolicy(ThreadRole::CONTROL);
+    registerLogThread(logger_);
     std::cout << "Server loop started. Waiting for clients..." << std::endl;
     
     while (running_) {
         // Server management tasks could go here
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+        std::this_thread::sleep_for(std::chrono::milliseconds(MULTICAST_PROBE_MS));
+
+        // Lets clients tell whether the group reaches them even while
+        // nobody speaks
+        if (multicast_.isOpen()) {
+            Message probe;
+            probe.type = MessageType::HEARTBEAT;
+            probe.size = 0;
+            multicast_.send(probe);
+        }
         
         // Log status every 30 seconds
         static int counter = 0;
-        if (++counter >= 30) {
+        if (++counter >= 30 * 1000 / MULTICAST_PROBE_MS) {
             counter = 0;
-            std::cout << "Server status: " << getConnectedClients() << " clients connected" << std::endl;
+            logEvent(logger_, LogEvent::SERVER_STATUS, getConnectedClients());
         }
     }
 }
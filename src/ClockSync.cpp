@@ -0,0 +1,126 @@
+#include "ClockSync.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Replies this much above the recent minimum round trip (or half of it,
+// if more) were held up in a queue and say little about the offset
+constexpr int64_t OUTLIER_MARGIN_NS = 250000;
+// Accepted replies averaged with equal weight before the filter settles
+constexpr uint64_t WARMUP_SAMPLES = 8;
+// Offset and drift gains of the settled filter
+constexpr double OFFSET_GAIN = 0.25;
+constexpr double DRIFT_GAIN = 0.05;
+constexpr double MAX_SKEW = 500e-6;
+
+} // namespace
+
+ClockSync::ClockSync()
+    : next_sequence_(0), rtt_window_{}, rtt_count_(0), rtt_pos_(0), ref_local_(0), offset_(0.0), skew_(0.0),
+      version_(0), pub_ref_local_(0), pub_offset_(0), pub_skew_(0.0), pub_rtt_(0), accepted_(0), outliers_(0) {}
+
+void ClockSync::reset() {
+    rtt_count_ = 0;
+    rtt_pos_ = 0;
+    ref_local_ = 0;
+    offset_ = 0.0;
+    skew_ = 0.0;
+    accepted_.store(0, std::memory_order_release);
+    outliers_.store(0, std::memory_order_relaxed);
+    publish(0);
+}
+
+void ClockSync::prepareRequest(HeartbeatPayload& request) {
+    request = HeartbeatPayload{};
+    request.version = HEARTBEAT_VERSION;
+    request.sequence = next_sequence_++;
+    request.client_send = monotonicNowNs();
+}
+
+bool ClockSync::processReply(const HeartbeatPayload& reply, int64_t received_ns) {
+    if (reply.version != HEARTBEAT_VERSION || !(reply.flags & HEARTBEAT_REPLY)) return false;
+    const int64_t rtt = (received_ns - reply.client_send) - (reply.server_send - reply.server_receive);
+    if (received_ns < reply.client_send || reply.server_send < reply.server_receive || rtt < 0) return false;
+
+    rtt_window_[rtt_pos_] = rtt;
+    rtt_pos_ = (rtt_pos_ + 1) % WINDOW;
+    rtt_count_ = std::min(rtt_count_ + 1, WINDOW);
+    const int64_t min_rtt = *std::min_element(rtt_window_, rtt_window_ + rtt_count_);
+    if (rtt > min_rtt + std::max(min_rtt / 2, OUTLIER_MARGIN_NS)) {
+        outliers_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Assume the path is symmetric; the estimate belongs to the local
+    // midpoint of the exchange
+    const double measured = 0.5 * static_cast<double>((reply.server_receive - reply.client_send) +
+                                                      (reply.server_send - received_ns));
+    const int64_t midpoint = reply.client_send + (received_ns - reply.client_send) / 2;
+
+    const uint64_t n = accepted_.load(std::memory_order_relaxed);
+    if (n == 0) {
+        offset_ = measured;
+        skew_ = 0.0;
+    } else {
+        const double dt = static_cast<double>(midpoint - ref_local_);
+        const double predicted = offset_ + skew_ * dt;
+        const double error = measured - predicted;
+        if (n < WARMUP_SAMPLES) {
+            offset_ = predicted + error / static_cast<double>(n + 1);
+        } else {
+            offset_ = predicted + OFFSET_GAIN * error;
+        }
+        if (n >= MIN_SAMPLES && dt > 0.0) {
+            skew_ = std::min(std::max(skew_ + DRIFT_GAIN * error / dt, -MAX_SKEW), MAX_SKEW);
+        }
+    }
+    ref_local_ = midpoint;
+    publish(min_rtt);
+    accepted_.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+void ClockSync::publish(int64_t rtt) {
+    const uint32_t v = version_.load(std::memory_order_relaxed);
+    version_.store(v + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    pub_ref_local_.store(ref_local_, std::memory_order_relaxed);
+    pub_offset_.store(std::llround(offset_), std::memory_order_relaxed);
+    pub_skew_.store(skew_, std::memory_order_relaxed);
+    pub_rtt_.store(rtt, std::memory_order_relaxed);
+    version_.store(v + 2, std::memory_order_release);
+}
+
+int64_t ClockSync::serverTimeNs(int64_t local_ns) const {
+    int64_t ref, offset;
+    double skew;
+    uint32_t before;
+    do {
+        before = version_.load(std::memory_order_acquire);
+        ref = pub_ref_local_.load(std::memory_order_relaxed);
+        offset = pub_offset_.load(std::memory_order_relaxed);
+        skew = pub_skew_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((before & 1) || version_.load(std::memory_order_relaxed) != before);
+    return local_ns + offset + static_cast<int64_t>(skew * static_cast<double>(local_ns - ref));
+}
+
+int64_t ClockSync::localTimeNs(int64_t server_ns) const {
+    // One step of the inverse is exact to well under a nanosecond at
+    // realistic drift
+    const int64_t guess = server_ns - (serverTimeNs(server_ns) - server_ns);
+    return guess - (serverTimeNs(guess) - server_ns);
+}
+
+ClockSyncStats ClockSync::stats() const {
+    ClockSyncStats s{};
+    s.synchronized = synchronized();
+    const int64_t now = monotonicNowNs();
+    s.offset_ns = serverTimeNs(now) - now;
+    s.rtt_ns = pub_rtt_.load(std::memory_order_relaxed);
+    s.drift_ppm = pub_skew_.load(std::memory_order_relaxed) * 1e6;
+    s.samples = accepted_.load(std::memory_order_relaxed);
+    s.outliers = outliers_.load(std::memory_order_relaxed);
+    return s;
+}
@@ -0,0 +1,130 @@
+#include "ComfortNoise.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Autocorrelation smoothing across analysed frames
+constexpr double SMOOTHING = 0.7;
+// White-noise correction keeps the model well conditioned on clean input
+constexpr float NOISE_CORRECTION = 1.0001f;
+
+// Steps the predictor down to its reflection coefficients; the all-pole
+// filter is stable exactly when every one is inside (-1, 1)
+bool lpcStable(const float* lpc, size_t order) {
+    double a[ComfortNoiseParams::ORDER];
+    double lower[ComfortNoiseParams::ORDER];
+    for (size_t i = 0; i < order; ++i) {
+        if (!std::isfinite(lpc[i])) return false;
+        a[i] = lpc[i];
+    }
+    for (size_t i = order; i > 0; --i) {
+        const double k = a[i - 1];
+        if (!(std::fabs(k) < 1.0)) return false;
+        const double scale = 1.0 / (1.0 - k * k);
+        for (size_t j = 1; j < i; ++j) lower[j - 1] = (a[j - 1] - k * a[i - j - 1]) * scale;
+        std::copy(lower, lower + i - 1, a);
+    }
+    return true;
+}
+
+} // namespace
+
+float levinsonDurbin(const float* r, float* lpc, size_t order) {
+    std::fill(lpc, lpc + order, 0.0f);
+    if (r[0] <= 0.0f) return 0.0f;
+
+    float error = r[0];
+    float previous[ComfortNoiseParams::ORDER];
+    for (size_t i = 1; i <= order; ++i) {
+        float acc = r[i];
+        for (size_t j = 1; j < i; ++j) acc += lpc[j - 1] * r[i - j];
+        const float k = -acc / error;
+
+        std::copy(lpc, lpc + i - 1, previous);
+        for (size_t j = 1; j < i; ++j) lpc[j - 1] = previous[j - 1] + k * previous[i - j - 1];
+        lpc[i - 1] = k;
+
+        error *= 1.0f - k * k;
+        if (error <= 0.0f) return 0.0f;
+    }
+    return error;
+}
+
+ComfortNoiseAnalyzer::ComfortNoiseAnalyzer() {
+    reset();
+}
+
+void ComfortNoiseAnalyzer::analyze(const float* samples, size_t n) {
+    if (n <= ComfortNoiseParams::ORDER) return;
+
+    for (size_t lag = 0; lag <= ComfortNoiseParams::ORDER; ++lag) {
+        double sum = 0.0;
+        for (size_t i = lag; i < n; ++i) sum += static_cast<double>(samples[i]) * samples[i - lag];
+        sum /= static_cast<double>(n);
+        autocorr_[lag] = primed_ ? SMOOTHING * autocorr_[lag] + (1.0 - SMOOTHING) * sum : sum;
+    }
+    primed_ = true;
+}
+
+bool ComfortNoiseAnalyzer::describe(ComfortNoiseParams& params) const {
+    if (!primed_) return false;
+
+    float r[ComfortNoiseParams::ORDER + 1];
+    for (size_t i = 0; i <= ComfortNoiseParams::ORDER; ++i) r[i] = static_cast<float>(autocorr_[i]);
+    r[0] *= NOISE_CORRECTION;
+
+    const float error = levinsonDurbin(r, params.lpc, ComfortNoiseParams::ORDER);
+    params.level = std::sqrt(std::max(error, 0.0f));
+    return true;
+}
+
+void ComfortNoiseAnalyzer::reset() {
+    std::fill(autocorr_, autocorr_ + ComfortNoiseParams::ORDER + 1, 0.0);
+    primed_ = false;
+}
+
+ComfortNoiseGenerator::ComfortNoiseGenerator() : seed_(0x2545F491u) {
+    reset();
+}
+
+void ComfortNoiseGenerator::setParams(const ComfortNoiseParams& params) {
+    params_ = params;
+    // Guard against garbage from the wire turning into a loud squeal
+    if (!std::isfinite(params_.level) || params_.level < 0.0f) params_.level = 0.0f;
+    params_.level = std::min(params_.level, 0.25f);
+    // An unstable envelope would grow without bound; fall back to white
+    // noise and drop whatever the filter already holds
+    if (!lpcStable(params_.lpc, ComfortNoiseParams::ORDER)) {
+        std::fill(params_.lpc, params_.lpc + ComfortNoiseParams::ORDER, 0.0f);
+        std::fill(history_, history_ + ComfortNoiseParams::ORDER, 0.0f);
+    }
+}
+
+void ComfortNoiseGenerator::generate(float* out, size_t n) {
+    // Unit-variance uniform excitation
+    const float scale = std::sqrt(3.0f) / 2147483648.0f;
+    const float step = n > 0 ? (params_.level - current_level_) / static_cast<float>(n) : 0.0f;
+
+    float level = current_level_;
+    for (size_t i = 0; i < n; ++i) {
+        seed_ ^= seed_ << 13;
+        seed_ ^= seed_ >> 17;
+        seed_ ^= seed_ << 5;
+        level += step;
+
+        float y = static_cast<float>(static_cast<int32_t>(seed_)) * scale * level;
+        for (size_t k = 0; k < ComfortNoiseParams::ORDER; ++k) y -= params_.lpc[k] * history_[k];
+        std::copy_backward(history_, history_ + ComfortNoiseParams::ORDER - 1, history_ + ComfortNoiseParams::ORDER);
+        history_[0] = y;
+        out[i] = y;
+    }
+    current_level_ = params_.level;
+}
+
+void ComfortNoiseGenerator::reset() {
+    params_.level = 0.0f;
+    std::fill(params_.lpc, params_.lpc + ComfortNoiseParams::ORDER, 0.0f);
+    std::fill(history_, history_ + ComfortNoiseParams::ORDER, 0.0f);
+    current_level_ = 0.0f;
+}
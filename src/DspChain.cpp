@@ -0,0 +1,175 @@
+#include "DspChain.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+void ScratchArena::reset(size_t floats) {
+    storage_.assign(floats, 0.0f);
+    used_ = 0;
+}
+
+// Slices are padded to 16 floats so neighbouring stages never share a cache line
+float* ScratchArena::allocate(size_t floats) {
+    size_t aligned = padded(floats);
+    if (used_ + aligned > storage_.size()) return nullptr;
+    float* slice = storage_.data() + used_;
+    used_ += aligned;
+    return slice;
+}
+
+size_t DspStage::scratchSize(int sample_rate, size_t max_frames) const {
+    (void)sample_rate;
+    (void)max_frames;
+    return 0;
+}
+
+bool DspStage::setParameter(const std::string& name, float value) {
+    if (name == "enabled") {
+        setEnabled(value != 0.0f);
+        return true;
+    }
+    return false;
+}
+
+std::string DspStage::describe() const {
+    return std::string(name_) + (isEnabled() ? " (on)" : " (off)");
+}
+
+DspChain::DspChain()
+    : work_(nullptr), sample_rate_(44100), max_frames_(0), prepared_(false) {
+}
+
+void DspChain::addStage(std::unique_ptr<DspStage> stage) {
+    if (prepared_) {
+        std::cerr << "DspChain: cannot add stage '" << stage->name() << "' after prepare" << std::endl;
+        return;
+    }
+    stages_.push_back(std::move(stage));
+}
+
+bool DspChain::prepare(int sample_rate, size_t max_frames) {
+    sample_rate_ = sample_rate;
+    max_frames_ = max_frames;
+
+    // Work buffer plus every stage's needs, each rounded up to 16 floats
+    size_t total = ScratchArena::padded(max_frames);
+    for (const auto& stage : stages_) {
+        total += ScratchArena::padded(stage->scratchSize(sample_rate, max_frames));
+    }
+    arena_.reset(total);
+
+    work_ = arena_.allocate(max_frames);
+    for (auto& stage : stages_) {
+        stage->prepare(sample_rate, max_frames, arena_);
+    }
+
+    timings_.reset(new Timing[stages_.size()]);
+    prepared_ = true;
+    return true;
+}
+
+void DspChain::reset() {
+    for (auto& stage : stages_) {
+        stage->reset();
+    }
+}
+
+void DspChain::process(float* block, size_t frames) {
+    if (!prepared_) return;
+
+    while (frames > max_frames_) {
+        processBlock(block, max_frames_);
+        block += max_frames_;
+        frames -= max_frames_;
+    }
+    if (frames > 0) {
+        processBlock(block, frames);
+    }
+}
+
+void DspChain::processBlock(float* block, size_t frames) {
+    using clock = std::chrono::steady_clock;
+
+    for (size_t i = 0; i < stages_.size(); ++i) {
+        DspStage& stage = *stages_[i];
+        Timing& t = timings_[i];
+        if (!stage.isEnabled()) {
+            t.active = false;
+            continue;
+        }
+        if (!t.active) {
+            stage.reset();
+            t.active = true;
+        }
+
+        auto start = clock::now();
+        stage.process(block, frames);
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+
+        t.blocks.fetch_add(1, std::memory_order_relaxed);
+        t.total_ns.fetch_add(ns, std::memory_order_relaxed);
+        if (ns > t.max_ns.load(std::memory_order_relaxed)) {
+            t.max_ns.store(ns, std::memory_order_relaxed);
+        }
+    }
+}
+
+size_t DspChain::latencyFrames() const {
+    size_t total = 0;
+    for (const auto& stage : stages_) {
+        if (stage->isEnabled()) total += stage->latencyFrames();
+    }
+    return total;
+}
+
+DspStage* DspChain::stage(const std::string& name) const {
+    for (const auto& stage : stages_) {
+        if (name == stage->name()) return stage.get();
+    }
+    return nullptr;
+}
+
+bool DspChain::setParameter(const std::string& stage_name, const std::string& param, float value) {
+    DspStage* target = stage(stage_name);
+    return target && target->setParameter(param, value);
+}
+
+std::vector<DspStageStats> DspChain::stats() const {
+    std::vector<DspStageStats> result;
+    if (!prepared_) return result;
+
+    const double block_us = 1e6 * static_cast<double>(max_frames_) / sample_rate_;
+    for (size_t i = 0; i < stages_.size(); ++i) {
+        const Timing& t = timings_[i];
+        DspStageStats s;
+        s.name = stages_[i]->name();
+        s.enabled = stages_[i]->isEnabled();
+        s.blocks = t.blocks.load(std::memory_order_relaxed);
+        s.avg_us = s.blocks ? t.total_ns.load(std::memory_order_relaxed) / 1000.0 / s.blocks : 0.0;
+        s.max_us = t.max_ns.load(std::memory_order_relaxed) / 1000.0;
+        s.load = block_us > 0 ? s.avg_us / block_us : 0.0;
+        result.push_back(s);
+    }
+    return result;
+}
+
+std::string DspChain::report() const {
+    std::string out;
+    char line[160];
+    for (const auto& s : stats()) {
+        snprintf(line, sizeof(line), "  %-10s %-3s blocks=%-8llu avg=%7.2fus max=%8.2fus load=%5.2f%%\n",
+                 s.name.c_str(), s.enabled ? "on" : "off",
+                 static_cast<unsigned long long>(s.blocks), s.avg_us, s.max_us, s.load * 100.0);
+        out += line;
+    }
+    return out;
+}
+
+void DspChain::resetStats() {
+    if (!prepared_) return;
+    for (size_t i = 0; i < stages_.size(); ++i) {
+        timings_[i].blocks = 0;
+        timings_[i].total_ns = 0;
+        timings_[i].max_ns = 0;
+    }
+}
@@ -0,0 +1,427 @@
+#include "DspStages.h"
+#include "SampleKernels.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr float PI = 3.14159265358979f;
+
+float dbToLinear(float db) {
+    return std::pow(10.0f, db / 20.0f);
+}
+
+// One-pole smoothing coefficient for a time constant in milliseconds
+float timeCoefficient(float ms, float rate) {
+    if (ms <= 0.0f || rate <= 0.0f) return 0.0f;
+    return std::exp(-1.0f / (ms * 0.001f * rate));
+}
+
+} // namespace
+
+// ---------------------------------------------------------------- Gain
+
+GainStage::GainStage(float gain_db) : DspStage("gain"), gain_db_(gain_db), current_(1.0f) {
+}
+
+void GainStage::prepare(int sample_rate, size_t max_frames, ScratchArena& arena) {
+    (void)sample_rate;
+    (void)max_frames;
+    (void)arena;
+    reset();
+}
+
+void GainStage::process(float* block, size_t frames) {
+    const float target = dbToLinear(gain_db_.load(std::memory_order_relaxed));
+    if (target == current_) {
+        SampleKernels::applyGain(block, frames, target);
+        return;
+    }
+
+    // Ramp across the block to avoid zipper noise
+    SampleKernels::applyRamp(block, frames, current_, (target - current_) / static_cast<float>(frames));
+    current_ = target;
+}
+
+void GainStage::reset() {
+    current_ = dbToLinear(gain_db_.load());
+}
+
+bool GainStage::setParameter(const std::string& name, float value) {
+    if (name == "gain_db") {
+        gain_db_ = value;
+        return true;
+    }
+    return DspStage::setParameter(name, value);
+}
+
+// ----------------------------------------------------------- High-pass
+
+HighPassStage::HighPassStage(float cutoff_hz)
+    : DspStage("highpass"), cutoff_hz_(cutoff_hz), active_cutoff_(0.0f), sample_rate_(44100),
+      b0_(1.0f), b1_(0.0f), b2_(0.0f), a1_(0.0f), a2_(0.0f), z1_(0.0f), z2_(0.0f) {
+}
+
+void HighPassStage::prepare(int sample_rate, size_t max_frames, ScratchArena& arena) {
+    (void)max_frames;
+    (void)arena;
+    sample_rate_ = sample_rate;
+    updateCoefficients(cutoff_hz_.load());
+    reset();
+}
+
+void HighPassStage::updateCoefficients(float cutoff) {
+    cutoff = std::min(std::max(cutoff, 10.0f), 0.45f * sample_rate_);
+    const float w0 = 2.0f * PI * cutoff / static_cast<float>(sample_rate_);
+    const float cosw = std::cos(w0);
+    const float alpha = std::sin(w0) / (2.0f * 0.70710678f);
+    const float a0 = 1.0f + alpha;
+
+    b0_ = (1.0f + cosw) * 0.5f / a0;
+    b1_ = -(1.0f + cosw) / a0;
+    b2_ = b0_;
+    a1_ = -2.0f * cosw / a0;
+    a2_ = (1.0f - alpha) / a0;
+    active_cutoff_ = cutoff_hz_.load(std::memory_order_relaxed);
+}
+
+void HighPassStage::process(float* block, size_t frames) {
+    if (cutoff_hz_.load(std::memory_order_relaxed) != active_cutoff_) {
+        updateCoefficients(cutoff_hz_.load(std::memory_order_relaxed));
+    }
+
+    // Transposed direct form II
+    float z1 = z1_, z2 = z2_;
+    for (size_t i = 0; i < frames; ++i) {
+        const float x = block[i];
+        const float y = b0_ * x + z1;
+        z1 = b1_ * x - a1_ * y + z2;
+        z2 = b2_ * x - a2_ * y;
+        block[i] = y;
+    }
+    z1_ = z1;
+    z2_ = z2;
+}
+
+void HighPassStage::reset() {
+    z1_ = z2_ = 0.0f;
+}
+
+bool HighPassStage::setParameter(const std::string& name, float value) {
+    if (name == "cutoff_hz") {
+        cutoff_hz_ = value;
+        return true;
+    }
+    return DspStage::setParameter(name, value);
+}
+
+// ---------------------------------------------------------- Noise gate
+
+NoiseGateStage::NoiseGateStage()
+    : DspStage("gate"), threshold_db_(-50.0f), floor_db_(-40.0f), attack_ms_(2.0f),
+      release_ms_(80.0f), hold_ms_(150.0f), sample_rate_(44100), envelope_(0.0f), gain_(1.0f),
+      hold_counter_(0) {
+}
+
+void NoiseGateStage::prepare(int sample_rate, size_t max_frames, ScratchArena& arena) {
+    (void)max_frames;
+    (void)arena;
+    sample_rate_ = sample_rate;
+    reset();
+}
+
+void NoiseGateStage::process(float* block, size_t frames) {
+    const float rate = static_cast<float>(sample_rate_);
+    const float threshold = dbToLinear(threshold_db_.load(std::memory_order_relaxed));
+    const float floor = dbToLinear(floor_db_.load(std::memory_order_relaxed));
+    const float attack = timeCoefficient(attack_ms_.load(std::memory_order_relaxed), rate);
+    const float release = timeCoefficient(release_ms_.load(std::memory_order_relaxed), rate);
+    const size_t hold = static_cast<size_t>(hold_ms_.load(std::memory_order_relaxed) * 0.001f * rate);
+    const float env_decay = timeCoefficient(10.0f, rate);
+
+    float env = envelope_, g = gain_;
+    size_t hold_counter = hold_counter_;
+
+    for (size_t i = 0; i < frames; ++i) {
+        const float level = std::fabs(block[i]);
+        env = level > env ? level : env * env_decay;
+
+        float target = floor;
+        if (env > threshold) {
+            hold_counter = hold;
+            target = 1.0f;
+        } else if (hold_counter > 0) {
+            --hold_counter;
+            target = 1.0f;
+        }
+
+        const float coeff = target > g ? attack : release;
+        g = target + (g - target) * coeff;
+        block[i] *= g;
+    }
+
+    envelope_ = env;
+    gain_ = g;
+    hold_counter_ = hold_counter;
+}
+
+void NoiseGateStage::reset() {
+    envelope_ = 0.0f;
+    gain_ = 1.0f;
+    hold_counter_ = 0;
+}
+
+bool NoiseGateStage::setParameter(const std::string& name, float value) {
+    if (name == "threshold_db") threshold_db_ = value;
+    else if (name == "floor_db") floor_db_ = value;
+    else if (name == "attack_ms") attack_ms_ = value;
+    else if (name == "release_ms") release_ms_ = value;
+    else if (name == "hold_ms") hold_ms_ = value;
+    else return DspStage::setParameter(name, value);
+    return true;
+}
+
+// ----------------------------------------------------------------- AGC
+
+AgcStage::AgcStage()
+    : DspStage("agc"), target_db_(-20.0f), max_gain_db_(20.0f), noise_db_(-55.0f),
+      sample_rate_(44100), mean_square_(0.0f), gain_(1.0f) {
+}
+
+void AgcStage::prepare(int sample_rate, size_t max_frames, ScratchArena& arena) {
+    (void)max_frames;
+    (void)arena;
+    sample_rate_ = sample_rate;
+    reset();
+}
+
+void AgcStage::process(float* block, size_t frames) {
+    const float rate = static_cast<float>(sample_rate_) / static_cast<float>(frames);
+
+    const float sum = SampleKernels::sumSquares(block, frames);
+
+    // Level and gain are tracked per block, the gain is ramped per sample
+    const float level_coeff = timeCoefficient(300.0f, rate);
+    mean_square_ = level_coeff * mean_square_ + (1.0f - level_coeff) * (sum / frames);
+
+    const float rms = std::sqrt(mean_square_);
+    float desired = gain_;
+    if (rms > dbToLinear(noise_db_.load(std::memory_order_relaxed))) {
+        const float max_gain = dbToLinear(max_gain_db_.load(std::memory_order_relaxed));
+        desired = std::min(dbToLinear(target_db_.load(std::memory_order_relaxed)) / rms, max_gain);
+    }
+
+    const float coeff = timeCoefficient(desired < gain_ ? 50.0f : 1000.0f, rate);
+    const float next = desired + (gain_ - desired) * coeff;
+
+    SampleKernels::applyRamp(block, frames, gain_, (next - gain_) / static_cast<float>(frames));
+    gain_ = next;
+}
+
+void AgcStage::reset() {
+    mean_square_ = 0.0f;
+    gain_ = 1.0f;
+}
+
+bool AgcStage::setParameter(const std::string& name, float value) {
+    if (name == "target_db") target_db_ = value;
+    else if (name == "max_gain_db") max_gain_db_ = value;
+    else if (name == "noise_db") noise_db_ = value;
+    else return DspStage::setParameter(name, value);
+    return true;
+}
+
+// ------------------------------------------------------------- Limiter
+
+LimiterStage::LimiterStage(float ceiling_db)
+    : DspStage("limiter"), ceiling_db_(ceiling_db), release_ms_(50.0f), sample_rate_(44100),
+      delay_(nullptr), delay_len_(0), delay_pos_(0), gain_(1.0f) {
+}
+
+size_t LimiterStage::scratchSize(int sample_rate, size_t max_frames) const {
+    (void)max_frames;
+    return static_cast<size_t>(LOOKAHEAD_MS * 0.001f * sample_rate) + 1;
+}
+
+void LimiterStage::prepare(int sample_rate, size_t max_frames, ScratchArena& arena) {
+    sample_rate_ = sample_rate;
+    delay_len_ = scratchSize(sample_rate, max_frames);
+    delay_ = arena.allocate(delay_len_);
+    reset();
+}
+
+void LimiterStage::process(float* block, size_t frames) {
+    if (!delay_) return;
+
+    const float ceiling = dbToLinear(ceiling_db_.load(std::memory_order_relaxed));
+    const float release = timeCoefficient(release_ms_.load(std::memory_order_relaxed),
+                                          static_cast<float>(sample_rate_));
+    // Reaches ~95% of a gain reduction within the look-ahead window
+    const float attack = std::exp(-3.0f / static_cast<float>(delay_len_));
+
+    float g = gain_;
+    size_t pos = delay_pos_;
+    for (size_t i = 0; i < frames; ++i) {
+        const float in = block[i];
+        const float peak = std::fabs(in);
+        const float target = peak > ceiling ? ceiling / peak : 1.0f;
+        g = target + (g - target) * (target < g ? attack : release);
+
+        const float delayed = delay_[pos];
+        delay_[pos] = in;
+        pos = (pos + 1 == delay_len_) ? 0 : pos + 1;
+
+        block[i] = std::min(std::max(delayed * g, -ceiling), ceiling);
+    }
+    gain_ = g;
+    delay_pos_ = pos;
+}
+
+void LimiterStage::reset() {
+    if (delay_) std::fill(delay_, delay_ + delay_len_, 0.0f);
+    delay_pos_ = 0;
+    gain_ = 1.0f;
+}
+
+bool LimiterStage::setParameter(const std::string& name, float value) {
+    if (name == "ceiling_db") ceiling_db_ = value;
+    else if (name == "release_ms") release_ms_ = value;
+    else return DspStage::setParameter(name, value);
+    return true;
+}
+
+// ------------------------------------------------------ Noise suppressor
+
+NoiseSuppressorStage::NoiseSuppressorStage()
+    : DspStage("denoise"), reduction_db_(-18.0f), oversubtract_(2.0f), noise_rise_db_(3.0f),
+      sample_rate_(44100), window_(nullptr), input_(nullptr), output_(nullptr), overlap_(nullptr),
+      re_(nullptr), im_(nullptr), power_(nullptr), smoothed_(nullptr), noise_(nullptr),
+      gain_(nullptr), fill_(0), primed_(false) {
+}
+
+size_t NoiseSuppressorStage::scratchSize(int sample_rate, size_t max_frames) const {
+    (void)sample_rate;
+    (void)max_frames;
+    return Fft::scratchSize(FRAME_SIZE) +
+           5 * ScratchArena::padded(FRAME_SIZE) +
+           ScratchArena::padded(HOP) +
+           4 * ScratchArena::padded(BINS);
+}
+
+void NoiseSuppressorStage::prepare(int sample_rate, size_t max_frames, ScratchArena& arena) {
+    (void)max_frames;
+    sample_rate_ = sample_rate;
+    if (!fft_.prepare(FRAME_SIZE, arena)) return;
+
+    window_ = arena.allocate(FRAME_SIZE);
+    input_ = arena.allocate(FRAME_SIZE);
+    output_ = arena.allocate(HOP);
+    overlap_ = arena.allocate(FRAME_SIZE);
+    re_ = arena.allocate(FRAME_SIZE);
+    im_ = arena.allocate(FRAME_SIZE);
+    power_ = arena.allocate(BINS);
+    smoothed_ = arena.allocate(BINS);
+    noise_ = arena.allocate(BINS);
+    gain_ = arena.allocate(BINS);
+    if (!gain_) return;
+
+    // Periodic sqrt-Hann on analysis and synthesis: the product is a Hann
+    // window, which sums to one at 50% overlap
+    for (size_t i = 0; i < FRAME_SIZE; ++i) {
+        window_[i] = std::sqrt(0.5f - 0.5f * std::cos(2.0f * PI * static_cast<float>(i) / FRAME_SIZE));
+    }
+    reset();
+}
+
+void NoiseSuppressorStage::process(float* block, size_t frames) {
+    if (!gain_) return;
+
+    // Input goes in behind the last frame, output comes from the previous
+    // one: every sample leaves exactly FRAME_SIZE samples after it arrived
+    size_t done = 0;
+    while (done < frames) {
+        const size_t n = std::min(frames - done, HOP - fill_);
+        std::copy(block + done, block + done + n, input_ + (FRAME_SIZE - HOP) + fill_);
+        std::copy(output_ + fill_, output_ + fill_ + n, block + done);
+        fill_ += n;
+        done += n;
+        if (fill_ == HOP) {
+            processFrame();
+            fill_ = 0;
+        }
+    }
+}
+
+void NoiseSuppressorStage::processFrame() {
+    std::copy(input_, input_ + FRAME_SIZE, re_);
+    std::fill(im_, im_ + FRAME_SIZE, 0.0f);
+    SampleKernels::multiply(re_, window_, FRAME_SIZE);
+    fft_.forward(re_, im_);
+    SampleKernels::magnitudeSquared(re_, im_, power_, BINS);
+
+    const float floor = dbToLinear(reduction_db_.load(std::memory_order_relaxed));
+    const float floor_sq = floor * floor;
+    const float over = oversubtract_.load(std::memory_order_relaxed);
+    const float hop_seconds = static_cast<float>(HOP) / static_cast<float>(sample_rate_);
+    const float rise = std::pow(10.0f, noise_rise_db_.load(std::memory_order_relaxed) * hop_seconds / 10.0f);
+    constexpr float SMOOTHING = 0.6f;
+    constexpr float GAIN_RELEASE = 0.5f;
+    constexpr float NOISE_SMOOTHING = 0.9f;
+    constexpr float PRESENCE_RATIO = 4.0f;
+    constexpr float EPSILON = 1e-12f;
+
+    if (!primed_) {
+        std::copy(power_, power_ + BINS, smoothed_);
+        std::copy(power_, power_ + BINS, noise_);
+        primed_ = true;
+    }
+
+    for (size_t b = 0; b < BINS; ++b) {
+        const float s = SMOOTHING * smoothed_[b] + (1.0f - SMOOTHING) * power_[b];
+        smoothed_[b] = s;
+        // Follows the mean while the bin looks like noise; otherwise it may
+        // only creep up, so speech never pulls the floor along
+        if (s < PRESENCE_RATIO * noise_[b]) {
+            noise_[b] = NOISE_SMOOTHING * noise_[b] + (1.0f - NOISE_SMOOTHING) * s + EPSILON;
+        } else {
+            noise_[b] *= rise;
+        }
+
+        const float g = std::sqrt(std::max(1.0f - over * noise_[b] / (s + EPSILON), floor_sq));
+        // Open instantly, close over a few frames to keep musical noise down
+        gain_[b] = g >= gain_[b] ? g : GAIN_RELEASE * gain_[b] + (1.0f - GAIN_RELEASE) * g;
+    }
+
+    SampleKernels::multiply(re_, gain_, BINS);
+    SampleKernels::multiply(im_, gain_, BINS);
+    // The input is real, so the upper half mirrors the lower one
+    for (size_t b = 1; b < FRAME_SIZE / 2; ++b) {
+        re_[FRAME_SIZE - b] = re_[b];
+        im_[FRAME_SIZE - b] = -im_[b];
+    }
+    fft_.inverse(re_, im_);
+
+    SampleKernels::multiplyAdd(overlap_, re_, window_, FRAME_SIZE);
+    std::copy(overlap_, overlap_ + HOP, output_);
+    std::copy(overlap_ + HOP, overlap_ + FRAME_SIZE, overlap_);
+    std::fill(overlap_ + FRAME_SIZE - HOP, overlap_ + FRAME_SIZE, 0.0f);
+    std::copy(input_ + HOP, input_ + FRAME_SIZE, input_);
+}
+
+void NoiseSuppressorStage::reset() {
+    if (!gain_) return;
+    std::fill(input_, input_ + FRAME_SIZE, 0.0f);
+    std::fill(output_, output_ + HOP, 0.0f);
+    std::fill(overlap_, overlap_ + FRAME_SIZE, 0.0f);
+    std::fill(gain_, gain_ + BINS, 1.0f);
+    fill_ = 0;
+    primed_ = false;
+}
+
+bool NoiseSuppressorStage::setParameter(const std::string& name, float value) {
+    if (name == "reduction_db") reduction_db_ = value;
+    else if (name == "oversubtract") oversubtract_ = value;
+    else if (name == "noise_rise_db") noise_rise_db_ = value;
+    else return DspStage::setParameter(name, value);
+    return true;
+}
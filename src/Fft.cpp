@@ -0,0 +1,70 @@
+#include "Fft.h"
+#include "SampleKernels.h"
+#include <cmath>
+#include <utility>
+
+bool Fft::prepare(size_t n, ScratchArena& arena) {
+    if (n < 2 || (n & (n - 1)) != 0) return false;
+
+    cos_ = arena.allocate(n / 2);
+    sin_ = arena.allocate(n / 2);
+    if (!cos_ || !sin_) return false;
+
+    for (size_t k = 0; k < n / 2; ++k) {
+        const double phase = 2.0 * 3.14159265358979323846 * static_cast<double>(k) / static_cast<double>(n);
+        cos_[k] = static_cast<float>(std::cos(phase));
+        sin_[k] = static_cast<float>(std::sin(phase));
+    }
+    size_ = n;
+    return true;
+}
+
+void Fft::forward(float* re, float* im) const {
+    transform(re, im, -1.0f);
+}
+
+void Fft::inverse(float* re, float* im) const {
+    transform(re, im, 1.0f);
+    const float scale = 1.0f / static_cast<float>(size_);
+    SampleKernels::applyGain(re, size_, scale);
+    SampleKernels::applyGain(im, size_, scale);
+}
+
+void Fft::transform(float* re, float* im, float sign) const {
+    const size_t n = size_;
+
+    // Bit-reversal permutation
+    for (size_t i = 0, j = 0; i < n; ++i) {
+        if (i < j) {
+            std::swap(re[i], re[j]);
+            std::swap(im[i], im[j]);
+        }
+        size_t bit = n >> 1;
+        while (j & bit) {
+            j ^= bit;
+            bit >>= 1;
+        }
+        j |= bit;
+    }
+
+    for (size_t len = 2; len <= n; len <<= 1) {
+        const size_t half = len / 2;
+        const size_t stride = n / len;
+        for (size_t start = 0; start < n; start += len) {
+            float* ar = re + start;
+            float* ai = im + start;
+            float* br = ar + half;
+            float* bi = ai + half;
+            for (size_t k = 0; k < half; ++k) {
+                const float wr = cos_[k * stride];
+                const float wi = sign * sin_[k * stride];
+                const float tr = br[k] * wr - bi[k] * wi;
+                const float ti = br[k] * wi + bi[k] * wr;
+                br[k] = ar[k] - tr;
+                bi[k] = ai[k] - ti;
+                ar[k] += tr;
+                ai[k] += ti;
+            }
+        }
+    }
+}
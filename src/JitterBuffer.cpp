@@ -0,0 +1,600 @@
+#include "JitterBuffer.h"
+#include "SampleKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+constexpr size_t SLOTS = 64;
+constexpr size_t MAX_PAYLOAD = JitterBuffer::MAX_FRAME_SAMPLES * sizeof(float);
+// Frames beyond the target depth tolerated before the oldest are dropped
+constexpr size_t MAX_EXCESS = 4;
+// Consecutive concealed frames before the stream waits for a fresh cushion
+constexpr size_t MAX_CONCEAL = 4;
+constexpr float CONCEAL_FADE = 0.5f;
+constexpr size_t DEFAULT_FRAME_SAMPLES = 256;
+constexpr int IDLE_SECONDS = 2;
+// Parity groups held while waiting for the rest of their frames
+constexpr size_t PARITY_GROUPS = 4;
+// Synchronized playout: frames buffered before the oldest are dropped, and
+// the error tolerated before the play position is slewed by one sample per
+// read or, past the jump limit, moved at once
+constexpr size_t SYNC_MAX_AHEAD = SLOTS / 2;
+constexpr int64_t SYNC_DEADBAND_NS = 250000;
+constexpr int64_t SYNC_JUMP_NS = 5000000;
+
+static_assert(FecParityEncoder::MAX_PAYLOAD == MAX_PAYLOAD, "parity covers any frame payload");
+
+inline int32_t sequenceDiff(uint32_t a, uint32_t b) {
+    return static_cast<int32_t>(a - b);
+}
+
+size_t decodeFrame(const AudioFrameHeader& header, const uint8_t* payload, size_t bytes, float* out) {
+    const size_t samples = std::min<size_t>(header.samples, JitterBuffer::MAX_FRAME_SAMPLES);
+    return decodeAudio(static_cast<AudioCodec>(header.codec), payload, bytes, samples, out);
+}
+
+} // namespace
+
+struct JitterBuffer::Stream {
+    enum class Mode { SILENT, COMFORT, SPEECH };
+
+    struct Slot {
+        std::atomic<uint64_t> tag{0};    // sequence + 1 once complete, 0 while written
+        AudioFrameHeader header;
+        uint32_t bytes;
+        uint8_t payload[MAX_PAYLOAD];
+    };
+
+    struct ParityGroup {
+        bool pending = false;
+        uint32_t first = 0;
+        FecParityHeader parity;
+        uint32_t bytes = 0;
+        uint8_t payload[MAX_PAYLOAD];
+    };
+
+    // Shared with the network thread
+    std::atomic<uint16_t> sender_id{0};
+    std::atomic<bool> idle{false};
+    std::atomic<uint32_t> highest{0};
+    std::atomic<uint64_t> arrivals{0};
+    std::atomic<int64_t> next_expected{-1};  // -1 until playout starts
+    std::atomic<uint64_t> received{0};
+    std::atomic<uint64_t> late{0};
+    std::atomic<uint64_t> lost{0};
+    std::atomic<uint64_t> recovered{0};
+    std::atomic<uint64_t> repaired{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> comfort_noise{0};
+    std::atomic<uint64_t> sync_adjusted{0};
+    Slot slots[SLOTS];
+
+    // Sender clock reference from SENDER_REPORTs, guarded by timing_version
+    std::atomic<uint32_t> timing_version{0};
+    std::atomic<uint32_t> timing_timestamp{0};
+    std::atomic<int64_t> timing_media_ns{-1};
+
+    // Network thread only
+    ParityGroup groups[PARITY_GROUPS];
+    size_t next_group = 0;
+    uint8_t repair_scratch[MAX_PAYLOAD];
+
+    // Audio thread only
+    bool started = false;
+    Mode mode = Mode::SILENT;
+    uint32_t next = 0;
+    uint64_t seen_arrivals = 0;
+    size_t idle_samples = 0;
+    size_t missing = 0;
+    size_t frame_samples = DEFAULT_FRAME_SAMPLES;
+    float decoded[MAX_FRAME_SAMPLES];
+    size_t decoded_len = 0;
+    size_t decoded_pos = 0;
+    ComfortNoiseGenerator comfort;
+    OpusFrameDecoder opus;        // configured by the network thread on creation
+    uint8_t packet[OPUS_MAX_PACKET];
+    bool last_opus = false;
+    // decoded[] holds the sender's audio from frame_timestamp on, rather
+    // than locally generated silence or noise
+    bool timed = false;
+    uint32_t frame_timestamp = 0;
+
+    // Network thread: publishes a complete frame in its slot
+    void store(const AudioFrameHeader& header, const uint8_t* payload, size_t bytes, bool restart) {
+        Slot& slot = slots[header.sequence % SLOTS];
+        slot.tag.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.header = header;
+        slot.bytes = static_cast<uint32_t>(bytes);
+        std::memcpy(slot.payload, payload, bytes);
+        slot.tag.store(static_cast<uint64_t>(header.sequence) + 1, std::memory_order_release);
+
+        if (restart || sequenceDiff(header.sequence, highest.load(std::memory_order_relaxed)) > 0) {
+            highest.store(header.sequence, std::memory_order_release);
+        }
+        arrivals.fetch_add(1, std::memory_order_release);
+    }
+
+    // Network thread: whether sequence is in its slot, or could still be
+    // played if it arrived now
+    bool present(uint32_t sequence) const {
+        return slots[sequence % SLOTS].tag.load(std::memory_order_relaxed) == static_cast<uint64_t>(sequence) + 1;
+    }
+
+    bool playable(uint32_t sequence) const {
+        const int64_t expected = next_expected.load(std::memory_order_acquire);
+        return (expected < 0 || sequenceDiff(sequence, static_cast<uint32_t>(expected)) >= 0) &&
+               sequenceDiff(highest.load(std::memory_order_relaxed), sequence) < static_cast<int32_t>(SLOTS);
+    }
+
+    // Network thread: rebuilds the group's frame if it is the only one
+    // missing. Groups are retired once complete, repaired or too late.
+    void repairGroup(ParityGroup& group) {
+        size_t missing_count = 0;
+        uint32_t missing = 0;
+        for (uint32_t i = 0; i < group.parity.count; ++i) {
+            if (!present(group.first + i)) {
+                missing = group.first + i;
+                ++missing_count;
+            }
+        }
+        if (missing_count == 0 || (missing_count == 1 && !playable(missing))) group.pending = false;
+        if (!group.pending || missing_count != 1) return;
+        group.pending = false;
+
+        FecParityHeader rebuilt = group.parity;
+        std::memcpy(repair_scratch, group.payload, group.bytes);
+        for (uint32_t i = 0; i < group.parity.count; ++i) {
+            const uint32_t sequence = group.first + i;
+            if (sequence == missing) continue;
+            const Slot& slot = slots[sequence % SLOTS];
+            if (slot.bytes > group.bytes) return;
+            fecAccumulate(rebuilt, repair_scratch, slot.header, slot.payload, slot.bytes);
+        }
+        if (rebuilt.length > group.bytes) return;
+
+        AudioFrameHeader header{};
+        header.sequence = missing;
+        header.timestamp = rebuilt.timestamp;
+        header.sender_id = sender_id.load(std::memory_order_relaxed);
+        header.samples = rebuilt.samples;
+        header.codec = rebuilt.codec;
+        header.flags = rebuilt.flags;
+        store(header, repair_scratch, rebuilt.length, false);
+        repaired.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Network thread: retries the pending groups that cover sequence
+    void repairAround(uint32_t sequence) {
+        for (ParityGroup& group : groups) {
+            if (group.pending && static_cast<uint32_t>(sequence - group.first) < group.parity.count) {
+                repairGroup(group);
+            }
+        }
+    }
+
+    // Network thread: takes a parity frame or redundant copy
+    void pushRepair(const AudioFrameHeader& header, const uint8_t* payload, size_t bytes) {
+        if (header.flags & FRAME_FEC_REDUNDANT) {
+            if (bytes > MAX_PAYLOAD || present(header.sequence) || !playable(header.sequence)) return;
+            AudioFrameHeader copy = header;
+            copy.flags &= static_cast<uint8_t>(~FRAME_FEC_MASK);
+            store(copy, payload, bytes, false);
+            repaired.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        FecParityHeader parity;
+        if (bytes < sizeof(parity)) return;
+        std::memcpy(&parity, payload, sizeof(parity));
+        if (parity.count == 0 || parity.count > FEC_MAX_GROUP) return;
+
+        ParityGroup& group = groups[next_group];
+        next_group = (next_group + 1) % PARITY_GROUPS;
+        group.first = header.sequence;
+        group.parity = parity;
+        group.bytes = static_cast<uint32_t>(bytes - sizeof(parity));
+        std::memcpy(group.payload, payload + sizeof(parity), group.bytes);
+        group.pending = true;
+        repairGroup(group);
+    }
+
+    // Copies an Opus packet out of its slot. False if it is not there, is
+    // not Opus, or was overwritten while being copied.
+    bool copyOpusPacket(uint32_t sequence, size_t& bytes) {
+        Slot& slot = slots[sequence % SLOTS];
+        const uint64_t expected = static_cast<uint64_t>(sequence) + 1;
+        if (slot.tag.load(std::memory_order_acquire) != expected) return false;
+
+        const AudioFrameHeader header = slot.header;
+        bytes = slot.bytes;
+        if (static_cast<AudioCodec>(header.codec) != AudioCodec::OPUS ||
+            (header.flags & FRAME_COMFORT_NOISE) || bytes > OPUS_MAX_PACKET) {
+            return false;
+        }
+        std::memcpy(packet, slot.payload, bytes);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.tag.load(std::memory_order_relaxed) == expected;
+    }
+
+    // Network thread
+    void setTiming(uint32_t timestamp, int64_t media_ns) {
+        const uint32_t v = timing_version.load(std::memory_order_relaxed);
+        timing_version.store(v + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        timing_timestamp.store(timestamp, std::memory_order_relaxed);
+        timing_media_ns.store(media_ns, std::memory_order_relaxed);
+        timing_version.store(v + 2, std::memory_order_release);
+    }
+
+    // The sender timestamp due at the DAC at media time media_ns. False
+    // until the sender has reported its clock.
+    bool dueTimestamp(int64_t media_ns, int sample_rate, int64_t latency_ns, uint32_t& due) const {
+        uint32_t before, timestamp;
+        int64_t reference;
+        do {
+            before = timing_version.load(std::memory_order_acquire);
+            timestamp = timing_timestamp.load(std::memory_order_relaxed);
+            reference = timing_media_ns.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((before & 1) || timing_version.load(std::memory_order_relaxed) != before);
+        if (reference < 0) return false;
+
+        const double elapsed = static_cast<double>(media_ns - latency_ns - reference) * 1e-9;
+        due = timestamp + static_cast<uint32_t>(static_cast<int64_t>(std::floor(elapsed * sample_rate + 0.5)));
+        return true;
+    }
+
+    bool peekComfortNoise(uint32_t sequence) const {
+        const Slot& slot = slots[sequence % SLOTS];
+        return slot.tag.load(std::memory_order_acquire) == static_cast<uint64_t>(sequence) + 1 &&
+               (slot.header.flags & FRAME_COMFORT_NOISE) != 0;
+    }
+
+    // Decodes the frame for sequence into decoded[]. Returns false if it has
+    // not arrived, or was overwritten while being read.
+    bool take(uint32_t sequence, bool& comfort_noise_frame) {
+        Slot& slot = slots[sequence % SLOTS];
+        const uint64_t expected = static_cast<uint64_t>(sequence) + 1;
+        if (slot.tag.load(std::memory_order_acquire) != expected) return false;
+
+        // The Opus decoder is stateful, so only feed it a verified copy
+        size_t packet_bytes = 0;
+        if (copyOpusPacket(sequence, packet_bytes)) {
+            const size_t samples = opus.decode(packet, packet_bytes, decoded, MAX_FRAME_SAMPLES);
+            if (samples == 0) return false;
+            comfort_noise_frame = false;
+            decoded_len = samples;
+            frame_samples = samples;
+            last_opus = true;
+            timed = true;
+            frame_timestamp = slot.header.timestamp;
+            return true;
+        }
+
+        const AudioFrameHeader header = slot.header;
+        const size_t bytes = std::min<size_t>(slot.bytes, MAX_PAYLOAD);
+        comfort_noise_frame = (header.flags & FRAME_COMFORT_NOISE) != 0;
+
+        ComfortNoiseParams params;
+        size_t samples = 0;
+        if (comfort_noise_frame) {
+            if (bytes < sizeof(params)) return false;
+            std::memcpy(&params, slot.payload, sizeof(params));
+        } else {
+            samples = decodeFrame(header, slot.payload, bytes, decoded);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.tag.load(std::memory_order_relaxed) != expected) return false;
+
+        if (comfort_noise_frame) {
+            comfort.setParams(params);
+        } else if (samples > 0) {
+            decoded_len = samples;
+            frame_samples = samples;
+            last_opus = false;
+            timed = true;
+            frame_timestamp = header.timestamp;
+        }
+        return comfort_noise_frame || samples > 0;
+    }
+
+    // Fills decoded[] in place of the missing frame before sequence + 1
+    void conceal(uint32_t sequence) {
+        if (last_opus) {
+            size_t samples = 0;
+            size_t bytes = 0;
+            if (copyOpusPacket(sequence + 1, bytes)) {
+                samples = opus.recover(packet, bytes, decoded, frame_samples);
+                if (samples > 0) recovered.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (samples == 0) samples = opus.conceal(decoded, frame_samples);
+            if (samples > 0) {
+                decoded_len = samples;
+                return;
+            }
+        }
+        SampleKernels::applyGain(decoded, decoded_len, CONCEAL_FADE);
+    }
+
+    void renderIdle() {
+        timed = false;
+        decoded_len = frame_samples;
+        if (mode == Mode::COMFORT) {
+            comfort.generate(decoded, decoded_len);
+        } else {
+            std::fill(decoded, decoded + decoded_len, 0.0f);
+        }
+    }
+
+    // target is the cushion speech waits for, max_ahead the backlog
+    // beyond which the oldest frames are dropped
+    void fillFrame(size_t target, size_t max_ahead, int sample_rate) {
+        decoded_pos = 0;
+
+        const uint64_t count = arrivals.load(std::memory_order_acquire);
+        if (count != seen_arrivals) {
+            seen_arrivals = count;
+            idle_samples = 0;
+        }
+
+        if (!started) {
+            if (count == 0 || idle.load(std::memory_order_acquire)) {
+                renderIdle();
+                return;
+            }
+            started = true;
+            mode = Mode::SILENT;
+            opus.reset();
+            next = highest.load(std::memory_order_acquire);
+        }
+
+        const uint32_t newest = highest.load(std::memory_order_acquire);
+        int32_t ahead = sequenceDiff(newest, next) + 1;
+
+        if (ahead > static_cast<int32_t>(max_ahead)) {
+            const int32_t skip = ahead - static_cast<int32_t>(target);
+            dropped.fetch_add(skip, std::memory_order_relaxed);
+            next += skip;
+            ahead = static_cast<int32_t>(target);
+        }
+
+        if (mode != Mode::SPEECH) {
+            // Descriptors take effect at once; speech waits for a full cushion
+            while (ahead > 0 && peekComfortNoise(next)) {
+                bool comfort_noise_frame = false;
+                if (take(next, comfort_noise_frame)) mode = Mode::COMFORT;
+                ++next;
+                --ahead;
+            }
+            if (ahead < static_cast<int32_t>(target)) {
+                renderIdle();
+                finishFrame(sample_rate);
+                return;
+            }
+        }
+
+        bool comfort_noise_frame = false;
+        if (take(next, comfort_noise_frame)) {
+            ++next;
+            missing = 0;
+            if (comfort_noise_frame) {
+                mode = Mode::COMFORT;
+                renderIdle();
+            } else {
+                mode = Mode::SPEECH;
+            }
+        } else if (mode == Mode::SPEECH) {
+            const uint32_t missed = next++;
+            if (ahead > 0) lost.fetch_add(1, std::memory_order_relaxed);
+            if (++missing > MAX_CONCEAL) {
+                // The sender stopped or stalled; wait for it to resume
+                mode = Mode::SILENT;
+                next = newest + 1;
+                renderIdle();
+            } else {
+                frame_timestamp += static_cast<uint32_t>(decoded_len);
+                conceal(missed);
+            }
+        } else {
+            // A gap while the sender was in DTX
+            ++next;
+            lost.fetch_add(1, std::memory_order_relaxed);
+            renderIdle();
+        }
+        finishFrame(sample_rate);
+    }
+
+    void finishFrame(int sample_rate) {
+        next_expected.store(next, std::memory_order_release);
+
+        idle_samples += decoded_len;
+        if (idle_samples > static_cast<size_t>(IDLE_SECONDS * sample_rate)) {
+            started = false;
+            mode = Mode::SILENT;
+            comfort.reset();
+            next_expected.store(-1, std::memory_order_release);
+            idle.store(true, std::memory_order_release);
+        }
+    }
+
+    // media_ns is when out[0] will be heard, or -1 to play frames as they
+    // come. Synchronized playout holds a frame back with silence or skips
+    // into it when it is far off its due time, and otherwise slews by one
+    // sample per call to absorb clock drift.
+    void produce(float* out, size_t n, size_t target, int sample_rate, int64_t media_ns, int64_t latency_ns) {
+        const bool sync = media_ns >= 0;
+        const size_t max_ahead = sync ? SYNC_MAX_AHEAD : target + MAX_EXCESS;
+        if (sync) target = 1;
+        const int32_t deadband = static_cast<int32_t>(SYNC_DEADBAND_NS * sample_rate / 1000000000);
+        const int32_t jump = static_cast<int32_t>(SYNC_JUMP_NS * sample_rate / 1000000000);
+        bool slewed = false;
+
+        size_t done = 0;
+        while (done < n) {
+            if (decoded_pos >= decoded_len) fillFrame(target, max_ahead, sample_rate);
+            if (decoded_len == 0) {
+                std::fill(out + done, out + n, 0.0f);
+                return;
+            }
+
+            uint32_t due = 0;
+            const int64_t at = media_ns + static_cast<int64_t>(done * 1e9 / sample_rate);
+            if (sync && timed && dueTimestamp(at, sample_rate, latency_ns, due)) {
+                // Positive when the next sample is early
+                const int32_t error = static_cast<int32_t>(frame_timestamp + static_cast<uint32_t>(decoded_pos) - due);
+                if (error > jump || (error > deadband && !slewed)) {
+                    const size_t hold = error > jump ? std::min<size_t>(error, n - done) : 1;
+                    std::fill(out + done, out + done + hold, error > jump ? 0.0f : decoded[decoded_pos]);
+                    done += hold;
+                    slewed = true;
+                    sync_adjusted.fetch_add(hold, std::memory_order_relaxed);
+                    continue;
+                }
+                if (error < -jump || (error < -deadband && !slewed)) {
+                    const size_t skip = std::min<size_t>(error < -jump ? -error : 1, decoded_len - decoded_pos);
+                    decoded_pos += skip;
+                    slewed = true;
+                    sync_adjusted.fetch_add(skip, std::memory_order_relaxed);
+                    continue;
+                }
+            }
+
+            const size_t count = std::min(n - done, decoded_len - decoded_pos);
+            std::memcpy(out + done, decoded + decoded_pos, count * sizeof(float));
+            decoded_pos += count;
+            done += count;
+        }
+    }
+};
+
+JitterBuffer::JitterBuffer(int sample_rate, size_t target_frames)
+    : sample_rate_(sample_rate), target_frames_(std::max<size_t>(target_frames, 1)),
+      streams_(new std::atomic<Stream*>[MAX_STREAMS]), stream_count_(0), sync_latency_ns_(0),
+      mix_scratch_(new float[MAX_FRAME_SAMPLES]) {
+    for (size_t i = 0; i < MAX_STREAMS; ++i) streams_[i].store(nullptr);
+}
+
+JitterBuffer::~JitterBuffer() {
+    for (size_t i = 0; i < MAX_STREAMS; ++i) delete streams_[i].load();
+}
+
+JitterBuffer::Stream* JitterBuffer::findOrCreate(uint16_t sender_id) {
+    const size_t count = stream_count_.load(std::memory_order_acquire);
+    Stream* reusable = nullptr;
+    for (size_t i = 0; i < count; ++i) {
+        Stream* s = streams_[i].load(std::memory_order_relaxed);
+        if (s->sender_id.load(std::memory_order_relaxed) == sender_id) return s;
+        if (!reusable && s->idle.load(std::memory_order_acquire)) reusable = s;
+    }
+
+    if (reusable) {
+        // Idle streams are not read by the audio thread until they see a new arrival
+        for (auto& slot : reusable->slots) slot.tag.store(0, std::memory_order_relaxed);
+        reusable->sender_id.store(sender_id, std::memory_order_relaxed);
+        reusable->setTiming(0, -1);
+        return reusable;
+    }
+
+    if (count == MAX_STREAMS) return nullptr;
+    Stream* s = new Stream();
+    if (opusAvailable() && opusSupportsRate(sample_rate_)) s->opus.configure(sample_rate_);
+    s->sender_id.store(sender_id, std::memory_order_relaxed);
+    streams_[count].store(s, std::memory_order_release);
+    stream_count_.store(count + 1, std::memory_order_release);
+    return s;
+}
+
+bool JitterBuffer::push(const AudioFrameHeader& header, const uint8_t* payload, size_t bytes) {
+    if (bytes > MAX_PAYLOAD + sizeof(FecParityHeader)) return false;
+
+    Stream* s = findOrCreate(header.sender_id);
+    if (!s) return false;
+
+    if (header.flags & FRAME_FEC_MASK) {
+        // Repair data is only useful to a stream that is playing
+        if (s->arrivals.load(std::memory_order_relaxed) == 0 || s->idle.load(std::memory_order_acquire)) {
+            return false;
+        }
+        s->pushRepair(header, payload, bytes);
+        return true;
+    }
+    if (bytes > MAX_PAYLOAD) return false;
+
+    s->received.fetch_add(1, std::memory_order_relaxed);
+    if (header.flags & FRAME_COMFORT_NOISE) {
+        s->comfort_noise.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    const bool restart = s->idle.exchange(false, std::memory_order_acq_rel) ||
+                         s->arrivals.load(std::memory_order_relaxed) == 0;
+    const int64_t expected = s->next_expected.load(std::memory_order_acquire);
+    if (!restart && expected >= 0 && sequenceDiff(header.sequence, static_cast<uint32_t>(expected)) < 0) {
+        s->late.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    if (restart) {
+        for (auto& group : s->groups) group.pending = false;
+    }
+    s->store(header, payload, bytes, restart);
+    s->repairAround(header.sequence);
+    return true;
+}
+
+void JitterBuffer::setSenderClock(uint16_t sender_id, uint32_t timestamp, int64_t media_time_ns) {
+    Stream* s = findOrCreate(sender_id);
+    if (s) s->setTiming(timestamp, media_time_ns);
+}
+
+void JitterBuffer::read(float* out, size_t frames, int64_t media_time_ns) {
+    std::fill(out, out + frames, 0.0f);
+    const int64_t latency = sync_latency_ns_.load(std::memory_order_relaxed);
+    if (latency <= 0) media_time_ns = -1;
+
+    const size_t count = stream_count_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; ++i) {
+        Stream* s = streams_[i].load(std::memory_order_acquire);
+        for (size_t done = 0; done < frames; done += MAX_FRAME_SAMPLES) {
+            const size_t n = std::min(frames - done, MAX_FRAME_SAMPLES);
+            const int64_t at = media_time_ns < 0 ? -1 : media_time_ns + static_cast<int64_t>(done * 1e9 / sample_rate_);
+            s->produce(mix_scratch_.get(), n, target_frames_, sample_rate_, at, latency);
+            SampleKernels::mixAccumulate(out + done, mix_scratch_.get(), n);
+        }
+    }
+}
+
+JitterBufferStats JitterBuffer::stats() const {
+    JitterBufferStats total{};
+    const size_t count = stream_count_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; ++i) {
+        const Stream* s = streams_[i].load(std::memory_order_acquire);
+        total.received += s->received.load(std::memory_order_relaxed);
+        total.late += s->late.load(std::memory_order_relaxed);
+        total.lost += s->lost.load(std::memory_order_relaxed);
+        total.recovered += s->recovered.load(std::memory_order_relaxed);
+        total.repaired += s->repaired.load(std::memory_order_relaxed);
+        total.dropped += s->dropped.load(std::memory_order_relaxed);
+        total.comfort_noise += s->comfort_noise.load(std::memory_order_relaxed);
+        total.sync_adjusted += s->sync_adjusted.load(std::memory_order_relaxed);
+    }
+    total.streams = count;
+    return total;
+}
+
+size_t JitterBuffer::streamCounters(JitterStreamCounters* out, size_t max) const {
+    const size_t count = std::min(stream_count_.load(std::memory_order_acquire), max);
+    for (size_t i = 0; i < count; ++i) {
+        const Stream* s = streams_[i].load(std::memory_order_acquire);
+        const uint64_t lost = s->lost.load(std::memory_order_relaxed);
+        const uint64_t repaired = s->repaired.load(std::memory_order_relaxed);
+        out[i].sender_id = s->sender_id.load(std::memory_order_relaxed);
+        out[i].expected = s->received.load(std::memory_order_relaxed) + lost + repaired;
+        out[i].missing = lost + repaired;
+    }
+    return count;
+}
@@ -0,0 +1,360 @@
+#include "LatencyHarness.h"
+#include "AudioClient.h"
+#include "AudioServer.h"
+#include "RealtimeMemory.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr double CHIRP_SECONDS = 0.01;
+constexpr double CHIRP_START_HZ = 1000.0;
+constexpr double CHIRP_END_HZ = 4000.0;
+constexpr float CHIRP_LEVEL = 0.5f;
+// Normalized correlation a played window needs to count as a chirp
+constexpr float DETECT_THRESHOLD = 0.6f;
+// Onsets move through the capture block from marker to marker, so the
+// capture stage is sampled across its whole range
+constexpr size_t ONSET_STEP = 97;
+// Time for the last marker to come out the other end
+constexpr double DRAIN_SECONDS = 1.0;
+
+// A Hann-windowed linear sweep: sharp autocorrelation peak, and it
+// survives every codec
+std::vector<float> makeChirp(int sample_rate) {
+    const size_t length = static_cast<size_t>(CHIRP_SECONDS * sample_rate);
+    std::vector<float> chirp(length);
+    const double two_pi = 6.283185307179586;
+    const double sweep = (CHIRP_END_HZ - CHIRP_START_HZ) / CHIRP_SECONDS;
+    for (size_t i = 0; i < length; ++i) {
+        const double t = static_cast<double>(i) / sample_rate;
+        const double window = 0.5 - 0.5 * std::cos(two_pi * i / (length - 1));
+        chirp[i] = static_cast<float>(CHIRP_LEVEL * window * std::sin(two_pi * (CHIRP_START_HZ * t + 0.5 * sweep * t * t)));
+    }
+    return chirp;
+}
+
+struct Marker {
+    uint64_t sample;      // onset in the sender's sample count
+    int64_t onset_ns;     // when the onset was captured
+};
+
+// The sender's null input. Counts samples exactly as the client stamps
+// frames, since every captured block goes through it.
+class MarkerSource {
+  public:
+    MarkerSource(int sample_rate, const std::vector<float>& chirp, uint64_t first, uint64_t last, uint64_t interval)
+        : sample_rate_(sample_rate), chirp_(chirp), next_onset_(first), last_(last), interval_(interval),
+          position_(0), count_(0), block_(0) {}
+
+    void fill(float* out, size_t frames, int64_t first_ns) {
+        const uint64_t block_start = position_;
+        const uint64_t block_end = position_ + frames;
+        std::fill(out, out + frames, 0.0f);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        block_ = frames;
+        // A chirp may have started in an earlier block
+        for (const Marker& marker : markers_) {
+            if (marker.sample + chirp_.size() <= block_start) continue;
+            mix(out, block_start, block_end, marker.sample);
+        }
+        while (next_onset_ < block_end && next_onset_ <= last_) {
+            const int64_t offset_ns = static_cast<int64_t>((next_onset_ - block_start) * 1e9 / sample_rate_);
+            markers_.push_back({next_onset_, first_ns + offset_ns});
+            mix(out, block_start, block_end, next_onset_);
+            ++count_;
+            next_onset_ += interval_ + (count_ * ONSET_STEP) % 256;
+        }
+        position_ = block_end;
+    }
+
+    std::vector<Marker> markers() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return markers_;
+    }
+
+    // The null device captures in blocks of one size
+    size_t blockFrames() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return block_;
+    }
+
+  private:
+    int sample_rate_;
+    const std::vector<float>& chirp_;
+    uint64_t next_onset_;
+    uint64_t last_;
+    uint64_t interval_;
+    uint64_t position_;
+    uint64_t count_;
+    size_t block_;
+    std::vector<Marker> markers_;
+    mutable std::mutex mutex_;
+
+    void mix(float* out, uint64_t block_start, uint64_t block_end, uint64_t onset) const {
+        const uint64_t from = std::max(block_start, onset);
+        const uint64_t to = std::min<uint64_t>(block_end, onset + chirp_.size());
+        for (uint64_t sample = from; sample < to; ++sample) {
+            out[sample - block_start] += chirp_[sample - onset];
+        }
+    }
+};
+
+// Matched filter over the played output. Correlation only runs while the
+// window holds real energy, so the silence between markers costs little.
+class MarkerDetector {
+  public:
+    MarkerDetector(int sample_rate, const std::vector<float>& chirp, uint64_t refractory)
+        : sample_rate_(sample_rate), chirp_(chirp), refractory_(refractory), chirp_energy_(0.0),
+          window_energy_(0.0), played_(0), best_score_(0.0f), best_onset_(0), in_peak_(false), quiet_until_(0) {
+        for (float value : chirp_) chirp_energy_ += static_cast<double>(value) * value;
+        history_.assign(chirp_.size(), 0.0f);
+    }
+
+    void process(const float* data, size_t frames, int64_t heard_ns) {
+        const size_t length = chirp_.size();
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < frames; ++i) {
+            // history_ is a ring of the last length samples
+            const size_t slot = played_ % length;
+            const double outgoing = history_[slot];
+            window_energy_ += static_cast<double>(data[i]) * data[i] - outgoing * outgoing;
+            history_[slot] = data[i];
+            ++played_;
+            if (played_ < length || played_ < quiet_until_) continue;
+
+            const uint64_t onset = played_ - length;
+            float score = 0.0f;
+            if (window_energy_ > 0.1 * chirp_energy_) {
+                double dot = 0.0;
+                for (size_t k = 0; k < length; ++k) dot += static_cast<double>(history_[(onset + k) % length]) * chirp_[k];
+                score = static_cast<float>(dot / std::sqrt(window_energy_ * chirp_energy_));
+            }
+
+            if (score >= DETECT_THRESHOLD) {
+                if (!in_peak_ || score > best_score_) {
+                    best_score_ = score;
+                    best_onset_ = onset;
+                    // heard_ns is the time of this block's first sample
+                    const double block_start = static_cast<double>(played_ - 1 - i);
+                    best_heard_ns_ = heard_ns + static_cast<int64_t>((static_cast<double>(onset) - block_start) * 1e9 / sample_rate_);
+                }
+                in_peak_ = true;
+            } else if (in_peak_) {
+                detections_.push_back(best_heard_ns_);
+                in_peak_ = false;
+                best_score_ = 0.0f;
+                quiet_until_ = best_onset_ + refractory_;
+            }
+        }
+    }
+
+    std::vector<int64_t> detections() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return detections_;
+    }
+
+  private:
+    int sample_rate_;
+    const std::vector<float>& chirp_;
+    uint64_t refractory_;
+    double chirp_energy_;
+    std::vector<float> history_;
+    double window_energy_;
+    uint64_t played_;
+    float best_score_;
+    uint64_t best_onset_;
+    int64_t best_heard_ns_ = 0;
+    bool in_peak_;
+    uint64_t quiet_until_;
+    std::vector<int64_t> detections_;
+    mutable std::mutex mutex_;
+};
+
+// Times of the audio frames one client saw, keyed by their first sample
+class FrameLog {
+  public:
+    void add(const AudioFrameHeader& header, int64_t ns) {
+        if (header.samples == 0 || (header.flags & FRAME_FEC_MASK)) return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        frames_.emplace(header.timestamp, Entry{header.samples, ns});
+    }
+
+    // Time of the frame carrying sample, -1 if none did
+    int64_t find(uint64_t sample) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const uint32_t wrapped = static_cast<uint32_t>(sample);
+        auto it = frames_.upper_bound(wrapped);
+        if (it == frames_.begin()) return -1;
+        --it;
+        return wrapped - it->first < it->second.samples ? it->second.ns : -1;
+    }
+
+  private:
+    struct Entry {
+        uint16_t samples;
+        int64_t ns;
+    };
+    std::map<uint32_t, Entry> frames_;
+    mutable std::mutex mutex_;
+};
+
+void printRow(std::ostream& out, const char* name, const LatencyHistogram& histogram) {
+    char line[160];
+    snprintf(line, sizeof(line), "  %-16s p50 %8.2f  p90 %8.2f  p99 %8.2f  max %8.2f\n", name,
+             histogram.percentileUs(0.5) / 1000.0, histogram.percentileUs(0.9) / 1000.0,
+             histogram.percentileUs(0.99) / 1000.0, histogram.maxUs() / 1000.0);
+    out << line;
+}
+
+} // namespace
+
+LatencyHarness::LatencyHarness(const LatencyHarnessConfig& config)
+    : config_(config), markers_sent_(0), spurious_(0), untraced_(0), total_sum_us_(0.0) {
+}
+
+bool LatencyHarness::run() {
+    const int rate = config_.sample_rate;
+    const std::vector<float> chirp = makeChirp(rate);
+    const uint64_t interval = static_cast<uint64_t>(config_.marker_interval_ms * 0.001 * rate);
+    if (interval < 4 * chirp.size()) {
+        std::cerr << "Markers need to be at least " << 4 * chirp.size() * 1000 / rate << " ms apart" << std::endl;
+        return false;
+    }
+    const uint64_t first = static_cast<uint64_t>(config_.warmup_seconds * rate);
+    const uint64_t last = first + static_cast<uint64_t>(config_.duration_seconds * rate);
+    MarkerSource source(rate, chirp, first, last, interval);
+    MarkerDetector detector(rate, chirp, interval / 2);
+    FrameLog sent;
+    FrameLog received;
+
+    AudioServer server;
+    if (!server.start(config_.port)) return false;
+
+    JitterBuffer jitter_buffer(rate);
+    jitter_buffer.setSyncLatency(static_cast<int64_t>(config_.sync_ms) * 1000000);
+    AudioClient receiver(-1, rate, 1, nullptr, nullptr, &jitter_buffer);
+    receiver.setListenOnly(true);
+    receiver.setMulticast(false);
+    receiver.setPreferredCodec(config_.codec);
+    receiver.setFec(config_.fec, config_.fec_group);
+    receiver.setImpairment(ImpairmentConfig(), config_.impairment);
+    receiver.audioProcessor().setNullDevice(true);
+    receiver.audioProcessor().setPlaybackTap([&detector](const float* data, size_t samples, int64_t heard_ns) {
+        detector.process(data, samples, heard_ns);
+    });
+    receiver.setFrameObserver([&received](FrameEvent event, const AudioFrameHeader& header, int64_t ns) {
+        if (event == FrameEvent::RECEIVED) received.add(header, ns);
+    });
+
+    AudioClient sender(-1, rate, 1, nullptr, nullptr, nullptr);
+    sender.setMulticast(false);
+    sender.setPreferredCodec(config_.codec);
+    sender.setOpusSettings(config_.opus);
+    sender.setFec(config_.fec, config_.fec_group);
+    sender.setDtxEnabled(config_.dtx);
+    sender.audioProcessor().setNullDevice(true);
+    sender.audioProcessor().setNullInput([&source](float* out, size_t samples, int64_t first_ns) {
+        source.fill(out, samples, first_ns);
+    });
+    sender.setFrameObserver([&sent](FrameEvent event, const AudioFrameHeader& header, int64_t ns) {
+        if (event == FrameEvent::SENT) sent.add(header, ns);
+    });
+
+    const bool started = receiver.connect("127.0.0.1", config_.port) && receiver.startAudio() &&
+                         sender.connect("127.0.0.1", config_.port) && sender.startAudio();
+    if (started) {
+        // Faults while streams and buffers settle are expected; the ones
+        // after the warmup are what the audio path costs in steady state
+        std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<int64_t>(config_.warmup_seconds * 1000)));
+        pageFaultReport();
+        std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<int64_t>(
+            (config_.duration_seconds + DRAIN_SECONDS) * 1000 + config_.sync_ms)));
+        page_faults_ = pageFaultReport();
+    }
+    sender.disconnect();
+    receiver.disconnect();
+    server.stop();
+    if (!started) {
+        std::cerr << "Could not start the session" << std::endl;
+        return false;
+    }
+
+    // Each playout pairs with the latest marker captured before it;
+    // markers are further apart than any latency measured
+    // The capture chain delays the chirp; frames are found by where it
+    // sits after processing, and capture lasts until that block is ready
+    const std::vector<Marker> markers = source.markers();
+    const uint64_t delay = sender.audioProcessor().captureChain().latencyFrames();
+    const uint64_t block = std::max<size_t>(1, source.blockFrames());
+    const std::vector<int64_t> heard = detector.detections();
+    markers_sent_ = markers.size();
+    std::vector<bool> matched(markers.size(), false);
+    const int64_t interval_ns = static_cast<int64_t>(interval * 1e9 / rate);
+    for (int64_t heard_ns : heard) {
+        auto next = std::upper_bound(markers.begin(), markers.end(), heard_ns,
+                                     [](int64_t ns, const Marker& marker) { return ns < marker.onset_ns; });
+        if (next == markers.begin()) {
+            ++spurious_;
+            continue;
+        }
+        const size_t index = static_cast<size_t>(next - markers.begin()) - 1;
+        const Marker& marker = markers[index];
+        if (matched[index] || heard_ns - marker.onset_ns >= interval_ns) {
+            ++spurious_;
+            continue;
+        }
+        matched[index] = true;
+
+        const int64_t total_us = (heard_ns - marker.onset_ns) / 1000;
+        total_.record(total_us);
+        total_sum_us_ += static_cast<double>(total_us);
+        const uint64_t carried = marker.sample + delay;
+        const int64_t sent_ns = sent.find(carried);
+        const int64_t received_ns = received.find(carried);
+        if (sent_ns < 0 || received_ns < 0) {
+            ++untraced_;
+            continue;
+        }
+        const uint64_t ready_sample = (carried / block + 1) * block;
+        const int64_t ready_ns = marker.onset_ns + static_cast<int64_t>((ready_sample - marker.sample) * 1e9 / rate);
+        capture_.record((ready_ns - marker.onset_ns) / 1000);
+        send_.record((sent_ns - ready_ns) / 1000);
+        network_.record((received_ns - sent_ns) / 1000);
+        playout_.record((heard_ns - received_ns) / 1000);
+    }
+    return true;
+}
+
+void LatencyHarness::printReport(std::ostream& out) const {
+    out << "Markers: " << markers_sent_ << " sent, " << total_.count() << " detected, "
+        << (markers_sent_ - total_.count()) << " missed, " << spurious_ << " spurious" << std::endl;
+    if (total_.count() == 0) return;
+
+    char line[160];
+    snprintf(line, sizeof(line), "Mouth to ear (ms): mean %.2f\n", total_sum_us_ / total_.count() / 1000.0);
+    out << line;
+    printRow(out, "total", total_);
+    if (capture_.count() > 0) {
+        out << "By stage (ms), from " << capture_.count() << " markers:" << std::endl;
+        printRow(out, "capture and DSP", capture_);
+        printRow(out, "encode and send", send_);
+        printRow(out, "network", network_);
+        printRow(out, "jitter buffer", playout_);
+    }
+    if (untraced_ > 0) {
+        out << untraced_ << " markers played partly from frames not sent as speech have no stage breakdown" << std::endl;
+    }
+    if (!page_faults_.empty()) {
+        out << "Page faults after the warmup:" << std::endl;
+        for (const auto& line : page_faults_) out << "  " << line << std::endl;
+    }
+}
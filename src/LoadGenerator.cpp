@@ -0,0 +1,756 @@
+#include "LoadGenerator.h"
+#include "AudioFrame.h"
+#include "ClockSync.h"
+#include "ComfortNoise.h"
+#include "JitterBuffer.h"
+#include "WavFileSource.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+
+#ifndef _WIN32
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <poll.h>
+#endif
+
+namespace {
+
+// As AudioClient: a clock sync heartbeat a second, and a comfort noise
+// descriptor every 160 ms of silence
+constexpr int64_t HEARTBEAT_INTERVAL_NS = 1000000000LL;
+constexpr float DESCRIPTOR_INTERVAL_MS = 160.0f;
+constexpr float DESCRIPTOR_LEVEL = 0.001f;
+// Unsent bytes a client may queue before it drops frames instead
+constexpr size_t MAX_BACKLOG_BYTES = 256 * 1024;
+constexpr size_t READ_CHUNK = 256 * 1024;
+constexpr uint32_t MAX_MESSAGE_BYTES = 1 << 20;
+// Message type and size, as NetworkManager frames them
+constexpr size_t MESSAGE_HEADER_BYTES = 5;
+// Speakers are spread over this many frame phases so their frames do not
+// all leave at once, while each event loop still wakes a bounded number
+// of times per frame
+constexpr size_t FRAME_PHASES = 4;
+// A loop further behind than this skips frames rather than bursting them
+constexpr int64_t MAX_CATCH_UP_NS = 1000000000LL;
+constexpr int64_t PUBLISH_INTERVAL_NS = 100000000LL;
+constexpr int64_t IDLE_WAIT_NS = 50000000LL;
+constexpr double VOICE_SECONDS = 10.0;
+
+void appendMessage(std::vector<uint8_t>& out, MessageType type, const void* head, size_t head_bytes,
+                   const void* body = nullptr, size_t body_bytes = 0) {
+    const uint32_t size = static_cast<uint32_t>(head_bytes + body_bytes);
+    const size_t at = out.size();
+    out.resize(at + MESSAGE_HEADER_BYTES + size);
+    out[at] = static_cast<uint8_t>(type);
+    std::memcpy(&out[at + 1], &size, sizeof(size));
+    if (head_bytes) std::memcpy(&out[at + MESSAGE_HEADER_BYTES], head, head_bytes);
+    if (body_bytes) std::memcpy(&out[at + MESSAGE_HEADER_BYTES + head_bytes], body, body_bytes);
+}
+
+bool setNonBlocking(SOCKET fd) {
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(fd, FIONBIO, &mode) == 0;
+#else
+    const int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+bool wouldBlock() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+// Frames are due at exact sample times, so wait with the finest timeout
+// the platform offers
+int pollSockets(std::vector<pollfd>& fds, int64_t timeout_ns) {
+    timeout_ns = std::max<int64_t>(0, timeout_ns);
+#ifdef _WIN32
+    return WSAPoll(fds.data(), static_cast<ULONG>(fds.size()), static_cast<INT>((timeout_ns + 999999) / 1000000));
+#elif defined(__linux__)
+    timespec timeout;
+    timeout.tv_sec = static_cast<time_t>(timeout_ns / 1000000000LL);
+    timeout.tv_nsec = static_cast<long>(timeout_ns % 1000000000LL);
+    return ppoll(fds.data(), fds.size(), &timeout, nullptr);
+#else
+    return poll(fds.data(), fds.size(), static_cast<int>((timeout_ns + 999999) / 1000000));
+#endif
+}
+
+std::string fixed2(double value) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.2f", value);
+    return text;
+}
+
+std::string formatMs(uint64_t us) {
+    return fixed2(us / 1000.0);
+}
+
+size_t maxFrameBytes(size_t samples) {
+    size_t bytes = samples * sizeof(float);
+    for (uint8_t codec = 0; codec < 32; ++codec) {
+        if (builtinCodecMask() & (1u << codec)) {
+            bytes = std::max(bytes, maxEncodedBytes(static_cast<AudioCodec>(codec), samples));
+        }
+    }
+    return bytes;
+}
+
+} // namespace
+
+LoadGenCounters& LoadGenCounters::operator+=(const LoadGenCounters& other) {
+    connected += other.connected;
+    connect_failures += other.connect_failures;
+    closed_by_server += other.closed_by_server;
+    frames_sent += other.frames_sent;
+    descriptors_sent += other.descriptors_sent;
+    bytes_sent += other.bytes_sent;
+    send_drops += other.send_drops;
+    frames_received += other.frames_received;
+    bytes_received += other.bytes_received;
+    frames_lost += other.frames_lost;
+    return *this;
+}
+
+namespace {
+
+struct SimClient {
+    enum class State : uint8_t { PENDING, OPEN, CLOSED };
+
+    size_t index = 0;
+    bool speaker = false;
+    State state = State::PENDING;
+    SOCKET fd = INVALID_SOCKET_VAL;
+    int64_t connect_at = 0;
+    size_t poll_slot = 0;
+
+    // Sending
+    AudioCodec codec = AudioCodec::FLOAT32;   // until the server picks one
+    CodecState codec_state;
+    uint32_t sequence = 0;
+    uint64_t next_sample = 0;     // shared sample clock at the next frame's first sample
+    size_t voice_offset = 0;
+    bool talking = false;
+    bool in_talkspurt = false;
+    int64_t toggle_at = 0;
+    size_t samples_since_descriptor = 0;
+    int64_t next_heartbeat = 0;
+    uint32_t heartbeat_sequence = 0;
+    std::vector<uint8_t> out;
+    size_t out_sent = 0;
+
+    // Receiving
+    std::vector<uint8_t> partial;     // an incomplete message from the last read
+    std::unordered_map<uint16_t, uint32_t> next_sequence;
+    LatencyHistogram latency;
+    uint64_t frames_received = 0;
+    uint64_t frames_lost = 0;
+};
+
+} // namespace
+
+// One thread driving its share of the clients through a single poll set.
+// Everything a loop touches is its own; only the counters are shared, and
+// those are published under a mutex a few times a second.
+class LoadGenerator::EventLoop {
+  public:
+    EventLoop(const LoadGenConfig& config, const std::vector<float>& voice, int64_t epoch_ns, unsigned seed)
+        : config_(config), voice_(voice), epoch_ns_(epoch_ns), rng_(seed), running_(false), poll_dirty_(true),
+          encode_buffer_(maxFrameBytes(config.frame_samples)) {
+        frame_ns_ = static_cast<int64_t>(config_.frame_samples * 1e9 / config_.sample_rate);
+    }
+
+    ~EventLoop() { stop(); }
+
+    void add(size_t index, bool speaker, int64_t connect_at) {
+        SimClient client;
+        client.index = index;
+        client.speaker = speaker;
+        client.connect_at = connect_at;
+        clients_.push_back(std::move(client));
+    }
+
+    void start() {
+        running_ = true;
+        thread_ = std::thread(&EventLoop::run, this);
+    }
+
+    void stop() {
+        running_ = false;
+        if (thread_.joinable()) thread_.join();
+    }
+
+    LoadGenCounters counters() const {
+        std::lock_guard<std::mutex> lock(published_mutex_);
+        return published_;
+    }
+
+    // Only once stopped
+    const std::vector<SimClient>& clients() const { return clients_; }
+    const LatencyHistogram& sendLag() const { return send_lag_; }
+    const LatencyHistogram& heartbeatRtt() const { return heartbeat_rtt_; }
+
+  private:
+    const LoadGenConfig& config_;
+    const std::vector<float>& voice_;
+    const int64_t epoch_ns_;
+    int64_t frame_ns_;
+    std::mt19937 rng_;
+    std::atomic<bool> running_;
+    std::thread thread_;
+
+    std::vector<SimClient> clients_;
+    std::vector<pollfd> fds_;
+    std::vector<size_t> owners_;      // client index for each pollfd
+    bool poll_dirty_;
+    std::vector<uint8_t> encode_buffer_;
+    LatencyHistogram send_lag_;       // how late frames left against their due time
+    LatencyHistogram heartbeat_rtt_;
+
+    LoadGenCounters counters_;
+    LoadGenCounters published_;
+    mutable std::mutex published_mutex_;
+    int64_t next_publish_ = 0;
+
+    int64_t sampleDueNs(uint64_t sample) const {
+        return epoch_ns_ + static_cast<int64_t>(static_cast<double>(sample) * 1e9 / config_.sample_rate);
+    }
+
+    int64_t randomDuration(double mean_seconds) {
+        std::exponential_distribution<double> duration(1.0 / std::max(0.01, mean_seconds));
+        return static_cast<int64_t>(duration(rng_) * 1e9);
+    }
+
+    void run() {
+        std::vector<uint8_t> scratch(READ_CHUNK);
+        int64_t next_work = 0;
+        while (running_) {
+            const int64_t now = monotonicNowNs();
+            if (now >= next_work) next_work = doWork(now);
+            if (poll_dirty_) rebuildPollSet();
+            if (fds_.empty()) {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(
+                    std::min(IDLE_WAIT_NS, std::max<int64_t>(0, next_work - monotonicNowNs()))));
+                continue;
+            }
+
+            if (pollSockets(fds_, next_work - monotonicNowNs()) <= 0) continue;
+            for (size_t i = 0; i < fds_.size(); ++i) {
+                const short events = fds_[i].revents;
+                if (!events) continue;
+                SimClient& client = clients_[owners_[i]];
+                if (client.state != SimClient::State::OPEN) continue;
+                if (events & (POLLIN | POLLERR | POLLHUP)) receive(client, scratch);
+                if (client.state == SimClient::State::OPEN && (events & POLLOUT)) flush(client);
+            }
+        }
+
+        for (SimClient& client : clients_) {
+            if (client.state != SimClient::State::OPEN) continue;
+            appendMessage(client.out, MessageType::DISCONNECT, nullptr, 0);
+            flush(client);
+            if (client.state == SimClient::State::OPEN) closeClient(client);
+        }
+        publish();
+    }
+
+    // Connects clients whose time has come, sends the frames and
+    // heartbeats that are due, and returns when the next one is
+    int64_t doWork(int64_t now) {
+        int64_t next = now + IDLE_WAIT_NS;
+        for (SimClient& client : clients_) {
+            if (client.state == SimClient::State::PENDING) {
+                if (now < client.connect_at) {
+                    next = std::min(next, client.connect_at);
+                    continue;
+                }
+                open(client, now);
+            }
+            if (client.state != SimClient::State::OPEN) continue;
+
+            if (client.speaker) next = std::min(next, sendDueFrames(client, now));
+            if (now >= client.next_heartbeat) {
+                sendHeartbeat(client, now);
+                client.next_heartbeat += HEARTBEAT_INTERVAL_NS;
+            }
+            next = std::min(next, client.next_heartbeat);
+            if (client.out_sent < client.out.size()) flush(client);
+        }
+        if (now >= next_publish_) {
+            publish();
+            next_publish_ = now + PUBLISH_INTERVAL_NS;
+        }
+        return next;
+    }
+
+    void open(SimClient& client, int64_t now) {
+        client.state = SimClient::State::CLOSED;
+        const SOCKET fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(config_.port));
+        if (fd == INVALID_SOCKET_VAL || inet_pton(AF_INET, config_.host.c_str(), &address.sin_addr) <= 0 ||
+            connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR_VAL ||
+            !setNonBlocking(fd)) {
+            if (fd != INVALID_SOCKET_VAL) close_socket(fd);
+            counters_.connect_failures++;
+            return;
+        }
+#ifdef _WIN32
+        char nodelay = 1;
+#else
+        int nodelay = 1;
+#endif
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+        client.fd = fd;
+        client.state = SimClient::State::OPEN;
+        poll_dirty_ = true;
+        counters_.connected++;
+
+        CodecHello hello{};
+        hello.version = CODEC_HELLO_VERSION;
+        hello.preferred = static_cast<uint8_t>(config_.codec);
+        hello.supported = builtinCodecMask();
+        hello.features = client.speaker ? 0 : HELLO_FEATURE_LISTEN_ONLY;
+        appendMessage(client.out, MessageType::CONNECT, &hello, sizeof(hello));
+        appendMessage(client.out, MessageType::CLIENT_READY, nullptr, 0);
+
+        std::uniform_int_distribution<int64_t> heartbeat_phase(0, HEARTBEAT_INTERVAL_NS - 1);
+        client.next_heartbeat = now + heartbeat_phase(rng_);
+
+        if (client.speaker) {
+            const size_t frame = config_.frame_samples;
+            const uint64_t elapsed = static_cast<uint64_t>((now - epoch_ns_) * 1e-9 * config_.sample_rate);
+            client.next_sample = (elapsed / frame + 1) * frame + (client.index % FRAME_PHASES) * frame / FRAME_PHASES;
+            client.voice_offset = (client.index * 7919 % (voice_.size() / frame)) * frame;
+            const double talk_share = config_.talk_seconds / (config_.talk_seconds + config_.pause_seconds);
+            client.talking = std::uniform_real_distribution<double>(0.0, 1.0)(rng_) < talk_share;
+            client.toggle_at = now + randomDuration(client.talking ? config_.talk_seconds : config_.pause_seconds);
+        }
+        flush(client);
+    }
+
+    int64_t sendDueFrames(SimClient& client, int64_t now) {
+        const size_t frame = config_.frame_samples;
+        int64_t due = sampleDueNs(client.next_sample + frame);
+        if (now - due > MAX_CATCH_UP_NS) {
+            const uint64_t skipped = static_cast<uint64_t>((now - due) / frame_ns_);
+            counters_.send_drops += skipped;
+            client.next_sample += skipped * frame;
+            due = sampleDueNs(client.next_sample + frame);
+        }
+        while (due <= now && client.state == SimClient::State::OPEN) {
+            send_lag_.record((now - due) / 1000);
+            sendFrame(client, now);
+            client.next_sample += frame;
+            due = sampleDueNs(client.next_sample + frame);
+        }
+        return due;
+    }
+
+    // Mirrors AudioClient::onAudioCaptured: speech while talking, then one
+    // descriptor as the talkspurt ends and a refresh every 160 ms
+    void sendFrame(SimClient& client, int64_t now) {
+        if (now >= client.toggle_at) {
+            client.talking = !client.talking;
+            client.toggle_at = now + randomDuration(client.talking ? config_.talk_seconds : config_.pause_seconds);
+        }
+        const size_t frame = config_.frame_samples;
+        AudioFrameHeader header{};
+        header.timestamp = static_cast<uint32_t>(client.next_sample);
+
+        if (client.talking || !config_.dtx) {
+            header.flags = client.in_talkspurt ? 0 : FRAME_TALKSPURT;
+            header.samples = static_cast<uint16_t>(frame);
+            header.codec = static_cast<uint8_t>(client.codec);
+            client.in_talkspurt = true;
+
+            const float* pcm = voice_.data() + client.voice_offset;
+            client.voice_offset = (client.voice_offset + frame) % voice_.size();
+            if (client.codec == AudioCodec::FLOAT32) {
+                if (queueFrame(client, header, pcm, frame * sizeof(float))) counters_.frames_sent++;
+            } else {
+                const size_t bytes = encodeAudio(client.codec, pcm, frame, encode_buffer_.data(), client.codec_state);
+                if (queueFrame(client, header, encode_buffer_.data(), bytes)) counters_.frames_sent++;
+            }
+            return;
+        }
+
+        client.samples_since_descriptor += frame;
+        const size_t interval = static_cast<size_t>(DESCRIPTOR_INTERVAL_MS * 0.001f * config_.sample_rate);
+        if (client.in_talkspurt || client.samples_since_descriptor >= interval) {
+            ComfortNoiseParams params{};
+            params.level = DESCRIPTOR_LEVEL;
+            header.flags = FRAME_COMFORT_NOISE;
+            if (queueFrame(client, header, &params, sizeof(params))) counters_.descriptors_sent++;
+            client.samples_since_descriptor = 0;
+        }
+        client.in_talkspurt = false;
+    }
+
+    bool queueFrame(SimClient& client, AudioFrameHeader& header, const void* payload, size_t bytes) {
+        if (client.out.size() - client.out_sent > MAX_BACKLOG_BYTES) {
+            counters_.send_drops++;
+            return false;
+        }
+        header.sequence = client.sequence++;
+        appendMessage(client.out, MessageType::AUDIO_DATA, &header, sizeof(header), payload, bytes);
+        counters_.bytes_sent += MESSAGE_HEADER_BYTES + sizeof(header) + bytes;
+        return true;
+    }
+
+    void sendHeartbeat(SimClient& client, int64_t now) {
+        HeartbeatPayload heartbeat{};
+        heartbeat.version = HEARTBEAT_VERSION;
+        heartbeat.sequence = client.heartbeat_sequence++;
+        heartbeat.client_send = now;
+        appendMessage(client.out, MessageType::HEARTBEAT, &heartbeat, sizeof(heartbeat));
+    }
+
+    void flush(SimClient& client) {
+        while (client.out_sent < client.out.size()) {
+#ifdef _WIN32
+            const int sent = send(client.fd, reinterpret_cast<const char*>(client.out.data() + client.out_sent),
+                                  static_cast<int>(client.out.size() - client.out_sent), SEND_FLAGS);
+#else
+            const ssize_t sent = send(client.fd, client.out.data() + client.out_sent,
+                                      client.out.size() - client.out_sent, SEND_FLAGS);
+#endif
+            if (sent > 0) {
+                client.out_sent += static_cast<size_t>(sent);
+            } else if (sent < 0 && wouldBlock()) {
+                break;
+            } else {
+                // A failed goodbye while shutting down is not a server close
+                if (running_) counters_.closed_by_server++;
+                closeClient(client);
+                return;
+            }
+        }
+        if (client.out_sent == client.out.size()) {
+            client.out.clear();
+            client.out_sent = 0;
+        } else if (client.out_sent >= MAX_BACKLOG_BYTES / 4) {
+            client.out.erase(client.out.begin(), client.out.begin() + client.out_sent);
+            client.out_sent = 0;
+        }
+        if (!poll_dirty_) fds_[client.poll_slot].events = pollEvents(client);
+    }
+
+    void receive(SimClient& client, std::vector<uint8_t>& scratch) {
+        for (;;) {
+#ifdef _WIN32
+            const int got = recv(client.fd, reinterpret_cast<char*>(scratch.data()), static_cast<int>(scratch.size()), 0);
+#else
+            const ssize_t got = recv(client.fd, scratch.data(), scratch.size(), 0);
+#endif
+            if (got > 0) {
+                counters_.bytes_received += static_cast<uint64_t>(got);
+                consume(client, scratch.data(), static_cast<size_t>(got), monotonicNowNs());
+                if (client.state != SimClient::State::OPEN || static_cast<size_t>(got) < scratch.size()) return;
+            } else if (got < 0 && wouldBlock()) {
+                return;
+            } else {
+                counters_.closed_by_server++;
+                closeClient(client);
+                return;
+            }
+        }
+    }
+
+    // Splits a read into messages, carrying an incomplete one over to the
+    // next read
+    void consume(SimClient& client, const uint8_t* data, size_t bytes, int64_t now) {
+        if (!client.partial.empty()) {
+            client.partial.insert(client.partial.end(), data, data + bytes);
+            data = client.partial.data();
+            bytes = client.partial.size();
+        }
+        size_t pos = 0;
+        while (bytes - pos >= MESSAGE_HEADER_BYTES) {
+            uint32_t size;
+            std::memcpy(&size, data + pos + 1, sizeof(size));
+            if (size > MAX_MESSAGE_BYTES) {
+                std::cerr << "Client " << client.index << ": message of " << size << " bytes, closing" << std::endl;
+                closeClient(client);
+                return;
+            }
+            if (bytes - pos - MESSAGE_HEADER_BYTES < size) break;
+            handleMessage(client, static_cast<MessageType>(data[pos]), data + pos + MESSAGE_HEADER_BYTES, size, now);
+            pos += MESSAGE_HEADER_BYTES + size;
+        }
+        if (!client.partial.empty()) {
+            client.partial.erase(client.partial.begin(), client.partial.begin() + pos);
+        } else {
+            client.partial.assign(data + pos, data + bytes);
+        }
+    }
+
+    void handleMessage(SimClient& client, MessageType type, const uint8_t* data, size_t size, int64_t now) {
+        switch (type) {
+            case MessageType::AUDIO_DATA: {
+                AudioFrameHeader header;
+                if (size < sizeof(header)) return;
+                std::memcpy(&header, data, sizeof(header));
+                if (header.flags & FRAME_FEC_MASK) return;
+
+                client.frames_received++;
+                counters_.frames_received++;
+                auto expected = client.next_sequence.find(header.sender_id);
+                if (expected == client.next_sequence.end()) {
+                    client.next_sequence.emplace(header.sender_id, header.sequence + 1);
+                } else {
+                    const int32_t gap = static_cast<int32_t>(header.sequence - expected->second);
+                    if (gap > 0) {
+                        client.frames_lost += static_cast<uint64_t>(gap);
+                        counters_.frames_lost += static_cast<uint64_t>(gap);
+                    }
+                    if (gap >= 0) expected->second = header.sequence + 1;
+                }
+                if (header.samples > 0) client.latency.record(latencyNs(header, now) / 1000);
+                break;
+            }
+
+            case MessageType::HEARTBEAT: {
+                HeartbeatPayload reply;
+                if (size < sizeof(reply)) return;
+                std::memcpy(&reply, data, sizeof(reply));
+                if (reply.flags & HEARTBEAT_REPLY) {
+                    heartbeat_rtt_.record(((now - reply.client_send) - (reply.server_send - reply.server_receive)) / 1000);
+                }
+                break;
+            }
+
+            case MessageType::CODEC_SELECT:
+                if (size >= 1 && data[0] < 32 && (builtinCodecMask() & (1u << data[0]))) {
+                    client.codec = static_cast<AudioCodec>(data[0]);
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    // Every speaker in the process counts samples from the same epoch, so
+    // the frame's last sample was captured at a known local time. The
+    // 32-bit timestamp is unwrapped against the current sample count.
+    int64_t latencyNs(const AudioFrameHeader& header, int64_t now) const {
+        const int64_t elapsed_ns = now - epoch_ns_;
+        const uint64_t elapsed = static_cast<uint64_t>(elapsed_ns * 1e-9 * config_.sample_rate);
+        const uint32_t end = header.timestamp + header.samples;
+        const int32_t behind = static_cast<int32_t>(static_cast<uint32_t>(elapsed) - end);
+        const double end_sample = static_cast<double>(static_cast<int64_t>(elapsed) - behind);
+        return elapsed_ns - static_cast<int64_t>(end_sample * 1e9 / config_.sample_rate);
+    }
+
+    void closeClient(SimClient& client) {
+        close_socket(client.fd);
+        client.fd = INVALID_SOCKET_VAL;
+        client.state = SimClient::State::CLOSED;
+        client.out.clear();
+        client.out_sent = 0;
+        client.partial.clear();
+        poll_dirty_ = true;
+    }
+
+    static short pollEvents(const SimClient& client) {
+        return static_cast<short>(POLLIN | (client.out_sent < client.out.size() ? POLLOUT : 0));
+    }
+
+    void rebuildPollSet() {
+        fds_.clear();
+        owners_.clear();
+        for (size_t i = 0; i < clients_.size(); ++i) {
+            SimClient& client = clients_[i];
+            if (client.state != SimClient::State::OPEN) continue;
+            client.poll_slot = fds_.size();
+            pollfd entry{};
+            entry.fd = client.fd;
+            entry.events = pollEvents(client);
+            fds_.push_back(entry);
+            owners_.push_back(i);
+        }
+        poll_dirty_ = false;
+    }
+
+    void publish() {
+        std::lock_guard<std::mutex> lock(published_mutex_);
+        published_ = counters_;
+    }
+};
+
+LoadGenerator::LoadGenerator(const LoadGenConfig& config)
+    : config_(config), epoch_ns_(0), started_ns_(0), stopped_ns_(0) {
+}
+
+LoadGenerator::~LoadGenerator() {
+    stop();
+}
+
+bool LoadGenerator::start() {
+    if (config_.clients == 0 || config_.frame_samples == 0 || config_.sample_rate <= 0) return false;
+    if (config_.frame_samples > JitterBuffer::MAX_FRAME_SAMPLES) {
+        std::cerr << "Frames are limited to " << JitterBuffer::MAX_FRAME_SAMPLES << " samples" << std::endl;
+        return false;
+    }
+    if (!loadVoice()) return false;
+
+    epoch_ns_ = monotonicNowNs();
+    started_ns_ = epoch_ns_;
+    const size_t loop_count = std::max<size_t>(1, std::min(config_.threads, config_.clients));
+    for (size_t i = 0; i < loop_count; ++i) {
+        loops_.emplace_back(new EventLoop(config_, voice_, epoch_ns_, static_cast<unsigned>(i + 1)));
+    }
+    // Round robin, so speakers are spread evenly over the loops
+    const int64_t ramp_ns = static_cast<int64_t>(std::max(0.0, config_.ramp_seconds) * 1e9);
+    for (size_t i = 0; i < config_.clients; ++i) {
+        const bool speaker = config_.speakers == 0 || i < config_.speakers;
+        const int64_t connect_at = epoch_ns_ + static_cast<int64_t>(static_cast<double>(ramp_ns) * i / config_.clients);
+        loops_[i % loop_count]->add(i, speaker, connect_at);
+    }
+    for (auto& loop : loops_) loop->start();
+    return true;
+}
+
+void LoadGenerator::stop() {
+    if (loops_.empty() || stopped_ns_) return;
+    for (auto& loop : loops_) loop->stop();
+    stopped_ns_ = monotonicNowNs();
+}
+
+LoadGenCounters LoadGenerator::counters() const {
+    LoadGenCounters total;
+    for (const auto& loop : loops_) total += loop->counters();
+    return total;
+}
+
+// The file is decoded once and shared by every speaker, each starting at
+// a different place in it
+bool LoadGenerator::loadVoice() {
+    voice_.clear();
+    if (!config_.source_path.empty()) {
+        WavFileSource source;
+        if (!source.open(config_.source_path)) return false;
+        if (source.sampleRate() != config_.sample_rate) {
+            std::cerr << config_.source_path << " is " << source.sampleRate() << " Hz; pass --rate "
+                      << source.sampleRate() << std::endl;
+            return false;
+        }
+        const float* block = nullptr;
+        while (size_t count = source.read(WavFileSource::MAX_BLOCK, block)) {
+            voice_.insert(voice_.end(), block, block + count);
+        }
+    } else {
+        // A buzz with a wandering pitch, shaped into syllables, over a
+        // little noise: enough spectral variety that codecs do real work
+        std::mt19937 rng(1);
+        std::normal_distribution<float> noise(0.0f, 0.01f);
+        const double two_pi = 6.283185307179586;
+        const size_t count = static_cast<size_t>(VOICE_SECONDS * config_.sample_rate);
+        voice_.resize(count);
+        double phase = 0.0;
+        for (size_t i = 0; i < count; ++i) {
+            const double t = static_cast<double>(i) / config_.sample_rate;
+            const double pitch = 140.0 + 40.0 * std::sin(two_pi * 0.7 * t);
+            const double syllable = 0.5 - 0.5 * std::cos(two_pi * 4.0 * t);
+            double buzz = 0.0;
+            for (int harmonic = 1; harmonic <= 8; ++harmonic) buzz += std::sin(harmonic * phase) / harmonic;
+            voice_[i] = static_cast<float>(0.2 * syllable * buzz) + noise(rng);
+            phase = std::fmod(phase + two_pi * pitch / config_.sample_rate, two_pi);
+        }
+    }
+
+    // Speakers read whole frames and wrap around
+    voice_.resize(voice_.size() / config_.frame_samples * config_.frame_samples);
+    if (voice_.empty()) {
+        std::cerr << "Need at least one frame of audio to speak" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void LoadGenerator::printSummary(std::ostream& out) const {
+    const LoadGenCounters total = counters();
+    const double seconds = std::max(1e-3, (stopped_ns_ - started_ns_) * 1e-9);
+
+    LatencyHistogram latency;
+    LatencyHistogram send_lag;
+    LatencyHistogram heartbeat_rtt;
+    std::vector<std::pair<uint64_t, size_t>> client_p99;    // p99 in us, client index
+    std::vector<uint64_t> client_frames;
+    for (const auto& loop : loops_) {
+        send_lag.merge(loop->sendLag());
+        heartbeat_rtt.merge(loop->heartbeatRtt());
+        for (const SimClient& client : loop->clients()) {
+            latency.merge(client.latency);
+            client_frames.push_back(client.frames_received);
+            if (client.latency.count() > 0) client_p99.emplace_back(client.latency.percentileUs(0.99), client.index);
+        }
+    }
+
+    out << "Clients: " << total.connected << " connected, " << total.connect_failures << " failed to connect, "
+        << total.closed_by_server << " closed by the server" << std::endl;
+    out << "Sent: " << total.frames_sent << " frames and " << total.descriptors_sent << " descriptors ("
+        << static_cast<uint64_t>(total.frames_sent / seconds) << " frames/s, "
+        << fixed2(total.bytes_sent / seconds / 1e6) << " MB/s), "
+        << total.send_drops << " dropped" << std::endl;
+    const double loss = total.frames_received + total.frames_lost
+                      ? 100.0 * total.frames_lost / (total.frames_received + total.frames_lost) : 0.0;
+    out << "Received: " << total.frames_received << " frames ("
+        << static_cast<uint64_t>(total.frames_received / seconds) << " frames/s, "
+        << fixed2(total.bytes_received / seconds / 1e6) << " MB/s), "
+        << total.frames_lost << " lost (" << loss << "%)" << std::endl;
+
+    if (latency.count() > 0) {
+        out << "Latency, capture to receipt (ms): p50 " << formatMs(latency.percentileUs(0.5))
+            << ", p90 " << formatMs(latency.percentileUs(0.9))
+            << ", p99 " << formatMs(latency.percentileUs(0.99))
+            << ", p99.9 " << formatMs(latency.percentileUs(0.999))
+            << ", max " << formatMs(latency.maxUs()) << std::endl;
+        std::sort(client_p99.begin(), client_p99.end());
+        out << "Per-client p99 (ms): best " << formatMs(client_p99.front().first)
+            << ", median " << formatMs(client_p99[client_p99.size() / 2].first)
+            << ", worst " << formatMs(client_p99.back().first) << " (client " << client_p99.back().second << ")"
+            << std::endl;
+    }
+    if (!client_frames.empty()) {
+        std::sort(client_frames.begin(), client_frames.end());
+        out << "Frames per client: min " << client_frames.front() << ", median "
+            << client_frames[client_frames.size() / 2] << ", max " << client_frames.back() << std::endl;
+    }
+    if (heartbeat_rtt.count() > 0) {
+        out << "Heartbeat round trip (ms): p50 " << formatMs(heartbeat_rtt.percentileUs(0.5))
+            << ", p99 " << formatMs(heartbeat_rtt.percentileUs(0.99)) << std::endl;
+    }
+    if (send_lag.count() > 0) {
+        out << "Send lag (ms): p99 " << formatMs(send_lag.percentileUs(0.99))
+            << ", max " << formatMs(send_lag.maxUs()) << std::endl;
+        const uint64_t frame_us = static_cast<uint64_t>(config_.frame_samples * 1e6 / config_.sample_rate);
+        if (send_lag.percentileUs(0.99) > frame_us) {
+            out << "The load generator fell behind, so latency includes its own delay; "
+                   "use more --threads or fewer clients" << std::endl;
+        }
+    }
+}
@@ -0,0 +1,384 @@
+#include "LosslessCodec.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+enum BlockMethod : uint8_t {
+    // 0 to 4 are the fixed predictors of that order
+    METHOD_LPC = 5,
+    METHOD_VERBATIM = 6,
+    METHOD_CONSTANT = 7
+};
+
+constexpr size_t FIXED_ORDERS = 5;
+constexpr size_t PARTITION = 64;
+constexpr unsigned RICE_PARAM_BITS = 5;
+constexpr unsigned MAX_RICE_PARAM = 30;
+// Quotients this large are sent as ESCAPE zeros and the raw 32-bit value
+constexpr uint32_t ESCAPE = 24;
+constexpr int LPC_PRECISION = 15;   // coefficient bits including sign
+constexpr double PI = 3.14159265358979323846;
+
+// Fixed predictors as LPC coefficients with no shift
+const int16_t FIXED_COEFFS[FIXED_ORDERS][4] = {
+    {0, 0, 0, 0},
+    {1, 0, 0, 0},
+    {2, -1, 0, 0},
+    {3, -3, 1, 0},
+    {4, -6, 4, -1},
+};
+
+struct Predictor {
+    size_t order = 0;
+    int shift = 0;
+    int16_t coeffs[LOSSLESS_MAX_ORDER] = {};
+};
+
+inline uint32_t zigzag(int32_t e) {
+    return (static_cast<uint32_t>(e) << 1) ^ static_cast<uint32_t>(e >> 31);
+}
+
+inline int32_t unzigzag(uint32_t v) {
+    return static_cast<int32_t>(v >> 1) ^ -static_cast<int32_t>(v & 1);
+}
+
+inline int64_t predict(const Predictor& p, const int32_t* x, size_t i) {
+    int64_t acc = 0;
+    for (size_t j = 0; j < p.order; ++j) acc += static_cast<int64_t>(p.coeffs[j]) * x[i - 1 - j];
+    return acc >> p.shift;
+}
+
+// Residuals of samples [order, n). False if one does not fit 32 bits.
+bool residuals(const Predictor& p, const int32_t* x, size_t n, uint32_t* out) {
+    for (size_t i = p.order; i < n; ++i) {
+        const int64_t e = x[i] - predict(p, x, i);
+        if (e < INT32_MIN || e > INT32_MAX) return false;
+        out[i - p.order] = zigzag(static_cast<int32_t>(e));
+    }
+    return true;
+}
+
+unsigned riceParam(const uint32_t* v, size_t n) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; ++i) sum += v[i];
+    unsigned k = 0;
+    while (k < MAX_RICE_PARAM && (static_cast<uint64_t>(n) << (k + 1)) <= sum) ++k;
+    return k;
+}
+
+uint64_t riceBits(const uint32_t* v, size_t n, unsigned k) {
+    uint64_t bits = RICE_PARAM_BITS;
+    for (size_t i = 0; i < n; ++i) {
+        const uint32_t q = v[i] >> k;
+        bits += q < ESCAPE ? q + 1 + k : ESCAPE + 32;
+    }
+    return bits;
+}
+
+uint64_t residualBits(const uint32_t* v, size_t n) {
+    uint64_t bits = 0;
+    for (size_t base = 0; base < n; base += PARTITION) {
+        const size_t count = std::min(PARTITION, n - base);
+        bits += riceBits(v + base, count, riceParam(v + base, count));
+    }
+    return bits;
+}
+
+size_t headerBytes(const Predictor& p, bool lpc) {
+    return 1 + (lpc ? 2 + 2 * p.order : 0) + 3 * p.order;
+}
+
+inline double hann(size_t i, size_t n) {
+    return 0.5 - 0.5 * std::cos(2.0 * PI * (i + 0.5) / n);
+}
+
+// Quantised LPC from the windowed autocorrelation. False for signals it
+// cannot model, e.g. too short or all zero.
+bool computeLpc(const int32_t* x, size_t n, Predictor& p) {
+    const size_t order = std::min(LOSSLESS_MAX_ORDER, n / 4);
+    if (order == 0) return false;
+
+    // Full blocks are the common case; their window is computed once
+    static const struct Window {
+        double w[LOSSLESS_BLOCK];
+        Window() { for (size_t i = 0; i < LOSSLESS_BLOCK; ++i) w[i] = hann(i, LOSSLESS_BLOCK); }
+    } full;
+    double windowed[LOSSLESS_BLOCK];
+    for (size_t i = 0; i < n; ++i) {
+        windowed[i] = (n == LOSSLESS_BLOCK ? full.w[i] : hann(i, n)) * x[i];
+    }
+    double r[LOSSLESS_MAX_ORDER + 1];
+    for (size_t lag = 0; lag <= order; ++lag) {
+        double acc = 0.0;
+        for (size_t i = lag; i < n; ++i) acc += windowed[i] * windowed[i - lag];
+        r[lag] = acc;
+    }
+    if (r[0] <= 0.0) return false;
+
+    // Levinson-Durbin for x[i] ~ sum c[j] x[i-1-j]
+    double c[LOSSLESS_MAX_ORDER] = {};
+    double previous[LOSSLESS_MAX_ORDER];
+    double error = r[0] * (1.0 + 1e-9);
+    for (size_t i = 0; i < order; ++i) {
+        double acc = r[i + 1];
+        for (size_t j = 0; j < i; ++j) acc -= c[j] * r[i - j];
+        const double k = acc / error;
+        std::copy(c, c + i, previous);
+        for (size_t j = 0; j < i; ++j) c[j] = previous[j] - k * previous[i - 1 - j];
+        c[i] = k;
+        error *= 1.0 - k * k;
+        if (error <= 0.0) return false;
+    }
+
+    double cmax = 0.0;
+    for (size_t j = 0; j < order; ++j) cmax = std::max(cmax, std::fabs(c[j]));
+    if (cmax <= 0.0) return false;
+    int shift = 0;
+    const double limit = (1 << (LPC_PRECISION - 1)) - 1;
+    while (shift < 15 && cmax * (1 << (shift + 1)) <= limit) ++shift;
+    if (cmax * (1 << shift) > limit) return false;
+
+    p.order = order;
+    p.shift = shift;
+    for (size_t j = 0; j < order; ++j) {
+        p.coeffs[j] = static_cast<int16_t>(std::lrint(c[j] * (1 << shift)));
+    }
+    return true;
+}
+
+class BitWriter {
+  public:
+    explicit BitWriter(uint8_t* out) : out_(out), pos_(0), acc_(0), bits_(0) {}
+
+    void put(uint32_t value, unsigned count) {
+        if (count > 24) {
+            put(value >> 16, count - 16);
+            put(value & 0xFFFF, 16);
+            return;
+        }
+        acc_ = (acc_ << count) | (value & ((1u << count) - 1));
+        bits_ += count;
+        while (bits_ >= 8) {
+            bits_ -= 8;
+            out_[pos_++] = static_cast<uint8_t>(acc_ >> bits_);
+        }
+    }
+
+    void zeros(uint32_t count) {
+        while (count >= 16) {
+            put(0, 16);
+            count -= 16;
+        }
+        if (count > 0) put(0, count);
+    }
+
+    // Pads to a byte boundary and returns the bytes written
+    size_t finish() {
+        if (bits_ > 0) put(0, 8 - bits_);
+        return pos_;
+    }
+
+  private:
+    uint8_t* out_;
+    size_t pos_;
+    uint64_t acc_;
+    unsigned bits_;
+};
+
+class BitReader {
+  public:
+    BitReader(const uint8_t* in, size_t bytes) : in_(in), bytes_(bytes), pos_(0), acc_(0), bits_(0) {}
+
+    bool get(unsigned count, uint32_t& value) {
+        if (count > 24) {
+            uint32_t high, low;
+            if (!get(count - 16, high) || !get(16, low)) return false;
+            value = high << 16 | low;
+            return true;
+        }
+        while (bits_ < count) {
+            if (pos_ == bytes_) return false;
+            acc_ = (acc_ << 8) | in_[pos_++];
+            bits_ += 8;
+        }
+        bits_ -= count;
+        value = static_cast<uint32_t>(acc_ >> bits_) & ((1u << count) - 1);
+        return true;
+    }
+
+    bool bit(uint32_t& value) { return get(1, value); }
+
+    size_t consumed() const { return pos_; }
+
+  private:
+    const uint8_t* in_;
+    size_t bytes_;
+    size_t pos_;
+    uint64_t acc_;
+    unsigned bits_;
+};
+
+void writeInt24(uint8_t* out, int32_t v) {
+    out[0] = static_cast<uint8_t>(v);
+    out[1] = static_cast<uint8_t>(v >> 8);
+    out[2] = static_cast<uint8_t>(v >> 16);
+}
+
+int32_t readInt24(const uint8_t* in) {
+    const uint32_t u = static_cast<uint32_t>(in[0]) << 8 | static_cast<uint32_t>(in[1]) << 16 |
+                       static_cast<uint32_t>(in[2]) << 24;
+    return static_cast<int32_t>(u) >> 8;
+}
+
+size_t encodeBlock(const int32_t* x, size_t n, uint8_t* out) {
+    if (std::all_of(x, x + n, [x](int32_t v) { return v == x[0]; })) {
+        out[0] = METHOD_CONSTANT;
+        writeInt24(out + 1, x[0]);
+        return 4;
+    }
+
+    uint32_t residual[LOSSLESS_BLOCK];
+    Predictor best;
+    bool best_lpc = false;
+    uint64_t best_bits = 8 * (1 + 3 * n);   // verbatim
+
+    auto consider = [&](const Predictor& p, bool lpc) {
+        if (p.order >= n || !residuals(p, x, n, residual)) return;
+        const uint64_t bits = 8 * headerBytes(p, lpc) + residualBits(residual, n - p.order) + 7;
+        if (bits < best_bits) {
+            best_bits = bits;
+            best = p;
+            best_lpc = lpc;
+        }
+    };
+
+    for (size_t order = 0; order < FIXED_ORDERS; ++order) {
+        Predictor p;
+        p.order = order;
+        std::copy(FIXED_COEFFS[order], FIXED_COEFFS[order] + order, p.coeffs);
+        consider(p, false);
+    }
+    Predictor lpc;
+    if (computeLpc(x, n, lpc)) consider(lpc, true);
+
+    if (best_bits == 8 * (1 + 3 * n)) {
+        out[0] = METHOD_VERBATIM;
+        for (size_t i = 0; i < n; ++i) writeInt24(out + 1 + 3 * i, x[i]);
+        return 1 + 3 * n;
+    }
+
+    size_t pos = 0;
+    if (best_lpc) {
+        out[pos++] = METHOD_LPC;
+        out[pos++] = static_cast<uint8_t>(best.order);
+        out[pos++] = static_cast<uint8_t>(best.shift);
+        for (size_t j = 0; j < best.order; ++j) {
+            const uint16_t c = static_cast<uint16_t>(best.coeffs[j]);
+            out[pos++] = static_cast<uint8_t>(c);
+            out[pos++] = static_cast<uint8_t>(c >> 8);
+        }
+    } else {
+        out[pos++] = static_cast<uint8_t>(best.order);
+    }
+    for (size_t i = 0; i < best.order; ++i, pos += 3) writeInt24(out + pos, x[i]);
+
+    residuals(best, x, n, residual);
+    BitWriter writer(out + pos);
+    const size_t count = n - best.order;
+    for (size_t base = 0; base < count; base += PARTITION) {
+        const size_t part = std::min(PARTITION, count - base);
+        const unsigned k = riceParam(residual + base, part);
+        writer.put(k, RICE_PARAM_BITS);
+        for (size_t i = base; i < base + part; ++i) {
+            const uint32_t q = residual[i] >> k;
+            if (q < ESCAPE) {
+                writer.zeros(q);
+                writer.put(1, 1);
+                if (k > 0) writer.put(residual[i], k);
+            } else {
+                writer.zeros(ESCAPE);
+                writer.put(residual[i], 32);
+            }
+        }
+    }
+    return pos + writer.finish();
+}
+
+// Returns the bytes consumed, 0 if malformed
+size_t decodeBlock(const uint8_t* in, size_t bytes, int32_t* x, size_t n) {
+    if (bytes < 1) return 0;
+    const uint8_t method = in[0];
+
+    if (method == METHOD_CONSTANT) {
+        if (bytes < 4) return 0;
+        std::fill(x, x + n, readInt24(in + 1));
+        return 4;
+    }
+    if (method == METHOD_VERBATIM) {
+        if (bytes < 1 + 3 * n) return 0;
+        for (size_t i = 0; i < n; ++i) x[i] = readInt24(in + 1 + 3 * i);
+        return 1 + 3 * n;
+    }
+
+    Predictor p;
+    size_t pos = 1;
+    if (method == METHOD_LPC) {
+        if (bytes < 3) return 0;
+        p.order = in[1];
+        p.shift = in[2];
+        pos = 3;
+        if (p.order == 0 || p.order > LOSSLESS_MAX_ORDER || p.shift > 15 || bytes < pos + 2 * p.order) return 0;
+        for (size_t j = 0; j < p.order; ++j, pos += 2) {
+            p.coeffs[j] = static_cast<int16_t>(in[pos] | in[pos + 1] << 8);
+        }
+    } else if (method < FIXED_ORDERS) {
+        p.order = method;
+        std::copy(FIXED_COEFFS[method], FIXED_COEFFS[method] + p.order, p.coeffs);
+    } else {
+        return 0;
+    }
+    if (p.order >= n || bytes < pos + 3 * p.order) return 0;
+    for (size_t i = 0; i < p.order; ++i, pos += 3) x[i] = readInt24(in + pos);
+
+    BitReader reader(in + pos, bytes - pos);
+    for (size_t base = p.order; base < n; base += PARTITION) {
+        const size_t end = std::min(base + PARTITION, n);
+        uint32_t k;
+        if (!reader.get(RICE_PARAM_BITS, k) || k > MAX_RICE_PARAM) return 0;
+        for (size_t i = base; i < end; ++i) {
+            uint32_t q = 0, b = 0;
+            while (q < ESCAPE) {
+                if (!reader.bit(b)) return 0;
+                if (b) break;
+                ++q;
+            }
+            uint32_t v;
+            if (q == ESCAPE) {
+                if (!reader.get(32, v)) return 0;
+            } else {
+                uint32_t low = 0;
+                if (k > 0 && !reader.get(k, low)) return 0;
+                v = q << k | low;
+            }
+            x[i] = static_cast<int32_t>(predict(p, x, i) + unzigzag(v));
+        }
+    }
+    return pos + reader.consumed();
+}
+
+} // namespace
+
+size_t losslessMaxBytes(size_t n) {
+    const size_t blocks = (n + LOSSLESS_BLOCK - 1) / LOSSLESS_BLOCK;
+    return blocks + 3 * n;
+}
+
+size_t encodeLosslessBlock(const int32_t* samples, size_t n, uint8_t* out) {
+    return n == 0 || n > LOSSLESS_BLOCK ? 0 : encodeBlock(samples, n, out);
+}
+
+size_t decodeLosslessBlock(const uint8_t* in, size_t bytes, int32_t* samples, size_t n) {
+    return n == 0 || n > LOSSLESS_BLOCK ? 0 : decodeBlock(in, bytes, samples, n);
+}
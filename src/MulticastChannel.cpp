@@ -0,0 +1,200 @@
+#include "MulticastChannel.h"
+#include <iostream>
+#include <cstring>
+
+#ifndef _WIN32
+    #include <sys/select.h>
+#endif
+
+namespace {
+
+// Type byte and size word, as on the TCP stream
+constexpr size_t FRAMING_BYTES = 1 + sizeof(uint32_t);
+
+template <typename T>
+bool setOption(SOCKET socket_fd, int level, int name, const T& value) {
+    return setsockopt(socket_fd, level, name, reinterpret_cast<const char*>(&value), sizeof(value)) == 0;
+}
+
+} // namespace
+
+MulticastChannel::MulticastChannel()
+    : socket_(INVALID_SOCKET_VAL), group_addr_{}, send_buffer_(MAX_DATAGRAM + FRAMING_BYTES),
+      receive_buffer_(MAX_DATAGRAM + FRAMING_BYTES) {
+}
+
+MulticastChannel::~MulticastChannel() {
+    close();
+}
+
+bool MulticastChannel::parseGroup(const std::string& spec, std::string& group, int& port) {
+    const size_t colon = spec.rfind(':');
+    group = spec.substr(0, colon);
+    if (colon != std::string::npos) {
+        try {
+            port = std::stoi(spec.substr(colon + 1));
+        } catch (...) {
+            return false;
+        }
+    }
+
+    in_addr addr{};
+    if (inet_pton(AF_INET, group.c_str(), &addr) <= 0) return false;
+    // 224.0.0.0/4
+    return (ntohl(addr.s_addr) >> 28) == 0xE && port > 0 && port < 65536;
+}
+
+bool MulticastChannel::resolveInterface(const std::string& interface_address, in_addr& out) {
+    out.s_addr = htonl(INADDR_ANY);
+    if (interface_address.empty()) return true;
+    if (inet_pton(AF_INET, interface_address.c_str(), &out) <= 0) {
+        std::cerr << "Invalid multicast interface address " << interface_address << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool MulticastChannel::openSender(const std::string& group, int port, int ttl,
+                                  const std::string& interface_address) {
+    close();
+
+    group_addr_ = sockaddr_in{};
+    group_addr_.sin_family = AF_INET;
+    group_addr_.sin_port = htons(static_cast<uint16_t>(port));
+    in_addr interface_addr;
+    if (inet_pton(AF_INET, group.c_str(), &group_addr_.sin_addr) <= 0 ||
+        !resolveInterface(interface_address, interface_addr)) {
+        std::cerr << "Invalid multicast group " << group << std::endl;
+        return false;
+    }
+
+    socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (socket_ == INVALID_SOCKET_VAL) {
+        std::cerr << "Failed to create multicast socket" << std::endl;
+        return false;
+    }
+
+    // Listeners on the server's own host hear the group too
+#ifdef _WIN32
+    const DWORD hops = static_cast<DWORD>(ttl);
+    const DWORD loop = 1;
+#else
+    const unsigned char hops = static_cast<unsigned char>(ttl);
+    const unsigned char loop = 1;
+#endif
+    if (!setOption(socket_, IPPROTO_IP, IP_MULTICAST_TTL, hops) ||
+        !setOption(socket_, IPPROTO_IP, IP_MULTICAST_LOOP, loop) ||
+        (!interface_address.empty() && !setOption(socket_, IPPROTO_IP, IP_MULTICAST_IF, interface_addr))) {
+        std::cerr << "Failed to configure multicast socket" << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool MulticastChannel::join(uint32_t group, int port, const std::string& interface_address) {
+    close();
+
+    group_addr_ = sockaddr_in{};
+    group_addr_.sin_family = AF_INET;
+    group_addr_.sin_port = htons(static_cast<uint16_t>(port));
+    group_addr_.sin_addr.s_addr = group;
+
+    ip_mreq membership{};
+    membership.imr_multiaddr.s_addr = group;
+    if (!resolveInterface(interface_address, membership.imr_interface)) return false;
+
+    socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (socket_ == INVALID_SOCKET_VAL) {
+        std::cerr << "Failed to create multicast socket" << std::endl;
+        return false;
+    }
+
+    // Several clients on one host share the group's port
+    const int reuse = 1;
+    setOption(socket_, SOL_SOCKET, SO_REUSEADDR, reuse);
+#ifdef SO_REUSEPORT
+    setOption(socket_, SOL_SOCKET, SO_REUSEPORT, reuse);
+#endif
+#ifdef IP_MULTICAST_ALL
+    // Only this group, not every group joined on the host with this port
+    const int all = 0;
+    setOption(socket_, IPPROTO_IP, IP_MULTICAST_ALL, all);
+#endif
+
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = group_addr_.sin_port;
+    if (bind(socket_, reinterpret_cast<sockaddr*>(&local), sizeof(local)) == SOCKET_ERROR_VAL) {
+        std::cerr << "Failed to bind multicast port " << port << std::endl;
+        close();
+        return false;
+    }
+    if (!setOption(socket_, IPPROTO_IP, IP_ADD_MEMBERSHIP, membership)) {
+        std::cerr << "Failed to join multicast group " << describe() << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MulticastChannel::close() {
+    if (socket_ != INVALID_SOCKET_VAL) {
+        ::close_socket(socket_);   // not this->close()
+        socket_ = INVALID_SOCKET_VAL;
+    }
+}
+
+bool MulticastChannel::send(const Message& message) {
+    if (socket_ == INVALID_SOCKET_VAL || message.size > MAX_DATAGRAM - FRAMING_BYTES ||
+        message.data.size() < message.size) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    send_buffer_[0] = static_cast<uint8_t>(message.type);
+    std::memcpy(send_buffer_.data() + 1, &message.size, sizeof(message.size));
+    if (message.size > 0) {
+        std::memcpy(send_buffer_.data() + FRAMING_BYTES, message.data.data(), message.size);
+    }
+    const size_t bytes = FRAMING_BYTES + message.size;
+    return sendto(socket_, reinterpret_cast<const char*>(send_buffer_.data()), static_cast<int>(bytes), 0,
+                  reinterpret_cast<const sockaddr*>(&group_addr_), sizeof(group_addr_)) ==
+           static_cast<int>(bytes);
+}
+
+bool MulticastChannel::receive(Message& message, int timeout_ms) {
+    if (socket_ == INVALID_SOCKET_VAL) return false;
+
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(socket_, &readable);
+    timeval timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_usec = (timeout_ms % 1000) * 1000;
+    if (select(static_cast<int>(socket_) + 1, &readable, nullptr, nullptr, &timeout) <= 0) return false;
+
+#ifdef _WIN32
+    const int received = recv(socket_, reinterpret_cast<char*>(receive_buffer_.data()),
+                              static_cast<int>(receive_buffer_.size()), 0);
+#else
+    const ssize_t received = recv(socket_, receive_buffer_.data(), receive_buffer_.size(), 0);
+#endif
+    if (received < static_cast<int>(FRAMING_BYTES)) return false;
+
+    uint32_t size;
+    std::memcpy(&size, receive_buffer_.data() + 1, sizeof(size));
+    if (size != static_cast<size_t>(received) - FRAMING_BYTES) return false;
+
+    message.type = static_cast<MessageType>(receive_buffer_[0]);
+    message.size = size;
+    message.data.assign(receive_buffer_.begin() + FRAMING_BYTES, receive_buffer_.begin() + received);
+    return true;
+}
+
+std::string MulticastChannel::describe() const {
+    char address[INET_ADDRSTRLEN] = "";
+    inet_ntop(AF_INET, &group_addr_.sin_addr, address, sizeof(address));
+    return std::string(address) + ":" + std::to_string(port());
+}
@@ -0,0 +1,203 @@
+#include "NetworkImpairment.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace {
+
+// Tail index of the Pareto delays: heavy, but with a finite variance
+constexpr double PARETO_SHAPE = 3.0;
+// Longest added delay, in multiples of the jitter
+constexpr double MAX_JITTER_MULTIPLE = 20.0;
+
+bool parsePercent(const std::string& value, double& probability) {
+    try {
+        const double percent = std::stod(value);
+        if (percent < 0.0 || percent > 100.0) return false;
+        probability = percent / 100.0;
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+bool parseNonNegative(const std::string& value, double& out) {
+    try {
+        out = std::stod(value);
+        return out >= 0.0;
+    } catch (...) {
+        return false;
+    }
+}
+
+} // namespace
+
+const char* delayDistributionName(DelayDistribution distribution) {
+    switch (distribution) {
+        case DelayDistribution::UNIFORM: return "uniform";
+        case DelayDistribution::NORMAL: return "normal";
+        case DelayDistribution::PARETO: return "pareto";
+    }
+    return "unknown";
+}
+
+bool ImpairmentConfig::active() const {
+    return delay_ms > 0.0 || jitter_ms > 0.0 || loss > 0.0 || burst_enter > 0.0 || reorder > 0.0 ||
+           duplicate > 0.0 || rate_kbps > 0.0;
+}
+
+std::string ImpairmentConfig::describe() const {
+    std::ostringstream out;
+    out << "delay " << delay_ms << " ms, jitter " << jitter_ms << " ms " << delayDistributionName(distribution)
+        << ", loss " << loss * 100 << "%";
+    if (burst_enter > 0.0) {
+        out << ", bursts " << burst_enter * 100 << "%/" << burst_exit * 100 << "% losing " << burst_loss * 100 << "%";
+    }
+    if (reorder > 0.0) out << ", reorder " << reorder * 100 << "% by " << reorder_hold_ms << " ms";
+    if (duplicate > 0.0) out << ", duplicate " << duplicate * 100 << "%";
+    if (rate_kbps > 0.0) out << ", " << rate_kbps << " kbit/s";
+    out << ", seed " << seed;
+    return out.str();
+}
+
+bool parseImpairment(const std::string& spec, ImpairmentConfig& config) {
+    std::istringstream items(spec);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        if (item.empty()) continue;
+        const size_t equals = item.find('=');
+        if (equals == std::string::npos) return false;
+        const std::string key = item.substr(0, equals);
+        const std::string value = item.substr(equals + 1);
+
+        bool ok = true;
+        if (key == "delay") {
+            ok = parseNonNegative(value, config.delay_ms);
+        } else if (key == "jitter") {
+            ok = parseNonNegative(value, config.jitter_ms);
+        } else if (key == "dist") {
+            if (value == "uniform") config.distribution = DelayDistribution::UNIFORM;
+            else if (value == "normal") config.distribution = DelayDistribution::NORMAL;
+            else if (value == "pareto") config.distribution = DelayDistribution::PARETO;
+            else ok = false;
+        } else if (key == "loss") {
+            ok = parsePercent(value, config.loss);
+        } else if (key == "burst") {
+            const size_t colon = value.find(':');
+            ok = colon != std::string::npos && parsePercent(value.substr(0, colon), config.burst_enter) &&
+                 parsePercent(value.substr(colon + 1), config.burst_exit);
+        } else if (key == "burst-loss") {
+            ok = parsePercent(value, config.burst_loss);
+        } else if (key == "reorder") {
+            ok = parsePercent(value, config.reorder);
+        } else if (key == "hold") {
+            ok = parseNonNegative(value, config.reorder_hold_ms);
+        } else if (key == "dup") {
+            ok = parsePercent(value, config.duplicate);
+        } else if (key == "rate") {
+            ok = parseNonNegative(value, config.rate_kbps);
+        } else if (key == "seed") {
+            try {
+                config.seed = std::stoull(value);
+            } catch (...) {
+                ok = false;
+            }
+        } else {
+            ok = false;
+        }
+        if (!ok) return false;
+    }
+    // A bad state that is never left would lose everything from then on
+    return config.burst_enter == 0.0 || config.burst_exit > 0.0;
+}
+
+ImpairmentStats& ImpairmentStats::operator+=(const ImpairmentStats& other) {
+    messages += other.messages;
+    dropped += other.dropped;
+    duplicated += other.duplicated;
+    reordered += other.reordered;
+    delayed_ns += other.delayed_ns;
+    return *this;
+}
+
+NetworkImpairment::NetworkImpairment(const ImpairmentConfig& config, uint64_t link)
+    : config_(config), bad_state_(false), link_free_ns_(0), last_due_ns_(0) {
+    // Each link gets its own stream, fixed by the seed
+    std::seed_seq seed{static_cast<uint32_t>(config.seed), static_cast<uint32_t>(config.seed >> 32),
+                       static_cast<uint32_t>(link), static_cast<uint32_t>(link >> 32)};
+    random_.seed(seed);
+}
+
+// The standard distributions differ between libraries; everything is
+// derived from the raw generator so a seed means the same on all of them
+double NetworkImpairment::uniform() {
+    return static_cast<double>(random_() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+int64_t NetworkImpairment::addedDelayNs() {
+    double added_ms = 0.0;
+    const double jitter = config_.jitter_ms;
+    if (jitter > 0.0) {
+        switch (config_.distribution) {
+            case DelayDistribution::UNIFORM:
+                added_ms = 2.0 * jitter * uniform();
+                break;
+            case DelayDistribution::NORMAL: {
+                // Box-Muller; 1 - u keeps the logarithm finite
+                const double radius = std::sqrt(-2.0 * std::log(1.0 - uniform()));
+                added_ms = jitter + 0.5 * jitter * radius * std::cos(6.283185307179586 * uniform());
+                break;
+            }
+            case DelayDistribution::PARETO: {
+                const double scale = jitter * (PARETO_SHAPE - 1.0) / PARETO_SHAPE;
+                added_ms = scale / std::pow(1.0 - uniform(), 1.0 / PARETO_SHAPE);
+                break;
+            }
+        }
+        added_ms = std::min(std::max(added_ms, 0.0), MAX_JITTER_MULTIPLE * jitter);
+    }
+    return static_cast<int64_t>((config_.delay_ms + added_ms) * 1e6);
+}
+
+bool NetworkImpairment::lose() {
+    if (config_.burst_enter > 0.0) {
+        const double change = uniform();
+        if (bad_state_ ? change < config_.burst_exit : change < config_.burst_enter) bad_state_ = !bad_state_;
+    }
+    return uniform() < (bad_state_ ? config_.burst_loss : config_.loss);
+}
+
+size_t NetworkImpairment::plan(bool media, size_t bytes, int64_t now_ns, int64_t due[MAX_DELIVERIES]) {
+    stats_.messages++;
+    if (media && lose()) {
+        stats_.dropped++;
+        return 0;
+    }
+
+    // The cap queues messages behind each other, lost ones never take the link
+    int64_t sent_ns = now_ns;
+    if (config_.rate_kbps > 0.0) {
+        const int64_t transmit_ns = static_cast<int64_t>(bytes * 8.0 / config_.rate_kbps * 1e6);
+        link_free_ns_ = std::max(link_free_ns_, now_ns) + transmit_ns;
+        sent_ns = link_free_ns_;
+    }
+
+    int64_t arrival_ns = sent_ns + addedDelayNs();
+    if (media && uniform() < config_.reorder) {
+        // Later messages keep their own timing and overtake this one
+        arrival_ns += static_cast<int64_t>(config_.reorder_hold_ms * 1e6);
+        stats_.reordered++;
+    } else {
+        arrival_ns = std::max(arrival_ns, last_due_ns_);
+        last_due_ns_ = arrival_ns;
+    }
+    stats_.delayed_ns += static_cast<uint64_t>(arrival_ns - now_ns);
+
+    due[0] = arrival_ns;
+    if (media && uniform() < config_.duplicate) {
+        stats_.duplicated++;
+        due[1] = arrival_ns;
+        return 2;
+    }
+    return 1;
+}
@@ -1,9 +1,36 @@
 #include "NetworkManager.h"
+#include "ThreadPolicy.h"
 #include <iostream>
 #include <cstring>
+#include <chrono>
+
+#ifndef _WIN32
+  #include <poll.h>
+#endif
+
+namespace {
+
+int64_t steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Type and size precede every payload
+constexpr size_t MESSAGE_HEADER_BYTES = sizeof(uint8_t) + sizeof(uint32_t);
+
+// A peer that vanishes mid-send is an error return, not a process-killing
+// SIGPIPE
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+} // namespace
 
 NetworkManager::NetworkManager() 
-    : server_socket_(INVALID_SOCKET_VAL), client_socket_(INVALID_SOCKET_VAL), is_server_(false), running_(false) {
+    : server_socket_(INVALID_SOCKET_VAL), client_socket_(INVALID_SOCKET_VAL), is_server_(false), running_(false), logger_(nullptr),
+      outgoing_order_(0), links_opened_(0), delivery_stop_(false) {
     initializeNetworking();
 }
 
@@ -31,7 +58,7 @@ void NetworkManager::cleanupNetworking() {
 #endif
 }
 
-bool NetworkManager::connectToServer(const std::string& host, int port) {
+bool NetworkManager::connectToServer(const std::string& host, int port, const std::vector<uint8_t>& hello) {
     client_socket_ = socket(AF_INET, SOCK_STREAM, 0);
     if (client_socket_ == INVALID_SOCKET_VAL) {
         std::cerr << "Failed to create socket" << std::endl;
@@ -53,6 +80,8 @@ bool NetworkManager::connectToServer(const std::string& host, int port) {
         return false;
     }
 
+    disableNagle(client_socket_);
+
     if (connect(client_socket_, (struct sockaddr*)&server_addr, sizeof(server_addr)) == SOCKET_ERROR_VAL) {
         std::cerr << "Connection failed" << std::endl;
         close_socket(client_socket_);
@@ -63,24 +92,38 @@ bool NetworkManager::connectToServer(const std::string& host, int port) {
     // Send connect message
     Message connect_msg;
     connect_msg.type = MessageType::CONNECT;
-    connect_msg.size = 0;
+    connect_msg.size = static_cast<uint32_t>(hello.size());
+    connect_msg.data = hello;
     
     return sendMessage(connect_msg, client_socket_);
 }
 
 void NetworkManager::disconnect() {
+    // Whatever the emulated network still holds goes ahead of the goodbye
+    stopDelivery(true);
     if (client_socket_ != INVALID_SOCKET_VAL) {
         // Send disconnect message
         Message disconnect_msg;
         disconnect_msg.type = MessageType::DISCONNECT;
         disconnect_msg.size = 0;
-        sendMessage(disconnect_msg, client_socket_);
+        sendNow(disconnect_msg, client_socket_);
+        forgetLink(client_socket_);
         
         close_socket(client_socket_);
         client_socket_ = INVALID_SOCKET_VAL;
     }
 }
 
+void NetworkManager::stopReceiving() {
+    if (client_socket_ != INVALID_SOCKET_VAL) {
+#ifdef _WIN32
+        shutdown(client_socket_, SD_RECEIVE);
+#else
+        shutdown(client_socket_, SHUT_RD);
+#endif
+    }
+}
+
 bool NetworkManager::startServer(int port) {
     server_socket_ = socket(AF_INET, SOCK_STREAM, 0);
     if (server_socket_ == INVALID_SOCKET_VAL) {
@@ -125,8 +168,15 @@ bool NetworkManager::startServer(int port) {
 
 void NetworkManager::stopServer() {
     running_ = false;
+    stopDelivery(false);
     
     if (server_socket_ != INVALID_SOCKET_VAL) {
+        // Closing alone does not wake a thread blocked in accept() on Linux
+#ifdef _WIN32
+        shutdown(server_socket_, SD_BOTH);
+#else
+        shutdown(server_socket_, SHUT_RDWR);
+#endif
         close_socket(server_socket_);
         server_socket_ = INVALID_SOCKET_VAL;
     }
@@ -142,6 +192,39 @@ bool NetworkManager::sendMessage(const Message& message, SOCKET socket_fd) {
     SOCKET target_socket = (socket_fd != INVALID_SOCKET_VAL) ? socket_fd : client_socket_;
     if (target_socket == INVALID_SOCKET_VAL) return false;
 
+    if (send_impairment_.active()) return sendImpaired(message, target_socket);
+    return sendNow(message, target_socket);
+}
+
+bool NetworkManager::sendStamped(Message& message, SOCKET socket_fd, const std::function<void(Message&)>& stamp) {
+    SOCKET target_socket = (socket_fd != INVALID_SOCKET_VAL) ? socket_fd : client_socket_;
+    if (target_socket == INVALID_SOCKET_VAL) return false;
+
+    if (send_impairment_.active()) {
+        // The emulated delay stands for the wire, so it comes after the stamp
+        stamp(message);
+        return sendImpaired(message, target_socket);
+    }
+    std::shared_ptr<std::mutex> send_lock = sendLock(target_socket);
+    std::lock_guard<std::mutex> lock(*send_lock);
+    stamp(message);
+    return writeMessage(message, target_socket);
+}
+
+bool NetworkManager::sendNow(const Message& message, SOCKET target_socket) {
+    std::shared_ptr<std::mutex> send_lock = sendLock(target_socket);
+    std::lock_guard<std::mutex> lock(*send_lock);
+    return writeMessage(message, target_socket);
+}
+
+std::shared_ptr<std::mutex> NetworkManager::sendLock(SOCKET socket_fd) {
+    std::lock_guard<std::mutex> lock(send_locks_mutex_);
+    std::shared_ptr<std::mutex>& send_lock = send_locks_[socket_fd];
+    if (!send_lock) send_lock = std::make_shared<std::mutex>();
+    return send_lock;
+}
+
+bool NetworkManager::writeMessage(const Message& message, SOCKET target_socket) {
     // Send header
     uint8_t type = static_cast<uint8_t>(message.type);
     if (!sendRaw(&type, sizeof(type), target_socket)) return false;
@@ -159,6 +242,11 @@ bool NetworkManager::receiveMessage(Message& message, SOCKET socket_fd) {
     SOCKET target_socket = (socket_fd != INVALID_SOCKET_VAL) ? socket_fd : client_socket_;
     if (target_socket == INVALID_SOCKET_VAL) return false;
 
+    if (receive_impairment_.active()) return receiveImpaired(message, target_socket);
+    return receiveNow(message, target_socket);
+}
+
+bool NetworkManager::receiveNow(Message& message, SOCKET target_socket) {
     // Receive header
     uint8_t type;
     if (!receiveRaw(&type, sizeof(type), target_socket)) return false;
@@ -176,7 +264,7 @@ bool NetworkManager::receiveMessage(Message& message, SOCKET socket_fd) {
     return true;
 }
 
-void NetworkManager::setMessageHandler(std::function<void(const Message&, SOCKET)> handler) {
+void NetworkManager::setMessageHandler(std::function<void(Message&, SOCKET)> handler) {
     message_handler_ = handler;
 }
 
@@ -185,6 +273,8 @@ bool NetworkManager::isConnected() const {
 }
 
 void NetworkManager::acceptClients() {
+    applyThreadPolicy(ThreadRole::CONTROL);
+    registerLogThread(logger_);
     while (running_) {
         sockaddr_in client_addr{};
         socklen_t client_len = sizeof(client_addr);
@@ -192,17 +282,20 @@ void NetworkManager::acceptClients() {
         SOCKET client_fd = accept(server_socket_, (struct sockaddr*)&client_addr, &client_len);
         if (client_fd == INVALID_SOCKET_VAL) {
             if (running_) {
-                std::cerr << "Accept failed" << std::endl;
+                logEvent(logger_, LogEvent::ACCEPT_FAILED);
             }
             continue;
         }
 
-        std::cout << "Client connected: " << client_fd << std::endl;
+        disableNagle(client_fd);
+        logEvent(logger_, LogEvent::CLIENT_ACCEPTED, client_fd);
         std::thread(&NetworkManager::handleClient, this, client_fd).detach();
     }
 }
 
 void NetworkManager::handleClient(SOCKET client_fd) {
+    applyThreadPolicy(ThreadRole::CONNECTION);
+    registerLogThread(logger_);
     while (running_) {
         Message message;
         if (receiveMessage(message, client_fd)) {
@@ -218,8 +311,185 @@ void NetworkManager::handleClient(SOCKET client_fd) {
         }
     }
     
+    forgetLink(client_fd);
     close_socket(client_fd);
-    std::cout << "Client disconnected: " << client_fd << std::endl;
+    logEvent(logger_, LogEvent::CLIENT_CLOSED, client_fd);
+}
+
+void NetworkManager::setImpairment(const ImpairmentConfig& send, const ImpairmentConfig& receive) {
+    send_impairment_ = send;
+    receive_impairment_ = receive;
+}
+
+ImpairmentStats NetworkManager::sendImpairmentStats() const {
+    std::lock_guard<std::mutex> lock(impairment_mutex_);
+    ImpairmentStats total = closed_send_stats_;
+    for (const auto& link : send_links_) total += link.second.stats();
+    return total;
+}
+
+ImpairmentStats NetworkManager::receiveImpairmentStats() const {
+    std::lock_guard<std::mutex> lock(impairment_mutex_);
+    ImpairmentStats total = closed_receive_stats_;
+    for (const auto& link : receive_links_) total += link.second->impairment.stats();
+    return total;
+}
+
+bool NetworkManager::sendImpaired(const Message& message, SOCKET socket_fd) {
+    std::lock_guard<std::mutex> lock(impairment_mutex_);
+    auto link = send_links_.find(socket_fd);
+    if (link == send_links_.end()) {
+        link = send_links_.emplace(socket_fd, NetworkImpairment(send_impairment_, links_opened_++)).first;
+    }
+
+    int64_t due[NetworkImpairment::MAX_DELIVERIES];
+    const size_t copies = link->second.plan(message.type == MessageType::AUDIO_DATA,
+                                            MESSAGE_HEADER_BYTES + message.size, steadyNowNs(), due);
+    for (size_t i = 0; i < copies; ++i) {
+        outgoing_.emplace(std::make_pair(due[i], outgoing_order_++), Outgoing{socket_fd, message});
+    }
+    if (!delivery_thread_.joinable()) {
+        delivery_stop_ = false;
+        delivery_thread_ = std::thread(&NetworkManager::deliveryLoop, this);
+    }
+    delivery_cv_.notify_one();
+    return true;
+}
+
+void NetworkManager::deliveryLoop() {
+    applyThreadPolicy(ThreadRole::NETWORK);
+    registerLogThread(logger_);
+    std::unique_lock<std::mutex> lock(impairment_mutex_);
+    while (!delivery_stop_) {
+        if (outgoing_.empty()) {
+            delivery_cv_.wait(lock);
+            continue;
+        }
+        const int64_t due_ns = outgoing_.begin()->first.first;
+        if (due_ns > steadyNowNs()) {
+            delivery_cv_.wait_until(lock, std::chrono::steady_clock::time_point(std::chrono::nanoseconds(due_ns)));
+            continue;
+        }
+
+        Outgoing next = std::move(outgoing_.begin()->second);
+        outgoing_.erase(outgoing_.begin());
+        lock.unlock();
+        {
+            std::lock_guard<std::mutex> delivering(delivery_mutex_);
+            // forgetLink() may have closed the socket meanwhile
+            bool open = true;
+            {
+                std::lock_guard<std::mutex> links(impairment_mutex_);
+                open = send_links_.count(next.socket_fd) > 0;
+            }
+            if (open) sendNow(next.message, next.socket_fd);
+        }
+        lock.lock();
+    }
+}
+
+void NetworkManager::stopDelivery(bool flush) {
+    {
+        std::lock_guard<std::mutex> lock(impairment_mutex_);
+        delivery_stop_ = true;
+    }
+    delivery_cv_.notify_one();
+    if (delivery_thread_.joinable()) {
+        delivery_thread_.join();
+    }
+
+    std::lock_guard<std::mutex> lock(impairment_mutex_);
+    if (flush) {
+        for (const auto& entry : outgoing_) sendNow(entry.second.message, entry.second.socket_fd);
+    }
+    outgoing_.clear();
+}
+
+void NetworkManager::forgetLink(SOCKET socket_fd) {
+    std::lock_guard<std::mutex> delivering(delivery_mutex_);
+    std::lock_guard<std::mutex> lock(impairment_mutex_);
+    auto send_link = send_links_.find(socket_fd);
+    if (send_link != send_links_.end()) {
+        closed_send_stats_ += send_link->second.stats();
+        send_links_.erase(send_link);
+    }
+    auto receive_link = receive_links_.find(socket_fd);
+    if (receive_link != receive_links_.end()) {
+        closed_receive_stats_ += receive_link->second->impairment.stats();
+        receive_links_.erase(receive_link);
+    }
+    for (auto it = outgoing_.begin(); it != outgoing_.end();) {
+        it = it->second.socket_fd == socket_fd ? outgoing_.erase(it) : std::next(it);
+    }
+    std::lock_guard<std::mutex> locks(send_locks_mutex_);
+    send_locks_.erase(socket_fd);
+}
+
+// Each socket has a single reader, so its link's queue is only touched
+// from that thread once created
+bool NetworkManager::receiveImpaired(Message& message, SOCKET socket_fd) {
+    ReceiveLink* link = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(impairment_mutex_);
+        auto it = receive_links_.find(socket_fd);
+        if (it == receive_links_.end()) {
+            std::unique_ptr<ReceiveLink> created(
+                new ReceiveLink{NetworkImpairment(receive_impairment_, links_opened_++), {}, 0});
+            it = receive_links_.emplace(socket_fd, std::move(created)).first;
+        }
+        link = it->second.get();
+    }
+
+    while (true) {
+        const int64_t now_ns = steadyNowNs();
+        if (!link->pending.empty() && link->pending.begin()->first.first <= now_ns) {
+            message = std::move(link->pending.begin()->second);
+            link->pending.erase(link->pending.begin());
+            return true;
+        }
+
+        const int64_t timeout_ns = link->pending.empty() ? -1 : link->pending.begin()->first.first - now_ns;
+        if (!waitReadable(socket_fd, timeout_ns)) continue;
+
+        Message arrived;
+        if (!receiveNow(arrived, socket_fd)) return false;
+        int64_t due[NetworkImpairment::MAX_DELIVERIES];
+        size_t copies = 0;
+        {
+            // Stats readers walk the links under the lock
+            std::lock_guard<std::mutex> lock(impairment_mutex_);
+            copies = link->impairment.plan(arrived.type == MessageType::AUDIO_DATA,
+                                           MESSAGE_HEADER_BYTES + arrived.size, steadyNowNs(), due);
+        }
+        for (size_t i = 0; i < copies; ++i) {
+            link->pending.emplace(std::make_pair(due[i], link->order++), arrived);
+        }
+    }
+}
+
+// True when data or an error is waiting; timeout_ns < 0 waits forever
+bool NetworkManager::waitReadable(SOCKET socket_fd, int64_t timeout_ns) {
+    const int timeout_ms = timeout_ns < 0 ? -1 : static_cast<int>((timeout_ns + 999999) / 1000000);
+#ifdef _WIN32
+    WSAPOLLFD entry{};
+    entry.fd = socket_fd;
+    entry.events = POLLRDNORM;
+    return WSAPoll(&entry, 1, timeout_ms) > 0;
+#else
+    pollfd entry{};
+    entry.fd = socket_fd;
+    entry.events = POLLIN;
+    return poll(&entry, 1, timeout_ms) > 0;
+#endif
+}
+
+void NetworkManager::disableNagle(SOCKET socket_fd) {
+#ifdef _WIN32
+    char opt = 1;
+#else
+    int opt = 1;
+#endif
+    setsockopt(socket_fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
 }
 
 bool NetworkManager::sendRaw(const void* data, size_t size, SOCKET socket_fd) {
@@ -228,9 +498,9 @@ bool NetworkManager::sendRaw(const void* data, size_t size, SOCKET socket_fd) {
     
     while (sent < size) {
 #ifdef _WIN32
-        int result = send(socket_fd, ptr + sent, static_cast<int>(size - sent), 0);
+        int result = send(socket_fd, ptr + sent, static_cast<int>(size - sent), SEND_FLAGS);
 #else
-        ssize_t result = send(socket_fd, ptr + sent, size - sent, 0);
+        ssize_t result = send(socket_fd, ptr + sent, size - sent, SEND_FLAGS);
 #endif
         if (result <= 0) return false;
         sent += result;
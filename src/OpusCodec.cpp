@@ -0,0 +1,173 @@
+#include "OpusCodec.h"
+#include <algorithm>
+#include <iostream>
+
+#ifdef AUDSYNC_HAVE_OPUS
+#include <opus/opus.h>
+#endif
+
+bool opusAvailable() {
+#ifdef AUDSYNC_HAVE_OPUS
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool opusSupportsRate(int sample_rate) {
+    return sample_rate == 8000 || sample_rate == 12000 || sample_rate == 16000 ||
+           sample_rate == 24000 || sample_rate == 48000;
+}
+
+OpusFrameEncoder::OpusFrameEncoder() : encoder_(nullptr), frame_samples_(0) {}
+
+OpusFrameDecoder::OpusFrameDecoder() : decoder_(nullptr) {}
+
+#ifdef AUDSYNC_HAVE_OPUS
+
+OpusFrameEncoder::~OpusFrameEncoder() {
+    if (encoder_) opus_encoder_destroy(encoder_);
+}
+
+bool OpusFrameEncoder::configure(int sample_rate, const OpusSettings& settings) {
+    if (!opusSupportsRate(sample_rate) || (settings.frame_ms != 10 && settings.frame_ms != 20)) {
+        std::cerr << "Opus needs 10 or 20 ms frames at 8, 12, 16, 24 or 48 kHz" << std::endl;
+        return false;
+    }
+
+    int error = OPUS_OK;
+    OpusEncoder* encoder = opus_encoder_create(sample_rate, 1, OPUS_APPLICATION_VOIP, &error);
+    if (error != OPUS_OK) {
+        std::cerr << "Failed to create Opus encoder: " << opus_strerror(error) << std::endl;
+        return false;
+    }
+    opus_encoder_ctl(encoder, OPUS_SET_BITRATE(settings.bitrate));
+    opus_encoder_ctl(encoder, OPUS_SET_COMPLEXITY(std::min(std::max(settings.complexity, 0), 10)));
+    opus_encoder_ctl(encoder, OPUS_SET_SIGNAL(OPUS_SIGNAL_VOICE));
+    opus_encoder_ctl(encoder, OPUS_SET_INBAND_FEC(settings.fec ? 1 : 0));
+    opus_encoder_ctl(encoder, OPUS_SET_PACKET_LOSS_PERC(std::min(std::max(settings.expected_loss, 0), 100)));
+    opus_encoder_ctl(encoder, OPUS_SET_DTX(settings.dtx ? 1 : 0));
+
+    if (encoder_) opus_encoder_destroy(encoder_);
+    encoder_ = encoder;
+    frame_samples_ = static_cast<size_t>(sample_rate / 1000 * settings.frame_ms);
+    return true;
+}
+
+bool OpusFrameEncoder::setBitrate(int bitrate) {
+    return encoder_ && opus_encoder_ctl(encoder_, OPUS_SET_BITRATE(bitrate)) == OPUS_OK;
+}
+
+bool OpusFrameEncoder::setExpectedLoss(int percent) {
+    return encoder_ && opus_encoder_ctl(encoder_, OPUS_SET_PACKET_LOSS_PERC(std::min(std::max(percent, 0), 100))) == OPUS_OK;
+}
+
+size_t OpusFrameEncoder::encode(const float* in, uint8_t* out, size_t max_bytes) {
+    if (!encoder_) return 0;
+    const int bytes = opus_encode_float(encoder_, in, static_cast<int>(frame_samples_), out,
+                                        static_cast<opus_int32>(max_bytes));
+    return bytes > 0 ? static_cast<size_t>(bytes) : 0;
+}
+
+OpusFrameDecoder::~OpusFrameDecoder() {
+    if (decoder_) opus_decoder_destroy(decoder_);
+}
+
+bool OpusFrameDecoder::configure(int sample_rate) {
+    if (!opusSupportsRate(sample_rate)) return false;
+
+    int error = OPUS_OK;
+    OpusDecoder* decoder = opus_decoder_create(sample_rate, 1, &error);
+    if (error != OPUS_OK) {
+        std::cerr << "Failed to create Opus decoder: " << opus_strerror(error) << std::endl;
+        return false;
+    }
+    if (decoder_) opus_decoder_destroy(decoder_);
+    decoder_ = decoder;
+    return true;
+}
+
+void OpusFrameDecoder::reset() {
+    if (decoder_) opus_decoder_ctl(decoder_, OPUS_RESET_STATE);
+}
+
+size_t OpusFrameDecoder::decode(const uint8_t* packet, size_t bytes, float* out, size_t max_samples) {
+    if (!decoder_) return 0;
+    const int samples = opus_decode_float(decoder_, packet, static_cast<opus_int32>(bytes), out,
+                                          static_cast<int>(max_samples), 0);
+    return samples > 0 ? static_cast<size_t>(samples) : 0;
+}
+
+size_t OpusFrameDecoder::recover(const uint8_t* next_packet, size_t bytes, float* out, size_t samples) {
+    if (!decoder_) return 0;
+    const int decoded = opus_decode_float(decoder_, next_packet, static_cast<opus_int32>(bytes), out,
+                                          static_cast<int>(samples), 1);
+    return decoded > 0 ? static_cast<size_t>(decoded) : 0;
+}
+
+size_t OpusFrameDecoder::conceal(float* out, size_t samples) {
+    if (!decoder_) return 0;
+    const int decoded = opus_decode_float(decoder_, nullptr, 0, out, static_cast<int>(samples), 0);
+    return decoded > 0 ? static_cast<size_t>(decoded) : 0;
+}
+
+#else
+
+OpusFrameEncoder::~OpusFrameEncoder() {}
+
+bool OpusFrameEncoder::configure(int sample_rate, const OpusSettings& settings) {
+    (void)sample_rate;
+    (void)settings;
+    std::cerr << "This build has no Opus support" << std::endl;
+    return false;
+}
+
+bool OpusFrameEncoder::setBitrate(int bitrate) {
+    (void)bitrate;
+    return false;
+}
+
+bool OpusFrameEncoder::setExpectedLoss(int percent) {
+    (void)percent;
+    return false;
+}
+
+size_t OpusFrameEncoder::encode(const float* in, uint8_t* out, size_t max_bytes) {
+    (void)in;
+    (void)out;
+    (void)max_bytes;
+    return 0;
+}
+
+OpusFrameDecoder::~OpusFrameDecoder() {}
+
+bool OpusFrameDecoder::configure(int sample_rate) {
+    (void)sample_rate;
+    return false;
+}
+
+void OpusFrameDecoder::reset() {}
+
+size_t OpusFrameDecoder::decode(const uint8_t* packet, size_t bytes, float* out, size_t max_samples) {
+    (void)packet;
+    (void)bytes;
+    (void)out;
+    (void)max_samples;
+    return 0;
+}
+
+size_t OpusFrameDecoder::recover(const uint8_t* next_packet, size_t bytes, float* out, size_t samples) {
+    (void)next_packet;
+    (void)bytes;
+    (void)out;
+    (void)samples;
+    return 0;
+}
+
+size_t OpusFrameDecoder::conceal(float* out, size_t samples) {
+    (void)out;
+    (void)samples;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,290 @@
+#include "RealtimeMemory.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+#ifndef _WIN32
+    #include <sys/mman.h>
+    #include <sys/resource.h>
+    #include <unistd.h>
+    #ifdef __linux__
+        #include <sys/syscall.h>
+    #endif
+#endif
+#ifdef __GLIBC__
+    #include <malloc.h>
+#endif
+
+namespace {
+
+// Deeper than any audio or network path goes; well inside the smallest
+// default thread stack (1 MiB on Windows)
+constexpr size_t STACK_PREFAULT_BYTES = 256 * 1024;
+constexpr size_t PAGE_BYTES = 4096;
+constexpr size_t HUGE_PAGE_BYTES = 2u << 20;
+
+std::atomic<bool> g_prepared(false);
+
+struct FaultCounts {
+    uint64_t minor = 0;
+    uint64_t major = 0;
+};
+
+struct TrackedThread {
+    ThreadRole role;
+    long tid;
+    FaultCounts reported;   // as of the last report
+    bool foreign = false;   // a callback thread we did not start
+};
+
+std::mutex g_threads_mutex;
+std::vector<TrackedThread> g_threads;
+// Callback threads announce themselves here without locking or
+// allocating; pageFaultReport() adopts them into g_threads. A positive tid
+// marks a slot waiting to be adopted.
+constexpr size_t CALLBACK_SLOTS = 8;
+struct CallbackSlot {
+    std::atomic<long> tid{0};
+    std::atomic<int> role{0};
+};
+CallbackSlot g_callback_slots[CALLBACK_SLOTS];
+// Faults of threads that exited since the last report
+FaultCounts g_exited[static_cast<size_t>(ThreadRole::COUNT)];
+
+#ifdef __linux__
+long currentTid() {
+    return static_cast<long>(syscall(SYS_gettid));
+}
+
+// Fields 10 and 12 of /proc/self/task/<tid>/stat
+bool readFaults(long tid, FaultCounts& counts) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/task/%ld/stat", tid);
+    FILE* file = fopen(path, "r");
+    if (!file) return false;
+    char text[1024];
+    const size_t length = fread(text, 1, sizeof(text) - 1, file);
+    fclose(file);
+    text[length] = '\0';
+
+    // The command name may hold spaces, so count from its closing paren
+    const char* pos = strrchr(text, ')');
+    if (!pos) return false;
+    unsigned long long minor = 0, major = 0;
+    if (sscanf(pos + 1, " %*c %*d %*d %*d %*d %*d %*u %llu %*u %llu", &minor, &major) != 2) return false;
+    counts.minor = minor;
+    counts.major = major;
+    return true;
+}
+
+// Folds an exiting thread's last faults into its role's total
+struct ThreadSlot {
+    bool tracked = false;
+    ~ThreadSlot() {
+        if (!tracked) return;
+        const long tid = currentTid();
+        FaultCounts now;
+        const bool read = readFaults(tid, now);
+        std::lock_guard<std::mutex> lock(g_threads_mutex);
+        for (auto it = g_threads.begin(); it != g_threads.end(); ++it) {
+            if (it->tid != tid) continue;
+            if (read) {
+                FaultCounts& exited = g_exited[static_cast<size_t>(it->role)];
+                exited.minor += now.minor - it->reported.minor;
+                exited.major += now.major - it->reported.major;
+            }
+            g_threads.erase(it);
+            break;
+        }
+    }
+};
+#endif
+
+// Writes one byte per page so each is mapped now rather than on first use
+void touchPages(volatile unsigned char* data, size_t bytes) {
+    for (size_t offset = 0; offset < bytes; offset += PAGE_BYTES) data[offset] = 0;
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((noinline))
+#endif
+void prefaultStack() {
+    volatile unsigned char stack[STACK_PREFAULT_BYTES];
+    touchPages(stack, sizeof(stack));
+}
+
+void reserveHeap(const RealtimeMemoryConfig& config) {
+#ifdef __GLIBC__
+    // Keep freed memory in the heap, and serve large blocks from it too
+    // instead of fresh mappings that would fault again. One arena, since
+    // other threads would otherwise allocate from arenas of their own.
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    mallopt(M_ARENA_MAX, 1);
+
+    unsigned char* reserve = static_cast<unsigned char*>(malloc(config.reserve_bytes));
+    if (!reserve) {
+        std::cerr << "Could not reserve " << (config.reserve_bytes >> 20) << " MiB of heap" << std::endl;
+        return;
+    }
+    const char* huge = "";
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (config.huge_pages) {
+        const uintptr_t begin = (reinterpret_cast<uintptr_t>(reserve) + HUGE_PAGE_BYTES - 1) & ~(HUGE_PAGE_BYTES - 1);
+        const uintptr_t end = (reinterpret_cast<uintptr_t>(reserve) + config.reserve_bytes) & ~(HUGE_PAGE_BYTES - 1);
+        if (end > begin && madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE) == 0) {
+            huge = ", huge pages";
+        } else {
+            huge = ", huge pages refused";
+        }
+    }
+#else
+    if (config.huge_pages) huge = ", no huge pages here";
+#endif
+    touchPages(reserve, config.reserve_bytes);
+    free(reserve);
+    std::cout << "Prefaulted a " << (config.reserve_bytes >> 20) << " MiB heap reserve" << huge << std::endl;
+#else
+    (void) config;
+    (void) HUGE_PAGE_BYTES;
+    std::cout << "Heap reserve needs glibc; allocations may still fault on first use" << std::endl;
+#endif
+}
+
+void lockMemory() {
+#if !defined(_WIN32) && defined(MCL_CURRENT)
+    int flags = MCL_CURRENT | MCL_FUTURE;
+#ifdef MCL_ONFAULT
+    // Every connection thread's stack would otherwise be locked in full
+    flags |= MCL_ONFAULT;
+#endif
+    if (mlockall(flags) == 0) {
+        std::cout << "Locked process memory" << std::endl;
+        return;
+    }
+    const int error = errno;
+    rlimit limit{};
+    getrlimit(RLIMIT_MEMLOCK, &limit);
+    std::cerr << "Could not lock memory (" << std::strerror(error) << "); RLIMIT_MEMLOCK is ";
+    if (limit.rlim_cur == RLIM_INFINITY) {
+        std::cerr << "unlimited" << std::endl;
+    } else {
+        std::cerr << (limit.rlim_cur >> 10) << " KiB" << std::endl;
+    }
+#else
+    std::cerr << "Memory locking is not supported here" << std::endl;
+#endif
+}
+
+} // namespace
+
+void prepareRealtimeMemory(const RealtimeMemoryConfig& config) {
+    if (g_prepared) return;
+    reserveHeap(config);
+    if (config.lock) lockMemory();
+    prefaultStack();
+    g_prepared = true;
+}
+
+bool realtimeMemoryPrepared() {
+    return g_prepared;
+}
+
+void prepareThreadMemory(ThreadRole role) {
+    if (g_prepared) prefaultStack();
+#ifdef __linux__
+    thread_local ThreadSlot slot;
+    if (slot.tracked) return;
+    TrackedThread thread;
+    thread.role = role;
+    thread.tid = currentTid();
+    if (!readFaults(thread.tid, thread.reported)) return;
+    slot.tracked = true;
+    std::lock_guard<std::mutex> lock(g_threads_mutex);
+    g_threads.push_back(thread);
+#else
+    (void) role;
+#endif
+}
+
+void trackCallbackThread(ThreadRole role) {
+#ifdef __linux__
+    thread_local bool tracked = false;
+    if (tracked) return;
+    tracked = true;
+    const long tid = currentTid();
+    for (auto& slot : g_callback_slots) {
+        // -1 claims the slot while the role is written; the tid publishes it
+        long expected = 0;
+        if (!slot.tid.compare_exchange_strong(expected, -1, std::memory_order_relaxed)) continue;
+        slot.role.store(static_cast<int>(role), std::memory_order_relaxed);
+        slot.tid.store(tid, std::memory_order_release);
+        return;
+    }
+#else
+    (void) role;
+#endif
+}
+
+std::vector<std::string> pageFaultReport() {
+    std::vector<std::string> lines;
+#ifdef __linux__
+    FaultCounts faults[static_cast<size_t>(ThreadRole::COUNT)];
+    size_t threads[static_cast<size_t>(ThreadRole::COUNT)] = {};
+    {
+        std::lock_guard<std::mutex> lock(g_threads_mutex);
+        // Callback threads count from their first report
+        for (auto& slot : g_callback_slots) {
+            const long tid = slot.tid.load(std::memory_order_acquire);
+            if (tid <= 0) continue;
+            TrackedThread thread;
+            thread.role = static_cast<ThreadRole>(slot.role.load(std::memory_order_relaxed));
+            thread.tid = tid;
+            thread.foreign = true;
+            slot.tid.store(0, std::memory_order_release);
+            if (readFaults(tid, thread.reported)) g_threads.push_back(thread);
+        }
+        for (size_t i = 0; i < static_cast<size_t>(ThreadRole::COUNT); ++i) {
+            faults[i] = g_exited[i];
+            g_exited[i] = FaultCounts();
+        }
+        for (auto it = g_threads.begin(); it != g_threads.end();) {
+            FaultCounts now;
+            if (!readFaults(it->tid, now)) {
+                // Nothing folds a callback thread in when it exits
+                it = it->foreign ? g_threads.erase(it) : std::next(it);
+                continue;
+            }
+            const size_t index = static_cast<size_t>(it->role);
+            faults[index].minor += now.minor - it->reported.minor;
+            faults[index].major += now.major - it->reported.major;
+            threads[index]++;
+            it->reported = now;
+            ++it;
+        }
+    }
+    for (size_t i = 0; i < static_cast<size_t>(ThreadRole::COUNT); ++i) {
+        if (threads[i] == 0 && faults[i].minor == 0 && faults[i].major == 0) continue;
+        lines.push_back(std::string(threadRoleName(static_cast<ThreadRole>(i))) + ": " +
+                        std::to_string(threads[i]) + " threads, " + std::to_string(faults[i].minor) + " minor and " +
+                        std::to_string(faults[i].major) + " major page faults");
+    }
+#elif !defined(_WIN32)
+    // Only the whole process can be counted here
+    static FaultCounts last;
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        const FaultCounts now{static_cast<uint64_t>(usage.ru_minflt), static_cast<uint64_t>(usage.ru_majflt)};
+        lines.push_back("process: " + std::to_string(now.minor - last.minor) + " minor and " +
+                        std::to_string(now.major - last.major) + " major page faults");
+        last = now;
+    }
+#endif
+    return lines;
+}
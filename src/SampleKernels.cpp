@@ -0,0 +1,194 @@
+#include "SampleKernels.h"
+#include "SampleKernelsScalar.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #include <intrin.h>
+    #include <immintrin.h>
+#endif
+
+DitherState::DitherState(uint32_t seed) {
+    // Distinct, non-zero start for every lane
+    uint32_t x = seed ? seed : 0x9E3779B9u;
+    for (auto& lane : lanes) {
+        x = x * 1664525u + 1013904223u;
+        lane = x | 1u;
+    }
+}
+
+namespace {
+
+void floatToInt16Scalar(const float* src, int16_t* dst, size_t n, DitherState* dither) {
+    scalarFloatToInt16(src, dst, n, dither);
+}
+void int16ToFloatScalar(const int16_t* src, float* dst, size_t n) {
+    scalarInt16ToFloat(src, dst, n);
+}
+void floatToInt24Scalar(const float* src, uint8_t* dst, size_t n, DitherState* dither) {
+    scalarFloatToInt24(src, dst, n, dither);
+}
+void int24ToFloatScalar(const uint8_t* src, float* dst, size_t n) {
+    scalarInt24ToFloat(src, dst, n);
+}
+void floatToUlawScalar(const float* src, uint8_t* dst, size_t n) {
+    scalarFloatToUlaw(src, dst, n);
+}
+void ulawToFloatScalar(const uint8_t* src, float* dst, size_t n) {
+    scalarUlawToFloat(src, dst, n);
+}
+void floatToAlawScalar(const float* src, uint8_t* dst, size_t n) {
+    scalarFloatToAlaw(src, dst, n);
+}
+void alawToFloatScalar(const uint8_t* src, float* dst, size_t n) {
+    scalarAlawToFloat(src, dst, n);
+}
+void floatToHalfScalar(const float* src, uint16_t* dst, size_t n) {
+    scalarFloatToHalf(src, dst, n);
+}
+void halfToFloatScalar(const uint16_t* src, float* dst, size_t n) {
+    scalarHalfToFloat(src, dst, n);
+}
+void applyGainScalar(float* buf, size_t n, float gain) {
+    scalarApplyGain(buf, n, gain);
+}
+void applyRampScalar(float* buf, size_t n, float start, float step) {
+    scalarApplyRamp(buf, n, start, step);
+}
+void mixAccumulateScalar(float* dst, const float* src, size_t n, float gain) {
+    scalarMixAccumulate(dst, src, n, gain);
+}
+void multiplyScalar(float* dst, const float* src, size_t n) {
+    scalarMultiply(dst, src, n);
+}
+void multiplyAddScalar(float* dst, const float* a, const float* b, size_t n) {
+    scalarMultiplyAdd(dst, a, b, n);
+}
+void magnitudeSquaredScalar(const float* re, const float* im, float* dst, size_t n) {
+    scalarMagnitudeSquared(re, im, dst, n);
+}
+float peakScalar(const float* src, size_t n) {
+    return scalarPeak(src, n);
+}
+float sumSquaresScalar(const float* src, size_t n) {
+    return scalarSumSquares(src, n);
+}
+void interleave2Scalar(const float* left, const float* right, float* dst, size_t frames) {
+    scalarInterleave2(left, right, dst, frames);
+}
+void deinterleave2Scalar(const float* src, float* left, float* right, size_t frames) {
+    scalarDeinterleave2(src, left, right, frames);
+}
+
+const SampleKernelTable SCALAR_TABLE = {
+    "scalar",
+    floatToInt16Scalar, int16ToFloatScalar, floatToInt24Scalar, int24ToFloatScalar,
+    floatToUlawScalar, ulawToFloatScalar, floatToAlawScalar, alawToFloatScalar,
+    floatToHalfScalar, halfToFloatScalar,
+    applyGainScalar, applyRampScalar, mixAccumulateScalar,
+    multiplyScalar, multiplyAddScalar, magnitudeSquaredScalar,
+    peakScalar, sumSquaresScalar,
+    interleave2Scalar, deinterleave2Scalar
+};
+
+bool cpuSupports(SampleKernels::Isa isa) {
+    using Isa = SampleKernels::Isa;
+    if (isa == Isa::SCALAR) return true;
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    switch (isa) {
+        case Isa::SSE2:   return __builtin_cpu_supports("sse2");
+        case Isa::AVX2:   return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c");
+        case Isa::AVX512: return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+        default:          return false;
+    }
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int regs[4];
+    __cpuid(regs, 1);
+    const bool sse2 = (regs[3] & (1 << 26)) != 0;
+    const bool f16c = (regs[2] & (1 << 29)) != 0;
+    const bool osxsave = (regs[2] & (1 << 27)) != 0 && (regs[2] & (1 << 28)) != 0;
+    const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    __cpuidex(regs, 7, 0);
+    switch (isa) {
+        case Isa::SSE2:   return sse2;
+        case Isa::AVX2:   return (xcr0 & 0x6) == 0x6 && (regs[1] & (1 << 5)) != 0 && f16c;
+        case Isa::AVX512: return (xcr0 & 0xE6) == 0xE6 && (regs[1] & (1 << 16)) != 0 && (regs[1] & (1 << 30)) != 0;
+        default:          return false;
+    }
+#else
+    return false;
+#endif
+}
+
+SampleKernels::Isa envCap() {
+    const char* env = std::getenv("AUDSYNC_SIMD");
+    if (!env) return SampleKernels::Isa::AVX512;
+    if (std::strcmp(env, "scalar") == 0) return SampleKernels::Isa::SCALAR;
+    if (std::strcmp(env, "sse2") == 0) return SampleKernels::Isa::SSE2;
+    if (std::strcmp(env, "avx2") == 0) return SampleKernels::Isa::AVX2;
+    return SampleKernels::Isa::AVX512;
+}
+
+struct ActiveKernels {
+    const SampleKernelTable* table;
+    SampleKernels::Isa isa;
+};
+
+ActiveKernels detect() {
+    const int cap = static_cast<int>(envCap());
+    for (int i = cap; i > 0; --i) {
+        const auto isa = static_cast<SampleKernels::Isa>(i);
+        if (const SampleKernelTable* t = SampleKernels::table(isa)) {
+            return {t, isa};
+        }
+    }
+    return {&SCALAR_TABLE, SampleKernels::Isa::SCALAR};
+}
+
+// Fixed once detected, so audio threads read it without synchronisation
+const ActiveKernels& activeKernels() {
+    static const ActiveKernels active = detect();
+    return active;
+}
+
+// Resolve once during static initialisation so the audio threads never
+// pay for detection
+const ActiveKernels& g_startup_kernels = activeKernels();
+
+} // namespace
+
+const SampleKernelTable* scalarSampleKernels() {
+    return &SCALAR_TABLE;
+}
+
+const SampleKernelTable& SampleKernels::active() {
+    return *activeKernels().table;
+}
+
+SampleKernels::Isa SampleKernels::activeIsa() {
+    return activeKernels().isa;
+}
+
+const SampleKernelTable* SampleKernels::table(Isa isa) {
+    if (!cpuSupports(isa)) return nullptr;
+    switch (isa) {
+        case Isa::SCALAR: return scalarSampleKernels();
+        case Isa::SSE2:   return sse2SampleKernels();
+        case Isa::AVX2:   return avx2SampleKernels();
+        case Isa::AVX512: return avx512SampleKernels();
+    }
+    return nullptr;
+}
+
+const char* SampleKernels::isaName(Isa isa) {
+    switch (isa) {
+        case Isa::SCALAR: return "scalar";
+        case Isa::SSE2:   return "sse2";
+        case Isa::AVX2:   return "avx2";
+        case Isa::AVX512: return "avx512";
+    }
+    return "unknown";
+}
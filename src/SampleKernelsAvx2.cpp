@@ -0,0 +1,321 @@
+#include "SampleKernels.h"
+
+#if defined(__AVX2__)
+
+#include "SampleKernelsScalar.h"
+#include <immintrin.h>
+#include <cstring>
+
+namespace {
+
+inline __m256i xorshift(__m256i x) {
+    x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 13));
+    x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 17));
+    return _mm256_xor_si256(x, _mm256_slli_epi32(x, 5));
+}
+
+inline __m256 tpdf(__m256i r) {
+    const __m256i lo = _mm256_and_si256(r, _mm256_set1_epi32(0xFFFF));
+    const __m256i hi = _mm256_srli_epi32(r, 16);
+    return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(lo, hi)), _mm256_set1_ps(1.0f / 65536.0f));
+}
+
+inline __m256i quantize(const float* src, size_t i, float scale, float lo, float hi, DitherState* dither) {
+    __m256 y = _mm256_mul_ps(_mm256_loadu_ps(src + i), _mm256_set1_ps(scale));
+    if (dither) {
+        __m256i* lane = reinterpret_cast<__m256i*>(dither->lanes + (i & 15));
+        const __m256i r = xorshift(_mm256_loadu_si256(lane));
+        _mm256_storeu_si256(lane, r);
+        y = _mm256_add_ps(y, tpdf(r));
+    }
+    y = _mm256_min_ps(_mm256_max_ps(y, _mm256_set1_ps(lo)), _mm256_set1_ps(hi));
+    return _mm256_cvtps_epi32(y);
+}
+
+// Packs the low three bytes of four int32 lanes into 12 bytes
+inline void store24(uint8_t* dst, __m128i v) {
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m128i packed = _mm_shuffle_epi8(v, shuffle);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), packed);
+    const int32_t tail = _mm_cvtsi128_si32(_mm_srli_si128(packed, 8));
+    std::memcpy(dst + 8, &tail, 4);
+}
+
+// Reads 16 bytes and sign-extends the first four packed int24 samples
+inline __m128i load24(const uint8_t* src) {
+    const __m128i shuffle = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    return _mm_srai_epi32(_mm_shuffle_epi8(v, shuffle), 8);
+}
+
+void floatToInt16Avx2(const float* src, int16_t* dst, size_t n, DitherState* dither) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m256i a = quantize(src, i, 32767.0f, -32768.0f, 32767.0f, dither);
+        const __m256i b = quantize(src, i + 8, 32767.0f, -32768.0f, 32767.0f, dither);
+        // packs works per 128-bit lane; restore sample order afterwards
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+    }
+    scalarFloatToInt16(src, dst, n, dither, i);
+}
+
+void int16ToFloatAvx2(const int16_t* src, float* dst, size_t n) {
+    const __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+    }
+    scalarInt16ToFloat(src, dst, n, i);
+}
+
+void floatToInt24Avx2(const float* src, uint8_t* dst, size_t n, DitherState* dither) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i v = quantize(src, i, 8388607.0f, -8388608.0f, 8388607.0f, dither);
+        store24(dst + 3 * i, _mm256_castsi256_si128(v));
+        store24(dst + 3 * i + 12, _mm256_extracti128_si256(v, 1));
+    }
+    scalarFloatToInt24(src, dst, n, dither, i);
+}
+
+void int24ToFloatAvx2(const uint8_t* src, float* dst, size_t n) {
+    const __m256 scale = _mm256_set1_ps(1.0f / 8388608.0f);
+    size_t i = 0;
+    // The second 16-byte load reaches 4 bytes past the 8 samples
+    for (; i + 10 <= n; i += 8) {
+        const __m256i v = _mm256_set_m128i(load24(src + 3 * i + 12), load24(src + 3 * i));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+    }
+    scalarInt24ToFloat(src, dst, n, i);
+}
+
+inline __m256i ulawCodes(const float* src, size_t i) {
+    const __m256 r = _mm256_cvtepi32_ps(quantize(src, i, 32767.0f, -32768.0f, 32767.0f, nullptr));
+    const __m256i sign = _mm256_slli_epi32(_mm256_srli_epi32(_mm256_castps_si256(r), 31), 7);
+    const __m256 abs = _mm256_and_ps(r, _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF)));
+    const __m256 mag = _mm256_add_ps(_mm256_min_ps(abs, _mm256_set1_ps(32635.0f)), _mm256_set1_ps(132.0f));
+    const __m256i bits = _mm256_castps_si256(mag);
+    const __m256i exponent = _mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(134));
+    const __m256i mantissa = _mm256_and_si256(_mm256_srli_epi32(bits, 19), _mm256_set1_epi32(0x0F));
+    const __m256i code = _mm256_or_si256(sign, _mm256_or_si256(_mm256_slli_epi32(exponent, 4), mantissa));
+    return _mm256_xor_si256(code, _mm256_set1_epi32(0xFF));
+}
+
+inline __m256i alawCodes(const float* src, size_t i) {
+    const __m256i v = _mm256_srai_epi32(quantize(src, i, 32767.0f, -32768.0f, 32767.0f, nullptr), 3);
+    const __m256i negative = _mm256_srai_epi32(v, 31);
+    const __m256i mask = _mm256_blendv_epi8(_mm256_set1_epi32(0xD5), _mm256_set1_epi32(0x55), negative);
+    const __m256i mag = _mm256_xor_si256(v, negative);
+    const __m256i bits = _mm256_castps_si256(_mm256_cvtepi32_ps(mag));
+    const __m256i small = _mm256_cmpgt_epi32(_mm256_set1_epi32(32), mag);
+    const __m256i segment = _mm256_andnot_si256(small, _mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(131)));
+    const __m256i mantissa = _mm256_blendv_epi8(_mm256_and_si256(_mm256_srli_epi32(bits, 19), _mm256_set1_epi32(0x0F)),
+                                                _mm256_srli_epi32(mag, 1), small);
+    return _mm256_xor_si256(_mm256_or_si256(_mm256_slli_epi32(segment, 4), mantissa), mask);
+}
+
+// Narrows two vectors of eight codes to 16 bytes in sample order
+inline void storeCodes(uint8_t* dst, __m256i a, __m256i b) {
+    const __m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+    const __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), bytes);
+}
+
+void floatToUlawAvx2(const float* src, uint8_t* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        storeCodes(dst + i, ulawCodes(src, i), ulawCodes(src, i + 8));
+    }
+    scalarFloatToUlaw(src, dst, n, i);
+}
+
+void floatToAlawAvx2(const float* src, uint8_t* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        storeCodes(dst + i, alawCodes(src, i), alawCodes(src, i + 8));
+    }
+    scalarFloatToAlaw(src, dst, n, i);
+}
+
+inline void lookup(const uint8_t* src, float* dst, size_t n, const float* table) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+        _mm256_storeu_ps(dst + i, _mm256_i32gather_ps(table, index, 4));
+    }
+    for (; i < n; ++i) dst[i] = table[src[i]];
+}
+
+void ulawToFloatAvx2(const uint8_t* src, float* dst, size_t n) {
+    lookup(src, dst, n, ulawTable());
+}
+
+void alawToFloatAvx2(const uint8_t* src, float* dst, size_t n) {
+    lookup(src, dst, n, alawTable());
+}
+
+// F16C, which every AVX2 CPU we select also reports
+void floatToHalfAvx2(const float* src, uint16_t* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), h);
+    }
+    scalarFloatToHalf(src, dst, n, i);
+}
+
+void halfToFloatAvx2(const uint16_t* src, float* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))));
+    }
+    scalarHalfToFloat(src, dst, n, i);
+}
+
+void applyGainAvx2(float* buf, size_t n, float gain) {
+    const __m256 g = _mm256_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(buf + i, _mm256_mul_ps(_mm256_loadu_ps(buf + i), g));
+    }
+    scalarApplyGain(buf, n, gain, i);
+}
+
+void applyRampAvx2(float* buf, size_t n, float start, float step) {
+    const __m256 s = _mm256_set1_ps(start);
+    const __m256 d = _mm256_set1_ps(step);
+    __m256 idx = _mm256_setr_ps(1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f);
+    const __m256 eight = _mm256_set1_ps(8.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256 g = _mm256_add_ps(s, _mm256_mul_ps(d, idx));
+        _mm256_storeu_ps(buf + i, _mm256_mul_ps(_mm256_loadu_ps(buf + i), g));
+        idx = _mm256_add_ps(idx, eight);
+    }
+    scalarApplyRamp(buf, n, start, step, i);
+}
+
+void mixAccumulateAvx2(float* dst, const float* src, size_t n, float gain) {
+    const __m256 g = _mm256_set1_ps(gain);
+    const __m256 lo = _mm256_set1_ps(-1.0f);
+    const __m256 hi = _mm256_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_mul_ps(_mm256_loadu_ps(src + i), g));
+        _mm256_storeu_ps(dst + i, _mm256_min_ps(_mm256_max_ps(v, lo), hi));
+    }
+    scalarMixAccumulate(dst, src, n, gain, i);
+}
+
+void multiplyAvx2(float* dst, const float* src, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(dst + i), _mm256_loadu_ps(src + i)));
+    }
+    scalarMultiply(dst, src, n, i);
+}
+
+void multiplyAddAvx2(float* dst, const float* a, const float* b, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256 p = _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), p));
+    }
+    scalarMultiplyAdd(dst, a, b, n, i);
+}
+
+void magnitudeSquaredAvx2(const float* re, const float* im, float* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256 r = _mm256_loadu_ps(re + i);
+        const __m256 m = _mm256_loadu_ps(im + i);
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_mul_ps(r, r), _mm256_mul_ps(m, m)));
+    }
+    scalarMagnitudeSquared(re, im, dst, n, i);
+}
+
+inline __m128 fold(__m256 v, bool use_max) {
+    const __m128 lo = _mm256_castps256_ps128(v);
+    const __m128 hi = _mm256_extractf128_ps(v, 1);
+    __m128 r = use_max ? _mm_max_ps(lo, hi) : _mm_add_ps(lo, hi);
+    const __m128 s1 = _mm_movehl_ps(r, r);
+    r = use_max ? _mm_max_ps(r, s1) : _mm_add_ps(r, s1);
+    const __m128 s2 = _mm_shuffle_ps(r, r, 1);
+    return use_max ? _mm_max_ss(r, s2) : _mm_add_ss(r, s2);
+}
+
+float peakAvx2(const float* src, size_t n) {
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    __m256 m = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        m = _mm256_max_ps(m, _mm256_and_ps(_mm256_loadu_ps(src + i), abs_mask));
+    }
+    return scalarPeak(src, n, i, _mm_cvtss_f32(fold(m, true)));
+}
+
+float sumSquaresAvx2(const float* src, size_t n) {
+    __m256 a = _mm256_setzero_ps();
+    __m256 b = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m256 x = _mm256_loadu_ps(src + i);
+        const __m256 y = _mm256_loadu_ps(src + i + 8);
+        a = _mm256_add_ps(a, _mm256_mul_ps(x, x));
+        b = _mm256_add_ps(b, _mm256_mul_ps(y, y));
+    }
+    return scalarSumSquares(src, n, i, _mm_cvtss_f32(fold(_mm256_add_ps(a, b), false)));
+}
+
+void interleave2Avx2(const float* left, const float* right, float* dst, size_t frames) {
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        const __m256 l = _mm256_loadu_ps(left + i);
+        const __m256 r = _mm256_loadu_ps(right + i);
+        const __m256 lo = _mm256_unpacklo_ps(l, r);
+        const __m256 hi = _mm256_unpackhi_ps(l, r);
+        _mm256_storeu_ps(dst + 2 * i, _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(dst + 2 * i + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+    scalarInterleave2(left, right, dst, frames, i);
+}
+
+void deinterleave2Avx2(const float* src, float* left, float* right, size_t frames) {
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        const __m256 a = _mm256_loadu_ps(src + 2 * i);
+        const __m256 b = _mm256_loadu_ps(src + 2 * i + 8);
+        const __m256 l = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m256 r = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm256_storeu_ps(left + i, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(l), 0xD8)));
+        _mm256_storeu_ps(right + i, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(r), 0xD8)));
+    }
+    scalarDeinterleave2(src, left, right, frames, i);
+}
+
+const SampleKernelTable AVX2_TABLE = {
+    "avx2",
+    floatToInt16Avx2, int16ToFloatAvx2, floatToInt24Avx2, int24ToFloatAvx2,
+    floatToUlawAvx2, ulawToFloatAvx2, floatToAlawAvx2, alawToFloatAvx2,
+    floatToHalfAvx2, halfToFloatAvx2,
+    applyGainAvx2, applyRampAvx2, mixAccumulateAvx2,
+    multiplyAvx2, multiplyAddAvx2, magnitudeSquaredAvx2,
+    peakAvx2, sumSquaresAvx2,
+    interleave2Avx2, deinterleave2Avx2
+};
+
+} // namespace
+
+const SampleKernelTable* avx2SampleKernels() {
+    return &AVX2_TABLE;
+}
+
+#else
+
+const SampleKernelTable* avx2SampleKernels() {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,322 @@
+#include "SampleKernels.h"
+
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+
+#include "SampleKernelsScalar.h"
+#include <cstring>
+
+// GCC 12's AVX-512 headers trip -Wuninitialized on their own
+// _mm512_undefined_* placeholders
+#if defined(__GNUC__) && !defined(__clang__)
+    #pragma GCC diagnostic ignored "-Wuninitialized"
+    #pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include <immintrin.h>
+
+namespace {
+
+inline __m512i xorshift(__m512i x) {
+    x = _mm512_xor_si512(x, _mm512_slli_epi32(x, 13));
+    x = _mm512_xor_si512(x, _mm512_srli_epi32(x, 17));
+    return _mm512_xor_si512(x, _mm512_slli_epi32(x, 5));
+}
+
+inline __m512 tpdf(__m512i r) {
+    const __m512i lo = _mm512_and_si512(r, _mm512_set1_epi32(0xFFFF));
+    const __m512i hi = _mm512_srli_epi32(r, 16);
+    return _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_sub_epi32(lo, hi)), _mm512_set1_ps(1.0f / 65536.0f));
+}
+
+// All sixteen dither lanes advance together, one per sample
+inline __m512i quantize(const float* src, size_t i, float scale, float lo, float hi, DitherState* dither) {
+    __m512 y = _mm512_mul_ps(_mm512_loadu_ps(src + i), _mm512_set1_ps(scale));
+    if (dither) {
+        const __m512i r = xorshift(_mm512_loadu_si512(dither->lanes));
+        _mm512_storeu_si512(dither->lanes, r);
+        y = _mm512_add_ps(y, tpdf(r));
+    }
+    y = _mm512_min_ps(_mm512_max_ps(y, _mm512_set1_ps(lo)), _mm512_set1_ps(hi));
+    return _mm512_cvtps_epi32(y);
+}
+
+inline void store24(uint8_t* dst, __m128i v) {
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m128i packed = _mm_shuffle_epi8(v, shuffle);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), packed);
+    const int32_t tail = _mm_cvtsi128_si32(_mm_srli_si128(packed, 8));
+    std::memcpy(dst + 8, &tail, 4);
+}
+
+inline __m128i load24(const uint8_t* src) {
+    const __m128i shuffle = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    return _mm_srai_epi32(_mm_shuffle_epi8(v, shuffle), 8);
+}
+
+void floatToInt16Avx512(const float* src, int16_t* dst, size_t n, DitherState* dither) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m512i v = quantize(src, i, 32767.0f, -32768.0f, 32767.0f, dither);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm512_cvtsepi32_epi16(v));
+    }
+    scalarFloatToInt16(src, dst, n, dither, i);
+}
+
+void int16ToFloatAvx512(const int16_t* src, float* dst, size_t n) {
+    const __m512 scale = _mm512_set1_ps(1.0f / 32768.0f);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m512i v = _mm512_cvtepi16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)));
+        _mm512_storeu_ps(dst + i, _mm512_mul_ps(_mm512_cvtepi32_ps(v), scale));
+    }
+    scalarInt16ToFloat(src, dst, n, i);
+}
+
+void floatToInt24Avx512(const float* src, uint8_t* dst, size_t n, DitherState* dither) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m512i v = quantize(src, i, 8388607.0f, -8388608.0f, 8388607.0f, dither);
+        store24(dst + 3 * i, _mm512_extracti32x4_epi32(v, 0));
+        store24(dst + 3 * i + 12, _mm512_extracti32x4_epi32(v, 1));
+        store24(dst + 3 * i + 24, _mm512_extracti32x4_epi32(v, 2));
+        store24(dst + 3 * i + 36, _mm512_extracti32x4_epi32(v, 3));
+    }
+    scalarFloatToInt24(src, dst, n, dither, i);
+}
+
+void int24ToFloatAvx512(const uint8_t* src, float* dst, size_t n) {
+    const __m512 scale = _mm512_set1_ps(1.0f / 8388608.0f);
+    size_t i = 0;
+    // The last 16-byte load reaches 4 bytes past the 16 samples
+    for (; i + 18 <= n; i += 16) {
+        const uint8_t* p = src + 3 * i;
+        __m512i v = _mm512_castsi128_si512(load24(p));
+        v = _mm512_inserti32x4(v, load24(p + 12), 1);
+        v = _mm512_inserti32x4(v, load24(p + 24), 2);
+        v = _mm512_inserti32x4(v, load24(p + 36), 3);
+        _mm512_storeu_ps(dst + i, _mm512_mul_ps(_mm512_cvtepi32_ps(v), scale));
+    }
+    scalarInt24ToFloat(src, dst, n, i);
+}
+
+inline __m128i ulawCodes(const float* src, size_t i) {
+    const __m512 r = _mm512_cvtepi32_ps(quantize(src, i, 32767.0f, -32768.0f, 32767.0f, nullptr));
+    const __m512i sign = _mm512_slli_epi32(_mm512_srli_epi32(_mm512_castps_si512(r), 31), 7);
+    const __m512 abs = _mm512_abs_ps(r);
+    const __m512 mag = _mm512_add_ps(_mm512_min_ps(abs, _mm512_set1_ps(32635.0f)), _mm512_set1_ps(132.0f));
+    const __m512i bits = _mm512_castps_si512(mag);
+    const __m512i exponent = _mm512_sub_epi32(_mm512_srli_epi32(bits, 23), _mm512_set1_epi32(134));
+    const __m512i mantissa = _mm512_and_si512(_mm512_srli_epi32(bits, 19), _mm512_set1_epi32(0x0F));
+    const __m512i code = _mm512_or_si512(sign, _mm512_or_si512(_mm512_slli_epi32(exponent, 4), mantissa));
+    return _mm512_cvtepi32_epi8(_mm512_xor_si512(code, _mm512_set1_epi32(0xFF)));
+}
+
+inline __m128i alawCodes(const float* src, size_t i) {
+    const __m512i v = _mm512_srai_epi32(quantize(src, i, 32767.0f, -32768.0f, 32767.0f, nullptr), 3);
+    const __mmask16 negative = _mm512_cmplt_epi32_mask(v, _mm512_setzero_si512());
+    const __m512i mask = _mm512_mask_blend_epi32(negative, _mm512_set1_epi32(0xD5), _mm512_set1_epi32(0x55));
+    const __m512i mag = _mm512_xor_si512(v, _mm512_srai_epi32(v, 31));
+    const __m512i bits = _mm512_castps_si512(_mm512_cvtepi32_ps(mag));
+    const __mmask16 large = _mm512_cmpge_epi32_mask(mag, _mm512_set1_epi32(32));
+    const __m512i segment = _mm512_maskz_sub_epi32(large, _mm512_srli_epi32(bits, 23), _mm512_set1_epi32(131));
+    const __m512i mantissa = _mm512_mask_blend_epi32(large, _mm512_srli_epi32(mag, 1),
+                                                     _mm512_and_si512(_mm512_srli_epi32(bits, 19), _mm512_set1_epi32(0x0F)));
+    return _mm512_cvtepi32_epi8(_mm512_xor_si512(_mm512_or_si512(_mm512_slli_epi32(segment, 4), mantissa), mask));
+}
+
+void floatToUlawAvx512(const float* src, uint8_t* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), ulawCodes(src, i));
+    }
+    scalarFloatToUlaw(src, dst, n, i);
+}
+
+void floatToAlawAvx512(const float* src, uint8_t* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), alawCodes(src, i));
+    }
+    scalarFloatToAlaw(src, dst, n, i);
+}
+
+inline void lookup(const uint8_t* src, float* dst, size_t n, const float* table) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m512i index = _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+        _mm512_storeu_ps(dst + i, _mm512_i32gather_ps(index, table, 4));
+    }
+    for (; i < n; ++i) dst[i] = table[src[i]];
+}
+
+void ulawToFloatAvx512(const uint8_t* src, float* dst, size_t n) {
+    lookup(src, dst, n, ulawTable());
+}
+
+void alawToFloatAvx512(const uint8_t* src, float* dst, size_t n) {
+    lookup(src, dst, n, alawTable());
+}
+
+void floatToHalfAvx512(const float* src, uint16_t* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m256i h = _mm512_cvtps_ph(_mm512_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), h);
+    }
+    scalarFloatToHalf(src, dst, n, i);
+}
+
+void halfToFloatAvx512(const uint16_t* src, float* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(dst + i, _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i))));
+    }
+    scalarHalfToFloat(src, dst, n, i);
+}
+
+void applyGainAvx512(float* buf, size_t n, float gain) {
+    const __m512 g = _mm512_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(buf + i, _mm512_mul_ps(_mm512_loadu_ps(buf + i), g));
+    }
+    if (i < n) {
+        const __mmask16 m = static_cast<__mmask16>((1u << (n - i)) - 1);
+        _mm512_mask_storeu_ps(buf + i, m, _mm512_mul_ps(_mm512_maskz_loadu_ps(m, buf + i), g));
+    }
+}
+
+void applyRampAvx512(float* buf, size_t n, float start, float step) {
+    const __m512 s = _mm512_set1_ps(start);
+    const __m512 d = _mm512_set1_ps(step);
+    __m512 idx = _mm512_setr_ps(1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16);
+    const __m512 sixteen = _mm512_set1_ps(16.0f);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m512 g = _mm512_add_ps(s, _mm512_mul_ps(d, idx));
+        _mm512_storeu_ps(buf + i, _mm512_mul_ps(_mm512_loadu_ps(buf + i), g));
+        idx = _mm512_add_ps(idx, sixteen);
+    }
+    scalarApplyRamp(buf, n, start, step, i);
+}
+
+void mixAccumulateAvx512(float* dst, const float* src, size_t n, float gain) {
+    const __m512 g = _mm512_set1_ps(gain);
+    const __m512 lo = _mm512_set1_ps(-1.0f);
+    const __m512 hi = _mm512_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 v = _mm512_add_ps(_mm512_loadu_ps(dst + i), _mm512_mul_ps(_mm512_loadu_ps(src + i), g));
+        _mm512_storeu_ps(dst + i, _mm512_min_ps(_mm512_max_ps(v, lo), hi));
+    }
+    if (i < n) {
+        const __mmask16 m = static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m512 v = _mm512_add_ps(_mm512_maskz_loadu_ps(m, dst + i),
+                                 _mm512_mul_ps(_mm512_maskz_loadu_ps(m, src + i), g));
+        _mm512_mask_storeu_ps(dst + i, m, _mm512_min_ps(_mm512_max_ps(v, lo), hi));
+    }
+}
+
+void multiplyAvx512(float* dst, const float* src, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(dst + i, _mm512_mul_ps(_mm512_loadu_ps(dst + i), _mm512_loadu_ps(src + i)));
+    }
+    scalarMultiply(dst, src, n, i);
+}
+
+void multiplyAddAvx512(float* dst, const float* a, const float* b, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m512 p = _mm512_mul_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+        _mm512_storeu_ps(dst + i, _mm512_add_ps(_mm512_loadu_ps(dst + i), p));
+    }
+    scalarMultiplyAdd(dst, a, b, n, i);
+}
+
+void magnitudeSquaredAvx512(const float* re, const float* im, float* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m512 r = _mm512_loadu_ps(re + i);
+        const __m512 m = _mm512_loadu_ps(im + i);
+        _mm512_storeu_ps(dst + i, _mm512_add_ps(_mm512_mul_ps(r, r), _mm512_mul_ps(m, m)));
+    }
+    scalarMagnitudeSquared(re, im, dst, n, i);
+}
+
+float peakAvx512(const float* src, size_t n) {
+    __m512 m = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        m = _mm512_max_ps(m, _mm512_abs_ps(_mm512_loadu_ps(src + i)));
+    }
+    if (i < n) {
+        const __mmask16 k = static_cast<__mmask16>((1u << (n - i)) - 1);
+        m = _mm512_max_ps(m, _mm512_abs_ps(_mm512_maskz_loadu_ps(k, src + i)));
+    }
+    return _mm512_reduce_max_ps(m);
+}
+
+float sumSquaresAvx512(const float* src, size_t n) {
+    __m512 a = _mm512_setzero_ps();
+    __m512 b = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m512 x = _mm512_loadu_ps(src + i);
+        const __m512 y = _mm512_loadu_ps(src + i + 16);
+        a = _mm512_fmadd_ps(x, x, a);
+        b = _mm512_fmadd_ps(y, y, b);
+    }
+    return scalarSumSquares(src, n, i, _mm512_reduce_add_ps(_mm512_add_ps(a, b)));
+}
+
+void interleave2Avx512(const float* left, const float* right, float* dst, size_t frames) {
+    const __m512i lo_idx = _mm512_setr_epi32(0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+    const __m512i hi_idx = _mm512_setr_epi32(8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+    size_t i = 0;
+    for (; i + 16 <= frames; i += 16) {
+        const __m512 l = _mm512_loadu_ps(left + i);
+        const __m512 r = _mm512_loadu_ps(right + i);
+        _mm512_storeu_ps(dst + 2 * i, _mm512_permutex2var_ps(l, lo_idx, r));
+        _mm512_storeu_ps(dst + 2 * i + 16, _mm512_permutex2var_ps(l, hi_idx, r));
+    }
+    scalarInterleave2(left, right, dst, frames, i);
+}
+
+void deinterleave2Avx512(const float* src, float* left, float* right, size_t frames) {
+    const __m512i even = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+    const __m512i odd = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+    size_t i = 0;
+    for (; i + 16 <= frames; i += 16) {
+        const __m512 a = _mm512_loadu_ps(src + 2 * i);
+        const __m512 b = _mm512_loadu_ps(src + 2 * i + 16);
+        _mm512_storeu_ps(left + i, _mm512_permutex2var_ps(a, even, b));
+        _mm512_storeu_ps(right + i, _mm512_permutex2var_ps(a, odd, b));
+    }
+    scalarDeinterleave2(src, left, right, frames, i);
+}
+
+const SampleKernelTable AVX512_TABLE = {
+    "avx512",
+    floatToInt16Avx512, int16ToFloatAvx512, floatToInt24Avx512, int24ToFloatAvx512,
+    floatToUlawAvx512, ulawToFloatAvx512, floatToAlawAvx512, alawToFloatAvx512,
+    floatToHalfAvx512, halfToFloatAvx512,
+    applyGainAvx512, applyRampAvx512, mixAccumulateAvx512,
+    multiplyAvx512, multiplyAddAvx512, magnitudeSquaredAvx512,
+    peakAvx512, sumSquaresAvx512,
+    interleave2Avx512, deinterleave2Avx512
+};
+
+} // namespace
+
+const SampleKernelTable* avx512SampleKernels() {
+    return &AVX512_TABLE;
+}
+
+#else
+
+const SampleKernelTable* avx512SampleKernels() {
+    return nullptr;
+}
+
+#endif
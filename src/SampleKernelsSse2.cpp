@@ -0,0 +1,357 @@
+#include "SampleKernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+
+#include "SampleKernelsScalar.h"
+#include <emmintrin.h>
+
+namespace {
+
+// Four lanes of xorshift32, matching ditherNext() lane for lane
+inline __m128i xorshift(__m128i x) {
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+    return _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+}
+
+inline __m128 tpdf(__m128i r) {
+    const __m128i lo = _mm_and_si128(r, _mm_set1_epi32(0xFFFF));
+    const __m128i hi = _mm_srli_epi32(r, 16);
+    return _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(lo, hi)), _mm_set1_ps(1.0f / 65536.0f));
+}
+
+// Scaled, dithered and clamped samples i..i+3 rounded to int32
+inline __m128i quantize(const float* src, size_t i, float scale, float lo, float hi, DitherState* dither) {
+    __m128 y = _mm_mul_ps(_mm_loadu_ps(src + i), _mm_set1_ps(scale));
+    if (dither) {
+        __m128i* lane = reinterpret_cast<__m128i*>(dither->lanes + (i & 15));
+        const __m128i r = xorshift(_mm_loadu_si128(lane));
+        _mm_storeu_si128(lane, r);
+        y = _mm_add_ps(y, tpdf(r));
+    }
+    y = _mm_min_ps(_mm_max_ps(y, _mm_set1_ps(lo)), _mm_set1_ps(hi));
+    return _mm_cvtps_epi32(y);
+}
+
+void floatToInt16Sse2(const float* src, int16_t* dst, size_t n, DitherState* dither) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i a = quantize(src, i, 32767.0f, -32768.0f, 32767.0f, dither);
+        const __m128i b = quantize(src, i + 4, 32767.0f, -32768.0f, 32767.0f, dither);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(a, b));
+    }
+    scalarFloatToInt16(src, dst, n, dither, i);
+}
+
+void int16ToFloatSse2(const int16_t* src, float* dst, size_t n) {
+    const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        // Sign-extend by placing each int16 in the top half and shifting down
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    scalarInt16ToFloat(src, dst, n, i);
+}
+
+// SSE2 has no byte shuffle, so only the arithmetic is vectorised for int24
+void floatToInt24Sse2(const float* src, uint8_t* dst, size_t n, DitherState* dither) {
+    alignas(16) int32_t tmp[4];
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_store_si128(reinterpret_cast<__m128i*>(tmp), quantize(src, i, 8388607.0f, -8388608.0f, 8388607.0f, dither));
+        for (int k = 0; k < 4; ++k) {
+            uint8_t* out = dst + 3 * (i + k);
+            out[0] = static_cast<uint8_t>(tmp[k]);
+            out[1] = static_cast<uint8_t>(tmp[k] >> 8);
+            out[2] = static_cast<uint8_t>(tmp[k] >> 16);
+        }
+    }
+    scalarFloatToInt24(src, dst, n, dither, i);
+}
+
+inline int32_t unpack24(const uint8_t* in) {
+    return static_cast<int32_t>(static_cast<uint32_t>(in[0]) << 8 | static_cast<uint32_t>(in[1]) << 16 |
+                                static_cast<uint32_t>(in[2]) << 24);
+}
+
+void int24ToFloatSse2(const uint8_t* src, float* dst, size_t n) {
+    const __m128 scale = _mm_set1_ps(1.0f / 8388608.0f);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const uint8_t* in = src + 3 * i;
+        // Built in registers; a round trip through memory stalls store forwarding
+        const __m128i v = _mm_srai_epi32(_mm_setr_epi32(unpack24(in), unpack24(in + 3),
+                                                        unpack24(in + 6), unpack24(in + 9)), 8);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+    }
+    scalarInt24ToFloat(src, dst, n, i);
+}
+
+// G.711 codes for four samples, computed on the rounded values as floats
+inline __m128i ulawCodes(const float* src, size_t i) {
+    const __m128 r = _mm_cvtepi32_ps(quantize(src, i, 32767.0f, -32768.0f, 32767.0f, nullptr));
+    const __m128i sign = _mm_slli_epi32(_mm_srli_epi32(_mm_castps_si128(r), 31), 7);
+    const __m128 abs = _mm_and_ps(r, _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF)));
+    const __m128 mag = _mm_add_ps(_mm_min_ps(abs, _mm_set1_ps(32635.0f)), _mm_set1_ps(132.0f));
+    const __m128i bits = _mm_castps_si128(mag);
+    const __m128i exponent = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(134));
+    const __m128i mantissa = _mm_and_si128(_mm_srli_epi32(bits, 19), _mm_set1_epi32(0x0F));
+    const __m128i code = _mm_or_si128(sign, _mm_or_si128(_mm_slli_epi32(exponent, 4), mantissa));
+    return _mm_xor_si128(code, _mm_set1_epi32(0xFF));
+}
+
+inline __m128i alawCodes(const float* src, size_t i) {
+    const __m128i v = _mm_srai_epi32(quantize(src, i, 32767.0f, -32768.0f, 32767.0f, nullptr), 3);
+    const __m128i negative = _mm_srai_epi32(v, 31);
+    const __m128i mask = _mm_or_si128(_mm_and_si128(negative, _mm_set1_epi32(0x55)),
+                                      _mm_andnot_si128(negative, _mm_set1_epi32(0xD5)));
+    const __m128i mag = _mm_xor_si128(v, negative);   // -v - 1 for negative v
+    const __m128i bits = _mm_castps_si128(_mm_cvtepi32_ps(mag));
+    const __m128i small = _mm_cmplt_epi32(mag, _mm_set1_epi32(32));
+    const __m128i segment = _mm_andnot_si128(small, _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(131)));
+    const __m128i mantissa = _mm_or_si128(_mm_and_si128(small, _mm_srli_epi32(mag, 1)),
+                                          _mm_andnot_si128(small, _mm_and_si128(_mm_srli_epi32(bits, 19), _mm_set1_epi32(0x0F))));
+    return _mm_xor_si128(_mm_or_si128(_mm_slli_epi32(segment, 4), mantissa), mask);
+}
+
+inline void storeCodes(uint8_t* dst, __m128i a, __m128i b, __m128i c, __m128i d) {
+    const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), packed);
+}
+
+void floatToUlawSse2(const float* src, uint8_t* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        storeCodes(dst + i, ulawCodes(src, i), ulawCodes(src, i + 4), ulawCodes(src, i + 8), ulawCodes(src, i + 12));
+    }
+    scalarFloatToUlaw(src, dst, n, i);
+}
+
+void floatToAlawSse2(const float* src, uint8_t* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        storeCodes(dst + i, alawCodes(src, i), alawCodes(src, i + 4), alawCodes(src, i + 8), alawCodes(src, i + 12));
+    }
+    scalarFloatToAlaw(src, dst, n, i);
+}
+
+// Decoding is a table lookup; without gathers SSE2 cannot do better
+void ulawToFloatSse2(const uint8_t* src, float* dst, size_t n) {
+    scalarUlawToFloat(src, dst, n);
+}
+
+void alawToFloatSse2(const uint8_t* src, float* dst, size_t n) {
+    scalarAlawToFloat(src, dst, n);
+}
+
+// The scalar half conversion, four lanes at a time
+void floatToHalfSse2(const float* src, uint16_t* dst, size_t n) {
+    const __m128i sign_mask = _mm_set1_epi32(static_cast<int>(0x80000000u));
+    const __m128i overflow = _mm_set1_epi32((127 + 16) << 23);
+    const __m128i infinity = _mm_set1_epi32(0x7F800000);
+    const __m128i normal = _mm_set1_epi32(113 << 23);
+    const __m128i magic = _mm_set1_epi32(static_cast<int>(HALF_DENORM_MAGIC));
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i halves[2];
+        for (int k = 0; k < 2; ++k) {
+            __m128i x = _mm_castps_si128(_mm_loadu_ps(src + i + 4 * k));
+            const __m128i sign = _mm_and_si128(x, sign_mask);
+            x = _mm_xor_si128(x, sign);
+
+            // Magnitudes are below 2^31, so signed compares are safe
+            const __m128i big = _mm_cmpgt_epi32(x, _mm_sub_epi32(overflow, _mm_set1_epi32(1)));
+            const __m128i nan = _mm_cmpgt_epi32(x, infinity);
+            const __m128i tiny = _mm_cmplt_epi32(x, normal);
+
+            const __m128i special = _mm_or_si128(_mm_set1_epi32(0x7C00), _mm_and_si128(nan, _mm_set1_epi32(0x0200)));
+            const __m128i subnormal = _mm_sub_epi32(
+                _mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(x), _mm_castsi128_ps(magic))), magic);
+            const __m128i odd = _mm_and_si128(_mm_srli_epi32(x, 13), _mm_set1_epi32(1));
+            const __m128i rounded = _mm_srli_epi32(
+                _mm_add_epi32(_mm_add_epi32(x, _mm_set1_epi32(static_cast<int>(((15u - 127u) << 23) + 0xFFF))), odd), 13);
+
+            __m128i h = _mm_or_si128(_mm_and_si128(tiny, subnormal), _mm_andnot_si128(tiny, rounded));
+            h = _mm_or_si128(_mm_and_si128(big, special), _mm_andnot_si128(big, h));
+            // Sign-extend so the signed pack below keeps the 16-bit pattern
+            halves[k] = _mm_srai_epi32(_mm_slli_epi32(_mm_or_si128(h, _mm_srli_epi32(sign, 16)), 16), 16);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(halves[0], halves[1]));
+    }
+    scalarFloatToHalf(src, dst, n, i);
+}
+
+void halfToFloatSse2(const uint16_t* src, float* dst, size_t n) {
+    const __m128i exponent_mask = _mm_set1_epi32(0x7C00 << 13);
+    const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32(113 << 23));
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i words[2] = {_mm_unpacklo_epi16(h, _mm_setzero_si128()),
+                                  _mm_unpackhi_epi16(h, _mm_setzero_si128())};
+        for (int k = 0; k < 2; ++k) {
+            __m128i x = _mm_slli_epi32(_mm_and_si128(words[k], _mm_set1_epi32(0x7FFF)), 13);
+            const __m128i exponent = _mm_and_si128(x, exponent_mask);
+            x = _mm_add_epi32(x, _mm_set1_epi32((127 - 15) << 23));
+
+            const __m128i special = _mm_cmpeq_epi32(exponent, exponent_mask);
+            const __m128i zero = _mm_cmpeq_epi32(exponent, _mm_setzero_si128());
+            x = _mm_add_epi32(x, _mm_and_si128(special, _mm_set1_epi32((128 - 16) << 23)));
+            const __m128i subnormal = _mm_castps_si128(
+                _mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(x, _mm_set1_epi32(1 << 23))), magic));
+            x = _mm_or_si128(_mm_and_si128(zero, subnormal), _mm_andnot_si128(zero, x));
+
+            const __m128i sign = _mm_slli_epi32(_mm_and_si128(words[k], _mm_set1_epi32(0x8000)), 16);
+            _mm_storeu_ps(dst + i + 4 * k, _mm_castsi128_ps(_mm_or_si128(x, sign)));
+        }
+    }
+    scalarHalfToFloat(src, dst, n, i);
+}
+
+void applyGainSse2(float* buf, size_t n, float gain) {
+    const __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(buf + i, _mm_mul_ps(_mm_loadu_ps(buf + i), g));
+    }
+    scalarApplyGain(buf, n, gain, i);
+}
+
+void applyRampSse2(float* buf, size_t n, float start, float step) {
+    const __m128 s = _mm_set1_ps(start);
+    const __m128 d = _mm_set1_ps(step);
+    __m128 idx = _mm_setr_ps(1.0f, 2.0f, 3.0f, 4.0f);
+    const __m128 four = _mm_set1_ps(4.0f);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128 g = _mm_add_ps(s, _mm_mul_ps(d, idx));
+        _mm_storeu_ps(buf + i, _mm_mul_ps(_mm_loadu_ps(buf + i), g));
+        idx = _mm_add_ps(idx, four);
+    }
+    scalarApplyRamp(buf, n, start, step, i);
+}
+
+void mixAccumulateSse2(float* dst, const float* src, size_t n, float gain) {
+    const __m128 g = _mm_set1_ps(gain);
+    const __m128 lo = _mm_set1_ps(-1.0f);
+    const __m128 hi = _mm_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), g));
+        _mm_storeu_ps(dst + i, _mm_min_ps(_mm_max_ps(v, lo), hi));
+    }
+    scalarMixAccumulate(dst, src, n, gain, i);
+}
+
+void multiplySse2(float* dst, const float* src, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i)));
+    }
+    scalarMultiply(dst, src, n, i);
+}
+
+void multiplyAddSse2(float* dst, const float* a, const float* b, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128 p = _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), p));
+    }
+    scalarMultiplyAdd(dst, a, b, n, i);
+}
+
+void magnitudeSquaredSse2(const float* re, const float* im, float* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128 r = _mm_loadu_ps(re + i);
+        const __m128 m = _mm_loadu_ps(im + i);
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_mul_ps(r, r), _mm_mul_ps(m, m)));
+    }
+    scalarMagnitudeSquared(re, im, dst, n, i);
+}
+
+inline float horizontalMax(__m128 v) {
+    v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(v);
+}
+
+inline float horizontalSum(__m128 v) {
+    v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(v);
+}
+
+float peakSse2(const float* src, size_t n) {
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 m = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        m = _mm_max_ps(m, _mm_and_ps(_mm_loadu_ps(src + i), abs_mask));
+    }
+    return scalarPeak(src, n, i, horizontalMax(m));
+}
+
+float sumSquaresSse2(const float* src, size_t n) {
+    __m128 a = _mm_setzero_ps();
+    __m128 b = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128 x = _mm_loadu_ps(src + i);
+        const __m128 y = _mm_loadu_ps(src + i + 4);
+        a = _mm_add_ps(a, _mm_mul_ps(x, x));
+        b = _mm_add_ps(b, _mm_mul_ps(y, y));
+    }
+    return scalarSumSquares(src, n, i, horizontalSum(_mm_add_ps(a, b)));
+}
+
+void interleave2Sse2(const float* left, const float* right, float* dst, size_t frames) {
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        const __m128 l = _mm_loadu_ps(left + i);
+        const __m128 r = _mm_loadu_ps(right + i);
+        _mm_storeu_ps(dst + 2 * i, _mm_unpacklo_ps(l, r));
+        _mm_storeu_ps(dst + 2 * i + 4, _mm_unpackhi_ps(l, r));
+    }
+    scalarInterleave2(left, right, dst, frames, i);
+}
+
+void deinterleave2Sse2(const float* src, float* left, float* right, size_t frames) {
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        const __m128 a = _mm_loadu_ps(src + 2 * i);
+        const __m128 b = _mm_loadu_ps(src + 2 * i + 4);
+        _mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+    scalarDeinterleave2(src, left, right, frames, i);
+}
+
+const SampleKernelTable SSE2_TABLE = {
+    "sse2",
+    floatToInt16Sse2, int16ToFloatSse2, floatToInt24Sse2, int24ToFloatSse2,
+    floatToUlawSse2, ulawToFloatSse2, floatToAlawSse2, alawToFloatSse2,
+    floatToHalfSse2, halfToFloatSse2,
+    applyGainSse2, applyRampSse2, mixAccumulateSse2,
+    multiplySse2, multiplyAddSse2, magnitudeSquaredSse2,
+    peakSse2, sumSquaresSse2,
+    interleave2Sse2, deinterleave2Sse2
+};
+
+} // namespace
+
+const SampleKernelTable* sse2SampleKernels() {
+    return &SSE2_TABLE;
+}
+
+#else
+
+const SampleKernelTable* sse2SampleKernels() {
+    return nullptr;
+}
+
+#endif
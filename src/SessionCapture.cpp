@@ -0,0 +1,251 @@
+#include "SessionCapture.h"
+#include "ThreadPolicy.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// Room for several hundred audio frames per connection between flushes
+constexpr size_t RING_BYTES = 256 * 1024;
+constexpr uint32_t CAPTURE_FILE_VERSION = 1;
+
+uint64_t steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t wallNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::atomic<uint64_t> g_next_instance_id{1};
+
+} // namespace
+
+struct SessionCapture::ConnectionRing {
+    explicit ConnectionRing(uint32_t id)
+        : ring(RING_BYTES), connection(id), retired(false), closed_ns(0), finished(false) {}
+
+    LockFreeRing<uint8_t> ring;
+    const uint32_t connection;
+    std::atomic<bool> retired;
+    std::atomic<uint64_t> closed_ns;
+    // Writer side: bytes read from the ring that do not yet make up a record
+    std::vector<uint8_t> partial;
+    bool finished;  // close record written, ring can go
+};
+
+SessionCapture::SessionCapture()
+    : instance_id_(g_next_instance_id.fetch_add(1)), file_(nullptr), next_connection_(1),
+      running_(false), captured_(0), dropped_(0) {
+    std::memcpy(header_.magic, "ASCP", 4);
+    header_.version = CAPTURE_FILE_VERSION;
+    header_.steady_base_ns = steadyNowNs();
+    header_.wall_clock_ns = wallNowNs();
+}
+
+SessionCapture::~SessionCapture() {
+    close();
+}
+
+bool SessionCapture::open(const std::string& path) {
+    if (running_) return true;
+
+    file_ = fopen(path.c_str(), "wb");
+    if (!file_) {
+        std::cerr << "Failed to open capture file " << path << std::endl;
+        return false;
+    }
+    if (fwrite(&header_, sizeof(header_), 1, file_) != 1) {
+        std::cerr << "Failed to write capture file header" << std::endl;
+        fclose(file_);
+        file_ = nullptr;
+        return false;
+    }
+
+    batch_.reserve(RING_BYTES);
+    running_ = true;
+    writer_thread_ = std::thread(&SessionCapture::writerLoop, this);
+    return true;
+}
+
+void SessionCapture::close() {
+    if (!running_) return;
+    running_ = false;
+
+    if (writer_thread_.joinable()) {
+        writer_thread_.join();
+    }
+    flushPending();
+
+    if (file_) {
+        fclose(file_);
+        file_ = nullptr;
+    }
+
+    if (dropped_ > 0) {
+        std::cerr << "Session capture dropped " << dropped_ << " messages" << std::endl;
+    }
+}
+
+void SessionCapture::record(uint8_t type, const uint8_t* payload, uint32_t size) {
+    if (!running_.load(std::memory_order_relaxed)) return;
+
+    ConnectionRing* cr = threadRing();
+    CaptureRecordHeader header;
+    header.arrival_ns = steadyNowNs() - header_.steady_base_ns;
+    header.connection = cr->connection;
+    header.size = size;
+    header.type = type;
+
+    // Only this thread writes the ring, so the space can only grow between
+    // the check and the two writes and the record goes in whole
+    if (cr->ring.space() < sizeof(header) + size) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    cr->ring.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+    if (size > 0) cr->ring.write(payload, size);
+    captured_.fetch_add(1, std::memory_order_relaxed);
+}
+
+SessionCapture::ConnectionRing* SessionCapture::threadRing() {
+    // Server connections each have their own thread, so the slot's ring is
+    // the connection; it closes when the thread exits
+    struct Slot {
+        uint64_t owner = 0;
+        std::shared_ptr<ConnectionRing> ring;
+        ~Slot() {
+            if (ring) retire(*ring);
+        }
+        static void retire(ConnectionRing& ring) {
+            ring.closed_ns = steadyNowNs();
+            ring.retired = true;
+        }
+    };
+    thread_local Slot slot;
+
+    if (slot.owner != instance_id_) {
+        if (slot.ring) Slot::retire(*slot.ring);
+
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        slot.ring = std::make_shared<ConnectionRing>(next_connection_++);
+        slot.owner = instance_id_;
+        rings_.push_back(slot.ring);
+    }
+    return slot.ring.get();
+}
+
+void SessionCapture::writerLoop() {
+    applyThreadPolicy(ThreadRole::BACKGROUND);
+    while (running_) {
+        flushPending();
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+void SessionCapture::flushPending() {
+    struct Pending {
+        uint64_t arrival_ns;
+        size_t offset;
+        size_t bytes;
+    };
+    std::vector<Pending> pending;
+    batch_.clear();
+
+    auto take = [&](uint64_t arrival_ns, const uint8_t* data, size_t bytes) {
+        pending.push_back({arrival_ns, batch_.size(), bytes});
+        batch_.insert(batch_.end(), data, data + bytes);
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        for (auto& cr : rings_) {
+            // Read retired before draining so a close is never written
+            // ahead of the connection's last messages
+            const bool retired = cr->retired;
+            const size_t n = cr->ring.available();
+            if (n > 0) {
+                const size_t start = cr->partial.size();
+                cr->partial.resize(start + n);
+                cr->partial.resize(start + cr->ring.read(cr->partial.data() + start, n));
+            }
+
+            size_t used = 0;
+            while (cr->partial.size() - used >= sizeof(CaptureRecordHeader)) {
+                CaptureRecordHeader header;
+                std::memcpy(&header, cr->partial.data() + used, sizeof(header));
+                const size_t bytes = sizeof(header) + header.size;
+                if (cr->partial.size() - used < bytes) break;
+                take(header.arrival_ns, cr->partial.data() + used, bytes);
+                used += bytes;
+            }
+            cr->partial.erase(cr->partial.begin(), cr->partial.begin() + used);
+
+            if (retired && cr->ring.available() == 0 && cr->partial.empty()) {
+                CaptureRecordHeader close{};
+                close.arrival_ns = cr->closed_ns - header_.steady_base_ns;
+                close.connection = cr->connection;
+                close.type = CAPTURE_CONNECTION_CLOSED;
+                take(close.arrival_ns, reinterpret_cast<const uint8_t*>(&close), sizeof(close));
+                cr->finished = true;
+            }
+        }
+
+        rings_.erase(std::remove_if(rings_.begin(), rings_.end(),
+            [](const std::shared_ptr<ConnectionRing>& cr) { return cr->finished; }), rings_.end());
+    }
+
+    if (pending.empty() || !file_) return;
+
+    std::stable_sort(pending.begin(), pending.end(),
+        [](const Pending& a, const Pending& b) { return a.arrival_ns < b.arrival_ns; });
+    for (const auto& p : pending) {
+        fwrite(batch_.data() + p.offset, 1, p.bytes, file_);
+    }
+    fflush(file_);
+}
+
+CaptureReader::~CaptureReader() {
+    close();
+}
+
+bool CaptureReader::open(const std::string& path) {
+    close();
+    file_ = fopen(path.c_str(), "rb");
+    if (!file_) {
+        std::cerr << "Cannot open capture " << path << std::endl;
+        return false;
+    }
+    if (fread(&header_, sizeof(header_), 1, file_) != 1 || std::memcmp(header_.magic, "ASCP", 4) != 0) {
+        std::cerr << path << " is not an AudSync capture" << std::endl;
+        close();
+        return false;
+    }
+    if (header_.version != CAPTURE_FILE_VERSION) {
+        std::cerr << path << " has unsupported capture version " << header_.version << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void CaptureReader::close() {
+    if (file_) {
+        fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+bool CaptureReader::next(CaptureRecordHeader& record, std::vector<uint8_t>& payload) {
+    if (!file_ || fread(&record, sizeof(record), 1, file_) != 1) return false;
+    payload.resize(record.size);
+    return record.size == 0 || fread(payload.data(), 1, record.size, file_) == record.size;
+}
+
+bool CaptureReader::rewind() {
+    return file_ && fseek(file_, sizeof(CaptureFileHeader), SEEK_SET) == 0;
+}
@@ -0,0 +1,244 @@
+#include "SessionLogger.h"
+#include "ThreadPolicy.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+namespace {
+
+constexpr size_t RING_RECORDS = 1024;
+constexpr uint32_t LOG_FILE_VERSION = 1;
+
+struct EventFormat {
+  LogEvent event;
+  const char* format;
+};
+
+// Arguments are always passed as four long longs; unused ones are ignored
+const EventFormat EVENT_FORMATS[] = {
+  {LogEvent::SERVER_STARTED,    "AudSync Server started on port %lld"},
+  {LogEvent::SERVER_STOPPED,    "Server stopped"},
+  {LogEvent::SERVER_STATUS,     "Server status: %lld clients connected"},
+  {LogEvent::CLIENT_ACCEPTED,   "Client connected: %lld"},
+  {LogEvent::CLIENT_CLOSED,     "Client disconnected: %lld"},
+  {LogEvent::ACCEPT_FAILED,     "Accept failed"},
+  {LogEvent::CLIENT_JOINED,     "Client %lld connected. Total clients: %lld"},
+  {LogEvent::CLIENT_LEFT,       "Client %lld disconnected. Total clients: %lld"},
+  {LogEvent::CLIENT_READY,      "Client %lld is ready for audio"},
+  {LogEvent::AUDIO_STARTED,     "Audio system started - you can now speak!"},
+  {LogEvent::AUDIO_STOPPED,     "Audio system stopped"},
+  {LogEvent::RECORDING_STARTED, "Recording started"},
+  {LogEvent::RECORDING_STOPPED, "Recording stopped"},
+  {LogEvent::PLAYBACK_STARTED,  "Playback started"},
+  {LogEvent::PLAYBACK_STOPPED,  "Playback stopped"},
+  {LogEvent::CONNECTION_LOST,   "Connection to server lost"},
+  {LogEvent::CODEC_SELECTED,    "Client %lld switched to codec %lld"},
+  {LogEvent::FEC_ADAPTED,       "FEC now every %lld frames for %lld/256 reported loss"},
+  {LogEvent::CLOCK_SYNCED,      "Media clock synchronized: offset %lld us, round trip %lld us"},
+  {LogEvent::MULTICAST_JOINED,  "Client %lld receives audio by multicast"},
+  {LogEvent::MULTICAST_LEFT,    "Client %lld fell back to unicast audio"},
+};
+
+uint64_t steadyNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t wallNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::atomic<uint64_t> g_next_instance_id{1};
+
+} // namespace
+
+struct SessionLogger::ThreadRing {
+  explicit ThreadRing(uint16_t id) : ring(RING_RECORDS), thread_id(id), retired(false) {}
+
+  LockFreeRing<LogRecord> ring;
+  const uint16_t thread_id;
+  std::atomic<bool> retired;
+};
+
+SessionLogger::SessionLogger(bool echo_to_console)
+    : instance_id_(g_next_instance_id.fetch_add(1)), echo_(echo_to_console), file_(nullptr),
+      next_thread_id_(0), running_(false), dropped_(0) {
+  std::memcpy(header_.magic, "ASLG", 4);
+  header_.version = LOG_FILE_VERSION;
+  header_.steady_base_ns = steadyNowNs();
+  header_.wall_clock_ns = wallNowNs();
+}
+
+SessionLogger::~SessionLogger() {
+  close();
+}
+
+bool SessionLogger::open(const std::string& path) {
+  if (running_) return true;
+
+  if (!path.empty()) {
+    file_ = fopen(path.c_str(), "wb");
+    if (!file_) {
+      std::cerr << "Failed to open session log " << path << std::endl;
+      return false;
+    }
+    if (fwrite(&header_, sizeof(header_), 1, file_) != 1) {
+      std::cerr << "Failed to write session log header" << std::endl;
+      fclose(file_);
+      file_ = nullptr;
+      return false;
+    }
+  }
+
+  batch_.reserve(RING_RECORDS * 4);
+  running_ = true;
+  flush_thread_ = std::thread(&SessionLogger::flushLoop, this);
+  return true;
+}
+
+void SessionLogger::close() {
+  if (!running_) return;
+  running_ = false;
+
+  if (flush_thread_.joinable()) {
+    flush_thread_.join();
+  }
+  flushPending();
+
+  if (file_) {
+    fclose(file_);
+    file_ = nullptr;
+  }
+
+  if (dropped_ > 0) {
+    std::cerr << "Session logger dropped " << dropped_ << " records" << std::endl;
+  }
+}
+
+void SessionLogger::log(LogEvent event, int64_t a0, int64_t a1, int64_t a2, int64_t a3) {
+  if (!running_.load(std::memory_order_relaxed)) return;
+
+  ThreadRing* tr = threadRing();
+  LogRecord record;
+  record.timestamp_ns = steadyNowNs();
+  record.event = static_cast<uint16_t>(event);
+  record.thread_id = tr->thread_id;
+  record.reserved = 0;
+  record.args[0] = a0;
+  record.args[1] = a1;
+  record.args[2] = a2;
+  record.args[3] = a3;
+
+  if (!tr->ring.push(record)) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void SessionLogger::registerThread() {
+  threadRing();
+}
+
+SessionLogger::ThreadRing* SessionLogger::threadRing() {
+  // One slot per thread; retires its ring when the thread exits so the
+  // flush thread can reclaim it once drained
+  struct Slot {
+    uint64_t owner = 0;
+    std::shared_ptr<ThreadRing> ring;
+    ~Slot() {
+      if (ring) ring->retired = true;
+    }
+  };
+  thread_local Slot slot;
+
+  if (slot.owner != instance_id_) {
+    if (slot.ring) slot.ring->retired = true;
+
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    slot.ring = std::make_shared<ThreadRing>(next_thread_id_++);
+    slot.owner = instance_id_;
+    rings_.push_back(slot.ring);
+  }
+  return slot.ring.get();
+}
+
+void SessionLogger::flushLoop() {
+  applyThreadPolicy(ThreadRole::BACKGROUND);
+  while (running_) {
+    flushPending();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+}
+
+void SessionLogger::flushPending() {
+  batch_.clear();
+  {
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    for (auto& tr : rings_) {
+      size_t n = tr->ring.available();
+      if (n == 0) continue;
+      size_t start = batch_.size();
+      batch_.resize(start + n);
+      batch_.resize(start + tr->ring.read(batch_.data() + start, n));
+    }
+
+    rings_.erase(std::remove_if(rings_.begin(), rings_.end(),
+        [](const std::shared_ptr<ThreadRing>& tr) {
+          return tr->retired && tr->ring.available() == 0;
+        }), rings_.end());
+  }
+
+  if (batch_.empty()) return;
+
+  std::stable_sort(batch_.begin(), batch_.end(),
+      [](const LogRecord& a, const LogRecord& b) { return a.timestamp_ns < b.timestamp_ns; });
+
+  if (file_) {
+    fwrite(batch_.data(), sizeof(LogRecord), batch_.size(), file_);
+    fflush(file_);
+  }
+
+  if (echo_) {
+    for (const auto& record : batch_) {
+      std::cout << formatMessage(record) << '\n';
+    }
+    std::cout.flush();
+  }
+}
+
+std::string SessionLogger::formatMessage(const LogRecord& record) {
+  char text[256];
+  const long long a0 = record.args[0], a1 = record.args[1], a2 = record.args[2], a3 = record.args[3];
+
+  for (const auto& entry : EVENT_FORMATS) {
+    if (static_cast<uint16_t>(entry.event) == record.event) {
+      snprintf(text, sizeof(text), entry.format, a0, a1, a2, a3);
+      return text;
+    }
+  }
+
+  snprintf(text, sizeof(text), "event %u (%lld, %lld, %lld, %lld)",
+           static_cast<unsigned>(record.event), a0, a1, a2, a3);
+  return text;
+}
+
+std::string SessionLogger::formatRecord(const LogRecord& record, const LogFileHeader& header) {
+  const uint64_t wall_ns = header.wall_clock_ns + (record.timestamp_ns - header.steady_base_ns);
+  const time_t seconds = static_cast<time_t>(wall_ns / 1000000000ull);
+  const unsigned micros = static_cast<unsigned>((wall_ns / 1000ull) % 1000000ull);
+
+  std::tm tm_buf{};
+#ifdef _WIN32
+  localtime_s(&tm_buf, &seconds);
+#else
+  localtime_r(&seconds, &tm_buf);
+#endif
+
+  char prefix[64];
+  snprintf(prefix, sizeof(prefix), "%02d:%02d:%02d.%06u [T%u] ",
+           tm_buf.tm_hour, tm_buf.tm_min, tm_buf.tm_sec, micros,
+           static_cast<unsigned>(record.thread_id));
+  return prefix + formatMessage(record);
+}
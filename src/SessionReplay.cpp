@@ -0,0 +1,313 @@
+#include "SessionReplay.h"
+#include "ClockSync.h"
+#include "NetworkManager.h"
+#include "SessionCapture.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <poll.h>
+#endif
+
+namespace {
+
+// Message type and size, as NetworkManager frames them
+constexpr size_t MESSAGE_HEADER_BYTES = 5;
+// Unsent bytes a connection may queue before the replay waits for it
+constexpr size_t MAX_BACKLOG_BYTES = 1024 * 1024;
+constexpr size_t READ_CHUNK = 64 * 1024;
+constexpr int64_t IDLE_WAIT_NS = 50000000LL;
+
+bool setNonBlocking(SOCKET fd) {
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(fd, FIONBIO, &mode) == 0;
+#else
+    const int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+bool wouldBlock() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+int pollSockets(std::vector<pollfd>& fds, int64_t timeout_ns) {
+    timeout_ns = std::max<int64_t>(0, timeout_ns);
+#ifdef _WIN32
+    return WSAPoll(fds.data(), static_cast<ULONG>(fds.size()), static_cast<INT>((timeout_ns + 999999) / 1000000));
+#elif defined(__linux__)
+    timespec timeout;
+    timeout.tv_sec = static_cast<time_t>(timeout_ns / 1000000000LL);
+    timeout.tv_nsec = static_cast<long>(timeout_ns % 1000000000LL);
+    return ppoll(fds.data(), fds.size(), &timeout, nullptr);
+#else
+    return poll(fds.data(), fds.size(), static_cast<int>((timeout_ns + 999999) / 1000000));
+#endif
+}
+
+void shutdownSend(SOCKET fd) {
+#ifdef _WIN32
+    shutdown(fd, SD_SEND);
+#else
+    shutdown(fd, SHUT_WR);
+#endif
+}
+
+std::string fixed2(double value) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.2f", value);
+    return text;
+}
+
+std::string formatMs(uint64_t us) {
+    return fixed2(us / 1000.0);
+}
+
+} // namespace
+
+struct SessionReplay::Connection {
+    // CLOSING sends what is queued, then half-closes; DRAINING waits for
+    // the server to close its side, since closing with replies unread
+    // resets the connection and can lose the last messages
+    enum class State { OPEN, CLOSING, DRAINING, CLOSED };
+
+    SOCKET fd = INVALID_SOCKET_VAL;
+    State state = State::CLOSED;
+    std::vector<uint8_t> out;
+    size_t out_sent = 0;
+
+    size_t backlog() const { return out.size() - out_sent; }
+};
+
+bool SessionReplay::run(const std::string& capture_path, ReplayStats& stats) {
+    CaptureReader reader;
+    if (!reader.open(capture_path)) return false;
+
+    std::unordered_map<uint32_t, Connection> connections;
+    std::vector<uint8_t> scratch(READ_CHUNK);
+    std::vector<pollfd> fds;
+    std::vector<Connection*> polled;
+
+    auto closeConnection = [&](Connection& connection) {
+        if (connection.fd != INVALID_SOCKET_VAL) close_socket(connection.fd);
+        connection.fd = INVALID_SOCKET_VAL;
+        connection.state = Connection::State::CLOSED;
+        connection.out.clear();
+        connection.out_sent = 0;
+    };
+
+    auto open = [&](Connection& connection) {
+        const SOCKET fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(config_.port));
+        if (fd == INVALID_SOCKET_VAL || inet_pton(AF_INET, config_.host.c_str(), &address.sin_addr) <= 0 ||
+            connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR_VAL ||
+            !setNonBlocking(fd)) {
+            if (fd != INVALID_SOCKET_VAL) close_socket(fd);
+            stats.connect_failures++;
+            return;
+        }
+#ifdef _WIN32
+        char nodelay = 1;
+#else
+        int nodelay = 1;
+#endif
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+        connection.fd = fd;
+        connection.state = Connection::State::OPEN;
+        stats.connections++;
+    };
+
+    auto flush = [&](Connection& connection) {
+        while (connection.out_sent < connection.out.size()) {
+#ifdef _WIN32
+            const int sent = send(connection.fd, reinterpret_cast<const char*>(connection.out.data() + connection.out_sent),
+                                  static_cast<int>(connection.backlog()), SEND_FLAGS);
+#else
+            const ssize_t sent = send(connection.fd, connection.out.data() + connection.out_sent,
+                                      connection.backlog(), SEND_FLAGS);
+#endif
+            if (sent > 0) {
+                connection.out_sent += static_cast<size_t>(sent);
+            } else if (sent < 0 && wouldBlock()) {
+                break;
+            } else {
+                stats.closed_by_server++;
+                closeConnection(connection);
+                return;
+            }
+        }
+        if (connection.out_sent == connection.out.size()) {
+            connection.out.clear();
+            connection.out_sent = 0;
+            // Everything up to the close is out
+            if (connection.state == Connection::State::CLOSING) {
+                shutdownSend(connection.fd);
+                connection.state = Connection::State::DRAINING;
+            }
+        } else if (connection.out_sent >= MAX_BACKLOG_BYTES / 4) {
+            connection.out.erase(connection.out.begin(), connection.out.begin() + connection.out_sent);
+            connection.out_sent = 0;
+        }
+    };
+
+    // Replies are not checked, only read so the server never blocks on us
+    auto drain = [&](Connection& connection) {
+        for (;;) {
+#ifdef _WIN32
+            const int got = recv(connection.fd, reinterpret_cast<char*>(scratch.data()), static_cast<int>(scratch.size()), 0);
+#else
+            const ssize_t got = recv(connection.fd, scratch.data(), scratch.size(), 0);
+#endif
+            if (got > 0) {
+                stats.bytes_received += static_cast<uint64_t>(got);
+                if (static_cast<size_t>(got) < scratch.size()) return;
+            } else if (got < 0 && wouldBlock()) {
+                return;
+            } else {
+                if (connection.state == Connection::State::OPEN) stats.closed_by_server++;
+                closeConnection(connection);
+                return;
+            }
+        }
+    };
+
+    CaptureRecordHeader record;
+    std::vector<uint8_t> payload;
+    bool have_record = reader.next(record, payload);
+    const uint64_t first_ns = have_record ? record.arrival_ns : 0;
+    uint64_t last_ns = first_ns;
+    const int64_t start_ns = monotonicNowNs();
+
+    while (!stopping_) {
+        int64_t now = monotonicNowNs();
+        int64_t wake = now + IDLE_WAIT_NS;
+
+        while (have_record) {
+            // Arrivals are sorted within each of the capture's flushes, so
+            // an occasional earlier one simply goes out at once
+            const uint64_t offset_ns = record.arrival_ns > first_ns ? record.arrival_ns - first_ns : 0;
+            const int64_t due = config_.speed > 0.0
+                              ? start_ns + static_cast<int64_t>(offset_ns / config_.speed) : now;
+            if (due > now) {
+                wake = std::min(wake, due);
+                break;
+            }
+
+            auto inserted = connections.emplace(record.connection, Connection());
+            Connection& connection = inserted.first->second;
+            if (inserted.second) open(connection);
+            // A slow server holds back the whole replay rather than reorder it
+            if (connection.backlog() >= MAX_BACKLOG_BYTES) break;
+
+            if (connection.state != Connection::State::OPEN) {
+                if (record.type != CAPTURE_CONNECTION_CLOSED) stats.skipped++;
+            } else if (record.type == CAPTURE_CONNECTION_CLOSED) {
+                // The captured client went away without a DISCONNECT; close
+                // once what it sent is out
+                connection.state = Connection::State::CLOSING;
+                flush(connection);
+            } else {
+                const size_t at = connection.out.size();
+                connection.out.resize(at + MESSAGE_HEADER_BYTES + record.size);
+                connection.out[at] = record.type;
+                std::memcpy(&connection.out[at + 1], &record.size, sizeof(record.size));
+                if (record.size) std::memcpy(&connection.out[at + MESSAGE_HEADER_BYTES], payload.data(), record.size);
+                stats.messages++;
+                stats.bytes += MESSAGE_HEADER_BYTES + record.size;
+                if (config_.speed > 0.0) stats.lateness.record((now - due) / 1000);
+                if (record.type == static_cast<uint8_t>(MessageType::DISCONNECT)) {
+                    connection.state = Connection::State::CLOSING;
+                }
+                flush(connection);
+            }
+
+            last_ns = std::max<uint64_t>(last_ns, record.arrival_ns);
+            have_record = reader.next(record, payload);
+            now = monotonicNowNs();
+        }
+
+        if (!have_record) {
+            // Clients still connected when the capture ended say goodbye, so
+            // the fresh server is left as empty as it started
+            bool busy = false;
+            for (auto& entry : connections) {
+                Connection& connection = entry.second;
+                if (connection.state == Connection::State::OPEN) {
+                    const uint32_t size = 0;
+                    connection.out.push_back(static_cast<uint8_t>(MessageType::DISCONNECT));
+                    connection.out.insert(connection.out.end(), reinterpret_cast<const uint8_t*>(&size),
+                                          reinterpret_cast<const uint8_t*>(&size) + sizeof(size));
+                    connection.state = Connection::State::CLOSING;
+                    flush(connection);
+                }
+                busy = busy || connection.state != Connection::State::CLOSED;
+            }
+            if (!busy) break;
+        }
+
+        fds.clear();
+        polled.clear();
+        for (auto& entry : connections) {
+            Connection& connection = entry.second;
+            if (connection.state == Connection::State::CLOSED) continue;
+            pollfd p{};
+            p.fd = connection.fd;
+            p.events = POLLIN;
+            if (connection.backlog() > 0) p.events |= POLLOUT;
+            fds.push_back(p);
+            polled.push_back(&connection);
+        }
+        if (fds.empty()) {
+            if (wake > now) std::this_thread::sleep_for(std::chrono::nanoseconds(wake - now));
+            continue;
+        }
+        if (pollSockets(fds, wake - now) <= 0) continue;
+        for (size_t i = 0; i < fds.size(); ++i) {
+            Connection& connection = *polled[i];
+            if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) drain(connection);
+            if (connection.state != Connection::State::CLOSED && (fds[i].revents & POLLOUT)) flush(connection);
+        }
+    }
+
+    for (auto& entry : connections) closeConnection(entry.second);
+    stats.capture_seconds = (last_ns - first_ns) * 1e-9;
+    stats.elapsed_seconds = (monotonicNowNs() - start_ns) * 1e-9;
+    return true;
+}
+
+void ReplayStats::print(std::ostream& out, double speed) const {
+    const double seconds = std::max(1e-3, elapsed_seconds);
+    out << "Connections: " << connections << " opened, " << connect_failures << " failed to connect, "
+        << closed_by_server << " closed by the server" << std::endl;
+    out << "Sent: " << messages << " messages (" << static_cast<uint64_t>(messages / seconds) << " messages/s, "
+        << fixed2(bytes / seconds / 1e6) << " MB/s), " << skipped << " skipped" << std::endl;
+    out << "Received: " << fixed2(bytes_received / 1e6) << " MB" << std::endl;
+    out << "Replayed " << fixed2(capture_seconds) << " s of capture in " << fixed2(elapsed_seconds) << " s ("
+        << fixed2(capture_seconds / seconds) << "x)" << std::endl;
+    if (speed > 0.0 && lateness.count() > 0) {
+        out << "Behind schedule (ms): p50 " << formatMs(lateness.percentileUs(0.5))
+            << ", p99 " << formatMs(lateness.percentileUs(0.99))
+            << ", max " << formatMs(lateness.maxUs()) << std::endl;
+    }
+}
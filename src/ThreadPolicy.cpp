@@ -0,0 +1,290 @@
+#include "ThreadPolicy.h"
+#include "RealtimeMemory.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <cerrno>
+    #include <pthread.h>
+    #include <sched.h>
+    #include <sys/resource.h>
+    #include <unistd.h>
+    #ifdef __linux__
+        #include <sys/syscall.h>
+    #endif
+#endif
+
+namespace {
+
+constexpr int DEFAULT_RT_PRIORITY = 50;
+// Where a refused real-time request lands instead
+constexpr int RT_FALLBACK_NICE = -10;
+
+const char* ROLE_NAMES[] = {"audio", "network", "connection", "control", "background"};
+static_assert(sizeof(ROLE_NAMES) / sizeof(ROLE_NAMES[0]) == static_cast<size_t>(ThreadRole::COUNT),
+              "every role needs a name");
+
+struct RoleState {
+    ThreadPolicy policy;
+    bool reported = false;
+};
+
+std::mutex g_policy_mutex;
+RoleState g_roles[static_cast<size_t>(ThreadRole::COUNT)];
+
+const char* schedName(SchedClass sched) {
+    return sched == SchedClass::FIFO ? "SCHED_FIFO" : sched == SchedClass::RR ? "SCHED_RR" : "normal";
+}
+
+std::string cpuList(const std::vector<int>& cpus) {
+    std::string text;
+    for (size_t i = 0; i < cpus.size(); ++i) {
+        if (i) text += ",";
+        text += std::to_string(cpus[i]);
+    }
+    return text;
+}
+
+bool parseInt(const std::string& text, int& value) {
+    if (text.empty()) return false;
+    char* end = nullptr;
+    const long parsed = std::strtol(text.c_str(), &end, 10);
+    if (*end != '\0') return false;
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+// "2,3" or "0-3,6"
+bool parseCpus(const std::string& text, std::vector<int>& cpus) {
+    cpus.clear();
+    size_t pos = 0;
+    while (pos <= text.size()) {
+        const size_t comma = std::min(text.find(',', pos), text.size());
+        const std::string item = text.substr(pos, comma - pos);
+        const size_t dash = item.find('-');
+        int first = 0, last = 0;
+        if (dash == std::string::npos) {
+            if (!parseInt(item, first)) return false;
+            last = first;
+        } else if (!parseInt(item.substr(0, dash), first) || !parseInt(item.substr(dash + 1), last)) {
+            return false;
+        }
+        if (first < 0 || last < first || last >= 1024) return false;
+        for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+        pos = comma + 1;
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return !cpus.empty();
+}
+
+// Both return what the thread ended up with, for the report
+std::string applyScheduling(const ThreadPolicy& policy) {
+    std::string outcome;
+    int nice = policy.nice;
+
+#ifdef _WIN32
+    int priority = THREAD_PRIORITY_NORMAL;
+    if (policy.sched != SchedClass::NORMAL) {
+        priority = policy.priority >= 80 ? THREAD_PRIORITY_TIME_CRITICAL : THREAD_PRIORITY_HIGHEST;
+    } else if (nice < 0) {
+        priority = THREAD_PRIORITY_ABOVE_NORMAL;
+    } else if (nice > 0) {
+        priority = THREAD_PRIORITY_BELOW_NORMAL;
+    }
+    if (priority == THREAD_PRIORITY_NORMAL) return "normal";
+    if (!SetThreadPriority(GetCurrentThread(), priority)) {
+        return "priority refused (error " + std::to_string(GetLastError()) + "), normal";
+    }
+    return "thread priority " + std::to_string(priority);
+#else
+    if (policy.sched != SchedClass::NORMAL) {
+        const int sched = policy.sched == SchedClass::FIFO ? SCHED_FIFO : SCHED_RR;
+        int wanted = std::max(sched_get_priority_min(sched), std::min(policy.priority, sched_get_priority_max(sched)));
+        bool clamped = false;
+#ifdef RLIMIT_RTPRIO
+        // Unprivileged processes may use real-time priorities up to this
+        // limit (e.g. "@audio - rtprio 95" in limits.conf)
+        rlimit limit;
+        if (geteuid() != 0 && getrlimit(RLIMIT_RTPRIO, &limit) == 0 &&
+            limit.rlim_cur < static_cast<rlim_t>(wanted)) {
+            if (limit.rlim_max > limit.rlim_cur) {
+                limit.rlim_cur = std::min(limit.rlim_max, static_cast<rlim_t>(wanted));
+                setrlimit(RLIMIT_RTPRIO, &limit);
+            }
+            if (limit.rlim_cur > 0 && limit.rlim_cur < static_cast<rlim_t>(wanted)) {
+                wanted = static_cast<int>(limit.rlim_cur);
+                clamped = true;
+            }
+        }
+#endif
+        sched_param param{};
+        param.sched_priority = wanted;
+        const int result = pthread_setschedparam(pthread_self(), sched, &param);
+        if (result == 0) {
+            outcome = std::string(schedName(policy.sched)) + " " + std::to_string(wanted);
+            if (clamped) outcome += " (capped by RLIMIT_RTPRIO)";
+            return outcome;
+        }
+        outcome = std::string(schedName(policy.sched)) + " refused (" + std::strerror(result) + "), ";
+    }
+    if (nice == 0) return outcome + "normal";
+
+#ifdef __linux__
+    // Linux applies nice values per thread
+    if (setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), nice) == 0) {
+        return outcome + "nice " + std::to_string(nice);
+    }
+    return outcome + "nice " + std::to_string(nice) + " refused (" + std::strerror(errno) + "), normal";
+#else
+    return outcome + "normal (no per-thread nice here)";
+#endif
+#endif
+}
+
+std::string applyAffinity(const std::vector<int>& cpus) {
+    if (cpus.empty()) return std::string();
+#if defined(_WIN32)
+    DWORD_PTR mask = 0;
+    for (int cpu : cpus) {
+        if (cpu < static_cast<int>(sizeof(mask) * 8)) mask |= static_cast<DWORD_PTR>(1) << cpu;
+    }
+    if (mask == 0 || !SetThreadAffinityMask(GetCurrentThread(), mask)) {
+        return ", CPUs " + cpuList(cpus) + " refused";
+    }
+    return ", CPUs " + cpuList(cpus);
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    }
+    const int result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (result != 0) return ", CPUs " + cpuList(cpus) + " refused (" + std::strerror(result) + ")";
+    return ", CPUs " + cpuList(cpus);
+#else
+    return ", CPU affinity not supported here";
+#endif
+}
+
+} // namespace
+
+std::string ThreadPolicy::describe() const {
+    std::string text;
+    if (sched != SchedClass::NORMAL) {
+        text = std::string(schedName(sched)) + " " + std::to_string(priority);
+        if (nice != 0) text += " (else nice " + std::to_string(nice) + ")";
+    } else if (nice != 0) {
+        text = "nice " + std::to_string(nice);
+    } else {
+        text = "normal";
+    }
+    if (!cpus.empty()) text += ", CPUs " + cpuList(cpus);
+    return text;
+}
+
+const char* threadRoleName(ThreadRole role) {
+    const size_t index = static_cast<size_t>(role);
+    return index < static_cast<size_t>(ThreadRole::COUNT) ? ROLE_NAMES[index] : "unknown";
+}
+
+bool parseThreadPolicy(const std::string& spec, ThreadRole& role, ThreadPolicy& policy) {
+    const size_t equals = spec.find('=');
+    if (equals == std::string::npos) return false;
+    const std::string name = spec.substr(0, equals);
+    size_t index = 0;
+    while (index < static_cast<size_t>(ThreadRole::COUNT) && name != ROLE_NAMES[index]) ++index;
+    if (index == static_cast<size_t>(ThreadRole::COUNT)) return false;
+    role = static_cast<ThreadRole>(index);
+
+    std::string rest = spec.substr(equals + 1);
+    policy = ThreadPolicy();
+    const size_t at = rest.find('@');
+    if (at != std::string::npos) {
+        if (!parseCpus(rest.substr(at + 1), policy.cpus)) return false;
+        rest = rest.substr(0, at);
+    }
+    const size_t colon = rest.find(':');
+    const std::string sched = rest.substr(0, colon);
+    const std::string value = colon == std::string::npos ? std::string() : rest.substr(colon + 1);
+
+    if (sched == "fifo" || sched == "rr") {
+        policy.sched = sched == "fifo" ? SchedClass::FIFO : SchedClass::RR;
+        policy.priority = DEFAULT_RT_PRIORITY;
+        policy.nice = RT_FALLBACK_NICE;
+        if (!value.empty() && !parseInt(value, policy.priority)) return false;
+        return policy.priority >= 1 && policy.priority <= 99;
+    }
+    if (sched == "nice") {
+        return parseInt(value, policy.nice) && policy.nice >= -20 && policy.nice <= 19;
+    }
+    return sched == "normal" && value.empty();
+}
+
+void setRealtimeThreadPolicies() {
+    ThreadPolicy audio;
+    audio.sched = SchedClass::FIFO;
+    audio.priority = 80;
+    audio.nice = RT_FALLBACK_NICE;
+    ThreadPolicy network = audio;
+    network.priority = 70;
+    ThreadPolicy connection = audio;
+    connection.priority = 60;
+    ThreadPolicy control;
+    control.nice = -5;
+    ThreadPolicy background;
+    background.nice = 5;
+
+    setThreadPolicy(ThreadRole::AUDIO, audio);
+    setThreadPolicy(ThreadRole::NETWORK, network);
+    setThreadPolicy(ThreadRole::CONNECTION, connection);
+    setThreadPolicy(ThreadRole::CONTROL, control);
+    setThreadPolicy(ThreadRole::BACKGROUND, background);
+}
+
+void setThreadPolicy(ThreadRole role, const ThreadPolicy& policy) {
+    std::lock_guard<std::mutex> lock(g_policy_mutex);
+    RoleState& state = g_roles[static_cast<size_t>(role)];
+    state.policy = policy;
+    state.reported = false;
+}
+
+ThreadPolicy threadPolicy(ThreadRole role) {
+    std::lock_guard<std::mutex> lock(g_policy_mutex);
+    return g_roles[static_cast<size_t>(role)].policy;
+}
+
+std::vector<std::string> describeThreadPolicies() {
+    std::lock_guard<std::mutex> lock(g_policy_mutex);
+    std::vector<std::string> lines;
+    for (size_t i = 0; i < static_cast<size_t>(ThreadRole::COUNT); ++i) {
+        if (!g_roles[i].policy.isDefault()) {
+            lines.push_back(std::string(ROLE_NAMES[i]) + ": " + g_roles[i].policy.describe());
+        }
+    }
+    return lines;
+}
+
+void applyThreadPolicy(ThreadRole role) {
+    prepareThreadMemory(role);
+    ThreadPolicy policy;
+    {
+        std::lock_guard<std::mutex> lock(g_policy_mutex);
+        policy = g_roles[static_cast<size_t>(role)].policy;
+    }
+    if (policy.isDefault()) return;
+
+    const std::string outcome = applyScheduling(policy) + applyAffinity(policy.cpus);
+
+    std::lock_guard<std::mutex> lock(g_policy_mutex);
+    RoleState& state = g_roles[static_cast<size_t>(role)];
+    if (!state.reported) {
+        state.reported = true;
+        std::cout << "Thread policy for " << threadRoleName(role) << " threads: " << outcome << std::endl;
+    }
+}
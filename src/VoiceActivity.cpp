@@ -0,0 +1,66 @@
+#include "VoiceActivity.h"
+#include "SampleKernels.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Frames below this are silence whatever the floor says (about -70 dBFS)
+constexpr float ABSOLUTE_FLOOR = 1e-7f;
+// The floor drops quickly to quieter frames and rises about 3 dB/s
+constexpr float FLOOR_FALL = 0.8f;
+constexpr float FLOOR_RISE_DB_PER_SECOND = 3.0f;
+
+} // namespace
+
+VoiceActivityDetector::VoiceActivityDetector()
+    : sample_rate_(44100), threshold_(0.0f), hangover_samples_(0), hangover_left_(0),
+      noise_floor_(ABSOLUTE_FLOOR), frame_speech_(false), primed_(false) {
+    configure(sample_rate_);
+}
+
+void VoiceActivityDetector::configure(int sample_rate, float threshold_db, float hangover_ms) {
+    sample_rate_ = sample_rate;
+    threshold_ = std::pow(10.0f, threshold_db / 10.0f);
+    hangover_samples_ = static_cast<size_t>(hangover_ms * 0.001f * sample_rate);
+    reset();
+}
+
+bool VoiceActivityDetector::process(const float* samples, size_t n) {
+    if (n == 0) return hangover_left_ > 0;
+
+    const float power = SampleKernels::sumSquares(samples, n) / static_cast<float>(n);
+    // Start from the first real frame, not the zeros a delaying stage
+    // emits first
+    if (!primed_ && power > ABSOLUTE_FLOOR) {
+        noise_floor_ = power;
+        primed_ = true;
+    }
+
+    frame_speech_ = power > noise_floor_ * threshold_ && power > ABSOLUTE_FLOOR;
+
+    if (power < noise_floor_) {
+        noise_floor_ = FLOOR_FALL * noise_floor_ + (1.0f - FLOOR_FALL) * power;
+    } else {
+        const float seconds = static_cast<float>(n) / static_cast<float>(sample_rate_);
+        noise_floor_ *= std::pow(10.0f, FLOOR_RISE_DB_PER_SECOND * seconds / 10.0f);
+    }
+    noise_floor_ = std::max(noise_floor_, ABSOLUTE_FLOOR);
+
+    if (frame_speech_) {
+        hangover_left_ = hangover_samples_ + n;
+    }
+    hangover_left_ = hangover_left_ > n ? hangover_left_ - n : 0;
+    return frame_speech_ || hangover_left_ > 0;
+}
+
+void VoiceActivityDetector::reset() {
+    hangover_left_ = 0;
+    noise_floor_ = ABSOLUTE_FLOOR;
+    frame_speech_ = false;
+    primed_ = false;
+}
+
+float VoiceActivityDetector::noiseFloorDb() const {
+    return 10.0f * std::log10(noise_floor_);
+}
@@ -0,0 +1,251 @@
+#include "WavFileSource.h"
+#include "SampleKernels.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+    #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace {
+
+constexpr uint16_t WAVE_FORMAT_PCM = 1;
+constexpr uint16_t WAVE_FORMAT_IEEE_FLOAT = 3;
+constexpr uint16_t WAVE_FORMAT_EXTENSIBLE = 0xFFFE;
+constexpr size_t MAX_CHANNELS = 32;
+
+uint16_t get16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+uint32_t get32(const uint8_t* p) { return get16(p) | (static_cast<uint32_t>(get16(p + 2)) << 16); }
+uint64_t get64(const uint8_t* p) { return get32(p) | (static_cast<uint64_t>(get32(p + 4)) << 32); }
+
+} // namespace
+
+WavFileSource::WavFileSource()
+    : data_(nullptr), mapped_bytes_(0),
+#ifdef _WIN32
+      file_handle_(INVALID_HANDLE_VALUE), mapping_handle_(nullptr),
+#endif
+      samples_(nullptr), encoding_(Encoding::PCM16), sample_rate_(0), channels_(0), frame_bytes_(0),
+      frames_(0), position_(0), seek_to_(-1), loop_(false) {
+}
+
+WavFileSource::~WavFileSource() {
+    close();
+}
+
+bool WavFileSource::open(const std::string& path) {
+    close();
+    if (!map(path)) return false;
+    if (!parse()) {
+        std::cerr << path << " is not a supported WAV file" << std::endl;
+        close();
+        return false;
+    }
+    path_ = path;
+    block_.reset(new float[MAX_BLOCK * channels_]);
+    position_ = 0;
+    seek_to_ = -1;
+    return true;
+}
+
+bool WavFileSource::map(const std::string& path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cerr << "Cannot open " << path << std::endl;
+        return false;
+    }
+    LARGE_INTEGER size;
+    HANDLE mapping = nullptr;
+    const void* view = nullptr;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+    if (!view) {
+        std::cerr << "Cannot map " << path << std::endl;
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    file_handle_ = file;
+    mapping_handle_ = mapping;
+    data_ = static_cast<const uint8_t*>(view);
+    mapped_bytes_ = static_cast<size_t>(size.QuadPart);
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Cannot open " << path << std::endl;
+        return false;
+    }
+    struct stat info;
+    void* view = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    // The mapping stays valid without the descriptor
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        std::cerr << "Cannot map " << path << std::endl;
+        return false;
+    }
+    // Played front to back; let the kernel read ahead
+    madvise(view, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+    data_ = static_cast<const uint8_t*>(view);
+    mapped_bytes_ = static_cast<size_t>(info.st_size);
+#endif
+    return true;
+}
+
+void WavFileSource::close() {
+    if (data_) {
+#ifdef _WIN32
+        UnmapViewOfFile(data_);
+        CloseHandle(mapping_handle_);
+        CloseHandle(file_handle_);
+        mapping_handle_ = nullptr;
+        file_handle_ = INVALID_HANDLE_VALUE;
+#else
+        munmap(const_cast<uint8_t*>(data_), mapped_bytes_);
+#endif
+    }
+    data_ = nullptr;
+    mapped_bytes_ = 0;
+    samples_ = nullptr;
+    frames_ = 0;
+    position_ = 0;
+}
+
+// Walks the chunks for fmt and data. RF64 files carry the real data size
+// in the ds64 chunk; a size that runs past the end of the file (a
+// recording that was never finalized) is cut to what is there.
+bool WavFileSource::parse() {
+    if (mapped_bytes_ < 12 || std::memcmp(data_ + 8, "WAVE", 4) != 0) return false;
+    const bool rf64 = std::memcmp(data_, "RF64", 4) == 0;
+    if (!rf64 && std::memcmp(data_, "RIFF", 4) != 0) return false;
+
+    uint64_t ds64_data_size = 0;
+    bool have_format = false;
+    uint16_t format = 0;
+    uint16_t bits = 0;
+    size_t offset = 12;
+    while (offset + 8 <= mapped_bytes_) {
+        const uint8_t* chunk = data_ + offset;
+        const uint8_t* body = chunk + 8;
+        const size_t available = mapped_bytes_ - offset - 8;
+        uint64_t size = get32(chunk + 4);
+
+        if (std::memcmp(chunk, "ds64", 4) == 0 && available >= 16) {
+            ds64_data_size = get64(body + 8);
+        } else if (std::memcmp(chunk, "fmt ", 4) == 0 && size >= 16 && available >= 16) {
+            format = get16(body);
+            channels_ = get16(body + 2);
+            sample_rate_ = static_cast<int>(get32(body + 4));
+            bits = get16(body + 14);
+            if (format == WAVE_FORMAT_EXTENSIBLE && size >= 40 && available >= 40) {
+                format = get16(body + 24);   // first two bytes of the subformat GUID
+            }
+            have_format = true;
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            if (!have_format) return false;
+            if (rf64 && size == 0xFFFFFFFFu) size = ds64_data_size;
+            if (size == 0 || size > available) size = available;
+
+            if (format == WAVE_FORMAT_PCM && bits == 16) {
+                encoding_ = Encoding::PCM16;
+            } else if (format == WAVE_FORMAT_PCM && bits == 24) {
+                encoding_ = Encoding::PCM24;
+            } else if (format == WAVE_FORMAT_PCM && bits == 32) {
+                encoding_ = Encoding::PCM32;
+            } else if (format == WAVE_FORMAT_IEEE_FLOAT && bits == 32) {
+                encoding_ = Encoding::FLOAT32;
+            } else {
+                return false;
+            }
+            if (channels_ < 1 || static_cast<size_t>(channels_) > MAX_CHANNELS || sample_rate_ <= 0) return false;
+
+            frame_bytes_ = static_cast<size_t>(channels_) * (bits / 8);
+            samples_ = body;
+            frames_ = size / frame_bytes_;
+            return true;
+        }
+        offset += 8 + static_cast<size_t>(std::min<uint64_t>(size + (size & 1), available));
+    }
+    return false;
+}
+
+void WavFileSource::seek(double seconds) {
+    const double frame = std::max(0.0, seconds) * sample_rate_;
+    seek_to_ = static_cast<int64_t>(std::min<double>(frame, static_cast<double>(frames_)));
+}
+
+double WavFileSource::positionSeconds() const {
+    return sample_rate_ ? static_cast<double>(position_) / sample_rate_ : 0.0;
+}
+
+size_t WavFileSource::read(size_t frames, const float*& out) {
+    if (!data_) return 0;
+
+    const int64_t target = seek_to_.exchange(-1);
+    if (target >= 0) position_ = static_cast<uint64_t>(target);
+
+    uint64_t position = position_;
+    if (position >= frames_) {
+        if (!loop_ || frames_ == 0) return 0;
+        position = 0;
+    }
+    const size_t count = static_cast<size_t>(std::min<uint64_t>(std::min(frames, MAX_BLOCK), frames_ - position));
+    const uint8_t* src = samples_ + position * frame_bytes_;
+    position_ = position + count;
+
+    if (channels_ == 1 && encoding_ == Encoding::FLOAT32 &&
+        reinterpret_cast<uintptr_t>(src) % alignof(float) == 0) {
+        out = reinterpret_cast<const float*>(src);
+        return count;
+    }
+
+    float* block = block_.get();
+    convert(src, block, count * channels_);
+    if (channels_ > 1) {
+        const float scale = 1.0f / channels_;
+        for (size_t frame = 0; frame < count; ++frame) {
+            float sum = 0.0f;
+            for (int channel = 0; channel < channels_; ++channel) sum += block[frame * channels_ + channel];
+            block[frame] = sum * scale;
+        }
+    }
+    out = block;
+    return count;
+}
+
+void WavFileSource::convert(const uint8_t* src, float* dst, size_t samples) const {
+    switch (encoding_) {
+        case Encoding::PCM16:
+            // Chunks start on even offsets, so 16-bit samples are aligned
+            SampleKernels::int16ToFloat(reinterpret_cast<const int16_t*>(src), dst, samples);
+            break;
+        case Encoding::PCM24:
+            SampleKernels::int24ToFloat(src, dst, samples);
+            break;
+        case Encoding::PCM32:
+            for (size_t i = 0; i < samples; ++i) {
+                int32_t value;
+                std::memcpy(&value, src + i * sizeof(value), sizeof(value));
+                dst[i] = static_cast<float>(value) * (1.0f / 2147483648.0f);
+            }
+            break;
+        case Encoding::FLOAT32:
+            std::memcpy(dst, src, samples * sizeof(float));
+            break;
+    }
+}
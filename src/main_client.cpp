@@ -1,24 +1,258 @@
 #include "AudioClient.h"
+#include "RealtimeMemory.h"
+#include "ThreadPolicy.h"
+#include <algorithm>
 #include <iostream>
 #include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <thread>
+
+namespace {
+
+// Source mode: every file streams from its own connection, controlled
+// together. Without a terminal the files play until they end.
+void runSources(std::vector<std::unique_ptr<AudioClient>>& clients,
+                std::vector<std::unique_ptr<WavFileSource>>& sources) {
+  std::cout << "Commands: seek <seconds>, loop <on|off>, stats, quit" << std::endl;
+  std::string command;
+  while (std::cin >> command) {
+    if (command == "quit") return;
+    if (command == "seek") {
+      double seconds = 0.0;
+      if (std::cin >> seconds) {
+        for (auto& source : sources) source->seek(seconds);
+      } else {
+        std::cin.clear();
+        std::cout << "Usage: seek <seconds>" << std::endl;
+      }
+    } else if (command == "loop") {
+      std::string mode;
+      std::cin >> mode;
+      for (auto& source : sources) source->setLoop(mode == "on");
+    } else if (command == "stats") {
+      for (size_t i = 0; i < clients.size(); ++i) {
+        std::cout << sources[i]->path() << " at " << sources[i]->positionSeconds() << " of "
+                  << sources[i]->durationSeconds() << " s" << std::endl;
+        clients[i]->printStats();
+      }
+    } else {
+      std::cout << "Unknown command: " << command << std::endl;
+    }
+  }
+
+  auto playing = [&]() {
+    for (size_t i = 0; i < clients.size(); ++i) {
+      if (clients[i]->isConnected() && !sources[i]->finished()) return true;
+    }
+    return false;
+  };
+  while (playing()) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  // Let the last frames leave before disconnecting
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+}
+
+} // namespace
 
 int main(int argc, char* argv[]) {
   std::string server_host = "127.0.0.1";
   int server_port = 8080;
 
+  std::string record_prefix;
+  std::string log_path;
+  bool dtx = true;
+  bool denoise = false;
+  AudioCodec codec = AudioCodec::PCM16;
+  int sample_rate = 48000;
+  OpusSettings opus;
+  FecMode fec = FecMode::OFF;
+  size_t fec_group = 4;
+  int sync_ms = 0;
+  bool multicast = true;
+  bool listen_only = false;
+  bool null_audio = false;
+  ImpairmentConfig impair_send;
+  ImpairmentConfig impair_receive;
+  std::string multicast_interface;
+  std::vector<std::string> source_paths;
+  RealtimeMemoryConfig memory;
+  bool prepare_memory = false;
+  bool loop = false;
+  double seek_seconds = 0.0;
+
   //Pase Command line arguments
-  if (argc >= 2) {
-    server_host = argv[1];
+  std::vector<std::string> positional;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--record" && i + 1 < argc) {
+      record_prefix = argv[++i];
+    } else if (arg == "--log" && i + 1 < argc) {
+      log_path = argv[++i];
+    } else if (arg == "--no-dtx") {
+      dtx = false;
+    } else if (arg == "--denoise") {
+      denoise = true;
+    } else if (arg == "--codec" && i + 1 < argc) {
+      if (!parseCodecName(argv[++i], codec)) {
+        std::cerr << "Unknown codec " << argv[i] << ", expected float32, pcm16, float16, ulaw, alaw, adpcm, lossless or opus" << std::endl;
+        return 1;
+      }
+    } else if (arg == "--rate" && i + 1 < argc) {
+      sample_rate = std::stoi(argv[++i]);
+    } else if (arg == "--opus-bitrate" && i + 1 < argc) {
+      opus.bitrate = std::stoi(argv[++i]);
+    } else if (arg == "--opus-complexity" && i + 1 < argc) {
+      opus.complexity = std::stoi(argv[++i]);
+    } else if (arg == "--opus-frame" && i + 1 < argc) {
+      opus.frame_ms = std::stoi(argv[++i]);
+    } else if (arg == "--opus-loss" && i + 1 < argc) {
+      opus.expected_loss = std::stoi(argv[++i]);
+    } else if (arg == "--no-fec") {
+      opus.fec = false;
+    } else if (arg == "--opus-dtx") {
+      opus.dtx = true;
+    } else if (arg == "--source" && i + 1 < argc) {
+      source_paths.push_back(argv[++i]);
+    } else if (arg == "--loop") {
+      loop = true;
+    } else if (arg == "--seek" && i + 1 < argc) {
+      seek_seconds = std::stod(argv[++i]);
+    } else if ((arg == "--impair-send" || arg == "--impair-recv") && i + 1 < argc) {
+      ImpairmentConfig& impairment = arg == "--impair-send" ? impair_send : impair_receive;
+      if (!parseImpairment(argv[++i], impairment)) {
+        std::cerr << "Invalid impairment " << argv[i] << ", expected e.g. delay=40,jitter=10,loss=1,burst=2:30" << std::endl;
+        return 1;
+      }
+    } else if (arg == "--lock-memory") {
+      memory.lock = true;
+      prepare_memory = true;
+    } else if (arg == "--huge-pages") {
+      memory.huge_pages = true;
+      prepare_memory = true;
+    } else if (arg == "--reserve-mb" && i + 1 < argc) {
+      memory.reserve_bytes = static_cast<size_t>(std::max(1, std::stoi(argv[++i]))) << 20;
+      prepare_memory = true;
+    } else if (arg == "--realtime") {
+      setRealtimeThreadPolicies();
+    } else if (arg == "--thread-policy" && i + 1 < argc) {
+      ThreadRole role;
+      ThreadPolicy policy;
+      if (!parseThreadPolicy(argv[++i], role, policy)) {
+        std::cerr << "Invalid thread policy " << argv[i] << ", expected e.g. network=fifo:70@2,3" << std::endl;
+        return 1;
+      }
+      setThreadPolicy(role, policy);
+    } else if (arg == "--null-audio") {
+      null_audio = true;
+    } else if (arg == "--listen-only") {
+      listen_only = true;
+    } else if (arg == "--no-multicast") {
+      multicast = false;
+    } else if (arg == "--multicast-if" && i + 1 < argc) {
+      multicast_interface = argv[++i];
+    } else if (arg == "--sync" && i + 1 < argc) {
+      sync_ms = std::max(0, std::stoi(argv[++i]));
+    } else if (arg == "--fec" && i + 1 < argc) {
+      if (!parseFecMode(argv[++i], fec)) {
+        std::cerr << "Unknown FEC mode " << argv[i] << ", expected off, parity or redundant" << std::endl;
+        return 1;
+      }
+    } else if (arg == "--fec-group" && i + 1 < argc) {
+      fec_group = static_cast<size_t>(std::max(1, std::stoi(argv[++i])));
+    } else {
+      positional.push_back(arg);
+    }
   }
 
-  if (argc >= 3) {
-    server_port = std::stoi(argv[2]);
+  if (positional.size() >= 1) {
+    server_host = positional[0];
+  }
+
+  if (positional.size() >= 2) {
+    server_port = std::stoi(positional[1]);
   }
 
   std::cout << "AudSync Client - Real-time Audio Streaming" << std::endl;
   std::cout << "Connecting to Server: " << server_host << " : "<< std::endl;
   
-  AudioClient client;
+  const int channels = 1;
+
+  if (prepare_memory) prepareRealtimeMemory(memory);
+  for (const auto& line : describeThreadPolicies()) {
+    std::cout << "Thread policy " << line << std::endl;
+  }
+
+  SessionLogger logger;
+  if (!logger.open(log_path)) {
+    return 1;
+  }
+
+  if (!source_paths.empty()) {
+    std::vector<std::unique_ptr<WavFileSource>> sources;
+    std::vector<std::unique_ptr<AudioClient>> clients;
+    for (const auto& path : source_paths) {
+      std::unique_ptr<WavFileSource> source(new WavFileSource());
+      if (!source->open(path)) return 1;
+      if (source->sampleRate() != sample_rate) {
+        std::cerr << path << " is " << source->sampleRate() << " Hz; pass --rate "
+                  << source->sampleRate() << " or convert it to " << sample_rate << " Hz" << std::endl;
+        return 1;
+      }
+      source->setLoop(loop);
+      source->seek(seek_seconds);
+
+      std::unique_ptr<AudioClient> client(new AudioClient(-1, sample_rate, channels, &logger, nullptr, nullptr));
+      client->setDtxEnabled(dtx);
+      client->setPreferredCodec(codec);
+      client->setOpusSettings(opus);
+      client->setFec(fec, fec_group);
+      client->setMulticast(false);
+      client->setFileSource(source.get());
+      // Every connection sees its own losses
+      ImpairmentConfig source_send = impair_send;
+      ImpairmentConfig source_receive = impair_receive;
+      source_send.seed += clients.size();
+      source_receive.seed += clients.size();
+      client->setImpairment(source_send, source_receive);
+      if (!client->connect(server_host, server_port) || !client->startAudio()) {
+        std::cerr << "Failed to stream " << path << std::endl;
+        return 1;
+      }
+      std::cout << "Streaming " << path << " (" << source->durationSeconds() << " s, "
+                << source->channels() << " channels)" << std::endl;
+      sources.push_back(std::move(source));
+      clients.push_back(std::move(client));
+    }
+    runSources(clients, sources);
+    // Clients stop before the files they read are unmapped
+    clients.clear();
+    return 0;
+  }
+
+  std::unique_ptr<AudioRecorder> recorder;
+  if (!record_prefix.empty()) {
+    recorder.reset(new AudioRecorder(sample_rate, channels));
+    if (!recorder->open(record_prefix)) {
+      std::cerr << "Recording disabled" << std::endl;
+      recorder.reset();
+    }
+  }
+
+  JitterBuffer jitter_buffer(sample_rate);
+  jitter_buffer.setSyncLatency(static_cast<int64_t>(sync_ms) * 1000000);
+  AudioClient client(-1, sample_rate, channels, &logger, recorder.get(), &jitter_buffer);
+  client.setDtxEnabled(dtx);
+  client.setPreferredCodec(codec);
+  client.setOpusSettings(opus);
+  client.setFec(fec, fec_group);
+  client.setMulticast(multicast, multicast_interface);
+  client.setListenOnly(listen_only);
+  client.audioProcessor().setNullDevice(null_audio);
+  client.audioProcessor().captureChain().stage("denoise")->setEnabled(denoise);
+  client.setImpairment(impair_send, impair_receive);
+  if (impair_send.active()) std::cout << "Impairing sent messages: " << impair_send.describe() << std::endl;
+  if (impair_receive.active()) std::cout << "Impairing received messages: " << impair_receive.describe() << std::endl;
 
   if(!client.connect(server_host, server_port)){
     std::cerr << "Failed to connect to server. Make sure the server is running. "<< std::endl;
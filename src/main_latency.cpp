@@ -0,0 +1,88 @@
+#include "LatencyHarness.h"
+#include "RealtimeMemory.h"
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[]) {
+  LatencyHarnessConfig config;
+  double max_p99_ms = 0.0;
+  RealtimeMemoryConfig memory;
+  bool prepare_memory = false;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--port" && i + 1 < argc) {
+      config.port = std::stoi(argv[++i]);
+    } else if (arg == "--rate" && i + 1 < argc) {
+      config.sample_rate = std::stoi(argv[++i]);
+    } else if (arg == "--codec" && i + 1 < argc) {
+      if (!parseCodecName(argv[++i], config.codec)) {
+        std::cerr << "Unknown codec " << argv[i] << ", expected float32, pcm16, float16, ulaw, alaw, adpcm, lossless or opus" << std::endl;
+        return 1;
+      }
+    } else if (arg == "--opus-bitrate" && i + 1 < argc) {
+      config.opus.bitrate = std::stoi(argv[++i]);
+    } else if (arg == "--opus-complexity" && i + 1 < argc) {
+      config.opus.complexity = std::stoi(argv[++i]);
+    } else if (arg == "--opus-frame" && i + 1 < argc) {
+      config.opus.frame_ms = std::stoi(argv[++i]);
+    } else if (arg == "--fec" && i + 1 < argc) {
+      if (!parseFecMode(argv[++i], config.fec)) {
+        std::cerr << "Unknown FEC mode " << argv[i] << ", expected off, parity or redundant" << std::endl;
+        return 1;
+      }
+    } else if (arg == "--fec-group" && i + 1 < argc) {
+      config.fec_group = static_cast<size_t>(std::max(1, std::stoi(argv[++i])));
+    } else if (arg == "--dtx") {
+      config.dtx = true;
+    } else if (arg == "--sync" && i + 1 < argc) {
+      config.sync_ms = std::max(0, std::stoi(argv[++i]));
+    } else if (arg == "--impair" && i + 1 < argc) {
+      if (!parseImpairment(argv[++i], config.impairment)) {
+        std::cerr << "Invalid impairment " << argv[i] << ", expected e.g. delay=40,jitter=10,loss=1,burst=2:30" << std::endl;
+        return 1;
+      }
+    } else if (arg == "--warmup" && i + 1 < argc) {
+      config.warmup_seconds = std::max(0.0, std::stod(argv[++i]));
+    } else if (arg == "--duration" && i + 1 < argc) {
+      config.duration_seconds = std::max(0.1, std::stod(argv[++i]));
+    } else if (arg == "--interval" && i + 1 < argc) {
+      config.marker_interval_ms = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--max-p99" && i + 1 < argc) {
+      max_p99_ms = std::stod(argv[++i]);
+    } else if (arg == "--lock-memory") {
+      memory.lock = true;
+      prepare_memory = true;
+    } else if (arg == "--huge-pages") {
+      memory.huge_pages = true;
+      prepare_memory = true;
+    } else if (arg == "--help" || arg == "-h") {
+      std::cout << "Usage: " << argv[0] << " [--port N] [--rate HZ] [--codec NAME] [--opus-bitrate BPS]\n"
+                << "       [--opus-complexity N] [--opus-frame MS] [--fec MODE] [--fec-group N] [--dtx]\n"
+                << "       [--sync MS] [--impair SPEC] [--warmup S] [--duration S] [--interval MS]\n"
+                << "       [--max-p99 MS] [--lock-memory] [--huge-pages]\n"
+                << "Fails when under 90% of markers are detected, or p99 exceeds --max-p99" << std::endl;
+      return 0;
+    } else {
+      std::cerr << "Unknown option " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  if (prepare_memory) prepareRealtimeMemory(memory);
+  LatencyHarness harness(config);
+  if (!harness.run()) return 1;
+  harness.printReport(std::cout);
+
+  if (harness.markersDetected() * 10 < harness.markersSent() * 9) {
+    std::cerr << "Too few markers detected" << std::endl;
+    return 1;
+  }
+  const double p99_ms = harness.total().percentileUs(0.99) / 1000.0;
+  if (max_p99_ms > 0.0 && p99_ms > max_p99_ms) {
+    std::cerr << "p99 latency " << p99_ms << " ms exceeds " << max_p99_ms << " ms" << std::endl;
+    return 1;
+  }
+  return 0;
+}
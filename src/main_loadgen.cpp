@@ -0,0 +1,142 @@
+#include "LoadGenerator.h"
+#include "ClockSync.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <signal.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+  #include <sys/resource.h>
+#endif
+
+std::atomic<bool> g_interrupted(false);
+
+void signalHandler(int signal) {
+  (void) signal;
+  g_interrupted = true;
+}
+
+// Every simulated client holds a socket
+void raiseOpenFileLimit(size_t clients) {
+#ifndef _WIN32
+  rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) != 0) return;
+  const rlim_t wanted = static_cast<rlim_t>(clients + 64);
+  if (limit.rlim_cur >= wanted) return;
+  limit.rlim_cur = std::min(wanted, limit.rlim_max);
+  setrlimit(RLIMIT_NOFILE, &limit);
+  if (limit.rlim_cur < wanted) {
+    std::cerr << "Open file limit is " << limit.rlim_cur << "; raise it (ulimit -n) for "
+              << clients << " clients" << std::endl;
+  }
+#else
+  (void) clients;
+#endif
+}
+
+int main(int argc, char* argv[]) {
+  LoadGenConfig config;
+  double duration_seconds = 30.0;
+  double report_seconds = 5.0;
+
+  std::vector<std::string> positional;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--clients" && i + 1 < argc) {
+      config.clients = static_cast<size_t>(std::max(1, std::stoi(argv[++i])));
+    } else if (arg == "--speakers" && i + 1 < argc) {
+      config.speakers = static_cast<size_t>(std::max(0, std::stoi(argv[++i])));
+    } else if (arg == "--threads" && i + 1 < argc) {
+      config.threads = static_cast<size_t>(std::max(1, std::stoi(argv[++i])));
+    } else if (arg == "--duration" && i + 1 < argc) {
+      duration_seconds = std::stod(argv[++i]);
+    } else if (arg == "--ramp" && i + 1 < argc) {
+      config.ramp_seconds = std::stod(argv[++i]);
+    } else if (arg == "--report" && i + 1 < argc) {
+      report_seconds = std::max(0.1, std::stod(argv[++i]));
+    } else if (arg == "--rate" && i + 1 < argc) {
+      config.sample_rate = std::stoi(argv[++i]);
+    } else if (arg == "--frame" && i + 1 < argc) {
+      config.frame_samples = static_cast<size_t>(std::max(1, std::stoi(argv[++i])));
+    } else if (arg == "--codec" && i + 1 < argc) {
+      if (!parseCodecName(argv[++i], config.codec) || !(builtinCodecMask() & codecBit(config.codec))) {
+        std::cerr << "Unknown codec " << argv[i] << ", expected float32, pcm16, float16, ulaw, alaw or adpcm" << std::endl;
+        return 1;
+      }
+    } else if (arg == "--no-dtx") {
+      config.dtx = false;
+    } else if (arg == "--talk" && i + 1 < argc) {
+      config.talk_seconds = std::stod(argv[++i]);
+    } else if (arg == "--pause" && i + 1 < argc) {
+      config.pause_seconds = std::stod(argv[++i]);
+    } else if (arg == "--source" && i + 1 < argc) {
+      config.source_path = argv[++i];
+    } else if (arg == "--help" || arg == "-h") {
+      std::cout << "Usage: " << argv[0] << " [host] [port] [--clients N] [--speakers N] [--threads N]\n"
+                << "       [--duration s] [--ramp s] [--report s] [--rate Hz] [--frame samples]\n"
+                << "       [--codec name] [--no-dtx] [--talk s] [--pause s] [--source file.wav]" << std::endl;
+      return 0;
+    } else {
+      positional.push_back(arg);
+    }
+  }
+  if (positional.size() >= 1) config.host = positional[0];
+  if (positional.size() >= 2) config.port = std::stoi(positional[1]);
+
+  std::cout << "AudSync Load Generator" << std::endl;
+  std::cout << config.clients << " clients (" << (config.speakers ? config.speakers : config.clients)
+            << " speaking) against " << config.host << ":" << config.port << " on " << config.threads
+            << " threads, " << codecName(config.codec) << ", ramp " << config.ramp_seconds << " s, then "
+            << duration_seconds << " s" << std::endl;
+
+#ifndef _WIN32
+  signal(SIGPIPE, SIG_IGN);
+#endif
+  signal(SIGINT, signalHandler);
+  signal(SIGTERM, signalHandler);
+  raiseOpenFileLimit(config.clients);
+
+  LoadGenerator generator(config);
+  if (!generator.start()) {
+    std::cerr << "Failed to start the load generator" << std::endl;
+    return 1;
+  }
+
+  const int64_t started = monotonicNowNs();
+  const int64_t end = started + static_cast<int64_t>((std::max(0.0, config.ramp_seconds) + duration_seconds) * 1e9);
+  const int64_t report_ns = static_cast<int64_t>(report_seconds * 1e9);
+  int64_t next_report = started + report_ns;
+  LoadGenCounters last;
+  while (!g_interrupted && monotonicNowNs() < end) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    const int64_t now = monotonicNowNs();
+    if (now < next_report) continue;
+
+    // Rates over the last interval
+    const LoadGenCounters total = generator.counters();
+    const double seconds = report_seconds + (now - next_report) * 1e-9;
+    char line[256];
+    snprintf(line, sizeof(line),
+             "%7.1f s  clients %llu/%zu  sent %8.0f frames/s %7.2f MB/s  received %9.0f frames/s %7.2f MB/s  lost %llu  dropped %llu\n",
+             (now - started) * 1e-9, static_cast<unsigned long long>(total.connected - total.closed_by_server),
+             config.clients, (total.frames_sent - last.frames_sent) / seconds,
+             (total.bytes_sent - last.bytes_sent) / seconds / 1e6,
+             (total.frames_received - last.frames_received) / seconds,
+             (total.bytes_received - last.bytes_received) / seconds / 1e6,
+             static_cast<unsigned long long>(total.frames_lost), static_cast<unsigned long long>(total.send_drops));
+    fputs(line, stdout);
+    fflush(stdout);
+    last = total;
+    next_report = now + report_ns;
+  }
+
+  generator.stop();
+  std::cout << std::endl;
+  generator.printSummary(std::cout);
+  return 0;
+}
@@ -0,0 +1,35 @@
+#include "SessionLogger.h"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <session.log>" << std::endl;
+    return 1;
+  }
+
+  FILE* file = fopen(argv[1], "rb");
+  if (!file) {
+    std::cerr << "Cannot open " << argv[1] << std::endl;
+    return 1;
+  }
+
+  LogFileHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1 || std::memcmp(header.magic, "ASLG", 4) != 0) {
+    std::cerr << argv[1] << " is not an AudSync session log" << std::endl;
+    fclose(file);
+    return 1;
+  }
+
+  LogRecord records[256];
+  size_t n;
+  while ((n = fread(records, sizeof(LogRecord), 256, file)) > 0) {
+    for (size_t i = 0; i < n; ++i) {
+      std::cout << SessionLogger::formatRecord(records[i], header) << '\n';
+    }
+  }
+
+  fclose(file);
+  return 0;
+}
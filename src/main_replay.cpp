@@ -0,0 +1,71 @@
+#include "SessionReplay.h"
+#include "NetworkManager.h"
+#include <iostream>
+#include <signal.h>
+#include <string>
+#include <vector>
+
+SessionReplay* g_replay = nullptr;
+
+void signalHandler(int signal) {
+  (void) signal;
+  if (g_replay) g_replay->stop();
+}
+
+int main(int argc, char* argv[]) {
+  ReplayConfig config;
+  std::vector<std::string> positional;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--speed" && i + 1 < argc) {
+      config.speed = std::stod(argv[++i]);
+      if (config.speed <= 0.0) {
+        std::cerr << "--speed must be positive; use --max for as fast as possible" << std::endl;
+        return 1;
+      }
+    } else if (arg == "--max") {
+      config.speed = 0.0;
+    } else if (arg == "--help" || arg == "-h") {
+      std::cout << "Usage: " << argv[0] << " <capture> [host] [port] [--speed N | --max]\n"
+                << "Plays a session captured with audsync_server --capture into a server" << std::endl;
+      return 0;
+    } else {
+      positional.push_back(arg);
+    }
+  }
+  if (positional.empty()) {
+    std::cerr << "Usage: " << argv[0] << " <capture> [host] [port] [--speed N | --max]" << std::endl;
+    return 1;
+  }
+  if (positional.size() >= 2) config.host = positional[1];
+  if (positional.size() >= 3) config.port = std::stoi(positional[2]);
+
+#ifdef _WIN32
+  WSADATA wsa_data;
+  if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+    std::cerr << "WSAStartup failed" << std::endl;
+    return 1;
+  }
+#else
+  signal(SIGPIPE, SIG_IGN);
+#endif
+
+  std::cout << "AudSync Replay" << std::endl;
+  std::cout << "Replaying " << positional[0] << " into " << config.host << ":" << config.port << " at ";
+  if (config.speed > 0.0) {
+    std::cout << config.speed << "x";
+  } else {
+    std::cout << "maximum speed";
+  }
+  std::cout << std::endl;
+
+  SessionReplay replay(config);
+  g_replay = &replay;
+  signal(SIGINT, signalHandler);
+  signal(SIGTERM, signalHandler);
+
+  ReplayStats stats;
+  if (!replay.run(positional[0], stats)) return 1;
+  stats.print(std::cout, config.speed);
+  return stats.connect_failures == 0 ? 0 : 1;
+}
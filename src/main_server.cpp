@@ -1,9 +1,15 @@
 #include "AudioServer.h"
+#include "RealtimeMemory.h"
+#include "ThreadPolicy.h"
+#include <algorithm>
 #include <iostream>
 #include <signal.h>
+#include <string>
 
 AudioServer* g_server = nullptr;
 
+constexpr int DEFAULT_MULTICAST_PORT = 5004;
+
 void signalHandler(int signal) {
   (void) signal;
   if(g_server){
@@ -14,15 +20,92 @@ void signalHandler(int signal) {
 
 int main(int argc, char* argv[]) {
   int port = 8080;
-  if (argc >= 2) {
-    port = std::stoi(argv[1]);
+  std::string log_path;
+  std::string capture_path;
+  std::string multicast_group;
+  int multicast_port = DEFAULT_MULTICAST_PORT;
+  int multicast_ttl = 1;
+  std::string multicast_interface;
+  ImpairmentConfig impair_send;
+  ImpairmentConfig impair_receive;
+  RealtimeMemoryConfig memory;
+  bool prepare_memory = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--log" && i + 1 < argc) {
+      log_path = argv[++i];
+    } else if (arg == "--capture" && i + 1 < argc) {
+      capture_path = argv[++i];
+    } else if (arg == "--multicast" && i + 1 < argc) {
+      if (!MulticastChannel::parseGroup(argv[++i], multicast_group, multicast_port)) {
+        std::cerr << "Expected --multicast <group>[:<port>] with a 224.0.0.0/4 group" << std::endl;
+        return 1;
+      }
+    } else if (arg == "--multicast-ttl" && i + 1 < argc) {
+      multicast_ttl = std::stoi(argv[++i]);
+    } else if (arg == "--multicast-if" && i + 1 < argc) {
+      multicast_interface = argv[++i];
+    } else if ((arg == "--impair-send" || arg == "--impair-recv") && i + 1 < argc) {
+      ImpairmentConfig& impairment = arg == "--impair-send" ? impair_send : impair_receive;
+      if (!parseImpairment(argv[++i], impairment)) {
+        std::cerr << "Invalid impairment " << argv[i] << ", expected e.g. delay=40,jitter=10,loss=1,burst=2:30" << std::endl;
+        return 1;
+      }
+    } else if (arg == "--lock-memory") {
+      memory.lock = true;
+      prepare_memory = true;
+    } else if (arg == "--huge-pages") {
+      memory.huge_pages = true;
+      prepare_memory = true;
+    } else if (arg == "--reserve-mb" && i + 1 < argc) {
+      memory.reserve_bytes = static_cast<size_t>(std::max(1, std::stoi(argv[++i]))) << 20;
+      prepare_memory = true;
+    } else if (arg == "--realtime") {
+      setRealtimeThreadPolicies();
+    } else if (arg == "--thread-policy" && i + 1 < argc) {
+      ThreadRole role;
+      ThreadPolicy policy;
+      if (!parseThreadPolicy(argv[++i], role, policy)) {
+        std::cerr << "Invalid thread policy " << argv[i] << ", expected e.g. network=fifo:70@2,3" << std::endl;
+        return 1;
+      }
+      setThreadPolicy(role, policy);
+    } else {
+      port = std::stoi(arg);
+    }
   }
 
   std::cout << "AudSync Server - Real-time Audio Streaming Hub" <<std::endl;
   std::cout << "Starting server on port: "<<port << std::endl;
   
-  AudioServer server;
+  if (prepare_memory) prepareRealtimeMemory(memory);
+  for (const auto& line : describeThreadPolicies()) {
+    std::cout << "Thread policy " << line << std::endl;
+  }
+
+  SessionLogger logger;
+  if (!logger.open(log_path)) {
+    return 1;
+  }
+
+  SessionCapture capture;
+  if (!capture_path.empty() && !capture.open(capture_path)) {
+    return 1;
+  }
+
+  AudioServer server(&logger);
   g_server = &server;
+  if (capture.isOpen()) {
+    server.setCapture(&capture);
+    std::cout << "Capturing received messages to " << capture_path << std::endl;
+  }
+  server.setImpairment(impair_send, impair_receive);
+  if (impair_send.active()) std::cout << "Impairing sent messages: " << impair_send.describe() << std::endl;
+  if (impair_receive.active()) std::cout << "Impairing received messages: " << impair_receive.describe() << std::endl;
+  if (!multicast_group.empty() &&
+      !server.setMulticast(multicast_group, multicast_port, multicast_ttl, multicast_interface)) {
+    std::cerr << "Multicast unavailable; relaying audio by unicast only" << std::endl;
+  }
 
   // Set up signal handler for graceful shutdown
   signal(SIGINT, signalHandler);
@@ -41,10 +124,15 @@ int main(int argc, char* argv[]) {
     if (command == "quit" || command == "stop") {
         break;
     } else if (command == "status") {
-        std::cout << "Connected clients: " << server.getConnectedClients() << std::endl;
+        std::cout << "Connected clients: " << server.getConnectedClients()
+                  << " (" << server.getListeners() << " listening only, "
+                  << server.getMulticastClients() << " on multicast)" << std::endl;
+        for (const auto& line : pageFaultReport()) {
+            std::cout << "Page faults since last status, " << line << std::endl;
+        }
     } else if (command == "help") {
         std::cout << "Commands:" << std::endl;
-        std::cout << "  status - Show server status" << std::endl;
+        std::cout << "  status - Show server status and page faults" << std::endl;
         std::cout << "  quit   - Stop server and exit" << std::endl;
         std::cout << "  help   - Show this help" << std::endl;
     } else {
@@ -52,6 +140,11 @@ int main(int argc, char* argv[]) {
      }
   }
   std::cout << "Server shutting down... " << std::endl;
+  server.stop();
+  if (capture.isOpen()) {
+    std::cout << "Captured " << capture.capturedMessages() << " messages" << std::endl;
+    capture.close();
+  }
   return 0;
 }
 